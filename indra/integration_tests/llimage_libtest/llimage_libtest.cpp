@@ -37,11 +37,16 @@
 #include "llimagebmp.h"
 #include "llimagetga.h"
 #include "llimagej2c.h"
+#include "llimageworker.h"
+#include "llimagekernels.h"
 #include "lldir.h"
 #include "lldiriterator.h"
+#include "llthreadpool.h"
+#include "lltracethreadrecorder.h"
 
 // system libraries
 #include <iostream>
+#include <vector>
 
 // doc string provided when invoking the program with --help 
 static const char USAGE[] = "\n"
@@ -91,6 +96,13 @@ static const char USAGE[] = "\n"
 "        Results in <metric>_report.csv\n"
 " -s, --image-stats\n"
 "        Output stats for each input and output image.\n"
+" -t, --threads <n>\n"
+"        Decode all j2c input files with 1 to n decode threads and report the throughput.\n"
+"        The discard level (see -d) is honored, output files are ignored.\n"
+" -k, --kernels <n>\n"
+"        Run the image scaling, compositing and mip kernels n times on every input image\n"
+"        with each instruction set the CPU supports and report their speed.\n"
+"        The discard level (see -d) is honored, output files are ignored.\n"
 "\n";
 
 // true when all image loading is done. Used by metric logging thread to know when to stop the thread.
@@ -307,6 +319,225 @@ void store_output_file(std::list<std::string> &output_filenames, std::list<std::
 	}
 }
 
+// Counts completed decodes and their latency for decode_throughput()
+class ThroughputResponder : public LLImageDecodeThread::Responder
+{
+public:
+	ThroughputResponder(LLAtomicS32& done, F64& latency, LLMutex& mutex)
+	:	mDone(done), mLatency(latency), mMutex(mutex), mStart(LLTimer::getTotalSeconds())
+	{
+	}
+
+	/*virtual*/ void completed(bool success, LLImageRaw* raw, LLImageRaw* aux)
+	{
+		if (!success)
+		{
+			std::cout << "Error: decode failed" << std::endl;
+		}
+		mMutex.lock();
+		mLatency += LLTimer::getTotalSeconds() - mStart;
+		mMutex.unlock();
+		mDone++;
+	}
+
+private:
+	LLAtomicS32& mDone;
+	F64& mLatency;
+	LLMutex& mMutex;
+	F64 mStart;
+};
+
+// Decode all j2c input files through an LLImageDecodeThread running on a pool of
+// 1 to max_threads threads and report images and megapixels decoded per second
+void decode_throughput(std::list<std::string> &input_filenames, int discard_level, int max_threads)
+{
+	// Load the compressed data once, reading the files is not what we are measuring
+	std::vector<LLPointer<LLImageFormatted> > images;
+	S64 pixels = 0;
+	std::list<std::string>::iterator in_file  = input_filenames.begin();
+	std::list<std::string>::iterator in_end = input_filenames.end();
+	for (; in_file != in_end; ++in_file)
+	{
+		LLPointer<LLImageFormatted> image = create_image(*in_file);
+		if (image.isNull() || (image->getCodec() != IMG_CODEC_J2C) || !image->load(*in_file))
+		{
+			std::cout << "Skipping " << *in_file << " : not a j2c image" << std::endl;
+			continue;
+		}
+		S32 discard = llmax(discard_level, 0);
+		pixels += (S64)(image->getWidth() >> discard) * (image->getHeight() >> discard);
+		images.push_back(image);
+	}
+	if (images.empty())
+	{
+		std::cout << "No j2c input file, no throughput to measure" << std::endl;
+		return;
+	}
+
+	std::cout << "Decoding " << images.size() << " images, " << (F64)pixels / 1000000.0 << " megapixels per pass" << std::endl;
+	std::cout << "threads, seconds, images/s, megapixels/s, mean latency (ms)" << std::endl;
+	for (int threads = 1; threads <= max_threads; ++threads)
+	{
+		LLThreadPool pool("llimage_libtest decode", threads);
+		LLImageJ2C::setThreadPool(&pool);
+		{
+			LLImageDecodeThread decoder(true, &pool);
+			LLAtomicS32 done(0);
+			F64 latency = 0.0;
+			LLMutex mutex(NULL);
+
+			LLTimer timer;
+			for (size_t i = 0; i < images.size(); ++i)
+			{
+				decoder.decodeImage(images[i], LLQueuedThread::PRIORITY_NORMAL, discard_level, FALSE,
+									new ThroughputResponder(done, latency, mutex));
+			}
+			while (done.CurrentValue() < (S32)images.size())
+			{
+				decoder.update(0.f);
+				ms_sleep(1);
+			}
+			F64 seconds = timer.getElapsedTimeF64();
+
+			std::cout << threads << ", " << seconds << ", "
+					  << (F64)images.size() / seconds << ", "
+					  << (F64)pixels / 1000000.0 / seconds << ", "
+					  << latency * 1000.0 / (F64)images.size() << std::endl;
+		}
+		LLImageJ2C::setThreadPool(NULL);
+	}
+}
+
+// Time each LLImageKernels function over all input images with every
+// instruction set, plain C++ being what LLImageRaw used before
+void kernel_benchmark(std::list<std::string> &input_filenames, int discard_level, int iterations)
+{
+	// Work on 3 and 4 channel copies of every image
+	std::vector<LLPointer<LLImageRaw> > rgb_images;
+	std::vector<LLPointer<LLImageRaw> > rgba_images;
+	S64 pixels = 0;
+	std::list<std::string>::iterator in_file  = input_filenames.begin();
+	std::list<std::string>::iterator in_end = input_filenames.end();
+	for (; in_file != in_end; ++in_file)
+	{
+		LLPointer<LLImageRaw> raw_image = load_image(*in_file, discard_level, NULL, 0, false);
+		if (raw_image.isNull() || raw_image->getWidth() < 2 || raw_image->getHeight() < 2)
+		{
+			std::cout << "Skipping " << *in_file << " : could not be loaded" << std::endl;
+			continue;
+		}
+		LLPointer<LLImageRaw> rgb = new LLImageRaw(raw_image->getWidth(), raw_image->getHeight(), 3);
+		LLPointer<LLImageRaw> rgba = new LLImageRaw(raw_image->getWidth(), raw_image->getHeight(), 4);
+		if (raw_image->getComponents() == 3 || raw_image->getComponents() == 4)
+		{
+			rgb->copy(raw_image);
+			rgba->copy(raw_image);
+		}
+		else
+		{
+			// Grey or grey and alpha, spread the first channel over all of them
+			const U8* src = raw_image->getData();
+			U8* dst = rgba->getData();
+			for (S32 i = 0; i < raw_image->getWidth() * raw_image->getHeight(); ++i)
+			{
+				dst[0] = dst[1] = dst[2] = dst[3] = src[0];
+				src += raw_image->getComponents();
+				dst += 4;
+			}
+			rgb->copy(rgba);
+		}
+		pixels += (S64)raw_image->getWidth() * raw_image->getHeight();
+		rgb_images.push_back(rgb);
+		rgba_images.push_back(rgba);
+	}
+	if (rgba_images.empty())
+	{
+		std::cout << "No input image, no kernel to time" << std::endl;
+		return;
+	}
+
+	static const char* kernel_names[] =
+	{
+		"mip rgba",
+		"mip rgb",
+		"scale rgba 3/4",
+		"scale rgb 3/4",
+		"copy rgba to rgb",
+		"copy rgb to rgba",
+		"composite rgba over rgb",
+		"composite scaled rgba over rgb 3/4"
+	};
+	const S32 kernel_count = sizeof(kernel_names) / sizeof(kernel_names[0]);
+
+	std::cout << iterations << " passes over " << rgba_images.size() << " images, "
+			  << (F64)pixels / 1000000.0 << " megapixels per pass" << std::endl;
+	std::cout << "kernel, instruction set, seconds, megapixels/s" << std::endl;
+
+	LLImageKernels::EInstructionSet saved_set = LLImageKernels::getInstructionSet();
+	std::vector<U8> out;
+	for (S32 kernel = 0; kernel < kernel_count; ++kernel)
+	{
+		for (S32 set = 0; set < LLImageKernels::IS_COUNT; ++set)
+		{
+			if (!LLImageKernels::setInstructionSet((LLImageKernels::EInstructionSet)set))
+			{
+				continue;
+			}
+
+			LLTimer timer;
+			for (int pass = 0; pass < iterations; ++pass)
+			{
+				for (size_t i = 0; i < rgba_images.size(); ++i)
+				{
+					LLImageRaw* rgb = rgb_images[i];
+					LLImageRaw* rgba = rgba_images[i];
+					const S32 width = rgba->getWidth();
+					const S32 height = rgba->getHeight();
+					const S32 scaled_width = llmax(width * 3 / 4, 1);
+					const S32 scaled_height = llmax(height * 3 / 4, 1);
+					out.resize(width * height * 4);
+					switch (kernel)
+					{
+					  case 0:
+						LLImageKernels::generateMip(rgba->getData(), &out[0], width / 2, height / 2, 4);
+						break;
+					  case 1:
+						LLImageKernels::generateMip(rgb->getData(), &out[0], width / 2, height / 2, 3);
+						break;
+					  case 2:
+						LLImageKernels::scale(rgba->getData(), width, height, &out[0], scaled_width, scaled_height, 4);
+						break;
+					  case 3:
+						LLImageKernels::scale(rgb->getData(), width, height, &out[0], scaled_width, scaled_height, 3);
+						break;
+					  case 4:
+						LLImageKernels::copy4onto3(rgba->getData(), &out[0], width * height);
+						break;
+					  case 5:
+						LLImageKernels::copy3onto4(rgb->getData(), &out[0], width * height);
+						break;
+					  case 6:
+						memcpy(&out[0], rgb->getData(), width * height * 3);	/* Flawfinder: ignore */
+						LLImageKernels::composite4onto3(rgba->getData(), &out[0], width * height);
+						break;
+					  default:
+						memcpy(&out[0], rgb->getData(), scaled_width * scaled_height * 3);	/* Flawfinder: ignore */
+						LLImageKernels::compositeScaled4onto3(rgba->getData(), width, height, &out[0], scaled_width, scaled_height);
+						break;
+					}
+				}
+			}
+			F64 seconds = timer.getElapsedTimeF64();
+
+			std::cout << kernel_names[kernel] << ", "
+					  << LLImageKernels::getInstructionSetName((LLImageKernels::EInstructionSet)set) << ", "
+					  << seconds << ", "
+					  << (F64)pixels * iterations / 1000000.0 / seconds << std::endl;
+		}
+	}
+	LLImageKernels::setInstructionSet(saved_set);
+}
+
 // Holds the metric gathering output in a thread safe way
 class LogThread : public LLThread
 {
@@ -350,10 +581,15 @@ int main(int argc, char** argv)
 	int blocks_size = -1;
 	int levels = 0;
 	bool reversible = false;
+	int decode_threads = 0;
+	int kernel_iterations = 0;
 
 	// Init whatever is necessary
 	ll_init_apr();
 	LLImage::initClass();
+	// Threads report their trace data to the main thread
+	LLTrace::ThreadRecorder* master_recorder = new LLTrace::ThreadRecorder();
+	LLTrace::set_master_thread_recorder(master_recorder);
 	LogThread* fast_timer_log_thread = NULL;	// For performance and metric gathering
 
 	// Analyze command line arguments
@@ -531,6 +767,38 @@ int main(int argc, char** argv)
 		{
 			image_stats = true;
 		}
+		else if (!strcmp(argv[arg], "--threads") || !strcmp(argv[arg], "-t"))
+		{
+			std::string value_str;
+			if ((arg + 1) < argc)
+			{
+				value_str = argv[arg+1];
+			}
+			if (((arg + 1) >= argc) || (value_str[0] == '-'))
+			{
+				std::cout << "No valid --threads argument given, throughput will not be measured" << std::endl;
+			}
+			else
+			{
+				decode_threads = llmax(atoi(value_str.c_str()), 1);
+			}
+		}
+		else if (!strcmp(argv[arg], "--kernels") || !strcmp(argv[arg], "-k"))
+		{
+			std::string value_str;
+			if ((arg + 1) < argc)
+			{
+				value_str = argv[arg+1];
+			}
+			if (((arg + 1) >= argc) || (value_str[0] == '-'))
+			{
+				std::cout << "No valid --kernels argument given, kernels will not be timed" << std::endl;
+			}
+			else
+			{
+				kernel_iterations = llmax(atoi(value_str.c_str()), 1);
+			}
+		}
 	}
 		
 	// Check arguments consistency. Exit with proper message if inconsistent.
@@ -554,6 +822,20 @@ int main(int argc, char** argv)
 		fast_timer_log_thread->start();
 	}
 	
+	// Measure decode throughput instead of converting if requested
+	if (decode_threads)
+	{
+		decode_throughput(input_filenames, discard_level, decode_threads);
+		output_filenames.clear();
+	}
+
+	// Time the image kernels if requested
+	if (kernel_iterations)
+	{
+		kernel_benchmark(input_filenames, discard_level, kernel_iterations);
+		output_filenames.clear();
+	}
+
 	// Perform action on each input file
 	std::list<std::string>::iterator in_file  = input_filenames.begin();
 	std::list<std::string>::iterator out_file = output_filenames.begin();
@@ -608,6 +890,8 @@ int main(int argc, char** argv)
 	{
 		fast_timer_log_thread->shutdown();
 	}
+	LLTrace::set_master_thread_recorder(NULL);
+	delete master_recorder;
 	
 	return 0;
 }
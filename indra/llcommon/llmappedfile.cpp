@@ -0,0 +1,387 @@
+/**
+ * @file llmappedfile.cpp
+ * @brief Cross-platform memory-mapped file.
+ *
+ * $LicenseInfo:firstyear=2014&license=viewerlgpl$
+ * Second Life Viewer Source Code
+ * Copyright (C) 2014, Linden Research, Inc.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation;
+ * version 2.1 of the License only.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ * Linden Research, Inc., 945 Battery Street, San Francisco, CA  94111  USA
+ * $/LicenseInfo$
+ */
+
+#include "linden_common.h"
+
+#include "llmappedfile.h"
+
+#if LL_WINDOWS
+#include "llwin32headerslean.h"
+#else
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <sys/mman.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <errno.h>
+#endif
+
+static size_t get_page_size()
+{
+	static size_t page_size = 0;
+	if (!page_size)
+	{
+#if LL_WINDOWS
+		SYSTEM_INFO info;
+		GetSystemInfo(&info);
+		// Views must start on an allocation granularity boundary, which is
+		// coarser than the page size.
+		page_size = info.dwAllocationGranularity;
+#else
+		page_size = (size_t)sysconf(_SC_PAGESIZE);
+#endif
+	}
+	return page_size;
+}
+
+#if LL_WINDOWS
+
+// Mirrors WIN32_MEMORY_RANGE_ENTRY, which older SDKs do not declare.
+struct memory_range_entry_t
+{
+	PVOID VirtualAddress;
+	SIZE_T NumberOfBytes;
+};
+typedef BOOL (WINAPI *prefetch_virtual_memory_t)(HANDLE, ULONG_PTR, memory_range_entry_t*, ULONG);
+
+class LLMappedFilePlatformImpl
+{
+public:
+	LLMappedFilePlatformImpl() : mFile(INVALID_HANDLE_VALUE), mMapping(NULL) {}
+
+	HANDLE mFile;
+	HANDLE mMapping;
+};
+
+bool LLMappedFile::open(const std::string& filename, size_t size, bool read_only)
+{
+	close();
+
+	mFilename = filename;
+	mReadOnly = read_only;
+
+	llutf16string utf16filename = utf8str_to_utf16str(filename);
+	mImpl->mFile = CreateFileW((LPCWSTR)utf16filename.c_str(),
+							   read_only ? GENERIC_READ : (GENERIC_READ | GENERIC_WRITE),
+							   FILE_SHARE_READ,
+							   NULL,
+							   read_only ? OPEN_EXISTING : OPEN_ALWAYS,
+							   FILE_ATTRIBUTE_NORMAL,
+							   NULL);
+	if (mImpl->mFile == INVALID_HANDLE_VALUE)
+	{
+		LL_WARNS() << "Unable to open " << filename << " for mapping: " << GetLastError() << LL_ENDL;
+		return false;
+	}
+
+	LARGE_INTEGER file_size;
+	GetFileSizeEx(mImpl->mFile, &file_size);
+	mSize = llmax(size, (size_t)file_size.QuadPart);
+
+	if (!map())
+	{
+		close();
+		return false;
+	}
+	return true;
+}
+
+bool LLMappedFile::map()
+{
+	if (!mSize)
+	{
+		// CreateFileMapping refuses empty files.
+		return false;
+	}
+
+	ULARGE_INTEGER map_size;
+	map_size.QuadPart = mSize;
+	mImpl->mMapping = CreateFileMappingW(mImpl->mFile, NULL,
+										 mReadOnly ? PAGE_READONLY : PAGE_READWRITE,
+										 map_size.HighPart, map_size.LowPart, NULL);
+	if (!mImpl->mMapping)
+	{
+		LL_WARNS() << "CreateFileMapping failed for " << mFilename << ": " << GetLastError() << LL_ENDL;
+		return false;
+	}
+
+	mData = (U8*)MapViewOfFile(mImpl->mMapping,
+							   mReadOnly ? FILE_MAP_READ : FILE_MAP_WRITE,
+							   0, 0, mSize);
+	if (!mData)
+	{
+		LL_WARNS() << "MapViewOfFile failed for " << mFilename << ": " << GetLastError() << LL_ENDL;
+		CloseHandle(mImpl->mMapping);
+		mImpl->mMapping = NULL;
+		return false;
+	}
+	return true;
+}
+
+void LLMappedFile::unmap()
+{
+	if (mData)
+	{
+		UnmapViewOfFile(mData);
+		mData = NULL;
+	}
+	if (mImpl->mMapping)
+	{
+		CloseHandle(mImpl->mMapping);
+		mImpl->mMapping = NULL;
+	}
+}
+
+void LLMappedFile::close()
+{
+	unmap();
+	if (mImpl->mFile != INVALID_HANDLE_VALUE)
+	{
+		CloseHandle(mImpl->mFile);
+		mImpl->mFile = INVALID_HANDLE_VALUE;
+	}
+	mSize = 0;
+}
+
+bool LLMappedFile::resize(size_t size)
+{
+	if (mImpl->mFile == INVALID_HANDLE_VALUE || mReadOnly)
+	{
+		return false;
+	}
+
+	unmap();
+
+	LARGE_INTEGER new_size;
+	new_size.QuadPart = size;
+	if (!SetFilePointerEx(mImpl->mFile, new_size, NULL, FILE_BEGIN) ||
+		!SetEndOfFile(mImpl->mFile))
+	{
+		LL_WARNS() << "Unable to resize " << mFilename << " to " << size << " bytes" << LL_ENDL;
+	}
+	else
+	{
+		mSize = size;
+	}
+	return map();
+}
+
+bool LLMappedFile::flush(size_t offset, size_t length, bool async)
+{
+	if (!mData || mReadOnly || offset >= mSize)
+	{
+		return false;
+	}
+	length = llmin(length, mSize - offset);
+
+	BOOL res = FlushViewOfFile(mData + offset, length);
+	if (res && !async)
+	{
+		res = FlushFileBuffers(mImpl->mFile);
+	}
+	return res ? true : false;
+}
+
+void LLMappedFile::prefetch(size_t offset, size_t length)
+{
+	if (!mData || offset >= mSize)
+	{
+		return;
+	}
+	length = llmin(length, mSize - offset);
+
+	// PrefetchVirtualMemory is Windows 8+ only, so look it up at run time.
+	// Touching the pages instead would block the caller until they are all
+	// read, so older systems just fault them in on first use.
+	static prefetch_virtual_memory_t prefetch_virtual_memory =
+		(prefetch_virtual_memory_t)GetProcAddress(GetModuleHandleA("kernel32.dll"), "PrefetchVirtualMemory");
+	if (prefetch_virtual_memory)
+	{
+		memory_range_entry_t range;
+		range.VirtualAddress = mData + offset;
+		range.NumberOfBytes = length;
+		prefetch_virtual_memory(GetCurrentProcess(), 1, &range, 0);
+	}
+}
+
+#else // !LL_WINDOWS
+
+class LLMappedFilePlatformImpl
+{
+public:
+	LLMappedFilePlatformImpl() : mFD(-1) {}
+
+	int mFD;
+};
+
+bool LLMappedFile::open(const std::string& filename, size_t size, bool read_only)
+{
+	close();
+
+	mFilename = filename;
+	mReadOnly = read_only;
+
+	mImpl->mFD = ::open(filename.c_str(), read_only ? O_RDONLY : (O_RDWR | O_CREAT), 0600);
+	if (mImpl->mFD == -1)
+	{
+		LL_WARNS() << "Unable to open " << filename << " for mapping: " << strerror(errno) << LL_ENDL;
+		return false;
+	}
+
+	struct stat file_info;
+	if (fstat(mImpl->mFD, &file_info) == -1)
+	{
+		close();
+		return false;
+	}
+
+	mSize = (size_t)file_info.st_size;
+	if (size > mSize)
+	{
+		if (read_only || ftruncate(mImpl->mFD, (off_t)size) == -1)
+		{
+			LL_WARNS() << "Unable to grow " << filename << " to " << size << " bytes" << LL_ENDL;
+			close();
+			return false;
+		}
+		mSize = size;
+	}
+
+	if (!map())
+	{
+		close();
+		return false;
+	}
+	return true;
+}
+
+bool LLMappedFile::map()
+{
+	if (!mSize)
+	{
+		// mmap refuses zero length mappings.
+		return false;
+	}
+
+	void* addr = ::mmap(NULL, mSize,
+						mReadOnly ? PROT_READ : (PROT_READ | PROT_WRITE),
+						MAP_SHARED, mImpl->mFD, 0);
+	if (addr == MAP_FAILED)
+	{
+		LL_WARNS() << "mmap failed for " << mFilename << ": " << strerror(errno) << LL_ENDL;
+		mData = NULL;
+		return false;
+	}
+	mData = (U8*)addr;
+	return true;
+}
+
+void LLMappedFile::unmap()
+{
+	if (mData)
+	{
+		::munmap(mData, mSize);
+		mData = NULL;
+	}
+}
+
+void LLMappedFile::close()
+{
+	unmap();
+	if (mImpl->mFD != -1)
+	{
+		::close(mImpl->mFD);
+		mImpl->mFD = -1;
+	}
+	mSize = 0;
+}
+
+bool LLMappedFile::resize(size_t size)
+{
+	if (mImpl->mFD == -1 || mReadOnly)
+	{
+		return false;
+	}
+
+	unmap();
+	if (ftruncate(mImpl->mFD, (off_t)size) == -1)
+	{
+		LL_WARNS() << "Unable to resize " << mFilename << " to " << size << " bytes" << LL_ENDL;
+	}
+	else
+	{
+		mSize = size;
+	}
+	return map();
+}
+
+bool LLMappedFile::flush(size_t offset, size_t length, bool async)
+{
+	if (!mData || mReadOnly || offset >= mSize)
+	{
+		return false;
+	}
+	length = llmin(length, mSize - offset);
+
+	// msync wants a page aligned start address.
+	size_t aligned = offset - (offset % get_page_size());
+	length += offset - aligned;
+	return ::msync(mData + aligned, length, async ? MS_ASYNC : MS_SYNC) == 0;
+}
+
+void LLMappedFile::prefetch(size_t offset, size_t length)
+{
+	if (!mData || offset >= mSize)
+	{
+		return;
+	}
+	length = llmin(length, mSize - offset);
+
+	size_t aligned = offset - (offset % get_page_size());
+	length += offset - aligned;
+	::madvise(mData + aligned, length, MADV_WILLNEED);
+}
+
+#endif // LL_WINDOWS
+
+LLMappedFile::LLMappedFile()
+:	mImpl(new LLMappedFilePlatformImpl),
+	mData(NULL),
+	mSize(0),
+	mReadOnly(false)
+{
+}
+
+LLMappedFile::~LLMappedFile()
+{
+	close();
+	delete mImpl;
+}
+
+bool LLMappedFile::flush(bool async)
+{
+	return flush(0, mSize, async);
+}
@@ -0,0 +1,85 @@
+/**
+ * @file llmappedfile.h
+ * @brief Cross-platform memory-mapped file.
+ *
+ * $LicenseInfo:firstyear=2014&license=viewerlgpl$
+ * Second Life Viewer Source Code
+ * Copyright (C) 2014, Linden Research, Inc.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation;
+ * version 2.1 of the License only.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ * Linden Research, Inc., 945 Battery Street, San Francisco, CA  94111  USA
+ * $/LicenseInfo$
+ */
+
+#ifndef LL_LLMAPPEDFILE_H
+#define LL_LLMAPPEDFILE_H
+
+#include <boost/noncopyable.hpp>
+
+class LLMappedFilePlatformImpl;
+
+/**
+ * Maps a whole file into the address space of the process.
+ *
+ * Writes through getData() land in the page cache and are written back by
+ * the OS; call flush() to force them out.  Pointers into the mapping are
+ * invalidated by resize() and close().
+ *
+ * The object itself is not thread safe.  Concurrent access to different
+ * ranges of the mapping is fine as long as nobody resizes or closes it.
+ */
+class LL_COMMON_API LLMappedFile : private boost::noncopyable
+{
+public:
+	LLMappedFile();
+	~LLMappedFile();
+
+	// Opens and maps filename.  If size is larger than the file, the file is
+	// grown (sparsely where the OS allows it) to size bytes.  Pass 0 to map
+	// the file at its current length.  Read-only files are never created.
+	bool open(const std::string& filename, size_t size, bool read_only);
+	void close();
+
+	// Grows or shrinks the file and remaps it.  The base address may change.
+	bool resize(size_t size);
+
+	// Write dirty pages back to disk.  If async is true, only schedules it.
+	bool flush(bool async = true);
+	bool flush(size_t offset, size_t length, bool async = true);
+
+	// Tells the OS we are about to touch this range, so it can read ahead.
+	void prefetch(size_t offset, size_t length);
+	void prefetch() { prefetch(0, mSize); }
+
+	bool isOpen() const						{ return mData != NULL; }
+	bool isReadOnly() const					{ return mReadOnly; }
+	U8* getData() const						{ return mData; }
+	size_t getSize() const					{ return mSize; }
+	const std::string& getFilename() const	{ return mFilename; }
+
+private:
+	bool map();
+	void unmap();
+
+private:
+	LLMappedFilePlatformImpl* mImpl;
+	std::string	mFilename;
+	U8*			mData;
+	size_t		mSize;
+	bool		mReadOnly;
+};
+
+#endif // LL_LLMAPPEDFILE_H
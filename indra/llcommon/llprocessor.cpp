@@ -135,7 +135,9 @@ namespace
 		eMONTIOR_MWAIT=33,
 		eCPLDebugStore=34,
 		eThermalMonitor2=35,
-		eAltivec=36
+		eAltivec=36,
+		eSSSE3_Features=37,
+		eSSE4_1_Features=38
 	};
 
 	const char* cpu_feature_names[] =
@@ -178,7 +180,9 @@ namespace
 		"CPL Qualified Debug Store",
 		"Thermal Monitor 2",
 
-		"Altivec"
+		"Altivec",
+		"SSSE3 New Instructions",
+		"SSE4.1 New Instructions"
 	};
 
 	std::string intel_CPUFamilyName(int composed_family) 
@@ -278,6 +282,16 @@ public:
 		return hasExtension("Altivec"); 
 	}
 
+	bool hasSSSE3() const
+	{
+		return hasExtension(cpu_feature_names[eSSSE3_Features]);
+	}
+
+	bool hasSSE41() const
+	{
+		return hasExtension(cpu_feature_names[eSSE4_1_Features]);
+	}
+
 	std::string getCPUFamilyName() const { return getInfo(eFamilyName, "Unknown").asString(); }
 	std::string getCPUBrandName() const { return getInfo(eBrandName, "Unknown").asString(); }
 
@@ -540,6 +554,16 @@ private:
 				{
 					setExtension(cpu_feature_names[eThermalMonitor2]);
 				}
+
+				if(cpu_info[2] & 0x200)
+				{
+					setExtension(cpu_feature_names[eSSSE3_Features]);
+				}
+
+				if(cpu_info[2] & 0x80000)
+				{
+					setExtension(cpu_feature_names[eSSE4_1_Features]);
+				}
 						
 				unsigned int feature_info = (unsigned int) cpu_info[3];
 				for(unsigned int index = 0, bit = 1; index < eSSE3_Features; ++index, bit <<= 1)
@@ -684,6 +708,17 @@ private:
 			}
 		}
 
+		// The upper half holds the ECX feature bits of CPUID 1
+		U32 ext_feature_info = (U32)(feature_info >> 32);
+		if(ext_feature_info & 0x200)
+		{
+			setExtension(cpu_feature_names[eSSSE3_Features]);
+		}
+		if(ext_feature_info & 0x80000)
+		{
+			setExtension(cpu_feature_names[eSSE4_1_Features]);
+		}
+
 		// *NOTE:Mani - I didn't find any docs that assure me that machdep.cpu.feature_bits will always be
 		// The feature bits I think it is. Here's a test:
 #ifndef LL_RELEASE_FOR_DOWNLOAD
@@ -824,6 +859,16 @@ private:
 		{
 			setExtension(cpu_feature_names[eSSE2_Ext]);
 		}
+
+		if( flags.find( " ssse3 " ) != std::string::npos )
+		{
+			setExtension(cpu_feature_names[eSSSE3_Features]);
+		}
+
+		if( flags.find( " sse4_1 " ) != std::string::npos )
+		{
+			setExtension(cpu_feature_names[eSSE4_1_Features]);
+		}
 	
 # endif // LL_X86
 	}
@@ -885,6 +930,8 @@ F64MegahertzImplicit LLProcessorInfo::getCPUFrequency() const { return mImpl->ge
 bool LLProcessorInfo::hasSSE() const { return mImpl->hasSSE(); }
 bool LLProcessorInfo::hasSSE2() const { return mImpl->hasSSE2(); }
 bool LLProcessorInfo::hasAltivec() const { return mImpl->hasAltivec(); }
+bool LLProcessorInfo::hasSSSE3() const { return mImpl->hasSSSE3(); }
+bool LLProcessorInfo::hasSSE41() const { return mImpl->hasSSE41(); }
 std::string LLProcessorInfo::getCPUFamilyName() const { return mImpl->getCPUFamilyName(); }
 std::string LLProcessorInfo::getCPUBrandName() const { return mImpl->getCPUBrandName(); }
 std::string LLProcessorInfo::getCPUFeatureDescription() const { return mImpl->getCPUFeatureDescription(); }
@@ -41,6 +41,8 @@ public:
 	bool hasSSE() const;
 	bool hasSSE2() const;
 	bool hasAltivec() const;
+	bool hasSSSE3() const;
+	bool hasSSE41() const;
 	std::string getCPUFamilyName() const;
 	std::string getCPUBrandName() const;
 	std::string getCPUFeatureDescription() const;
@@ -33,14 +33,24 @@
 //============================================================================
 
 // MAIN THREAD
-LLQueuedThread::LLQueuedThread(const std::string& name, bool threaded, bool should_pause) :
+LLQueuedThread::LLQueuedThread(const std::string& name, bool threaded, bool should_pause,
+							   LLThreadPool* pool, U32 pool_concurrency) :
 	LLThread(name),
 	mThreaded(threaded),
 	mIdleThread(TRUE),
+	mThreadPool(threaded ? pool : NULL),
+	mPoolConcurrency(llmax(pool_concurrency, 1U)),
+	mPoolTokens(0),
 	mNextHandle(0),
 	mStarted(FALSE)
 {
-	if (mThreaded)
+	if (mThreadPool)
+	{
+		// No thread of our own, but setQuitting() and addRequest() go by
+		// mStatus.  should_pause is moot, the pool only runs what is queued.
+		mStatus = RUNNING;
+	}
+	else if (mThreaded)
 	{
 		if(should_pause)
 		{
@@ -54,7 +64,7 @@ LLQueuedThread::LLQueuedThread(const std::string& name, bool threaded, bool shou
 // MAIN THREAD
 LLQueuedThread::~LLQueuedThread()
 {
-	if (!mThreaded)
+	if (!mThreaded || mThreadPool)
 	{
 		endThread();
 	}
@@ -67,7 +77,30 @@ void LLQueuedThread::shutdown()
 	setQuitting();
 
 	unpause(); // MAIN THREAD
-	if (mThreaded)
+	if (mThreadPool)
+	{
+		// Running requests finish, queued ones are aborted by the tokens
+		// now that we are quitting.
+		S32 timeout = 100;
+		for ( ; timeout>0; timeout--)
+		{
+			lockData();
+			bool done = (mPoolTokens == 0);
+			unlockData();
+			if (done)
+			{
+				break;
+			}
+			ms_sleep(100);
+			LLThread::yield();
+		}
+		if (timeout == 0)
+		{
+			LL_WARNS() << "~LLQueuedThread (" << mName << ") timed out waiting for the thread pool!" << LL_ENDL;
+		}
+		mStatus = STOPPED;
+	}
+	else if (mThreaded)
 	{
 		S32 timeout = 100;
 		for ( ; timeout>0; timeout--)
@@ -114,7 +147,7 @@ S32 LLQueuedThread::update(F32 max_time_ms)
 {
 	if (!mStarted)
 	{
-		if (!mThreaded)
+		if (!mThreaded || mThreadPool)
 		{
 			startThread();
 			mStarted = TRUE;
@@ -135,8 +168,15 @@ S32 LLQueuedThread::updateQueue(F32 max_time_ms)
 		pending = getPending();
 		if(pending > 0)
 		{
-		unpause();
-	}
+			if (mThreadPool)
+			{
+				kickThreadPool();
+			}
+			else
+			{
+				unpause();
+			}
+		}
 	}
 	else
 	{
@@ -153,7 +193,11 @@ S32 LLQueuedThread::updateQueue(F32 max_time_ms)
 void LLQueuedThread::incQueue()
 {
 	// Something has been added to the queue
-	if (!isPaused())
+	if (mThreadPool)
+	{
+		kickThreadPool();
+	}
+	else if (!isPaused())
 	{
 		if (mThreaded)
 		{
@@ -523,6 +567,78 @@ void LLQueuedThread::run()
 	LL_INFOS() << "LLQueuedThread " << mName << " EXITING." << LL_ENDL;
 }
 
+//============================================================================
+// Thread pool support
+
+//static
+LLThreadPool::EBand LLQueuedThread::getPoolBand(U32 priority)
+{
+	if (priority >= PRIORITY_URGENT)
+	{
+		return LLThreadPool::BAND_URGENT;
+	}
+	if (priority >= PRIORITY_HIGH)
+	{
+		return LLThreadPool::BAND_HIGH;
+	}
+	if (priority >= PRIORITY_NORMAL)
+	{
+		return LLThreadPool::BAND_NORMAL;
+	}
+	return LLThreadPool::BAND_LOW;
+}
+
+// May be called from any thread
+// Puts one token on the pool per queued request, up to mPoolConcurrency.
+void LLQueuedThread::kickThreadPool()
+{
+	lockData();
+	if (mStatus != RUNNING)
+	{
+		// shutdown() no longer waits for new tokens.
+		unlockData();
+		return;
+	}
+	U32 wanted = llmin(mPoolConcurrency, (U32)mRequestQueue.size());
+	while (mPoolTokens < wanted)
+	{
+		if (mPoolTokens++ == 0)
+		{
+			mIdleThread = FALSE;
+		}
+		U32 priority = (*mRequestQueue.begin())->getPriority();
+		mThreadPool->submit(new PoolToken(this), getPoolBand(priority));
+	}
+	unlockData();
+}
+
+// POOL THREAD
+void LLQueuedThread::runPoolToken(PoolToken* token)
+{
+	processNextRequest();
+
+	lockData();
+	U32 queued = (U32)mRequestQueue.size();
+	if (queued == 0 || mPoolTokens > queued)
+	{
+		// Nothing left for this token.  shutdown() may destroy us as soon
+		// as the count drops to zero and it gets the lock, so nothing of
+		// ours may be touched after unlockData().
+		if (--mPoolTokens == 0)
+		{
+			mIdleThread = TRUE;
+		}
+		unlockData();
+		delete token;
+		return;
+	}
+	// Go to the back of the band of the next request, so that other users
+	// of the pool get a turn.
+	U32 priority = (*mRequestQueue.begin())->getPriority();
+	mThreadPool->submit(token, getPoolBand(priority));
+	unlockData();
+}
+
 // virtual
 void LLQueuedThread::startThread()
 {
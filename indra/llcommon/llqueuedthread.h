@@ -35,11 +35,18 @@
 #include "llapr.h"
 
 #include "llthread.h"
+#include "llthreadpool.h"
 #include "llsimplehash.h"
 
 //============================================================================
 // Note: ~LLQueuedThread is O(N) N=# of queued threads, assumed to be small
 //   It is assumed that LLQueuedThreads are rarely created/destroyed.
+//
+// Passing an LLThreadPool to the constructor runs the requests on the pool
+// instead of a thread of our own, with up to pool_concurrency of them in
+// flight at once.  threadedUpdate() is not called in that mode.  Requests run
+// on whichever pool thread picks them up, so with a concurrency above 1 they
+// must not share unguarded state, getLocalAPRFilePool() included.
 
 class LL_COMMON_API LLQueuedThread : public LLThread
 {
@@ -149,7 +156,8 @@ public:
 	static handle_t nullHandle() { return handle_t(0); }
 	
 public:
-	LLQueuedThread(const std::string& name, bool threaded = true, bool should_pause = false);
+	LLQueuedThread(const std::string& name, bool threaded = true, bool should_pause = false,
+				   LLThreadPool* pool = NULL, U32 pool_concurrency = 1);
 	virtual ~LLQueuedThread();	
 	virtual void shutdown();
 	
@@ -158,6 +166,20 @@ private:
 	LLQueuedThread(const LLQueuedThread&);
 	LLQueuedThread& operator=(const LLQueuedThread&);
 
+	// Runs one request on the pool, then passes itself on or retires.
+	class PoolToken : public LLThreadPool::Task
+	{
+	public:
+		PoolToken(LLQueuedThread* owner) : mOwner(owner) {}
+		/*virtual*/ void run() { mOwner->runPoolToken(this); }
+	private:
+		LLQueuedThread* mOwner;
+	};
+
+	static LLThreadPool::EBand getPoolBand(U32 priority);
+	void kickThreadPool();
+	void runPoolToken(PoolToken* token);
+
 	virtual bool runCondition(void);
 	virtual void run(void);
 	virtual void startThread(void);
@@ -181,6 +203,7 @@ public:
 
 	virtual S32 getPending();
 	bool getThreaded() { return mThreaded ? true : false; }
+	bool usesThreadPool() const { return mThreadPool != NULL; }
 
 	// Request accessors
 	status_t getRequestStatus(handle_t handle);
@@ -199,6 +222,10 @@ protected:
 	BOOL mThreaded;  // if false, run on main thread and do updates during update()
 	BOOL mStarted;  // required when mThreaded is false to call startThread() from update()
 	LLAtomic32<BOOL> mIdleThread; // request queue is empty (or we are quitting) and the thread is idle
+
+	LLThreadPool* mThreadPool;	// if set, requests run on the pool instead of this thread
+	U32 mPoolConcurrency;
+	U32 mPoolTokens;			// tasks of ours on the pool, guarded by lockData()
 	
 	typedef std::set<QueuedRequest*, queued_request_less> request_queue_t;
 	request_queue_t mRequestQueue;
@@ -33,6 +33,7 @@
 #include "llerror.h"
 #include "../llmath/llmath.h"
 #include "llformat.h"
+#include "llsdarena.h"
 #include "llsdserialize.h"
 #include "stringize.h"
 
@@ -88,8 +89,14 @@ protected:
 	bool shared() const							{ return (mUseCount > 1) && (mUseCount != STATIC_USAGE_COUNT); }
 	
 	U32 mUseCount;
+	bool mInArena;
 
 public:
+	static void* operator new(size_t size);
+	static void operator delete(void* ptr);
+		///< Impls come out of the current LLSDArena of the thread if there
+		//	 is one, and from the heap otherwise
+	
 	static void reset(Impl*& var, Impl* impl);
 		///< safely set var to refer to the new impl (possibly shared)
 		
@@ -419,9 +426,16 @@ namespace
 		return (i != mData.end()) ? i->second : LLSD();
 	}
 	
+	// Keys of maps built in an arena are shared through the arena
+	inline const LLSD::String& internKey(const LLSD::String& k)
+	{
+		LLSDArena* arena = LLSDArena::getCurrent();
+		return arena ? arena->internKey(k) : k;
+	}
+
 	void ImplMap::insert(const LLSD::String& k, const LLSD& v)
 	{
-		mData.insert(DataMap::value_type(k, v));
+		mData.insert(DataMap::value_type(internKey(k), v));
 	}
 	
 	void ImplMap::erase(const LLSD::String& k)
@@ -431,7 +445,12 @@ namespace
 	
 	LLSD& ImplMap::ref(const LLSD::String& k)
 	{
-		return mData[k];
+		DataMap::iterator i = mData.lower_bound(k);
+		if (i == mData.end()  ||  mData.key_comp()(k, i->first))
+		{
+			i = mData.insert(i, DataMap::value_type(internKey(k), LLSD()));
+		}
+		return i->second;
 	}
 	
 	const LLSD& ImplMap::ref(const LLSD::String& k) const
@@ -625,12 +644,15 @@ namespace
 LLSD::Impl::Impl()
 	: mUseCount(0)
 {
+	LLSDArena* arena = LLSDArena::getCurrent();
+	mInArena = arena && arena->isLastAllocation(this);
 	++sAllocationCount;
 	++sOutstandingCount;
 }
 
 LLSD::Impl::Impl(StaticAllocationMarker)
-	: mUseCount(0)
+	: mUseCount(0),
+	  mInArena(false)
 {
 }
 
@@ -647,11 +669,39 @@ void LLSD::Impl::reset(Impl*& var, Impl* impl)
 	}
 	if (var  &&  var->mUseCount != STATIC_USAGE_COUNT && --var->mUseCount == 0)
 	{
-		delete var;
+		if (var->mInArena)
+		{
+			var->~Impl();
+			LLSDArena::release(var);
+		}
+		else
+		{
+			delete var;
+		}
 	}
 	var = impl;
 }
 
+void* LLSD::Impl::operator new(size_t size)
+{
+	LLSDArena* arena = LLSDArena::getCurrent();
+	return arena ? arena->allocate(size) : ::operator new(size);
+}
+
+void LLSD::Impl::operator delete(void* ptr)
+{
+	// Heap Impls, and an arena Impl whose constructor threw
+	LLSDArena* arena = LLSDArena::getCurrent();
+	if (arena && arena->isLastAllocation(ptr))
+	{
+		LLSDArena::release(ptr);
+	}
+	else
+	{
+		::operator delete(ptr);
+	}
+}
+
 LLSD::Impl& LLSD::Impl::safe(Impl* impl)
 {
 	static Impl theUndefined(STATIC_USAGE_COUNT);
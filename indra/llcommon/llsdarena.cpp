@@ -0,0 +1,168 @@
+/**
+ * @file llsdarena.cpp
+ * @brief Block allocator for the values of large, short lived LLSD documents.
+ *
+ * $LicenseInfo:firstyear=2014&license=viewerlgpl$
+ * Second Life Viewer Source Code
+ * Copyright (C) 2014, Linden Research, Inc.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation;
+ * version 2.1 of the License only.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ * Linden Research, Inc., 945 Battery Street, San Francisco, CA  94111  USA
+ * $/LicenseInfo$
+ */
+
+#include "linden_common.h"
+
+#include "llsdarena.h"
+
+#include "llapr.h"
+#include "llthreadlocalstorage.h"
+
+// Copies of a std::string share one buffer with the reference counted
+// strings of the older gcc runtime, so handing out copies of one key costs
+// a single allocation per distinct key. Everywhere else a copy allocates
+// anyway, or not at all for keys short enough for the string itself, and
+// keeping a table of keys would only add a lookup.
+#if defined(__GLIBCXX__) && !(defined(_GLIBCXX_USE_CXX11_ABI) && _GLIBCXX_USE_CXX11_ABI)
+#define LL_SHARED_STRING_COPIES 1
+#else
+#define LL_SHARED_STRING_COPIES 0
+#endif
+
+// Ahead of every allocation, keeps what follows aligned for a double.
+union LLSDArena::Prefix
+{
+	Block* mBlock;
+	F64 mAlign;
+};
+
+struct LLSDArena::Block
+{
+	// Allocations in the block, plus one while the arena still fills it
+	LLAtomicS32 mLive;
+	U32 mUsed;
+	U32 mSize;
+};
+
+const U32 LLSDArena::sBlockHeaderSize = (sizeof(Block) + sizeof(Prefix) - 1) & ~(sizeof(Prefix) - 1);
+
+static LLAtomicS32 sLiveBlocks;
+
+LLSDArena::Scope::Scope(LLSDArena& arena)
+:	mPrevious(LLThreadLocalSingletonPointer<LLSDArena>::getInstance())
+{
+	LLThreadLocalSingletonPointer<LLSDArena>::setInstance(&arena);
+}
+
+LLSDArena::Scope::~Scope()
+{
+	LLThreadLocalSingletonPointer<LLSDArena>::setInstance(mPrevious);
+}
+
+LLSDArena::LLSDArena(U32 block_size)
+:	mBlock(NULL),
+	mLastAllocation(NULL),
+	mBlockSize(block_size),
+	mBlockCount(0),
+	mAllocationCount(0)
+{
+}
+
+LLSDArena::~LLSDArena()
+{
+	llassert(getCurrent() != this);
+	retireBlock();
+}
+
+// static
+LLSDArena* LLSDArena::getCurrent()
+{
+	return LLThreadLocalSingletonPointer<LLSDArena>::getInstance();
+}
+
+// static
+S32 LLSDArena::getLiveBlockCount()
+{
+	return sLiveBlocks.CurrentValue();
+}
+
+void* LLSDArena::allocate(size_t size)
+{
+	U32 needed = (U32)((sizeof(Prefix) + size + sizeof(Prefix) - 1) & ~(sizeof(Prefix) - 1));
+	if (!mBlock || mBlock->mUsed + needed > mBlock->mSize)
+	{
+		retireBlock();
+
+		U32 block_size = llmax(mBlockSize, sBlockHeaderSize + needed);
+		void* memory = malloc(block_size);
+		if (!memory)
+		{
+			LL_ERRS() << "Out of memory allocating an LLSD arena block of " << block_size << " bytes" << LL_ENDL;
+		}
+		mBlock = new (memory) Block;
+		mBlock->mLive = 1;
+		mBlock->mUsed = sBlockHeaderSize;
+		mBlock->mSize = block_size;
+		++mBlockCount;
+		sLiveBlocks++;
+	}
+
+	Prefix* prefix = (Prefix*)((U8*)mBlock + mBlock->mUsed);
+	prefix->mBlock = mBlock;
+	mBlock->mUsed += needed;
+	mBlock->mLive++;
+	++mAllocationCount;
+
+	mLastAllocation = prefix + 1;
+	return mLastAllocation;
+}
+
+// static
+void LLSDArena::release(void* ptr)
+{
+	Block* block = ((Prefix*)ptr - 1)->mBlock;
+	if (--block->mLive == 0)
+	{
+		block->~Block();
+		free(block);
+		sLiveBlocks--;
+	}
+}
+
+void LLSDArena::retireBlock()
+{
+	if (mBlock)
+	{
+		// The last value released frees the block if some are still alive
+		if (--mBlock->mLive == 0)
+		{
+			mBlock->~Block();
+			free(mBlock);
+			sLiveBlocks--;
+		}
+		mBlock = NULL;
+		mLastAllocation = NULL;
+	}
+}
+
+const std::string& LLSDArena::internKey(const std::string& key)
+{
+#if LL_SHARED_STRING_COPIES
+	return *mKeys.insert(key).first;
+#else
+	return key;
+#endif
+}
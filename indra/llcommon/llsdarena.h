@@ -0,0 +1,109 @@
+/**
+ * @file llsdarena.h
+ * @brief Block allocator for the values of large, short lived LLSD documents.
+ *
+ * $LicenseInfo:firstyear=2014&license=viewerlgpl$
+ * Second Life Viewer Source Code
+ * Copyright (C) 2014, Linden Research, Inc.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation;
+ * version 2.1 of the License only.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ * Linden Research, Inc., 945 Battery Street, San Francisco, CA  94111  USA
+ * $/LicenseInfo$
+ */
+
+#ifndef LL_LLSDARENA_H
+#define LL_LLSDARENA_H
+
+#include <set>
+#include <string>
+
+/**
+ * Parsing a big document such as an inventory cache or a mesh block makes
+ * one small heap allocation per value. While an arena is current on a
+ * thread, every LLSD value created on that thread is carved out of large
+ * blocks of the arena instead, and map keys are shared between all maps of
+ * the document.
+ *
+ * Values still count their references as usual and may be copied, kept and
+ * released on any thread. A block goes back to the heap in one piece as
+ * soon as the arena is done with it and the last value in it is released,
+ * so an arena suits documents that are parsed, used and dropped together:
+ * a single value kept from it keeps its whole block.
+ *
+ * An arena allocates for one thread at a time.
+ *
+ * @code
+ *	LLSDArena arena;
+ *	LLSD doc;
+ *	{
+ *		LLSDArena::Scope scope(arena);
+ *		LLSDSerialize::fromBinary(doc, data, size);
+ *	}
+ * @endcode
+ */
+class LL_COMMON_API LLSDArena
+{
+public:
+	enum { DEFAULT_BLOCK_SIZE = 64 * 1024 };
+
+	// Makes an arena current on the calling thread, scopes nest.
+	class LL_COMMON_API Scope
+	{
+	public:
+		Scope(LLSDArena& arena);
+		~Scope();
+
+	private:
+		LLSDArena* mPrevious;
+	};
+
+	LLSDArena(U32 block_size = DEFAULT_BLOCK_SIZE);
+	~LLSDArena();
+
+	// The arena of the calling thread, NULL if there is none.
+	static LLSDArena* getCurrent();
+
+	// Memory for one value, never NULL.
+	void* allocate(size_t size);
+	// Gives back memory from allocate() of any arena, on any thread.
+	static void release(void* ptr);
+	// True for the memory handed out by the last call to allocate().
+	bool isLastAllocation(const void* ptr) const { return ptr == mLastAllocation; }
+
+	// The copy of a map key kept by this arena, see llsdarena.cpp.
+	const std::string& internKey(const std::string& key);
+
+	U32 getBlockCount() const { return mBlockCount; }
+	U32 getAllocationCount() const { return mAllocationCount; }
+	// Blocks of every arena that have not gone back to the heap yet.
+	static S32 getLiveBlockCount();
+
+private:
+	struct Block;
+	union Prefix;
+	static const U32 sBlockHeaderSize;
+
+	void retireBlock();
+
+	Block* mBlock;
+	void* mLastAllocation;
+	U32 mBlockSize;
+	U32 mBlockCount;
+	U32 mAllocationCount;
+	std::set<std::string> mKeys;
+};
+
+#endif // LL_LLSDARENA_H
@@ -1211,6 +1211,481 @@ bool LLSDBinaryParser::parseString(
 }
 
 
+/**
+ * LLSDBinaryReader
+ */
+LLSDBinaryReader::LLSDBinaryReader(const U8* data, size_t size) :
+	mBegin(data),
+	mPos(data),
+	mEnd(data + size),
+	mStarted(false),
+	mToken(TOKEN_END),
+	mBoolean(false),
+	mInteger(0),
+	mReal(0.0),
+	mStringData(NULL),
+	mStringSize(0),
+	mSize(0)
+{
+	memset(mUUID, 0, UUID_BYTES);
+	// Deep enough for any mesh or inventory payload without growing.
+	mStack.reserve(16);
+}
+
+LLUUID LLSDBinaryReader::getUUID() const
+{
+	LLUUID id;
+	memcpy(id.mData, mUUID, UUID_BYTES);		/* Flawfinder: ignore */
+	return id;
+}
+
+LLDate LLSDBinaryReader::getDate() const
+{
+	return LLDate(mReal);
+}
+
+bool LLSDBinaryReader::isString(const char* str) const
+{
+	size_t len = strlen(str);		/* Flawfinder: ignore */
+	return (len == mStringSize) && !memcmp(str, mStringData, len);
+}
+
+LLSDBinaryReader::EToken LLSDBinaryReader::fail()
+{
+	mToken = TOKEN_ERROR;
+	mStringData = NULL;
+	mStringSize = 0;
+	return mToken;
+}
+
+bool LLSDBinaryReader::readBytes(void* dest, size_t size)
+{
+	if ((size_t)(mEnd - mPos) < size)
+	{
+		return false;
+	}
+	memcpy(dest, mPos, size);		/* Flawfinder: ignore */
+	mPos += size;
+	return true;
+}
+
+// Reads a 4 byte size and checks that many bytes follow
+bool LLSDBinaryReader::readSized(size_t& size)
+{
+	U32 size_nbo = 0;
+	if (!readBytes(&size_nbo, sizeof(U32)))
+	{
+		return false;
+	}
+	S32 value = (S32)ntohl(size_nbo);
+	if (value < 0 || (size_t)(mEnd - mPos) < (size_t)value)
+	{
+		return false;
+	}
+	size = (size_t)value;
+	return true;
+}
+
+// Notation style string, see deserialize_string_delim(). Only strings with
+// escapes get copied.
+bool LLSDBinaryReader::readQuoted(char delim)
+{
+	const char* start = (const char*)mPos;
+	const char* end = (const char*)mEnd;
+	const char* p = start;
+	while (p < end && *p != delim && *p != '\\')
+	{
+		++p;
+	}
+	if (p == end)
+	{
+		return false;
+	}
+	if (*p == delim)
+	{
+		mStringData = start;
+		mStringSize = p - start;
+		mPos = (const U8*)(p + 1);
+		return true;
+	}
+
+	mUnescaped.assign(start, p);
+	while (p < end)
+	{
+		char c = *p++;
+		if (c == delim)
+		{
+			mStringData = mUnescaped.data();
+			mStringSize = mUnescaped.size();
+			mPos = (const U8*)p;
+			return true;
+		}
+		if (c != '\\')
+		{
+			mUnescaped += c;
+			continue;
+		}
+		if (p == end)
+		{
+			break;
+		}
+		c = *p++;
+		switch (c)
+		{
+		case 'a': mUnescaped += '\a'; break;
+		case 'b': mUnescaped += '\b'; break;
+		case 'f': mUnescaped += '\f'; break;
+		case 'n': mUnescaped += '\n'; break;
+		case 'r': mUnescaped += '\r'; break;
+		case 't': mUnescaped += '\t'; break;
+		case 'v': mUnescaped += '\v'; break;
+		case 'x':
+			if (end - p < 2)
+			{
+				return false;
+			}
+			mUnescaped += (char)((hex_as_nybble(p[0]) << 4) | hex_as_nybble(p[1]));
+			p += 2;
+			break;
+		default:
+			mUnescaped += c;
+			break;
+		}
+	}
+	return false;
+}
+
+LLSDBinaryReader::EToken LLSDBinaryReader::next()
+{
+	if (mToken == TOKEN_ERROR)
+	{
+		return mToken;
+	}
+	if (mStack.empty())
+	{
+		if (mStarted || mPos == mEnd)
+		{
+			mToken = TOKEN_END;
+			return mToken;
+		}
+		mStarted = true;
+		return readToken();
+	}
+
+	Frame& frame = mStack.back();
+	if (frame.mIsMap && frame.mExpectKey)
+	{
+		if (mPos == mEnd)
+		{
+			return fail();
+		}
+		char c = (char)*mPos++;
+		if (!frame.mRemaining)
+		{
+			// Exactly as many keys as announced.
+			if (c != '}')
+			{
+				return fail();
+			}
+			mStack.pop_back();
+			mToken = TOKEN_MAP_END;
+			return mToken;
+		}
+		switch (c)
+		{
+		case 'k':
+			if (!readSized(mStringSize))
+			{
+				return fail();
+			}
+			mStringData = (const char*)mPos;
+			mPos += mStringSize;
+			break;
+		case '\'':
+		case '"':
+			if (!readQuoted(c))
+			{
+				return fail();
+			}
+			break;
+		default:
+			return fail();
+		}
+		frame.mExpectKey = false;
+		--frame.mRemaining;
+		mToken = TOKEN_MAP_KEY;
+		return mToken;
+	}
+
+	if (frame.mIsMap)
+	{
+		frame.mExpectKey = true;
+	}
+	else if (!frame.mRemaining)
+	{
+		if (mPos == mEnd || *mPos != ']')
+		{
+			return fail();
+		}
+		++mPos;
+		mStack.pop_back();
+		mToken = TOKEN_ARRAY_END;
+		return mToken;
+	}
+	else
+	{
+		--frame.mRemaining;
+	}
+	return readToken();
+}
+
+// Reads a value, see LLSDBinaryParser::doParse() for the format.
+LLSDBinaryReader::EToken LLSDBinaryReader::readToken()
+{
+	if (mPos == mEnd)
+	{
+		return fail();
+	}
+	char c = (char)*mPos++;
+	switch (c)
+	{
+	case '{':
+	case '[':
+	{
+		U32 size_nbo = 0;
+		if (!readBytes(&size_nbo, sizeof(U32)))
+		{
+			return fail();
+		}
+		mSize = (S32)ntohl(size_nbo);
+		if (mSize < 0)
+		{
+			return fail();
+		}
+		Frame frame;
+		frame.mIsMap = (c == '{');
+		frame.mExpectKey = true;
+		frame.mRemaining = mSize;
+		mStack.push_back(frame);
+		mToken = frame.mIsMap ? TOKEN_MAP_BEGIN : TOKEN_ARRAY_BEGIN;
+		return mToken;
+	}
+
+	case '!':
+		mToken = TOKEN_UNDEFINED;
+		return mToken;
+
+	case '0':
+	case '1':
+		mBoolean = (c == '1');
+		mToken = TOKEN_BOOLEAN;
+		return mToken;
+
+	case 'i':
+	{
+		U32 value_nbo = 0;
+		if (!readBytes(&value_nbo, sizeof(U32)))
+		{
+			return fail();
+		}
+		mInteger = (S32)ntohl(value_nbo);
+		mToken = TOKEN_INTEGER;
+		return mToken;
+	}
+
+	case 'r':
+	{
+		F64 real_nbo = 0.0;
+		if (!readBytes(&real_nbo, sizeof(F64)))
+		{
+			return fail();
+		}
+		mReal = ll_ntohd(real_nbo);
+		mToken = TOKEN_REAL;
+		return mToken;
+	}
+
+	case 'd':
+		// Dates are written in host order.
+		if (!readBytes(&mReal, sizeof(F64)))
+		{
+			return fail();
+		}
+		mToken = TOKEN_DATE;
+		return mToken;
+
+	case 'u':
+		if (!readBytes(mUUID, UUID_BYTES))
+		{
+			return fail();
+		}
+		mToken = TOKEN_UUID;
+		return mToken;
+
+	case '\'':
+	case '"':
+		if (!readQuoted(c))
+		{
+			return fail();
+		}
+		mToken = TOKEN_STRING;
+		return mToken;
+
+	case 's':
+	case 'l':
+	case 'b':
+		if (!readSized(mStringSize))
+		{
+			return fail();
+		}
+		mStringData = (const char*)mPos;
+		mPos += mStringSize;
+		mToken = (c == 's') ? TOKEN_STRING : ((c == 'l') ? TOKEN_URI : TOKEN_BINARY);
+		return mToken;
+
+	default:
+		LL_INFOS() << "Unrecognized character while parsing: int(" << (int)c
+			<< ")" << LL_ENDL;
+		return fail();
+	}
+}
+
+bool LLSDBinaryReader::skipValue()
+{
+	S32 depth = getDepth();
+	if (mToken == TOKEN_MAP_KEY)
+	{
+		EToken token = next();
+		if (token != TOKEN_MAP_BEGIN && token != TOKEN_ARRAY_BEGIN)
+		{
+			return token != TOKEN_ERROR;
+		}
+	}
+	else if (mToken == TOKEN_MAP_BEGIN || mToken == TOKEN_ARRAY_BEGIN)
+	{
+		--depth;
+	}
+	else
+	{
+		return mToken != TOKEN_ERROR;
+	}
+
+	while (getDepth() > depth)
+	{
+		if (next() == TOKEN_ERROR)
+		{
+			return false;
+		}
+	}
+	return true;
+}
+
+S32 LLSDBinaryReader::readValue(LLSD& data)
+{
+	EToken token = next();
+	if (token == TOKEN_END)
+	{
+		data.clear();
+		return 0;
+	}
+	S32 parse_count = buildValue(data);
+	if (parse_count == LLSDParser::PARSE_FAILURE)
+	{
+		data.clear();
+	}
+	return parse_count;
+}
+
+// Builds LLSD from the current token
+S32 LLSDBinaryReader::buildValue(LLSD& data)
+{
+	switch (mToken)
+	{
+	case TOKEN_UNDEFINED:
+		data.clear();
+		return 1;
+	case TOKEN_BOOLEAN:
+		data = mBoolean;
+		return 1;
+	case TOKEN_INTEGER:
+		data = mInteger;
+		return 1;
+	case TOKEN_REAL:
+		data = mReal;
+		return 1;
+	case TOKEN_DATE:
+		data = getDate();
+		return 1;
+	case TOKEN_UUID:
+		data = getUUID();
+		return 1;
+	case TOKEN_STRING:
+		data = getString();
+		return 1;
+	case TOKEN_URI:
+		data = LLURI(getString());
+		return 1;
+	case TOKEN_BINARY:
+	{
+		LLSD::Binary value((const U8*)mStringData, (const U8*)mStringData + mStringSize);
+		data = value;
+		return 1;
+	}
+
+	case TOKEN_MAP_BEGIN:
+	{
+		data = LLSD::emptyMap();
+		S32 parse_count = 1;
+		std::string key;
+		while (next() == TOKEN_MAP_KEY)
+		{
+			key.assign(mStringData, mStringSize);
+			LLSD child;
+			next();
+			S32 child_count = buildValue(child);
+			if (child_count == LLSDParser::PARSE_FAILURE)
+			{
+				return LLSDParser::PARSE_FAILURE;
+			}
+			parse_count += child_count;
+			data.insert(key, child);
+		}
+		return (mToken == TOKEN_MAP_END) ? parse_count : LLSDParser::PARSE_FAILURE;
+	}
+
+	case TOKEN_ARRAY_BEGIN:
+	{
+		data = LLSD::emptyArray();
+		S32 parse_count = 1;
+		if (mSize > 0 && (size_t)mSize <= (size_t)(mEnd - mPos))
+		{
+			// Every element takes at least a byte, so a size that fits in
+			// the rest of the buffer is safe to allocate up front.
+			data[mSize - 1] = LLSD();
+		}
+		for (S32 i = 0; next() != TOKEN_ARRAY_END; ++i)
+		{
+			if (mToken == TOKEN_ERROR)
+			{
+				return LLSDParser::PARSE_FAILURE;
+			}
+			// Built in place, the array does not grow any more.
+			S32 child_count = buildValue(data[i]);
+			if (child_count == LLSDParser::PARSE_FAILURE)
+			{
+				return LLSDParser::PARSE_FAILURE;
+			}
+			parse_count += child_count;
+		}
+		return parse_count;
+	}
+
+	default:
+		return LLSDParser::PARSE_FAILURE;
+	}
+}
+
+
 /**
  * LLSDFormatter
  */
@@ -2081,43 +2556,81 @@ std::string zip_llsd(LLSD& data)
 }
 
 //decompress a block of LLSD from provided istream
-// not very efficient -- creats a copy of decompressed LLSD block in memory
-// and deserializes from that copy using LLSDSerialize
 bool unzip_llsd(LLSD& data, std::istream& is, S32 size)
 {
-	U8* result = NULL;
-	U32 cur_size = 0;
-	z_stream strm;
-		
-	const U32 CHUNK = 65536;
+	if (size <= 0)
+	{
+		return false;
+	}
+	std::vector<U8> in(size);
+	is.read((char*) &in[0], size);
+	return unzip_llsd(data, &in[0], (S32)is.gcount());
+}
 
-	U8 *in = new U8[size];
-	is.read((char*) in, size); 
+//decompress a block of LLSD from memory, the decompressed block is parsed
+//in place without any further copies
+bool unzip_llsd(LLSD& data, const U8* in, S32 size)
+{
+	if (!in || size <= 0)
+	{
+		return false;
+	}
 
-	U8 out[CHUNK];
-		
+	// Mesh and inventory blocks typically inflate to a few times their size,
+	// so start there and double as needed.
+	U32 capacity = llmax((U32)size * 4, (U32)65536);
+	U8* result = (U8*) malloc(capacity);
+	if (!result)
+	{
+		LL_WARNS() << "Unzip error: out of memory, needed " << capacity << " bytes" << LL_ENDL;
+		return false;
+	}
+	U32 cur_size = 0;
+
+	z_stream strm;
 	strm.zalloc = Z_NULL;
 	strm.zfree = Z_NULL;
 	strm.opaque = Z_NULL;
 	strm.avail_in = size;
-	strm.next_in = in;
+	strm.next_in = (Bytef*) in;
 
 	S32 ret = inflateInit(&strm);
-	
+	if (ret != Z_OK)
+	{
+		LL_DEBUGS() << "Unzip error: " << ret << LL_ENDL;	// <FS>
+		free(result);
+		return false;
+	}
+
 	do
 	{
-		strm.avail_out = CHUNK;
-		strm.next_out = out;
+		if (cur_size == capacity)
+		{
+			// <FS:ND> Make sure to properly handle out of memory situations
+			U8* pNew = (U8*) realloc(result, capacity * 2);
+			if (!pNew)
+			{
+				LL_WARNS() << "Unzip error: out of memory, needed " << capacity * 2 << " bytes" << LL_ENDL;
+				inflateEnd(&strm);
+				free(result);
+				return false;
+			}
+			result = pNew;
+			capacity *= 2;
+			// </FS:ND>
+		}
+
+		strm.avail_out = capacity - cur_size;
+		strm.next_out = result + cur_size;
 		ret = inflate(&strm, Z_NO_FLUSH);
 		if (ret == Z_STREAM_ERROR)
 		{
 			LL_DEBUGS() << "Unzip error: Z_STREAM_ERROR" << LL_ENDL;	// <FS>
 			inflateEnd(&strm);
 			free(result);
-			delete [] in;
 			return false;
 		}
-		
+
 		switch (ret)
 		{
 		case Z_NEED_DICT:
@@ -2127,35 +2640,14 @@ bool unzip_llsd(LLSD& data, std::istream& is, S32 size)
 			LL_DEBUGS() << "Unzip error: " << ret << LL_ENDL;	// <FS>
 			inflateEnd(&strm);
 			free(result);
-			delete [] in;
 			return false;
 			break;
 		}
 
-		U32 have = CHUNK-strm.avail_out;
-		
-		// <FS:ND> Make sure to properly handle out of memory situations
-
-		// result = (U8*) realloc(result, cur_size + have);
-		U8 *pNew = (U8*) realloc(result, cur_size + have);
-		if( !pNew )
-		{
-			free( result );
-			LL_WARNS() << "Unzip error: out of memory, needed " << cur_size+have << " bytes" << LL_ENDL;
-			return  false;
-		}
-		
-		result = pNew;
-
-		// </FS:ND>
-
-		memcpy(result+cur_size, out, have);
-		cur_size += have;
-
+		cur_size = capacity - strm.avail_out;
 	} while (ret == Z_OK);
 
 	inflateEnd(&strm);
-	delete [] in;
 
 	if (ret != Z_STREAM_END)
 	{
@@ -2165,25 +2657,24 @@ bool unzip_llsd(LLSD& data, std::istream& is, S32 size)
 	}
 
 	//result now points to the decompressed LLSD block
-	{
-		std::string res_str((char*) result, cur_size);
-
-		std::string deprecated_header("<? LLSD/Binary ?>");
+	const U8* start = result;
+	U32 start_size = cur_size;
 
-		if (res_str.substr(0, deprecated_header.size()) == deprecated_header)
-		{
-			res_str = res_str.substr(deprecated_header.size()+1, cur_size);
-		}
-		cur_size = res_str.size();
+	static const char deprecated_header[] = "<? LLSD/Binary ?>";
+	const U32 header_size = sizeof(deprecated_header) - 1;
+	if (cur_size > header_size && !memcmp(result, deprecated_header, header_size))
+	{
+		// Skip the header and the newline after it
+		start += header_size + 1;
+		start_size -= header_size + 1;
+	}
 
-		std::istringstream istr(res_str);
-		
-		if (!LLSDSerialize::fromBinary(data, istr, cur_size))
-		{
-			LL_DEBUGS() << "Failed to unzip LLSD block" << LL_ENDL;
-			free(result);
-			return false;
-		}		
+	LLSDBinaryReader reader(start, start_size);
+	if (reader.readValue(data) <= 0)
+	{
+		LL_DEBUGS() << "Failed to unzip LLSD block" << LL_ENDL;
+		free(result);
+		return false;
 	}
 
 	free(result);
@@ -396,6 +396,138 @@ private:
 	bool parseString(std::istream& istr, std::string& value) const;
 };
 
+/**
+ * @class LLSDBinaryReader
+ * @brief Pull parser for binary LLSD held in one contiguous buffer.
+ *
+ * Reads the same format as LLSDBinaryParser, but straight from memory
+ * and one token at a time, so a caller can look at keys and values and
+ * skip what it does not need without building any LLSD. Strings, URIs,
+ * binaries and map keys are handed out as spans of the buffer, nothing
+ * is allocated per token. readValue() builds LLSD for the parts that
+ * are wanted.
+ *
+ * The buffer must outlive the reader.
+ */
+class LL_COMMON_API LLSDBinaryReader
+{
+public:
+	enum EToken
+	{
+		TOKEN_ERROR = -1,	// malformed or truncated, every further call fails too
+		TOKEN_END = 0,		// the top level value has been read
+		TOKEN_UNDEFINED,
+		TOKEN_BOOLEAN,
+		TOKEN_INTEGER,
+		TOKEN_REAL,
+		TOKEN_UUID,
+		TOKEN_STRING,
+		TOKEN_DATE,
+		TOKEN_URI,
+		TOKEN_BINARY,
+		TOKEN_MAP_BEGIN,
+		TOKEN_MAP_KEY,		// always followed by the value of that key
+		TOKEN_MAP_END,
+		TOKEN_ARRAY_BEGIN,
+		TOKEN_ARRAY_END
+	};
+
+	LLSDBinaryReader(const U8* data, size_t size);
+
+	/**
+	 * @brief Moves to the next token.
+	 */
+	EToken next();
+	EToken getToken() const { return mToken; }
+
+	/**
+	 * @brief Values of the current token, only meaningful for its type.
+	 */
+	bool getBoolean() const { return mBoolean; }
+	S32 getInteger() const { return mInteger; }
+	F64 getReal() const { return mReal; }
+	LLUUID getUUID() const;
+	LLDate getDate() const;
+
+	/**
+	 * @brief Bytes of a string, URI, binary or map key.
+	 *
+	 * Points into the buffer, except for quoted keys and strings with
+	 * escapes, and stays valid until the next call to next().
+	 */
+	const char* getStringData() const { return mStringData; }
+	size_t getStringSize() const { return mStringSize; }
+	std::string getString() const { return std::string(mStringData, mStringSize); }
+	bool isString(const char* str) const;
+
+	/**
+	 * @brief Number of elements announced by a map or array begin token.
+	 */
+	S32 getSize() const { return mSize; }
+
+	/**
+	 * @brief Number of maps and arrays the reader is in.
+	 */
+	S32 getDepth() const { return (S32)mStack.size(); }
+
+	/**
+	 * @brief Bytes of the buffer consumed so far.
+	 */
+	size_t getOffset() const { return mPos - mBegin; }
+
+	/**
+	 * @brief Skips a value without looking at it.
+	 *
+	 * After a map key skips its value. After a map or array begin skips
+	 * to the matching end, which becomes the current token.
+	 * @return Returns false if the data is malformed.
+	 */
+	bool skipValue();
+
+	/**
+	 * @brief Builds LLSD for the next value.
+	 *
+	 * After a map key this is the value of that key.
+	 * @param data[out] The parsed value, undefined on failure.
+	 * @return Returns the number of LLSD objects parsed like
+	 * LLSDParser::parse(), 0 at the end of the data and
+	 * LLSDParser::PARSE_FAILURE on failure.
+	 */
+	S32 readValue(LLSD& data);
+
+private:
+	struct Frame
+	{
+		bool mIsMap;
+		bool mExpectKey;
+		S32 mRemaining;
+	};
+
+	EToken fail();
+	bool readBytes(void* dest, size_t size);
+	bool readSized(size_t& size);
+	bool readQuoted(char delim);
+	EToken readToken();
+	S32 buildValue(LLSD& data);
+
+private:
+	const U8* mBegin;
+	const U8* mPos;
+	const U8* mEnd;
+	std::vector<Frame> mStack;
+	bool mStarted;
+
+	EToken mToken;
+	bool mBoolean;
+	S32 mInteger;
+	F64 mReal;
+	U8 mUUID[UUID_BYTES];
+	const char* mStringData;
+	size_t mStringSize;
+	S32 mSize;
+	std::string mUnescaped;
+};
+
 
 /** 
  * @class LLSDFormatter
@@ -788,10 +920,17 @@ public:
 		(void)p->parse(str, sd, max_bytes);
 		return sd;
 	}
+	// Same as the stream version for data already in memory, see LLSDBinaryReader
+	static S32 fromBinary(LLSD& sd, const U8* data, S32 size)
+	{
+		LLSDBinaryReader reader(data, size > 0 ? size : 0);
+		return reader.readValue(sd);
+	}
 };
 
 //dirty little zip functions -- yell at davep
 LL_COMMON_API std::string zip_llsd(LLSD& data);
 LL_COMMON_API bool unzip_llsd(LLSD& data, std::istream& is, S32 size);
+LL_COMMON_API bool unzip_llsd(LLSD& data, const U8* in, S32 size);
 LL_COMMON_API U8* unzip_llsdNavMesh( bool& valid, unsigned int& outsize,std::istream& is, S32 size);
 #endif // LL_LLSDSERIALIZE_H
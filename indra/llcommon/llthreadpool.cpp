@@ -0,0 +1,355 @@
+/**
+ * @file llthreadpool.cpp
+ * @brief Work-stealing pool of worker threads shared between subsystems.
+ *
+ * $LicenseInfo:firstyear=2014&license=viewerlgpl$
+ * Second Life Viewer Source Code
+ * Copyright (C) 2014, Linden Research, Inc.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation;
+ * version 2.1 of the License only.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ * Linden Research, Inc., 945 Battery Street, San Francisco, CA  94111  USA
+ * $/LicenseInfo$
+ */
+
+#include "linden_common.h"
+
+#include "llthreadpool.h"
+
+#include "llpointer.h"
+
+#if LL_WINDOWS
+#include "llwin32headerslean.h"
+#else
+#include <unistd.h>
+#endif
+
+//============================================================================
+
+class LLThreadPoolWorker : public LLThread
+{
+public:
+	LLThreadPoolWorker(const std::string& name, LLThreadPool* pool, S32 index)
+	:	LLThread(name),
+		mPool(pool),
+		mIndex(index),
+		mThreadID(0)
+	{
+	}
+
+	// Set by the worker itself before it looks for work, so it holds the
+	// same value LLThread::currentID() returns on that thread on all
+	// platforms.
+	volatile uintptr_t mThreadID;
+
+private:
+	/*virtual*/ void run()
+	{
+		mThreadID = LLThread::currentID();
+
+		while (!mPool->mQuitting)
+		{
+			LLThreadPool::Task* task = mPool->takeTask(mIndex);
+			if (task)
+			{
+				task->run();
+			}
+			else
+			{
+				mPool->waitForWork();
+			}
+		}
+	}
+
+	LLThreadPool*	mPool;
+	S32				mIndex;
+};
+
+//============================================================================
+
+// Shared by the caller of parallelFor() and the helpers it queues.  The
+// helpers may only get to run after the caller has returned, so they hold a
+// reference and only touch mTask after claiming a chunk, which can no longer
+// happen once the caller stops waiting.
+class LLParallelForState : public LLThreadSafeRefCount
+{
+public:
+	LLParallelForState(LLThreadPool::RangeTask& task, S32 count, S32 chunk_size, S32 chunks)
+	:	mTask(task),
+		mCount(count),
+		mChunkSize(chunk_size),
+		mChunks(chunks),
+		mNextChunk(0),
+		mDoneChunks(0)
+	{
+	}
+
+	// Returns false when every chunk has been claimed.
+	bool runChunk()
+	{
+		S32 chunk = mNextChunk++;
+		if (chunk >= mChunks)
+		{
+			return false;
+		}
+		S32 begin = chunk * mChunkSize;
+		mTask.run(begin, llmin(begin + mChunkSize, mCount));
+		mDoneChunks++;
+		return true;
+	}
+
+	bool isDone() const	{ return mDoneChunks.CurrentValue() >= mChunks; }
+
+private:
+	LLThreadPool::RangeTask& mTask;
+	const S32 mCount;
+	const S32 mChunkSize;
+	const S32 mChunks;
+	LLAtomicS32 mNextChunk;
+	LLAtomicS32 mDoneChunks;
+};
+
+class LLParallelForHelper : public LLThreadPool::Task
+{
+public:
+	LLParallelForHelper(LLParallelForState* state) : mState(state) {}
+
+	/*virtual*/ void run()
+	{
+		while (mState->runChunk())
+		{
+		}
+		delete this;
+	}
+
+private:
+	LLPointer<LLParallelForState> mState;
+};
+
+//============================================================================
+
+LLThreadPool::LLThreadPool(const std::string& name, S32 num_threads)
+:	mWakeCondition(new LLCondition(NULL)),
+	mQuitting(false)
+{
+	num_threads = llmax(num_threads, 1);
+
+	mQueues.resize(num_threads);
+	for (S32 i = 0; i < num_threads; i++)
+	{
+		mQueues[i].mMutex = new LLMutex(NULL);
+	}
+
+	for (S32 i = 0; i < num_threads; i++)
+	{
+		mWorkers.push_back(new LLThreadPoolWorker(llformat("%s %d", name.c_str(), i), this, i));
+	}
+	for (S32 i = 0; i < num_threads; i++)
+	{
+		mWorkers[i]->start();
+	}
+
+	LL_INFOS("ThreadPool") << "Started " << name << " with " << num_threads << " threads" << LL_ENDL;
+}
+
+LLThreadPool::~LLThreadPool()
+{
+	mWakeCondition->lock();
+	mQuitting = true;
+	mWakeCondition->broadcast();
+	mWakeCondition->unlock();
+
+	// The workers finish the task they are running and exit, LLThread's
+	// destructor waits for that.
+	for (S32 i = 0; i < (S32)mWorkers.size(); i++)
+	{
+		delete mWorkers[i];
+	}
+	mWorkers.clear();
+
+	// Run what is left on this thread, so that whoever waits on a task
+	// hears back and the tasks get to delete or release themselves.  They
+	// may still submit more, it goes on the queues and runs here too.
+	S32 drained = 0;
+	while (Task* task = takeTask(0))
+	{
+		task->run();
+		drained++;
+	}
+	if (drained)
+	{
+		LL_INFOS("ThreadPool") << "Ran " << drained << " tasks left queued at shutdown" << LL_ENDL;
+	}
+
+	for (S32 i = 0; i < (S32)mQueues.size(); i++)
+	{
+		delete mQueues[i].mMutex;
+	}
+	mQueues.clear();
+
+	delete mWakeCondition;
+	mWakeCondition = NULL;
+}
+
+//static
+S32 LLThreadPool::getDefaultThreadCount()
+{
+	S32 cores = 1;
+#if LL_WINDOWS
+	SYSTEM_INFO info;
+	GetSystemInfo(&info);
+	cores = (S32)info.dwNumberOfProcessors;
+#else
+	long online = sysconf(_SC_NPROCESSORS_ONLN);
+	if (online > 0)
+	{
+		cores = (S32)online;
+	}
+#endif
+	// Leave a core to the main thread.
+	return llmax(cores - 1, 1);
+}
+
+S32 LLThreadPool::getCurrentWorker() const
+{
+	uintptr_t id = LLThread::currentID();
+	for (S32 i = 0; i < (S32)mWorkers.size(); i++)
+	{
+		if (mWorkers[i]->mThreadID == id)
+		{
+			return i;
+		}
+	}
+	return -1;
+}
+
+void LLThreadPool::submit(Task* task, EBand band)
+{
+	llassert(task);
+	llassert(band >= 0 && band < BAND_COUNT);
+
+	S32 index = getCurrentWorker();
+	if (index < 0)
+	{
+		index = (S32)((mNextQueue++) % (U32)mQueues.size());
+	}
+
+	Queue& queue = mQueues[index];
+	queue.mMutex->lock();
+	queue.mTasks[band].push_back(task);
+	queue.mMutex->unlock();
+
+	// Count before signalling so that a worker checking the count under
+	// mWakeCondition either sees this task or is already waiting.
+	mQueuedTasks++;
+	mWakeCondition->lock();
+	mWakeCondition->signal();
+	mWakeCondition->unlock();
+}
+
+LLThreadPool::Task* LLThreadPool::takeTask(S32 index)
+{
+	const S32 num_queues = (S32)mQueues.size();
+
+	for (S32 band = 0; band < BAND_COUNT; band++)
+	{
+		// Newest first from our own deque, it is most likely still in cache.
+		Queue& own = mQueues[index];
+		own.mMutex->lock();
+		if (!own.mTasks[band].empty())
+		{
+			Task* task = own.mTasks[band].back();
+			own.mTasks[band].pop_back();
+			own.mMutex->unlock();
+			mQueuedTasks--;
+			return task;
+		}
+		own.mMutex->unlock();
+
+		// Oldest first from the others, it has waited longest.
+		for (S32 i = 1; i < num_queues; i++)
+		{
+			Queue& victim = mQueues[(index + i) % num_queues];
+			if (!victim.mMutex->trylock())
+			{
+				// Busy, its owner or another thief is at it.
+				continue;
+			}
+			if (!victim.mTasks[band].empty())
+			{
+				Task* task = victim.mTasks[band].front();
+				victim.mTasks[band].pop_front();
+				victim.mMutex->unlock();
+				mQueuedTasks--;
+				mStolenTasks++;
+				return task;
+			}
+			victim.mMutex->unlock();
+		}
+	}
+	return NULL;
+}
+
+void LLThreadPool::waitForWork()
+{
+	mWakeCondition->lock();
+	if (mQueuedTasks.CurrentValue() > 0)
+	{
+		// Only missed it because a queue was busy, try again.
+		mWakeCondition->unlock();
+		LLThread::yield();
+		return;
+	}
+	while (mQueuedTasks.CurrentValue() <= 0 && !mQuitting)
+	{
+		mWakeCondition->wait();
+	}
+	mWakeCondition->unlock();
+}
+
+void LLThreadPool::parallelFor(S32 count, S32 min_chunk, RangeTask& task, EBand band)
+{
+	if (count <= 0)
+	{
+		return;
+	}
+
+	// A few chunks per thread so that a slow one does not hold up the rest.
+	S32 threads = getThreadCount() + 1;
+	S32 chunk_size = llmax(min_chunk, 1);
+	chunk_size = llmax(chunk_size, (count + threads * 4 - 1) / (threads * 4));
+	S32 chunks = (count + chunk_size - 1) / chunk_size;
+	if (chunks == 1)
+	{
+		task.run(0, count);
+		return;
+	}
+
+	LLPointer<LLParallelForState> state = new LLParallelForState(task, count, chunk_size, chunks);
+	S32 helpers = llmin(chunks - 1, getThreadCount());
+	for (S32 i = 0; i < helpers; i++)
+	{
+		submit(new LLParallelForHelper(state), band);
+	}
+
+	while (state->runChunk())
+	{
+	}
+	// Whatever is left is being worked on right now.
+	while (!state->isDone())
+	{
+		LLThread::yield();
+	}
+}
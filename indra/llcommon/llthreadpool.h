@@ -0,0 +1,120 @@
+/**
+ * @file llthreadpool.h
+ * @brief Work-stealing pool of worker threads shared between subsystems.
+ *
+ * $LicenseInfo:firstyear=2014&license=viewerlgpl$
+ * Second Life Viewer Source Code
+ * Copyright (C) 2014, Linden Research, Inc.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation;
+ * version 2.1 of the License only.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ * Linden Research, Inc., 945 Battery Street, San Francisco, CA  94111  USA
+ * $/LicenseInfo$
+ */
+
+#ifndef LL_LLTHREADPOOL_H
+#define LL_LLTHREADPOOL_H
+
+#include <deque>
+#include <vector>
+
+#include "llthread.h"
+
+class LLThreadPoolWorker;
+
+/**
+ * A fixed set of worker threads for subsystems that have more work than one
+ * thread of their own can get through.
+ *
+ * Every worker owns one deque per priority band.  Tasks submitted by a
+ * worker go to its own deques, tasks from other threads are dealt out round
+ * robin.  A worker takes the newest task of the most urgent band it has work
+ * in; before settling for a less urgent band of its own it steals the oldest
+ * task of that band from the others, so a backlog queued up behind one busy
+ * worker gets spread over every idle core.
+ */
+class LL_COMMON_API LLThreadPool
+{
+	friend class LLThreadPoolWorker;
+
+public:
+	// The pool never deletes tasks, run() may delete or resubmit its task.
+	class LL_COMMON_API Task
+	{
+	public:
+		virtual ~Task() {}
+		virtual void run() = 0;
+	};
+
+	// Work that can be split into independent index ranges, see parallelFor().
+	class LL_COMMON_API RangeTask
+	{
+	public:
+		virtual ~RangeTask() {}
+		virtual void run(S32 begin, S32 end) = 0;
+	};
+
+	enum EBand
+	{
+		BAND_URGENT = 0,
+		BAND_HIGH,
+		BAND_NORMAL,
+		BAND_LOW,
+		BAND_COUNT
+	};
+
+	LLThreadPool(const std::string& name, S32 num_threads);
+	~LLThreadPool(); // stops the workers, then runs the tasks still queued
+
+	// Number of cores less one for the main thread, at least one.
+	static S32 getDefaultThreadCount();
+
+	// May be called from any thread, including the workers.
+	void submit(Task* task, EBand band = BAND_NORMAL);
+
+	// Splits [0, count) into chunks of at least min_chunk indices and runs
+	// them on the pool, returning once all are done.  The calling thread
+	// works on chunks too instead of just waiting, so this is safe to call
+	// from a task running on the pool.
+	void parallelFor(S32 count, S32 min_chunk, RangeTask& task, EBand band = BAND_HIGH);
+
+	S32 getThreadCount() const	{ return (S32)mWorkers.size(); }
+	S32 getQueuedTasks() const	{ return mQueuedTasks.CurrentValue(); }
+	U32 getStolenTasks() const	{ return mStolenTasks.CurrentValue(); }
+
+private:
+	struct Queue
+	{
+		Queue() : mMutex(NULL) {}
+		LLMutex* mMutex;
+		std::deque<Task*> mTasks[BAND_COUNT];
+	};
+
+	Task* takeTask(S32 index);
+	S32 getCurrentWorker() const;
+	void waitForWork();
+
+private:
+	std::vector<LLThreadPoolWorker*> mWorkers;
+	std::vector<Queue> mQueues;	// one per worker
+
+	LLCondition*	mWakeCondition;
+	LLAtomicS32		mQueuedTasks;
+	LLAtomicU32		mNextQueue;
+	LLAtomicU32		mStolenTasks;
+	volatile bool	mQuitting;
+};
+
+#endif // LL_LLTHREADPOOL_H
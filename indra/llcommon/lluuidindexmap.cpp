@@ -0,0 +1,293 @@
+/**
+ * @file lluuidindexmap.cpp
+ * @brief UUID to index map with lock-free lookups.
+ *
+ * $LicenseInfo:firstyear=2014&license=viewerlgpl$
+ * Second Life Viewer Source Code
+ * Copyright (C) 2014, Linden Research, Inc.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation;
+ * version 2.1 of the License only.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ * Linden Research, Inc., 945 Battery Street, San Francisco, CA  94111  USA
+ * $/LicenseInfo$
+ */
+
+#include "linden_common.h"
+
+#include "lluuidindexmap.h"
+
+#include "llstl.h"
+#include "llthread.h"
+
+#include <algorithm>
+
+#if LL_WINDOWS
+#include "llwin32headerslean.h"
+#endif
+
+// Readers must not let their loads of a shard move across the loads of its
+// sequence count, by the compiler or by a weakly ordered CPU.  This is a
+// full hardware fence, which orders them on every target.  Writers get a
+// full barrier from the atomic increments of the sequence count.
+static inline void read_barrier()
+{
+#if LL_WINDOWS
+	MemoryBarrier();
+#else
+	__sync_synchronize();
+#endif
+}
+
+LLUUIDIndexMap::LLUUIDIndexMap()
+{
+	for (U32 i = 0; i < SHARD_COUNT; i++)
+	{
+		mShards[i].mMutex = new LLMutex(NULL);
+		mShards[i].mTable = new Table(64);
+	}
+}
+
+LLUUIDIndexMap::~LLUUIDIndexMap()
+{
+	for (U32 i = 0; i < SHARD_COUNT; i++)
+	{
+		Shard& shard = mShards[i];
+		delete shard.mTable;
+		std::for_each(shard.mRetired.begin(), shard.mRetired.end(), DeletePointer());
+		shard.mRetired.clear();
+		delete shard.mMutex;
+	}
+}
+
+//static
+U32 LLUUIDIndexMap::hash(const LLUUID& id)
+{
+	U32 words[4];
+	memcpy(words, id.mData, sizeof(words));
+	// The top bits pick the shard and the bottom bits the slot, so mix both ways.
+	U32 h = (words[0] ^ words[2]) * 0x9E3779B1 ^ (words[1] ^ words[3]);
+	return h ^ (h >> 16);
+}
+
+//static
+S32 LLUUIDIndexMap::probe(const Table* table, const LLUUID& id, U32 hash)
+{
+	const U32 mask = table->mMask;
+	U32 pos = hash & mask;
+	// Bounded, so that a reader racing a writer can not loop forever.
+	for (U32 i = 0; i <= mask; i++)
+	{
+		const Slot& slot = table->mSlots[pos];
+		if (slot.mIndex < 0)
+		{
+			break;
+		}
+		if (slot.mID == id)
+		{
+			return (S32)pos;
+		}
+		pos = (pos + 1) & mask;
+	}
+	return -1;
+}
+
+//static
+U32 LLUUIDIndexMap::beginRead(const Shard& shard)
+{
+	while (true)
+	{
+		U32 sequence = shard.mSequence.CurrentValue();
+		if (!(sequence & 1))
+		{
+			read_barrier();
+			return sequence;
+		}
+		// A writer is in the middle of a change.
+		LLThread::yield();
+	}
+}
+
+//static
+bool LLUUIDIndexMap::endRead(const Shard& shard, U32 sequence)
+{
+	read_barrier();
+	return shard.mSequence.CurrentValue() == sequence;
+}
+
+//static
+S32 LLUUIDIndexMap::lookup(const Shard& shard, const LLUUID& id, U32 hash)
+{
+	const Table* table = shard.mTable;
+	S32 pos = probe(table, id, hash);
+	return pos >= 0 ? table->mSlots[pos].mIndex : -1;
+}
+
+void LLUUIDIndexMap::reserve(U32 max_entries)
+{
+	U32 per_shard = max_entries / SHARD_COUNT + 1;
+	for (U32 i = 0; i < SHARD_COUNT; i++)
+	{
+		Shard& shard = mShards[i];
+		LLMutexLock lock(shard.mMutex);
+		U32 capacity = shard.mTable->mMask + 1;
+		while (capacity * 3 < per_shard * 4)
+		{
+			capacity <<= 1;
+		}
+		if (capacity > shard.mTable->mMask + 1)
+		{
+			grow(shard, capacity);
+		}
+	}
+}
+
+// shard.mMutex is locked before calling this.
+void LLUUIDIndexMap::grow(Shard& shard, U32 capacity)
+{
+	Table* old_table = shard.mTable;
+	Table* new_table = new Table(capacity);
+	for (U32 i = 0; i <= old_table->mMask; i++)
+	{
+		const Slot& slot = old_table->mSlots[i];
+		if (slot.mIndex >= 0)
+		{
+			U32 pos = hash(slot.mID) & new_table->mMask;
+			while (new_table->mSlots[pos].mIndex >= 0)
+			{
+				pos = (pos + 1) & new_table->mMask;
+			}
+			new_table->mSlots[pos] = slot;
+		}
+	}
+
+	beginWrite(shard);
+	shard.mTable = new_table;
+	endWrite(shard);
+
+	// Readers may still be probing the old table.
+	shard.mRetired.push_back(old_table);
+}
+
+void LLUUIDIndexMap::clear()
+{
+	for (U32 i = 0; i < SHARD_COUNT; i++)
+	{
+		Shard& shard = mShards[i];
+		LLMutexLock lock(shard.mMutex);
+		if (!shard.mCount)
+		{
+			continue;
+		}
+		beginWrite(shard);
+		std::fill(shard.mTable->mSlots.begin(), shard.mTable->mSlots.end(), Slot());
+		shard.mCount = 0;
+		endWrite(shard);
+	}
+}
+
+S32 LLUUIDIndexMap::find(const LLUUID& id) const
+{
+	const U32 h = hash(id);
+	const Shard& shard = getShard(h);
+	while (true)
+	{
+		U32 sequence = beginRead(shard);
+		S32 idx = lookup(shard, id, h);
+		if (endRead(shard, sequence))
+		{
+			return idx;
+		}
+	}
+}
+
+void LLUUIDIndexMap::insert(const LLUUID& id, S32 idx)
+{
+	llassert(idx >= 0);
+	const U32 h = hash(id);
+	Shard& shard = getShard(h);
+	LLMutexLock lock(shard.mMutex);
+
+	Table* table = shard.mTable;
+	S32 pos = probe(table, id, h);
+	if (pos < 0 && (shard.mCount + 1) * 4 > (table->mMask + 1) * 3)
+	{
+		grow(shard, (table->mMask + 1) * 2);
+		table = shard.mTable;
+	}
+
+	beginWrite(shard);
+	if (pos >= 0)
+	{
+		table->mSlots[pos].mIndex = idx;
+	}
+	else
+	{
+		U32 free_pos = h & table->mMask;
+		while (table->mSlots[free_pos].mIndex >= 0)
+		{
+			free_pos = (free_pos + 1) & table->mMask;
+		}
+		table->mSlots[free_pos].mID = id;
+		table->mSlots[free_pos].mIndex = idx;
+		shard.mCount++;
+	}
+	endWrite(shard);
+}
+
+void LLUUIDIndexMap::erase(const LLUUID& id)
+{
+	const U32 h = hash(id);
+	Shard& shard = getShard(h);
+	LLMutexLock lock(shard.mMutex);
+
+	Table* table = shard.mTable;
+	S32 pos = probe(table, id, h);
+	if (pos < 0)
+	{
+		return;
+	}
+
+	// Backward shift deletion: pull later members of the probe run into the
+	// hole so that lookups can keep stopping at the first empty slot.
+	const U32 mask = table->mMask;
+	U32 hole = (U32)pos;
+	beginWrite(shard);
+	table->mSlots[hole].mIndex = -1;
+	for (U32 next = (hole + 1) & mask; table->mSlots[next].mIndex >= 0; next = (next + 1) & mask)
+	{
+		U32 home = hash(table->mSlots[next].mID) & mask;
+		// Leave the slot alone if its home lies cyclically in (hole, next].
+		bool stays = (hole < next) ? (home > hole && home <= next) : (home > hole || home <= next);
+		if (!stays)
+		{
+			table->mSlots[hole] = table->mSlots[next];
+			table->mSlots[next].mIndex = -1;
+			hole = next;
+		}
+	}
+	shard.mCount--;
+	endWrite(shard);
+}
+
+U32 LLUUIDIndexMap::size() const
+{
+	U32 count = 0;
+	for (U32 i = 0; i < SHARD_COUNT; i++)
+	{
+		LLMutexLock lock(mShards[i].mMutex);
+		count += mShards[i].mCount;
+	}
+	return count;
+}
@@ -0,0 +1,144 @@
+/**
+ * @file lluuidindexmap.h
+ * @brief UUID to index map with lock-free lookups.
+ *
+ * $LicenseInfo:firstyear=2014&license=viewerlgpl$
+ * Second Life Viewer Source Code
+ * Copyright (C) 2014, Linden Research, Inc.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation;
+ * version 2.1 of the License only.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ * Linden Research, Inc., 945 Battery Street, San Francisco, CA  94111  USA
+ * $/LicenseInfo$
+ */
+
+#ifndef LL_LLUUIDINDEXMAP_H
+#define LL_LLUUIDINDEXMAP_H
+
+#include <vector>
+
+#include "llapr.h"
+#include "llmutex.h"
+#include "lluuid.h"
+
+/**
+ * Maps UUIDs to indices of an array, for many reader threads and a few
+ * writers.  Split into shards by hash.  Lookups take no lock: writers bump
+ * the shard's sequence count before and after each change, and a reader
+ * that sees it move retries.  Writers serialize on the shard mutex.  Tables
+ * are open addressed with linear probing and only ever grow; outgrown
+ * tables are kept until destruction so that a reader never follows a freed
+ * pointer.
+ *
+ * The array itself may be guarded by the same sequence counts, see
+ * findEntry() and writeEntry().
+ */
+class LL_COMMON_API LLUUIDIndexMap
+{
+public:
+	LLUUIDIndexMap();
+	~LLUUIDIndexMap();
+
+	// Sizes the tables for max_entries ids.  Call before any reader starts.
+	void reserve(U32 max_entries);
+	void clear();
+
+	// -1 if id is not in the map
+	S32 find(const LLUUID& id) const;
+	void insert(const LLUUID& id, S32 idx);
+	void erase(const LLUUID& id);
+
+	// Same as find(), but also copies entries[idx] out while the shard is
+	// known to be stable.  entries may be NULL.  ENTRY has an LLUUID mID.
+	template <class ENTRY>
+	S32 findEntry(const LLUUID& id, const ENTRY* entries, U32 num_entries, ENTRY& entry) const
+	{
+		const U32 h = hash(id);
+		const Shard& shard = getShard(h);
+		while (true)
+		{
+			U32 sequence = beginRead(shard);
+			S32 idx = lookup(shard, id, h);
+			if (entries && idx >= 0 && (U32)idx < num_entries)
+			{
+				entry = entries[idx];
+			}
+			if (endRead(shard, sequence))
+			{
+				return idx;
+			}
+		}
+	}
+
+	// Stores entry at dest as a change to the shard of entry.mID, so that
+	// findEntry() never returns a half written entry.  An id must be
+	// erased before its entry is reused for another one.
+	template <class ENTRY>
+	void writeEntry(const ENTRY& entry, ENTRY* dest)
+	{
+		Shard& shard = getShard(hash(entry.mID));
+		LLMutexLock lock(shard.mMutex);
+		beginWrite(shard);
+		*dest = entry;
+		endWrite(shard);
+	}
+
+	// Number of ids in the map, for tests and stats
+	U32 size() const;
+
+private:
+	struct Slot
+	{
+		Slot() : mIndex(-1) {}
+		LLUUID mID;
+		S32 mIndex; // -1 when the slot is empty
+	};
+
+	struct Table
+	{
+		Table(U32 capacity) : mMask(capacity - 1), mSlots(capacity) {}
+		U32 mMask;
+		std::vector<Slot> mSlots;
+	};
+
+	struct Shard
+	{
+		Shard() : mMutex(NULL), mSequence(0), mTable(NULL), mCount(0) {}
+		LLMutex* mMutex;
+		LLAtomicU32 mSequence; // odd while a writer is changing the shard
+		Table* volatile mTable;
+		U32 mCount;
+		std::vector<Table*> mRetired;
+	};
+
+	static U32 hash(const LLUUID& id);
+	static S32 probe(const Table* table, const LLUUID& id, U32 hash);
+	Shard& getShard(U32 hash) const { return mShards[hash >> (32 - SHARD_BITS)]; }
+	void grow(Shard& shard, U32 capacity);
+	void beginWrite(Shard& shard) { shard.mSequence++; }
+	void endWrite(Shard& shard) { shard.mSequence++; }
+
+	// A read of a shard is good if endRead() returns true for the count
+	// beginRead() returned.
+	static U32 beginRead(const Shard& shard);
+	static bool endRead(const Shard& shard, U32 sequence);
+	static S32 lookup(const Shard& shard, const LLUUID& id, U32 hash);
+
+	static const U32 SHARD_BITS = 5;
+	static const U32 SHARD_COUNT = 1 << SHARD_BITS;
+	mutable Shard mShards[SHARD_COUNT];
+};
+
+#endif // LL_LLUUIDINDEXMAP_H
@@ -84,7 +84,8 @@ private:
 	LLMutex* mDeleteMutex;
 	
 public:
-	LLWorkerThread(const std::string& name, bool threaded = true, bool should_pause = false);
+	LLWorkerThread(const std::string& name, bool threaded = true, bool should_pause = false,
+				   LLThreadPool* pool = NULL, U32 pool_concurrency = 1);
 	~LLWorkerThread();
 
 	/*virtual*/ S32 update(F32 max_time_ms);
@@ -0,0 +1,192 @@
+/**
+ * @file llsdarena_test.cpp
+ * @date 2014-10
+ * @brief LLSDArena test cases.
+ *
+ * $LicenseInfo:firstyear=2014&license=viewerlgpl$
+ * Second Life Viewer Source Code
+ * Copyright (C) 2014, Linden Research, Inc.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation;
+ * version 2.1 of the License only.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ * Linden Research, Inc., 945 Battery Street, San Francisco, CA  94111  USA
+ * $/LicenseInfo$
+ */
+
+#include "linden_common.h"
+
+#include "../llsdarena.h"
+#include "../llsd.h"
+#include "../llsdserialize.h"
+#include "../llformat.h"
+#include "../lltimer.h"
+
+#include "../test/lltut.h"
+
+#include <sstream>
+
+namespace
+{
+	// Something shaped like an inventory skeleton
+	LLSD make_skeleton(S32 folders)
+	{
+		LLSD skeleton = LLSD::emptyArray();
+		for (S32 i = 0; i < folders; ++i)
+		{
+			LLSD folder;
+			folder["folder_id"] = LLUUID::generateNewID();
+			folder["parent_id"] = LLUUID::null;
+			folder["name"] = llformat("Folder %d", i);
+			folder["type_default"] = -1;
+			folder["version"] = i;
+			skeleton.append(folder);
+		}
+		return skeleton;
+	}
+
+	std::string to_binary(const LLSD& sd)
+	{
+		std::ostringstream str;
+		LLSDSerialize::toBinary(sd, str);
+		return str.str();
+	}
+}
+
+namespace tut
+{
+	struct sdarena_test
+	{
+		sdarena_test() : mLiveBlocks(LLSDArena::getLiveBlockCount()) {}
+
+		S32 mLiveBlocks;
+	};
+	typedef test_group<sdarena_test> sdarena_group_t;
+	typedef sdarena_group_t::object sdarena_object_t;
+	tut::sdarena_group_t sdarena_instance("LLSDArena");
+
+	template<> template<>
+	void sdarena_object_t::test<1>()
+	{
+		set_test_name("documents built in an arena are the same");
+
+		std::string str = to_binary(make_skeleton(500));
+		LLSD from_heap;
+		LLSDSerialize::fromBinary(from_heap, (const U8*)str.data(), str.size());
+
+		LLSDArena arena(16 * 1024);
+		LLSD from_arena;
+		{
+			LLSDArena::Scope scope(arena);
+			ensure_equals("current", LLSDArena::getCurrent(), &arena);
+			LLSDSerialize::fromBinary(from_arena, (const U8*)str.data(), str.size());
+		}
+		ensure("no longer current", LLSDArena::getCurrent() == NULL);
+		ensure_equals("same", from_arena, from_heap);
+
+		// One map and five values per folder plus the array
+		ensure_equals("allocations", arena.getAllocationCount(), (U32)(500 * 6 + 1));
+		ensure("few blocks", arena.getBlockCount() < 20);
+	}
+
+	template<> template<>
+	void sdarena_object_t::test<2>()
+	{
+		set_test_name("blocks go back once everything in them is released");
+
+		LLSD kept;
+		{
+			LLSDArena arena(4 * 1024);
+			LLSD doc;
+			{
+				LLSDArena::Scope scope(arena);
+				doc = make_skeleton(200);
+				kept = doc[0];
+			}
+			ensure("blocks in use", LLSDArena::getLiveBlockCount() > mLiveBlocks);
+			ensure_equals("value", doc[199]["version"].asInteger(), 199);
+		}
+		// The arena and the document are gone, the kept folder holds its
+		// block and works as usual.
+		ensure_equals("kept block", LLSDArena::getLiveBlockCount(), mLiveBlocks + 1);
+		kept["name"] = "Renamed";
+		ensure_equals("kept value", kept["name"].asString(), "Renamed");
+		kept.clear();
+		ensure_equals("all released", LLSDArena::getLiveBlockCount(), mLiveBlocks);
+	}
+
+	template<> template<>
+	void sdarena_object_t::test<3>()
+	{
+		set_test_name("scopes nest and values outside stay on the heap");
+
+		LLSDArena outer;
+		LLSDArena inner;
+		LLSD heap = "heap";
+		{
+			LLSDArena::Scope outer_scope(outer);
+			LLSD a = 1;
+			{
+				LLSDArena::Scope inner_scope(inner);
+				ensure_equals("inner", LLSDArena::getCurrent(), &inner);
+				LLSD b = 2;
+			}
+			ensure_equals("outer again", LLSDArena::getCurrent(), &outer);
+			heap = a;
+		}
+		ensure_equals("outer allocations", outer.getAllocationCount(), 1U);
+		ensure_equals("inner allocations", inner.getAllocationCount(), 1U);
+		ensure_equals("value", heap.asInteger(), 1);
+
+		LLSD after = "after";
+		ensure_equals("no arena", outer.getAllocationCount(), 1U);
+	}
+
+	template<> template<>
+	void sdarena_object_t::test<4>()
+	{
+		set_test_name("arena parse benchmark");
+
+		std::string str = to_binary(make_skeleton(40000));
+		const S32 ITERATIONS = 5;
+
+		LLTimer timer;
+		for (S32 i = 0; i < ITERATIONS; ++i)
+		{
+			LLSD doc;
+			LLSDSerialize::fromBinary(doc, (const U8*)str.data(), str.size());
+		}
+		F64 heap_time = timer.getElapsedTimeF64();
+
+		timer.reset();
+		U32 blocks = 0;
+		for (S32 i = 0; i < ITERATIONS; ++i)
+		{
+			LLSDArena arena(256 * 1024);
+			LLSD doc;
+			{
+				LLSDArena::Scope scope(arena);
+				LLSDSerialize::fromBinary(doc, (const U8*)str.data(), str.size());
+			}
+			blocks = arena.getBlockCount();
+		}
+		F64 arena_time = timer.getElapsedTimeF64();
+
+		LL_INFOS() << "40000 folders, " << str.size() << " bytes: heap "
+				   << heap_time * 1000.0 / ITERATIONS << " ms, arena "
+				   << arena_time * 1000.0 / ITERATIONS << " ms in "
+				   << blocks << " blocks" << LL_ENDL;
+		ensure_equals("all released", LLSDArena::getLiveBlockCount(), mLiveBlocks);
+	}
+}
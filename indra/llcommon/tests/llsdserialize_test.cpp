@@ -54,6 +54,7 @@ namespace lambda = boost::lambda;
 #include "../llsdserialize.h"
 #include "llsdutil.h"
 #include "../llformat.h"
+#include "../lltimer.h"
 
 #include "../test/lltut.h"
 #include "../test/namedtempfile.h"
@@ -267,8 +268,17 @@ namespace tut
 		mFormatter->format(v, stream);
 		//LL_INFOS() << "checkRoundTrip: length " << stream.str().length() << LL_ENDL;
 		LLSD w;
-		mParser->reset();	// reset() call is needed since test code re-uses mParser
-		mParser->parse(stream, w, stream.str().size());
+		if (mParser.notNull())
+		{
+			mParser->reset();	// reset() call is needed since test code re-uses mParser
+			mParser->parse(stream, w, stream.str().size());
+		}
+		else
+		{
+			// No parser means the binary in memory path
+			std::string str = stream.str();
+			LLSDSerialize::fromBinary(w, (const U8*)str.data(), str.size());
+		}
 		
 		try
 		{
@@ -494,6 +504,14 @@ namespace tut
 		doRoundTripTests("binary serialization");
 	}
 
+	template<> template<> 
+	void TestLLSDSerializeObject::test<4>()
+	{
+		mFormatter = new LLSDBinaryFormatter();
+		mParser = NULL;
+		doRoundTripTests("binary buffer serialization");
+	}
+
 
 	/**
 	 * @class TestLLSDParsing
@@ -1306,6 +1324,233 @@ namespace tut
 	}
 */
 
+	/**
+	 * @class TestLLSDBinaryReader
+	 * @brief Pull parsing of binary LLSD out of a buffer
+	 */
+	class TestLLSDBinaryReader
+	{
+	public:
+		TestLLSDBinaryReader() {}
+
+		static std::string toBinary(const LLSD& sd)
+		{
+			std::ostringstream str;
+			LLSDSerialize::toBinary(sd, str);
+			return str.str();
+		}
+
+		static LLSD makeMesh(S32 faces, S32 vertices)
+		{
+			LLSD mesh = LLSD::emptyArray();
+			for (S32 i = 0; i < faces; ++i)
+			{
+				LLSD face;
+				face["Position"] = LLSD::Binary(vertices * 6, (U8)i);
+				face["Normal"] = LLSD::Binary(vertices * 6, (U8)(i + 1));
+				face["TexCoord0"] = LLSD::Binary(vertices * 4, (U8)(i + 2));
+				face["TriangleList"] = LLSD::Binary(vertices * 6, (U8)(i + 3));
+				face["PositionDomain"]["Min"] = LLSDArray(-0.5)(-0.5)(-0.5);
+				face["PositionDomain"]["Max"] = LLSDArray(0.5)(0.5)(0.5);
+				mesh.append(face);
+			}
+			return mesh;
+		}
+	};
+
+	typedef tut::test_group<TestLLSDBinaryReader> TestLLSDBinaryReaderGroup;
+	typedef TestLLSDBinaryReaderGroup::object TestLLSDBinaryReaderObject;
+	TestLLSDBinaryReaderGroup gTestLLSDBinaryReaderGroup("llsd binary reader");
+
+	template<> template<> 
+	void TestLLSDBinaryReaderObject::test<1>()
+	{
+		// Pick one key out of a header without building any LLSD
+		LLSD header;
+		header["version"] = 1;
+		header["high_lod"]["offset"] = 0;
+		header["high_lod"]["size"] = 4096;
+		header["physics_mesh"]["offset"] = 4096;
+		header["physics_mesh"]["size"] = 512;
+		header["name"] = "mesh";
+		std::string str = toBinary(header);
+
+		LLSDBinaryReader reader((const U8*)str.data(), str.size());
+		ensure_equals("map", reader.next(), LLSDBinaryReader::TOKEN_MAP_BEGIN);
+		ensure_equals("map size", reader.getSize(), 4);
+		S32 size = 0;
+		while (reader.next() == LLSDBinaryReader::TOKEN_MAP_KEY)
+		{
+			if (reader.isString("physics_mesh"))
+			{
+				ensure_equals("nested map", reader.next(), LLSDBinaryReader::TOKEN_MAP_BEGIN);
+				while (reader.next() == LLSDBinaryReader::TOKEN_MAP_KEY)
+				{
+					std::string key = reader.getString();
+					ensure_equals("integer", reader.next(), LLSDBinaryReader::TOKEN_INTEGER);
+					if (key == "size")
+					{
+						size = reader.getInteger();
+					}
+				}
+				ensure_equals("nested map end", reader.getToken(), LLSDBinaryReader::TOKEN_MAP_END);
+			}
+			else
+			{
+				ensure("skip", reader.skipValue());
+			}
+		}
+		ensure_equals("map end", reader.getToken(), LLSDBinaryReader::TOKEN_MAP_END);
+		ensure_equals("depth", reader.getDepth(), 0);
+		ensure_equals("size", size, 512);
+		ensure_equals("end", reader.next(), LLSDBinaryReader::TOKEN_END);
+		ensure_equals("offset", reader.getOffset(), str.size());
+	}
+
+	template<> template<> 
+	void TestLLSDBinaryReaderObject::test<2>()
+	{
+		// Only what the value needs is read, like the mesh header in front
+		// of the LOD blocks.
+		LLSD header;
+		header["version"] = 1;
+		std::string str = toBinary(header);
+		size_t header_size = str.size();
+		str += "trailing lod data";
+
+		LLSD value;
+		LLSDBinaryReader reader((const U8*)str.data(), str.size());
+		ensure("parsed", reader.readValue(value) > 0);
+		ensure_equals("value", value, header);
+		ensure_equals("offset", reader.getOffset(), header_size);
+	}
+
+	template<> template<> 
+	void TestLLSDBinaryReaderObject::test<3>()
+	{
+		// Truncated anywhere fails cleanly
+		std::string str = toBinary(makeMesh(2, 4));
+		for (size_t i = 0; i < str.size(); ++i)
+		{
+			LLSD value = "untouched";
+			ensure_equals(llformat("truncated at %d", (S32)i),
+						  LLSDSerialize::fromBinary(value, (const U8*)str.data(), i),
+						  (i ? LLSDParser::PARSE_FAILURE : 0));
+			ensure(llformat("cleared at %d", (S32)i), value.isUndefined());
+		}
+	}
+
+	template<> template<> 
+	void TestLLSDBinaryReaderObject::test<4>()
+	{
+		// A length past the end of the buffer must not be trusted
+		const char bad_string[] = { 's', 0x7f, 0, 0, 0, 'a', 'b' };
+		LLSD value;
+		ensure_equals("string length",
+					  LLSDSerialize::fromBinary(value, (const U8*)bad_string, sizeof(bad_string)),
+					  LLSDParser::PARSE_FAILURE);
+
+		const char bad_array[] = { '[', 0x7f, 0, 0, 0, 'i', 0, 0, 0, 1, ']' };
+		ensure_equals("array size",
+					  LLSDSerialize::fromBinary(value, (const U8*)bad_array, sizeof(bad_array)),
+					  LLSDParser::PARSE_FAILURE);
+
+		const char negative_array[] = { '[', (char)0xff, 0, 0, 0, ']' };
+		ensure_equals("negative size",
+					  LLSDSerialize::fromBinary(value, (const U8*)negative_array, sizeof(negative_array)),
+					  LLSDParser::PARSE_FAILURE);
+	}
+
+	template<> template<> 
+	void TestLLSDBinaryReaderObject::test<5>()
+	{
+		// Quoted notation strings and keys, as LLSDBinaryParser takes them
+		const char quoted[] = "{\0\0\0\x02'a\\tb'\"x\\x41\\\"y\"\"k\"'v'}";
+		LLSD value;
+		ensure_equals("count",
+					  LLSDSerialize::fromBinary(value, (const U8*)quoted, sizeof(quoted) - 1),
+					  3);
+		ensure_equals("escaped key", value["a\tb"].asString(), "xA\"y");
+		ensure_equals("plain key", value["k"].asString(), "v");
+	}
+
+	template<> template<> 
+	void TestLLSDBinaryReaderObject::test<6>()
+	{
+		// The first of two equal keys wins, as with LLSDBinaryParser
+		const char twice[] = "{\0\0\0\x02k\0\0\0\x01" "ai\0\0\0\x01k\0\0\0\x01" "ai\0\0\0\x02}";
+		std::string str(twice, sizeof(twice) - 1);
+
+		LLSD from_buffer;
+		LLSDSerialize::fromBinary(from_buffer, (const U8*)str.data(), str.size());
+		LLSD from_stream;
+		std::istringstream stream(str);
+		LLSDSerialize::fromBinary(from_stream, stream, str.size());
+		ensure_equals("same as stream", from_buffer, from_stream);
+		ensure_equals("first", from_buffer["a"].asInteger(), 1);
+	}
+
+	template<> template<> 
+	void TestLLSDBinaryReaderObject::test<7>()
+	{
+		// Compressed blocks, with and without the deprecated header
+		LLSD mesh = makeMesh(3, 16);
+		std::string zipped = zip_llsd(mesh);
+		LLSD value;
+		ensure("unzip", unzip_llsd(value, (const U8*)zipped.data(), zipped.size()));
+		ensure_equals("unzipped", value, mesh);
+
+		std::istringstream stream(zipped);
+		LLSD from_stream;
+		ensure("unzip stream", unzip_llsd(from_stream, stream, zipped.size()));
+		ensure_equals("unzipped stream", from_stream, mesh);
+
+		ensure("bad data", !unzip_llsd(value, (const U8*)"not zlib", 8));
+	}
+
+	template<> template<> 
+	void TestLLSDBinaryReaderObject::test<8>()
+	{
+		set_test_name("binary parse benchmark");
+
+		// A mesh sized LOD block and a header sized map
+		LLSD header;
+		for (S32 i = 0; i < 200; ++i)
+		{
+			header[llformat("key %d", i)] = LLSDMap("offset", i * 1024)("size", 1024);
+		}
+		const LLSD payloads[] = { makeMesh(8, 8192), header };
+		const char* names[] = { "mesh", "header" };
+		const S32 ITERATIONS = 20;
+
+		for (S32 p = 0; p < 2; ++p)
+		{
+			std::string str = toBinary(payloads[p]);
+
+			LLTimer timer;
+			LLSD from_stream;
+			for (S32 i = 0; i < ITERATIONS; ++i)
+			{
+				std::istringstream stream(str);
+				LLSDSerialize::fromBinary(from_stream, stream, str.size());
+			}
+			F64 stream_time = timer.getElapsedTimeF64();
+
+			timer.reset();
+			LLSD from_buffer;
+			for (S32 i = 0; i < ITERATIONS; ++i)
+			{
+				LLSDSerialize::fromBinary(from_buffer, (const U8*)str.data(), str.size());
+			}
+			F64 buffer_time = timer.getElapsedTimeF64();
+
+			ensure_equals(names[p], from_buffer, from_stream);
+			LL_INFOS() << names[p] << " " << str.size() << " bytes, stream parser "
+					   << stream_time * 1000.0 / ITERATIONS << " ms, buffer reader "
+					   << buffer_time * 1000.0 / ITERATIONS << " ms" << LL_ENDL;
+		}
+	}
+
    /**
 	 * @class TestLLSDCrossCompatible
 	 * @brief Miscellaneous serialization and parsing tests
@@ -0,0 +1,266 @@
+/**
+ * @file llthreadpool_test.cpp
+ * @date 2014-10
+ * @brief LLThreadPool and thread pool backed LLQueuedThread test cases.
+ *
+ * $LicenseInfo:firstyear=2014&license=viewerlgpl$
+ * Second Life Viewer Source Code
+ * Copyright (C) 2014, Linden Research, Inc.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation;
+ * version 2.1 of the License only.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ * Linden Research, Inc., 945 Battery Street, San Francisco, CA  94111  USA
+ * $/LicenseInfo$
+ */
+
+#include "linden_common.h"
+
+#include "../llthreadpool.h"
+#include "../llqueuedthread.h"
+#include "../lltimer.h"
+
+#include "../test/lltut.h"
+
+#include <vector>
+
+namespace
+{
+	// Counts itself done, optionally queueing more tasks from the worker.
+	class CountTask : public LLThreadPool::Task
+	{
+	public:
+		CountTask(LLAtomicS32& done, LLThreadPool* pool = NULL, S32 children = 0)
+		:	mDone(done), mPool(pool), mChildren(children)
+		{
+		}
+
+		/*virtual*/ void run()
+		{
+			for (S32 i = 0; i < mChildren; i++)
+			{
+				mPool->submit(new CountTask(mDone), LLThreadPool::BAND_LOW);
+			}
+			mDone++;
+			delete this;
+		}
+
+	private:
+		LLAtomicS32& mDone;
+		LLThreadPool* mPool;
+		S32 mChildren;
+	};
+
+	// Marks every index it is given
+	class MarkRange : public LLThreadPool::RangeTask
+	{
+	public:
+		MarkRange(std::vector<S32>& marks) : mMarks(marks) {}
+
+		/*virtual*/ void run(S32 begin, S32 end)
+		{
+			for (S32 i = begin; i < end; i++)
+			{
+				mMarks[i]++;
+			}
+		}
+
+	private:
+		std::vector<S32>& mMarks;
+	};
+
+	// Runs a parallelFor from inside the pool
+	class NestedTask : public LLThreadPool::Task
+	{
+	public:
+		NestedTask(LLThreadPool& pool, std::vector<S32>& marks, LLAtomicS32& done)
+		:	mPool(pool), mMarks(marks), mDone(done)
+		{
+		}
+
+		/*virtual*/ void run()
+		{
+			MarkRange range(mMarks);
+			mPool.parallelFor((S32)mMarks.size(), 16, range);
+			mDone++;
+			delete this;
+		}
+
+	private:
+		LLThreadPool& mPool;
+		std::vector<S32>& mMarks;
+		LLAtomicS32& mDone;
+	};
+
+	class CountingThread : public LLQueuedThread
+	{
+	public:
+		class CountRequest : public QueuedRequest
+		{
+		public:
+			CountRequest(handle_t handle, LLAtomicS32& done)
+			:	QueuedRequest(handle, PRIORITY_NORMAL, FLAG_AUTO_COMPLETE), mDone(done)
+			{
+			}
+
+			/*virtual*/ bool processRequest()
+			{
+				mDone++;
+				return true;
+			}
+
+		private:
+			LLAtomicS32& mDone;
+		};
+
+		CountingThread(LLThreadPool* pool)
+		:	LLQueuedThread("counting", true, false, pool, pool->getThreadCount())
+		{
+		}
+
+		void add(LLAtomicS32& done)
+		{
+			addRequest(new CountRequest(generateHandle(), done));
+		}
+	};
+
+	// Holds up the only worker of a pool until its time is up
+	class BlockingTask : public LLThreadPool::Task
+	{
+	public:
+		BlockingTask(LLAtomicS32& started, S32 ms) : mStarted(started), mMilliseconds(ms) {}
+
+		/*virtual*/ void run()
+		{
+			mStarted++;
+			ms_sleep(mMilliseconds);
+			delete this;
+		}
+
+	private:
+		LLAtomicS32& mStarted;
+		S32 mMilliseconds;
+	};
+
+	bool wait_for(LLAtomicS32& count, S32 expected)
+	{
+		for (S32 i = 0; i < 1000 && count.CurrentValue() < expected; i++)
+		{
+			ms_sleep(10);
+		}
+		return count.CurrentValue() == expected;
+	}
+}
+
+namespace tut
+{
+	struct threadpool_test
+	{
+	};
+	typedef test_group<threadpool_test> threadpool_group_t;
+	typedef threadpool_group_t::object threadpool_object_t;
+	tut::threadpool_group_t threadpool_instance("LLThreadPool");
+
+	template<> template<>
+	void threadpool_object_t::test<1>()
+	{
+		set_test_name("tasks from outside and inside the pool all run");
+
+		LLThreadPool pool("test pool", 4);
+		ensure_equals("thread count", pool.getThreadCount(), 4);
+
+		LLAtomicS32 done(0);
+		for (S32 i = 0; i < 100; i++)
+		{
+			pool.submit(new CountTask(done, &pool, 10), (LLThreadPool::EBand)(i % LLThreadPool::BAND_COUNT));
+		}
+		ensure("all tasks ran", wait_for(done, 100 * 11));
+	}
+
+	template<> template<>
+	void threadpool_object_t::test<2>()
+	{
+		set_test_name("LLQueuedThread requests run on the pool");
+
+		LLThreadPool pool("test pool", 3);
+		LLAtomicS32 done(0);
+		{
+			CountingThread thread(&pool);
+			ensure("uses pool", thread.usesThreadPool());
+			for (S32 i = 0; i < 500; i++)
+			{
+				thread.add(done);
+			}
+			ensure("all requests ran", wait_for(done, 500));
+
+			for (S32 i = 0; i < 1000 && thread.getPending(); i++)
+			{
+				ms_sleep(10);
+			}
+			ensure_equals("queue drained", thread.getPending(), 0);
+		}
+		ensure_equals("nothing left on the pool", pool.getQueuedTasks(), 0);
+	}
+
+	template<> template<>
+	void threadpool_object_t::test<3>()
+	{
+		set_test_name("parallelFor covers every index once, also from pool threads");
+
+		LLThreadPool pool("test pool", 2);
+
+		std::vector<S32> marks(1000, 0);
+		MarkRange range(marks);
+		pool.parallelFor((S32)marks.size(), 10, range);
+		for (S32 i = 0; i < (S32)marks.size(); i++)
+		{
+			ensure_equals("index run once", marks[i], 1);
+		}
+
+		// Every thread of the pool waiting in parallelFor at once must not
+		// deadlock, the callers do the work themselves.
+		std::vector<S32> first(500, 0), second(500, 0);
+		LLAtomicS32 done(0);
+		pool.submit(new NestedTask(pool, first, done));
+		pool.submit(new NestedTask(pool, second, done));
+		ensure("nested runs finished", wait_for(done, 2));
+		for (S32 i = 0; i < 500; i++)
+		{
+			ensure_equals("first nested index run once", first[i], 1);
+			ensure_equals("second nested index run once", second[i], 1);
+		}
+	}
+
+	template<> template<>
+	void threadpool_object_t::test<4>()
+	{
+		set_test_name("tasks still queued run when the pool is destroyed");
+
+		LLAtomicS32 started(0);
+		LLAtomicS32 done(0);
+		{
+			LLThreadPool pool("test pool", 1);
+			pool.submit(new BlockingTask(started, 200));
+			ensure("worker busy", wait_for(started, 1));
+
+			// Some queue more from the destructor
+			for (S32 i = 0; i < 50; i++)
+			{
+				pool.submit(new CountTask(done, &pool, i % 2), (LLThreadPool::EBand)(i % LLThreadPool::BAND_COUNT));
+			}
+			ensure("still queued", pool.getQueuedTasks() > 0);
+		}
+		ensure_equals("all ran and deleted themselves", done.CurrentValue(), 50 + 25);
+	}
+}
@@ -0,0 +1,286 @@
+/**
+ * @file lluuidindexmap_test.cpp
+ * @date 2014-10
+ * @brief LLUUIDIndexMap probing, erasing, growing and lock-free reads.
+ *
+ * $LicenseInfo:firstyear=2014&license=viewerlgpl$
+ * Second Life Viewer Source Code
+ * Copyright (C) 2014, Linden Research, Inc.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation;
+ * version 2.1 of the License only.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ * Linden Research, Inc., 945 Battery Street, San Francisco, CA  94111  USA
+ * $/LicenseInfo$
+ */
+
+#include "linden_common.h"
+
+#include "../lluuidindexmap.h"
+#include "../llthreadpool.h"
+#include "../lltimer.h"
+
+#include "../test/lltut.h"
+
+#include <vector>
+
+namespace
+{
+	// An id whose hash depends only on slot_hash, below 0x10000 it is the
+	// hash itself: shard 0, home slot slot_hash modulo the table size.  Ids
+	// differing only in serial collide.
+	LLUUID make_id(U32 serial, U32 slot_hash)
+	{
+		U32 words[4] = { serial, slot_hash, serial, 0 };
+		LLUUID id;
+		memcpy(id.mData, words, sizeof(words));
+		return id;
+	}
+
+	struct Entry
+	{
+		Entry() : mFirst(0), mSecond(0) {}
+		LLUUID mID;
+		S32 mFirst;
+		S32 mSecond;	// always written the same as mFirst
+	};
+
+	// Looks ids up until told to stop, counting wrong answers
+	class ReadTask : public LLThreadPool::Task
+	{
+	public:
+		ReadTask(const LLUUIDIndexMap& map, const std::vector<LLUUID>& ids, const std::vector<Entry>* entries,
+				 volatile bool& stop, LLAtomicS32& errors, LLAtomicS32& done)
+		:	mMap(map), mIDs(ids), mEntries(entries), mStop(stop), mErrors(errors), mDone(done)
+		{
+		}
+
+		/*virtual*/ void run()
+		{
+			while (!mStop)
+			{
+				for (S32 i = 0; i < (S32)mIDs.size(); i++)
+				{
+					if (mEntries)
+					{
+						Entry entry;
+						S32 idx = mMap.findEntry(mIDs[i], &(*mEntries)[0], (U32)mEntries->size(), entry);
+						if (idx != i || entry.mID != mIDs[i] || entry.mFirst != entry.mSecond)
+						{
+							mErrors++;
+						}
+					}
+					else if (mMap.find(mIDs[i]) != i)
+					{
+						mErrors++;
+					}
+				}
+			}
+			mDone++;
+			delete this;
+		}
+
+	private:
+		const LLUUIDIndexMap& mMap;
+		const std::vector<LLUUID>& mIDs;
+		const std::vector<Entry>* mEntries;
+		volatile bool& mStop;
+		LLAtomicS32& mErrors;
+		LLAtomicS32& mDone;
+	};
+
+	bool wait_for(LLAtomicS32& count, S32 expected)
+	{
+		for (S32 i = 0; i < 1000 && count.CurrentValue() < expected; i++)
+		{
+			ms_sleep(10);
+		}
+		return count.CurrentValue() == expected;
+	}
+}
+
+namespace tut
+{
+	struct uuidindexmap_test
+	{
+	};
+	typedef test_group<uuidindexmap_test> uuidindexmap_group_t;
+	typedef uuidindexmap_group_t::object uuidindexmap_object_t;
+	tut::uuidindexmap_group_t uuidindexmap_instance("LLUUIDIndexMap");
+
+	template<> template<>
+	void uuidindexmap_object_t::test<1>()
+	{
+		set_test_name("insert, find, replace and erase");
+
+		LLUUIDIndexMap map;
+		ensure_equals("empty", map.find(make_id(1, 1)), -1);
+
+		for (S32 i = 0; i < 1000; i++)
+		{
+			LLUUID id;
+			id.generate();
+			map.insert(id, i);
+			ensure_equals("found after insert", map.find(id), i);
+			map.insert(id, i + 1);
+			ensure_equals("replaced", map.find(id), i + 1);
+			map.erase(id);
+			ensure_equals("gone after erase", map.find(id), -1);
+			map.erase(id);
+		}
+		ensure_equals("nothing left", map.size(), 0U);
+	}
+
+	template<> template<>
+	void uuidindexmap_object_t::test<2>()
+	{
+		set_test_name("erase shifts the rest of a probe run back");
+
+		LLUUIDIndexMap map;
+
+		// Runs at 5..9, and at 62..63 wrapping round to 0..2, with members
+		// from other homes mixed in
+		std::vector<LLUUID> ids;
+		const U32 homes[] = { 5, 5, 6, 5, 7, 62, 62, 63, 62, 0 };
+		const S32 count = (S32)(sizeof(homes) / sizeof(homes[0]));
+		for (S32 i = 0; i < count; i++)
+		{
+			ids.push_back(make_id(i + 1, homes[i]));
+			map.insert(ids[i], i);
+		}
+
+		// Erasing in any order must leave the rest findable
+		for (S32 first = 0; first < count; first++)
+		{
+			std::vector<bool> erased(count, false);
+			for (S32 i = 0; i < count; i++)
+			{
+				map.insert(ids[i], i);
+			}
+			for (S32 n = 0; n < count; n++)
+			{
+				S32 victim = (first + n * 3) % count;
+				map.erase(ids[victim]);
+				erased[victim] = true;
+				for (S32 i = 0; i < count; i++)
+				{
+					ensure_equals("rest still found", map.find(ids[i]), erased[i] ? -1 : i);
+				}
+			}
+			for (S32 i = 0; i < count; i++)
+			{
+				ensure_equals("all erased", map.find(ids[i]), -1);
+			}
+		}
+
+		// Erasing from the middle of one run keeps each member findable
+		for (S32 i = 0; i < count; i++)
+		{
+			map.insert(ids[i], i);
+		}
+		map.erase(ids[1]);
+		map.erase(ids[6]);
+		for (S32 i = 0; i < count; i++)
+		{
+			ensure_equals("found after middle erase", map.find(ids[i]), (i == 1 || i == 6) ? -1 : i);
+		}
+		ensure_equals("size", map.size(), (U32)count - 2);
+	}
+
+	template<> template<>
+	void uuidindexmap_object_t::test<3>()
+	{
+		set_test_name("growing while other threads read");
+
+		LLUUIDIndexMap map;
+		std::vector<LLUUID> ids;
+		for (S32 i = 0; i < 200; i++)
+		{
+			ids.push_back(make_id(i + 1, i % 64));
+			map.insert(ids[i], i);
+		}
+
+		volatile bool stop = false;
+		LLAtomicS32 errors(0);
+		LLAtomicS32 done(0);
+		{
+			LLThreadPool pool("index readers", 3);
+			for (S32 i = 0; i < pool.getThreadCount(); i++)
+			{
+				pool.submit(new ReadTask(map, ids, NULL, stop, errors, done));
+			}
+
+			// All into shard 0, so its table grows several times over
+			for (S32 i = 0; i < 20000; i++)
+			{
+				map.insert(make_id(i + 1000, i % 0x10000), 1000 + i);
+				if (i % 3 == 0)
+				{
+					map.erase(make_id(i + 1000, i % 0x10000));
+				}
+			}
+			stop = true;
+			ensure("readers stopped", wait_for(done, pool.getThreadCount()));
+		}
+		ensure_equals("readers always found the old ids", errors.CurrentValue(), 0);
+		for (S32 i = 0; i < (S32)ids.size(); i++)
+		{
+			ensure_equals("old id", map.find(ids[i]), i);
+		}
+	}
+
+	template<> template<>
+	void uuidindexmap_object_t::test<4>()
+	{
+		set_test_name("findEntry never sees half of a writeEntry");
+
+		LLUUIDIndexMap map;
+		std::vector<LLUUID> ids;
+		std::vector<Entry> entries(100);
+		for (S32 i = 0; i < (S32)entries.size(); i++)
+		{
+			ids.push_back(make_id(i + 1, i % 8));
+			entries[i].mID = ids[i];
+			map.insert(ids[i], i);
+		}
+
+		volatile bool stop = false;
+		LLAtomicS32 errors(0);
+		LLAtomicS32 done(0);
+		{
+			LLThreadPool pool("entry readers", 3);
+			for (S32 i = 0; i < pool.getThreadCount(); i++)
+			{
+				pool.submit(new ReadTask(map, ids, &entries, stop, errors, done));
+			}
+
+			for (S32 n = 0; n < 200000; n++)
+			{
+				Entry entry;
+				entry.mID = ids[n % ids.size()];
+				entry.mFirst = n;
+				entry.mSecond = n;
+				map.writeEntry(entry, &entries[n % ids.size()]);
+			}
+			stop = true;
+			ensure("readers stopped", wait_for(done, pool.getThreadCount()));
+		}
+		ensure_equals("no torn entries", errors.CurrentValue(), 0);
+
+		Entry entry;
+		ensure_equals("index", map.findEntry(ids[7], &entries[0], (U32)entries.size(), entry), 7);
+		ensure("entry", entry.mID == ids[7] && entry.mFirst == entries[7].mFirst);
+		ensure_equals("missing id", map.findEntry(make_id(5000, 3), &entries[0], (U32)entries.size(), entry), -1);
+	}
+}
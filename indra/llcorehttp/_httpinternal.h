@@ -145,8 +145,19 @@ const int HTTP_CONNECTION_LIMIT_DEFAULT = 8;
 const int HTTP_CONNECTION_LIMIT_MIN = 1;
 const int HTTP_CONNECTION_LIMIT_MAX = 256;
 
-// Miscellaneous defaults
+// Pipelining depth.  Depths of 0 and 1 mean no pipelining.
 const long HTTP_PIPELINING_DEFAULT = 0L;
+const long HTTP_PIPELINING_MAX = 20L;
+
+// Consecutive failures of requests on reused, pipelined connections
+// after which a policy class stops pipelining.
+const int HTTP_PIPELINING_FAILURE_LIMIT = 3;
+
+// Largest Content-Length for which a response body is
+// received into one contiguous block.
+const size_t HTTP_BODY_RESERVE_MAX = 16 * 1024 * 1024;
+
+// Miscellaneous defaults
 const bool HTTP_USE_RETRY_AFTER_DEFAULT = true;
 const long HTTP_THROTTLE_RATE_DEFAULT = 0L;
 
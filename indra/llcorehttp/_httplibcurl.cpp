@@ -38,11 +38,32 @@ namespace LLCore
 {
 
 
+// Per-policy-class transport state.  Pipelining as actually
+// in effect on the multi handle and the counters reported
+// through HttpRequest::getPolicyStats().
+//
+// Threading:  accessed only by worker thread (and init
+// thread before the worker starts)
+struct HttpLibcurl::ClassState
+{
+public:
+	ClassState()
+		: mPipelineRequested(-1L),
+		  mPipelineFailures(0)
+		{}
+
+	long						mPipelineRequested;		// PO_PIPELINING_DEPTH in effect, -1 after a fallback
+	int							mPipelineFailures;		// Consecutive, reset by a good pipelined request
+	HttpRequest::PolicyStats	mStats;
+};
+
+
 HttpLibcurl::HttpLibcurl(HttpService * service)
 	: mService(service),
 	  mPolicyCount(0),
 	  mMultiHandles(NULL),
-	  mActiveHandles(NULL)
+	  mActiveHandles(NULL),
+	  mClassStates(NULL)
 {}
 
 
@@ -81,6 +102,9 @@ void HttpLibcurl::shutdown()
 
 		delete [] mActiveHandles;
 		mActiveHandles = NULL;
+
+		delete [] mClassStates;
+		mClassStates = NULL;
 	}
 
 	mPolicyCount = 0;
@@ -95,11 +119,144 @@ void HttpLibcurl::start(int policy_count)
 	mPolicyCount = policy_count;
 	mMultiHandles = new CURLM * [mPolicyCount];
 	mActiveHandles = new int [mPolicyCount];
+	mClassStates = new ClassState [mPolicyCount];
 	
 	for (int policy_class(0); policy_class < mPolicyCount; ++policy_class)
 	{
 		mMultiHandles[policy_class] = curl_multi_init();
 		mActiveHandles[policy_class] = 0;
+		policyUpdated(policy_class);
+	}
+}
+
+
+void HttpLibcurl::policyUpdated(int policy_class)
+{
+	if (policy_class < 0 || policy_class >= mPolicyCount || ! mMultiHandles[policy_class])
+	{
+		return;
+	}
+
+	HttpPolicy & policy(mService->getPolicy());
+	const HttpPolicyClass & options(policy.getClassOptions(policy_class));
+	ClassState & state(mClassStates[policy_class]);
+	CURLM * multi_handle(mMultiHandles[policy_class]);
+
+	if (options.mPipelining != state.mPipelineRequested)
+	{
+		// A new depth also gives a server that failed earlier another chance
+		state.mPipelineRequested = options.mPipelining;
+		state.mPipelineFailures = 0;
+		state.mStats.mPipeliningFailed = false;
+		setPipelining(policy_class, options.mPipelining);
+	}
+
+#if LIBCURL_VERSION_NUM >= 0x071e00
+	// Older libcurls have no per-multi connection limits, the
+	// policy layer's request limit is all there is.
+	curl_multi_setopt(multi_handle, CURLMOPT_MAX_TOTAL_CONNECTIONS, options.mConnectionLimit);
+	curl_multi_setopt(multi_handle, CURLMOPT_MAX_HOST_CONNECTIONS, options.mPerHostConnectionLimit);
+#endif
+	curl_multi_setopt(multi_handle, CURLMOPT_MAXCONNECTS, options.mConnectionLimit);
+}
+
+
+void HttpLibcurl::setPipelining(int policy_class, long depth)
+{
+	CURLM * multi_handle(mMultiHandles[policy_class]);
+	const bool enable(depth > 1L);
+
+	curl_multi_setopt(multi_handle, CURLMOPT_PIPELINING, enable ? 1L : 0L);
+#if LIBCURL_VERSION_NUM >= 0x071e00
+	// Older libcurls pipeline to a fixed depth of five
+	if (enable)
+	{
+		curl_multi_setopt(multi_handle, CURLMOPT_MAX_PIPELINE_LENGTH, depth);
+	}
+#endif
+	mClassStates[policy_class].mStats.mPipeliningDepth = enable ? depth : 1L;
+}
+
+
+int HttpLibcurl::getPipelineDepth(int policy_class) const
+{
+	llassert_always(policy_class < mPolicyCount);
+
+	return mClassStates ? int(mClassStates[policy_class].mStats.mPipeliningDepth) : 1;
+}
+
+
+void HttpLibcurl::getPolicyStats(int policy_class, HttpRequest::PolicyStats & stats) const
+{
+	llassert_always(policy_class < mPolicyCount);
+
+	stats = mClassStates[policy_class].mStats;
+	stats.mActive = mActiveHandles[policy_class];
+}
+
+
+void HttpLibcurl::recordTransfer(int policy_class, CURL * handle, CURLcode status)
+{
+	ClassState & state(mClassStates[policy_class]);
+	HttpRequest::PolicyStats & stats(state.mStats);
+
+	long connects(0L), header_size(0L), request_size(0L);
+	double appconnect_time(0.0), download_size(0.0), upload_size(0.0);
+	curl_easy_getinfo(handle, CURLINFO_NUM_CONNECTS, &connects);
+	curl_easy_getinfo(handle, CURLINFO_APPCONNECT_TIME, &appconnect_time);
+	curl_easy_getinfo(handle, CURLINFO_HEADER_SIZE, &header_size);
+	curl_easy_getinfo(handle, CURLINFO_REQUEST_SIZE, &request_size);
+	curl_easy_getinfo(handle, CURLINFO_SIZE_DOWNLOAD, &download_size);
+	curl_easy_getinfo(handle, CURLINFO_SIZE_UPLOAD, &upload_size);
+
+	++stats.mRequests;
+	if (connects > 0L)
+	{
+		stats.mConnectionsOpened += connects;
+		if (appconnect_time > 0.0)
+		{
+			++stats.mTLSHandshakes;
+		}
+	}
+	else
+	{
+		++stats.mConnectionsReused;
+	}
+	stats.mBytesReceived += U64(header_size) + U64(download_size);
+	stats.mBytesSent += U64(request_size) + U64(upload_size);
+
+	if (stats.mPipeliningDepth <= 1L || connects > 0L)
+	{
+		// Only requests queued behind others on a connection tell
+		// us anything about the server's pipelining.
+		return;
+	}
+
+	if (CURLE_GOT_NOTHING == status
+		|| CURLE_RECV_ERROR == status
+		|| CURLE_SEND_ERROR == status
+		|| CURLE_PARTIAL_FILE == status)
+	{
+		// Connections closed under queued requests or responses
+		// cut short.  A few in a row and we stop pipelining, the
+		// policy layer retries the requests as usual.
+		if (++state.mPipelineFailures >= HTTP_PIPELINING_FAILURE_LIMIT)
+		{
+			LL_WARNS("CoreHttp") << "Pipelined requests failing in policy class " << policy_class
+								 << ", last status:  " << curl_easy_strerror(status)
+								 << ".  Pipelining disabled for the class."
+								 << LL_ENDL;
+			setPipelining(policy_class, 0L);
+			stats.mPipeliningFailed = true;
+			state.mPipelineFailures = 0;
+			// No longer what is in effect, so the next policy
+			// update, even to the same depth, tries again
+			state.mPipelineRequested = -1L;
+		}
+	}
+	else if (CURLE_OK == status)
+	{
+		state.mPipelineFailures = 0;
 	}
 }
 
@@ -287,6 +444,8 @@ bool HttpLibcurl::completeRequest(CURLM * multi_handle, CURL * handle, CURLcode
 	--mActiveHandles[op->mReqPolicy];
 	op->mCurlActive = false;
 
+	recordTransfer(op->mReqPolicy, handle, status);
+
 	// Set final status of request if it hasn't failed by other mechanisms yet
 	if (op->mStatus)
 	{
@@ -107,6 +107,26 @@ public:
 	int getActiveCount() const;
 	int getActiveCountInClass(int policy_class) const;
 
+	/// Push the current options of a policy class (pipelining and
+	/// connection limits) down to its libcurl multi handle.  Called
+	/// on start and whenever an option of the class is changed.
+	///
+	/// Threading:  called by init thread before the worker starts
+	/// and by the worker thread after.
+	void policyUpdated(int policy_class);
+
+	/// Number of requests the class may have in flight on each
+	/// connection.  1 when pipelining is off or has failed over.
+	///
+	/// Threading:  called by worker thread.
+	int getPipelineDepth(int policy_class) const;
+
+	/// Copy out the connection and byte counters for a class.
+	/// Queue lengths are left to the policy layer.
+	///
+	/// Threading:  called by worker thread.
+	void getPolicyStats(int policy_class, HttpRequest::PolicyStats & stats) const;
+
 	/// Attempt to cancel a request identified by handle.
 	///
 	/// Interface shadows HttpService's method.
@@ -124,9 +144,17 @@ protected:
 	/// Invoked to cancel an active request, mainly during shutdown
 	/// and destroy.
 	void cancelRequest(HttpOpRequest * op);
+
+	/// Update counters for a finished request and watch for
+	/// servers that mishandle pipelined requests.
+	void recordTransfer(int policy_class, CURL * handle, CURLcode status);
+
+	/// Turn pipelining on or off for a class' multi handle.
+	void setPipelining(int policy_class, long depth);
 	
 protected:
 	typedef std::set<HttpOpRequest *> active_set_t;
+	struct ClassState;
 	
 protected:
 	HttpService *		mService;				// Simple reference, not owner
@@ -134,6 +162,7 @@ protected:
 	int					mPolicyCount;
 	CURLM **			mMultiHandles;			// One handle per policy class
 	int *				mActiveHandles;			// Active count per policy class
+	ClassState *		mClassStates;			// Pipelining state and counters per policy class
 }; // end class HttpLibcurl
 
 }  // end namespace LLCore
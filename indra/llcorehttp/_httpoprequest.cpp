@@ -628,6 +628,16 @@ size_t HttpOpRequest::writeCallback(void * data, size_t size, size_t nmemb, void
 	if (! op->mReplyBody)
 	{
 		op->mReplyBody = new BufferArray();
+
+		// Headers are in by the first write.  Sizing one block to
+		// the body lets consumers decode it in place.
+		double content_length(-1.0);
+		if (CURLE_OK == curl_easy_getinfo(op->mCurlHandle, CURLINFO_CONTENT_LENGTH_DOWNLOAD, &content_length)
+			&& content_length > 0.0
+			&& content_length <= double(HTTP_BODY_RESERVE_MAX))
+		{
+			op->mReplyBody->reserve(size_t(content_length));
+		}
 	}
 	const size_t req_size(size * nmemb);
 	const size_t write_size(op->mReplyBody->append(static_cast<char *>(data), req_size));
@@ -233,8 +233,11 @@ HttpService::ELoopSpeed HttpPolicy::processReadyQueue()
 			continue;
 		}
 
+		// With pipelining, the connection limit bounds connections
+		// and each may carry a full pipeline of requests.
 		int active(transport.getActiveCountInClass(policy_class));
-		int needed(state.mOptions.mConnectionLimit - active);		// Expect negatives here
+		int needed(state.mOptions.mConnectionLimit * transport.getPipelineDepth(policy_class)
+				   - active);		// Expect negatives here
 
 		if (needed > 0)
 		{
@@ -52,7 +52,7 @@ const HttpService::OptionDescriptor HttpService::sOptionDesc[] =
 	{	false,		true,		true,		false	},		// PO_HTTP_PROXY
 	{	true,		true,		true,		false	},		// PO_LLPROXY
 	{	true,		true,		true,		false	},		// PO_TRACE
-	{	true,		true,		false,		true	},		// PO_ENABLE_PIPELINING
+	{	true,		true,		false,		true	},		// PO_PIPELINING_DEPTH
 	{	true,		true,		false,		true	}		// PO_THROTTLE_RATE
 };
 HttpService * HttpService::sInstance(NULL);
@@ -192,6 +192,11 @@ void HttpService::startThread()
 	mPolicy->start();
 	mTransport->start(mLastPolicy + 1);
 
+	{
+		LLCoreInt::HttpScopedLock lock(mStatsMutex);
+		mStats.resize(mLastPolicy + 1);
+	}
+
 	mThread = new LLCoreInt::HttpThread(boost::bind(&HttpService::threadRun, this, _1));
 	sState = RUNNING;
 }
@@ -294,6 +299,8 @@ void HttpService::threadRun(LLCoreInt::HttpThread * thread)
 		// Give libcurl some cycles
 		new_loop = mTransport->processTransport();
 		loop = (std::min)(loop, new_loop);
+
+		publishStats();
 		
 		// Determine whether to spin, sleep briefly or sleep for next request
 		if (REQUEST_SLEEP != loop)
@@ -437,6 +444,11 @@ HttpStatus HttpService::setPolicyOption(HttpRequest::EPolicyOption opt, HttpRequ
 		HttpPolicyClass & opts(mPolicy->getClassOptions(pclass));
 
 		status = opts.set(opt, value);
+		if (status && RUNNING == sState)
+		{
+			// Before the thread starts, start() picks the options up
+			mTransport->policyUpdated(pclass);
+		}
 		if (status && ret_value)
 		{
 			status = opts.get(opt, ret_value);
@@ -447,6 +459,32 @@ HttpStatus HttpService::setPolicyOption(HttpRequest::EPolicyOption opt, HttpRequ
 }
 
 
+HttpStatus HttpService::getPolicyStats(HttpRequest::policy_t pclass, HttpRequest::PolicyStats * stats)
+{
+	if (! stats || pclass > mLastPolicy)
+	{
+		return HttpStatus(HttpStatus::LLCORE, LLCore::HE_INVALID_ARG);
+	}
+
+	LLCoreInt::HttpScopedLock lock(mStatsMutex);
+	*stats = pclass < mStats.size() ? mStats[pclass] : HttpRequest::PolicyStats();
+	return HttpStatus();
+}
+
+
+void HttpService::publishStats()
+{
+	LLCoreInt::HttpScopedLock lock(mStatsMutex);
+	for (HttpRequest::policy_t pclass(0); pclass < mStats.size(); ++pclass)
+	{
+		HttpRequest::PolicyStats & stats(mStats[pclass]);
+
+		mTransport->getPolicyStats(pclass, stats);
+		stats.mQueued = mPolicy->getReadyCount(pclass);
+	}
+}
+
+
 HttpStatus HttpService::setPolicyOption(HttpRequest::EPolicyOption opt, HttpRequest::policy_t pclass,
 										const std::string & value, std::string * ret_value)
 {
@@ -36,6 +36,7 @@
 #include "httprequest.h"
 #include "_httppolicyglobal.h"
 #include "_httppolicyclass.h"
+#include "_mutex.h"
 
 
 namespace LLCoreInt
@@ -183,12 +184,23 @@ public:
 
 	/// Threading:  callable by consumer thread.
 	HttpRequest::policy_t createPolicyClass();
+
+	/// Copy out the last published counters for a policy class.
+	///
+	/// Threading:  callable by any thread.
+	HttpStatus getPolicyStats(HttpRequest::policy_t pclass, HttpRequest::PolicyStats * stats);
 	
 protected:
 	void threadRun(LLCoreInt::HttpThread * thread);
 	
 	ELoopSpeed processRequestQueue(ELoopSpeed loop);
 
+	/// Gather policy and transport counters into mStats for
+	/// other threads to read.
+	///
+	/// Threading:  callable by worker thread.
+	void publishStats();
+
 protected:
 	friend class HttpOpSetGet;
 	friend class HttpRequest;
@@ -221,6 +233,8 @@ protected:
 	HttpRequestQueue *					mRequestQueue;	// Refcounted
 	LLAtomicU32							mExitRequested;
 	LLCoreInt::HttpThread *				mThread;
+	LLCoreInt::HttpMutex				mStatsMutex;
+	std::vector<HttpRequest::PolicyStats>	mStats;		// Per class, guarded by mStatsMutex
 	
 	// === working-thread-only data ===
 	HttpPolicy *						mPolicy;		// Simple pointer, has ownership
@@ -26,11 +26,14 @@
 
 #include "bufferarray.h"
 
+#include "llmemory.h"
+
 
 // BufferArray is a list of chunks, each a BufferArray::Block, of contiguous
 // data presented as a single array.  Chunks are at least BufferArray::BLOCK_ALLOC_SIZE
 // in length and can be larger.  Any chunk may be partially filled or even
-// empty.
+// empty.  Chunks made by reserve() are sized to the request instead and
+// keep their data in separate, aligned storage that can be detached.
 //
 // The BufferArray itself is sharable as a RefCounted entity.  As shared
 // reads don't work with the concept of a current position/seek value,
@@ -56,7 +59,7 @@ public:
 	void operator delete(void *, size_t len);
 
 protected:
-	Block(size_t len);
+	Block(size_t len, char * storage);
 
 	Block(const Block &);						// Not defined
 	void operator=(const Block &);				// Not defined
@@ -66,17 +69,23 @@ protected:
 	void * operator new(size_t len, size_t addl_len);
 	
 public:
-	// Only public entry to get a block.
+	// Only public entries to get a block.
 	static Block * alloc(size_t len);
+	static Block * allocAligned(size_t len);
+
+	// Give up aligned storage leaving an empty block,
+	// NULL for blocks with inline storage.
+	char * detach();
 
 public:
 	size_t mUsed;
 	size_t mAlloced;
+	char * mData;		// mInline or aligned storage
 
 	// *NOTE:  Must be last member of the object.  We'll
 	// overallocate as requested via operator new and index
 	// into the array at will.
-	char mData[1];		
+	char mInline[1];
 };
 
 
@@ -168,6 +177,78 @@ void * BufferArray::appendBufferAlloc(size_t len)
 }
 
 
+void BufferArray::reserve(size_t len)
+{
+	if (! mBlocks.empty())
+	{
+		const Block & last(*mBlocks.back());
+		if (last.mAlloced - last.mUsed >= len)
+		{
+			// Already room at the end
+			return;
+		}
+	}
+
+	if (mBlocks.size() >= mBlocks.capacity())
+	{
+		mBlocks.reserve(mBlocks.size() + 5);
+	}
+	mBlocks.push_back(Block::allocAligned(len));
+}
+
+
+const void * BufferArray::getContiguous(size_t pos, size_t len)
+{
+	if (pos >= mLen || len > mLen - pos)
+		return NULL;
+
+	size_t offset(0);
+	int block(findBlock(pos, &offset));
+	if (block < 0)
+		return NULL;
+
+	const Block & b(*mBlocks[block]);
+	if (len > b.mUsed - offset)
+		return NULL;
+	return &b.mData[offset];
+}
+
+
+void * BufferArray::detach(size_t * len)
+{
+	*len = 0;
+
+	// Exactly one block may hold data
+	Block * data_block(NULL);
+	for (container_t::iterator it(mBlocks.begin()); it != mBlocks.end(); ++it)
+	{
+		if ((*it)->mUsed)
+		{
+			if (data_block)
+				return NULL;
+			data_block = *it;
+		}
+	}
+	if (! data_block)
+		return NULL;
+
+	const size_t used(data_block->mUsed);
+	char * storage(data_block->detach());
+	if (! storage)
+		return NULL;
+
+	for (container_t::iterator it(mBlocks.begin()); it != mBlocks.end(); ++it)
+	{
+		delete *it;
+	}
+	mBlocks.clear();
+	mLen = 0;
+
+	*len = used;
+	return storage;
+}
+
+
 size_t BufferArray::read(size_t pos, void * dst, size_t len)
 {
 	char * c_dst(static_cast<char *>(dst));
@@ -307,21 +388,45 @@ bool BufferArray::getBlockStartEnd(int block, const char ** start, const char **
 // ==================================
 
 
-BufferArray::Block::Block(size_t len)
+BufferArray::Block::Block(size_t len, char * storage)
 	: mUsed(0),
-	  mAlloced(len)
+	  mAlloced(len),
+	  mData(storage ? storage : mInline)
 {
-	memset(mData, 0, len);
+	if (! storage)
+	{
+		memset(mData, 0, len);
+	}
 }
 			
 
 BufferArray::Block::~Block()
 {
+	if (mData != mInline)
+	{
+		ll_aligned_free_16(mData);
+	}
+	mData = NULL;
 	mUsed = 0;
 	mAlloced = 0;
 }
 
 
+char * BufferArray::Block::detach()
+{
+	if (mData == mInline)
+	{
+		return NULL;
+	}
+
+	char * storage(mData);
+	mData = mInline;
+	mUsed = 0;
+	mAlloced = 0;
+	return storage;
+}
+
+
 void * BufferArray::Block::operator new(size_t len, size_t addl_len)
 {
 	void * mem = new char[len + addl_len + sizeof(void *)];
@@ -344,7 +449,20 @@ void BufferArray::Block::operator delete(void * mem, size_t)
 
 BufferArray::Block * BufferArray::Block::alloc(size_t len)
 {
-	Block * block = new (len) Block(len);
+	Block * block = new (len) Block(len, NULL);
+	return block;
+}
+
+
+BufferArray::Block * BufferArray::Block::allocAligned(size_t len)
+{
+	// Reserved blocks are filled by the caller, skip the memset
+	char * storage = static_cast<char *>(ll_aligned_malloc_16((std::max)(len, size_t(16))));
+	if (! storage)
+	{
+		return alloc(len);
+	}
+	Block * block = new (0) Block(len, storage);
 	return block;
 }
 	
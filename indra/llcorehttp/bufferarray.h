@@ -101,12 +101,41 @@ public:
 	///					of BufferArray of 'len' size.
 	void * appendBufferAlloc(size_t len);
 
+	/// Makes sure the next 'len' bytes appended land in a
+	/// single block.  Meant to be called with a response's
+	/// Content-Length before the body arrives so that the
+	/// whole body can be used in place.  Reserved blocks are
+	/// 16-byte aligned and allocated apart from the block
+	/// header so that @see detach() can hand them out.
+	void reserve(size_t len);
+
 	/// Current count of bytes in BufferArray instance.
 	size_t size() const
 		{
 			return mLen;
 		}
 
+	/// Borrow a pointer to 'len' bytes starting at 'pos'
+	/// if they are contiguous in the instance.  The pointer
+	/// is good until the next modifying call or until the
+	/// last reference is released, callers hanging on to it
+	/// should hold a reference.
+	///
+	/// @return			Pointer to the data or NULL if the
+	///					range is out of bounds or spans
+	///					blocks.  Use @see read() then.
+	const void * getContiguous(size_t pos, size_t len);
+
+	/// Take over the storage when all of the data is in one
+	/// reserved block.  The instance is left empty.
+	///
+	/// @param	len		Receives the count of bytes in the
+	///					returned storage.
+	/// @return			Storage to be freed by the caller with
+	///					ll_aligned_free_16() or NULL if the data
+	///					isn't in a single reserved block.
+	void * detach(size_t * len);
+
 	/// Copies data from the given position in the instance
 	/// to the caller's buffer.  Will return a short count of
 	/// bytes copied if the 'len' extends beyond the data.
@@ -96,6 +96,31 @@ HttpRequest::policy_t HttpRequest::createPolicyClass()
 }
 
 
+HttpRequest::PolicyStats::PolicyStats()
+	: mActive(0L),
+	  mQueued(0L),
+	  mPipeliningDepth(1L),
+	  mPipeliningFailed(false),
+	  mRequests(0U),
+	  mConnectionsOpened(0U),
+	  mConnectionsReused(0U),
+	  mTLSHandshakes(0U),
+	  mBytesReceived(0U),
+	  mBytesSent(0U)
+{}
+
+
+HttpStatus HttpRequest::getPolicyStats(policy_t pclass, PolicyStats * stats)
+{
+	HttpService * service(HttpService::instanceOf());
+	if (! service)
+	{
+		return HttpStatus(HttpStatus::LLCORE, HE_INVALID_ARG);
+	}
+	return service->getPolicyStats(pclass, stats);
+}
+
+
 HttpStatus HttpRequest::setStaticPolicyOption(EPolicyOption opt, policy_t pclass,
 											  long value, long * ret_value)
 {
@@ -183,11 +183,18 @@ public:
 		/// Global only
 		PO_TRACE,
 
-		/// Suitable requests are allowed to pipeline on their
-		/// connections when they ask for it.
+		/// Long value giving the number of requests that may be
+		/// pipelined on a single connection.  Values of 0 or 1
+		/// disable pipelining (the default), larger values enable
+		/// it for GET requests in the class.  The class' connection
+		/// limit then caps connections rather than requests and up
+		/// to limit * depth requests may be in flight.  If the
+		/// server is seen to break pipelined requests, the class
+		/// falls back to one request per connection until the
+		/// option is set again.
 		///
 		/// Per-class only
-		PO_ENABLE_PIPELINING,
+		PO_PIPELINING_DEPTH,
 
 		/// Controls whether client-side throttling should be
 		/// performed on this policy class.  Positive values
@@ -233,6 +240,34 @@ public:
 	HttpHandle setPolicyOption(EPolicyOption opt, policy_t pclass, const std::string & value,
 							   HttpHandler * handler);
 
+	/// Counters kept by the worker thread for each policy class.
+	/// Totals count from service start, the others are the state
+	/// at the last pass through the worker loop.
+	struct PolicyStats
+	{
+		PolicyStats();
+
+		long				mActive;				// Requests handed to libcurl
+		long				mQueued;				// Requests on ready and retry queues
+		long				mPipeliningDepth;		// Depth in effect, 1 when not pipelining
+		bool				mPipeliningFailed;		// Fell back after pipelining errors
+
+		U64					mRequests;				// Total completed by transport
+		U64					mConnectionsOpened;		// Total requests that opened a connection
+		U64					mConnectionsReused;		// Total requests sent on an open connection
+		U64					mTLSHandshakes;			// Total SSL/TLS handshakes
+		U64					mBytesReceived;			// Total headers and bodies
+		U64					mBytesSent;				// Total request headers and bodies
+	};
+
+	/// Copy out the counters for a policy class.  Threading:  callable
+	/// by any thread, takes a lock shared with the worker thread.
+	///
+	/// @param pclass		Policy class to be queried.
+	/// @param stats		Receives the counters when successful.
+	/// @return				Standard status code.
+	static HttpStatus getPolicyStats(policy_t pclass, PolicyStats * stats);
+
 	/// @}
 
 	/// @name RequestMethods
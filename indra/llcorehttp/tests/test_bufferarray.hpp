@@ -30,6 +30,8 @@
 
 #include <iostream>
 
+#include "llmemory.h"
+
 #include "test_allocator.h"
 
 
@@ -426,6 +428,92 @@ void BufferArrayTestObjectType::test<8>()
 	ensure("All memory released", mMemTotal == GetMemTotal());
 }
 
+template <> template <>
+void BufferArrayTestObjectType::test<9>()
+{
+	set_test_name("BufferArray reserve, getContiguous and detach");
+
+	// record the total amount of dynamically allocated memory
+	mMemTotal = GetMemTotal();
+
+	// create a new ref counted object with an implicit reference
+	BufferArray * ba = new BufferArray();
+
+	// Reserve more than a standard block and fill it in pieces
+	const size_t body_len(BufferArray::BLOCK_ALLOC_SIZE + 1000);
+	ba->reserve(body_len);
+	ensure("Reserve doesn't change size", 0 == ba->size());
+
+	char piece[1000];
+	for (size_t i(0); i < sizeof(piece); ++i)
+	{
+		piece[i] = char(i);
+	}
+	size_t written(0);
+	while (written < body_len)
+	{
+		written += ba->append(piece, (std::min)(sizeof(piece), body_len - written));
+	}
+	ensure("All data appended", body_len == ba->size());
+
+	const char * whole(static_cast<const char *>(ba->getContiguous(0, body_len)));
+	ensure("Reserved body is contiguous", NULL != whole);
+	ensure("Reserved body is aligned", 0 == (reinterpret_cast<size_t>(whole) & 0xf));
+	ensure("Contiguous content correct", 0 == memcmp(whole + 2000, piece, sizeof(piece)));
+	ensure("Range inside is contiguous", whole + 10 == ba->getContiguous(10, 100));
+	ensure("Range past end refused", NULL == ba->getContiguous(10, body_len));
+
+	size_t detached_len(0);
+	char * storage(static_cast<char *>(ba->detach(&detached_len)));
+	ensure("Reserved body detached", NULL != storage);
+	ensure("Detached length correct", body_len == detached_len);
+	ensure("Detached storage is the borrowed one", whole == storage);
+	ensure("Empty after detach", 0 == ba->size());
+	ll_aligned_free_16(storage);
+
+	// release the implicit reference, causing the object to be released
+	ba->release();
+
+	// make sure we didn't leak any memory
+	ensure("All memory released", mMemTotal == GetMemTotal());
+}
+
+template <> template <>
+void BufferArrayTestObjectType::test<10>()
+{
+	set_test_name("BufferArray getContiguous and detach across blocks");
+
+	// record the total amount of dynamically allocated memory
+	mMemTotal = GetMemTotal();
+
+	// create a new ref counted object with an implicit reference
+	BufferArray * ba = new BufferArray();
+
+	// Without a reserve, data spills from one standard block into the next
+	char str1[] = "abcdefghij";
+	size_t str1_len(strlen(str1));
+	void * out_buf(ba->appendBufferAlloc(BufferArray::BLOCK_ALLOC_SIZE - 5));
+	memset(out_buf, 'X', BufferArray::BLOCK_ALLOC_SIZE - 5);
+	ba->append(str1, str1_len);
+	ensure("Two blocks of data", BufferArray::BLOCK_ALLOC_SIZE + 5 == ba->size());
+
+	ensure("First block is contiguous",
+		   out_buf == ba->getContiguous(0, BufferArray::BLOCK_ALLOC_SIZE - 5));
+	ensure("Range across blocks refused",
+		   NULL == ba->getContiguous(BufferArray::BLOCK_ALLOC_SIZE - 2, 5));
+
+	size_t detached_len(0);
+	ensure("Standard blocks aren't detached", NULL == ba->detach(&detached_len));
+	ensure("Nothing detached", 0 == detached_len);
+	ensure("Data kept after failed detach", BufferArray::BLOCK_ALLOC_SIZE + 5 == ba->size());
+
+	// release the implicit reference, causing the object to be released
+	ba->release();
+
+	// make sure we didn't leak any memory
+	ensure("All memory released", mMemTotal == GetMemTotal());
+}
+
 }  // end namespace tut
 
 
@@ -3311,6 +3311,143 @@ void HttpRequestTestObjectType::test<23>()
 }
 
 
+template <> template <>
+void HttpRequestTestObjectType::test<24>()
+{
+	ScopedCurlInit ready;
+
+	std::string url_base(get_base_url());
+	
+	set_test_name("HttpRequest pipelined GETs and policy stats");
+
+	// Handler can be stack-allocated *if* there are no dangling
+	// references to it after completion of this method.
+	// Create before memory record as the string copy will bump numbers.
+	TestHandler2 handler(this, "handler");
+		
+	// record the total amount of dynamically allocated memory
+	mMemTotal = GetMemTotal();
+	mHandlerCalls = 0;
+
+	HttpRequest * req = NULL;
+
+	try
+	{
+		// Get singletons created
+		HttpRequest::createService();
+
+		// Pipeline the default class before the thread starts
+		long depth(0);
+		HttpStatus status = HttpRequest::setStaticPolicyOption(HttpRequest::PO_PIPELINING_DEPTH,
+															   HttpRequest::DEFAULT_POLICY_ID,
+															   4L, &depth);
+		ensure("Pipelining depth accepted", bool(status));
+		ensure("Pipelining depth as set", 4L == depth);
+		status = HttpRequest::setStaticPolicyOption(HttpRequest::PO_PIPELINING_DEPTH,
+													HttpRequest::DEFAULT_POLICY_ID,
+													1000L, &depth);
+		ensure("Pipelining depth clamped", depth < 1000L);
+		status = HttpRequest::setStaticPolicyOption(HttpRequest::PO_PIPELINING_DEPTH,
+													HttpRequest::DEFAULT_POLICY_ID,
+													4L, NULL);
+		
+		// Start threading early so that thread memory is invariant
+		// over the test.
+		HttpRequest::startThread();
+
+		// create a new ref counted object with an implicit reference
+		req = new HttpRequest();
+		ensure("Memory allocated on construction", mMemTotal < GetMemTotal());
+
+		// Issue a few GETs that *can* connect
+		mStatus = HttpStatus(200);
+		const int req_count(3);
+		for (int i(0); i < req_count; ++i)
+		{
+			HttpHandle handle = req->requestGet(HttpRequest::DEFAULT_POLICY_ID,
+												0U,
+												url_base,
+												NULL,
+												NULL,
+												&handler);
+			ensure("Valid handle returned for get request", handle != LLCORE_HTTP_HANDLE_INVALID);
+		}
+
+		// Run the notification pump.
+		int count(0);
+		int limit(LOOP_COUNT_LONG);
+		while (count++ < limit && mHandlerCalls < req_count)
+		{
+			req->update(1000000);
+			usleep(LOOP_SLEEP_INTERVAL);
+		}
+		ensure("Requests executed in reasonable time", count < limit);
+		ensure("One handler invocation per request", mHandlerCalls == req_count);
+
+		// Stats are published once per pass of the worker loop
+		HttpRequest::PolicyStats stats;
+		count = 0;
+		limit = LOOP_COUNT_SHORT;
+		while (count++ < limit && stats.mRequests < U64(req_count))
+		{
+			status = HttpRequest::getPolicyStats(HttpRequest::DEFAULT_POLICY_ID, &stats);
+			ensure("Stats available for default class", bool(status));
+			usleep(LOOP_SLEEP_INTERVAL);
+		}
+		ensure("All requests counted", stats.mRequests == U64(req_count));
+		ensure("At least one connection opened", stats.mConnectionsOpened >= 1);
+		ensure("Every request opened or reused a connection",
+			   stats.mConnectionsOpened + stats.mConnectionsReused >= stats.mRequests);
+		ensure("Bytes received counted", stats.mBytesReceived > 0);
+		ensure("Pipelining depth reported", stats.mPipeliningDepth == 4L || stats.mPipeliningFailed);
+		ensure("Nothing left in flight", 0 == stats.mActive && 0 == stats.mQueued);
+
+		status = HttpRequest::getPolicyStats(HttpRequest::INVALID_POLICY_ID, &stats);
+		ensure("No stats for an unknown class", ! status);
+		
+		// Okay, request a shutdown of the servicing thread
+		mStatus = HttpStatus();
+		mHandlerCalls = 0;
+		HttpHandle handle = req->requestStopThread(&handler);
+		ensure("Valid handle returned for stop request", handle != LLCORE_HTTP_HANDLE_INVALID);
+	
+		// Run the notification pump again
+		count = 0;
+		limit = LOOP_COUNT_LONG;
+		while (count++ < limit && mHandlerCalls < 1)
+		{
+			req->update(1000000);
+			usleep(LOOP_SLEEP_INTERVAL);
+		}
+		ensure("Stop request executed in reasonable time", count < limit);
+		ensure("Stop handler invocation", mHandlerCalls == 1);
+
+		// See that we actually shutdown the thread
+		count = 0;
+		limit = LOOP_COUNT_SHORT;
+		while (count++ < limit && ! HttpService::isStopped())
+		{
+			usleep(LOOP_SLEEP_INTERVAL);
+		}
+		ensure("Thread actually stopped running", HttpService::isStopped());
+	
+		// release the request object
+		delete req;
+		req = NULL;
+
+		// Shut down service
+		HttpRequest::destroyService();
+	}
+	catch (...)
+	{
+		stop_thread(req);
+		delete req;
+		HttpRequest::destroyService();
+		throw;
+	}
+}
+
+
 }  // end namespace tut
 
 namespace
@@ -108,6 +108,15 @@ protected:
     static S32  sMinimalReverseByteRangePercent;
 };
 
+//============================================================================
+// Keeps memory alive that an image points into but does not own.
+
+class LLImageDataOwner : public LLThreadSafeRefCount
+{
+protected:
+	virtual ~LLImageDataOwner() {}
+};
+
 //============================================================================
 // Image base class
 
@@ -140,8 +149,9 @@ public:
 	S32 getDataSize() const		{ return mDataSize; }
 
 	const U8 *getData() const	;
-	U8 *getData()				;
+	U8 *getData()				; // takes a private copy of borrowed data
 	bool isBufferInvalid() ;
+	bool isDataBorrowed() const	{ return mDataOwner.notNull(); }
 
 	void setSize(S32 width, S32 height, S32 ncomponents);
 	U8* allocateDataSize(S32 width, S32 height, S32 ncomponents, S32 size = -1); // setSize() + allocateData()
@@ -151,6 +161,13 @@ public:
 protected:
 	// special accessor to allow direct setting of mData and mDataSize by LLImageFormatted
 	void setDataAndSize(U8 *data, S32 size);
+	// Points the image at size bytes it does not own, holding owner until the
+	// image lets go of them.  Borrowed data is read only: the non-const
+	// getData() and allocateData() swap in a private copy first.
+	void setBorrowedData(const U8 *data, S32 size, LLImageDataOwner* owner);
+
+private:
+	void detachBorrowedData();
 	
 public:
 	static void generateMip(const U8 *indata, U8* mipdata, int width, int height, S32 nchannels);
@@ -170,6 +187,7 @@ public:
 private:
 	U8 *mData;
 	S32 mDataSize;
+	LLPointer<LLImageDataOwner> mDataOwner; // set while mData is borrowed
 
 	U16 mWidth;
 	U16 mHeight;
@@ -199,6 +217,8 @@ public:
 	LLImageRaw();
 	LLImageRaw(U16 width, U16 height, S8 components);
 	LLImageRaw(U8 *data, U16 width, U16 height, S8 components, bool no_copy = false);
+	// Borrows data without copying it, see LLImageBase::setBorrowedData()
+	LLImageRaw(const U8 *data, U16 width, U16 height, S8 components, LLImageDataOwner* owner);
 	// Construct using createFromFile (used by tools)
 	//LLImageRaw(const std::string& filename, bool j2c_lowest_mip_only = false);
 
@@ -271,11 +291,6 @@ protected:
 	// Create an image from a local file (generally used in tools)
 	//bool createFromFile(const std::string& filename, bool j2c_lowest_mip_only = false);
 
-	void copyLineScaled( U8* in, U8* out, S32 in_pixel_len, S32 out_pixel_len, S32 in_pixel_step, S32 out_pixel_step );
-	void compositeRowScaled4onto3( U8* in, U8* out, S32 in_pixel_len, S32 out_pixel_len );
-
-	U8	fastFractionalMult(U8 a,U8 b);
-
 	void setDataAndSize(U8 *data, S32 width, S32 height, S8 components) ;
 
 public:
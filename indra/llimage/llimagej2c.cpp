@@ -46,6 +46,7 @@ const char* fallbackEngineInfoLLImageJ2CImpl();
 
 // Test data gathering handle
 LLImageCompressionTester* LLImageJ2C::sTesterp = NULL ;
+LLThreadPool* LLImageJ2C::sThreadPool = NULL;
 const std::string sTesterName("ImageCompressionTester");
 
 //static
@@ -36,6 +36,7 @@ const F32 DEFAULT_COMPRESSION_RATE = 1.f/8.f;
 
 class LLImageJ2CImpl;
 class LLImageCompressionTester ;
+class LLThreadPool;
 
 class LLImageJ2C : public LLImageFormatted
 {
@@ -78,6 +79,11 @@ public:
 
 	static std::string getEngineInfo();
 
+	// Pool the decoder may split the work on a single image across.  NULL
+	// (the default) decodes each image on the calling thread only.
+	static void setThreadPool(LLThreadPool* pool) { sThreadPool = pool; }
+	static LLThreadPool* getThreadPool() { return sThreadPool; }
+
 protected:
 	friend class LLImageJ2CImpl;
 	friend class LLImageJ2COJ;
@@ -99,6 +105,8 @@ protected:
 
     // Image compression/decompression tester
 	static LLImageCompressionTester* sTesterp;
+
+	static LLThreadPool* sThreadPool;
 };
 
 // Derive from this class to implement JPEG2000 decoding
@@ -0,0 +1,710 @@
+/**
+ * @file llimagekernels.cpp
+ * @brief Scalar and SIMD versions of the inner loops of LLImageRaw
+ *
+ * $LicenseInfo:firstyear=2014&license=viewerlgpl$
+ * Second Life Viewer Source Code
+ * Copyright (C) 2014, Linden Research, Inc.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation;
+ * version 2.1 of the License only.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ * Linden Research, Inc., 945 Battery Street, San Francisco, CA  94111  USA
+ * $/LicenseInfo$
+ */
+
+#include "linden_common.h"
+
+#include "llimagekernels.h"
+
+#include "llmath.h"
+#include "llprocessor.h"
+
+#include <emmintrin.h>
+#include <vector>
+
+// Defined in llimagekernels_sse41.cpp, the only file built with SSSE3 and
+// SSE4.1 code generation enabled.
+void image_copy4onto3_sse41(const U8* src, U8* dst, S32 pixels);
+void image_copy3onto4_sse41(const U8* src, U8* dst, S32 pixels);
+void image_composite4onto3_sse41(const U8* src, U8* dst, S32 pixels);
+void image_mip3_sse41(const U8* indata, U8* mipdata, S32 width, S32 height);
+
+//============================================================================
+// Plain C++, the loops LLImageRaw and LLImageBase used to run themselves.
+
+static void avg4_colors4(const U8* a, const U8* b, const U8* c, const U8* d, U8* dst)
+{
+	dst[0] = (U8)(((U32)(a[0]) + b[0] + c[0] + d[0])>>2);
+	dst[1] = (U8)(((U32)(a[1]) + b[1] + c[1] + d[1])>>2);
+	dst[2] = (U8)(((U32)(a[2]) + b[2] + c[2] + d[2])>>2);
+	dst[3] = (U8)(((U32)(a[3]) + b[3] + c[3] + d[3])>>2);
+}
+
+static void avg4_colors3(const U8* a, const U8* b, const U8* c, const U8* d, U8* dst)
+{
+	dst[0] = (U8)(((U32)(a[0]) + b[0] + c[0] + d[0])>>2);
+	dst[1] = (U8)(((U32)(a[1]) + b[1] + c[1] + d[1])>>2);
+	dst[2] = (U8)(((U32)(a[2]) + b[2] + c[2] + d[2])>>2);
+}
+
+static void avg4_colors2(const U8* a, const U8* b, const U8* c, const U8* d, U8* dst)
+{
+	dst[0] = (U8)(((U32)(a[0]) + b[0] + c[0] + d[0])>>2);
+	dst[1] = (U8)(((U32)(a[1]) + b[1] + c[1] + d[1])>>2);
+}
+
+// Averages columns [first, width) of rows [0, height) of the mip
+static void generate_mip_scalar_cols(const U8* indata, U8* mipdata, S32 first, S32 width, S32 height, S32 nchannels)
+{
+	const S32 in_width = width*2;
+	for (S32 h=0; h<height; h++)
+	{
+		const U8* in = indata + nchannels*(in_width*2*h + first*2);
+		U8* data = mipdata + nchannels*(width*h + first);
+		for (S32 w=first; w<width; w++)
+		{
+			switch(nchannels)
+			{
+			  case 4:
+				avg4_colors4(in, in+4, in+4*in_width, in+4*in_width+4, data);
+				break;
+			  case 3:
+				avg4_colors3(in, in+3, in+3*in_width, in+3*in_width+3, data);
+				break;
+			  case 2:
+				avg4_colors2(in, in+2, in+2*in_width, in+2*in_width+2, data);
+				break;
+			  default:
+				*(U8*)data = (U8)(((U32)(in[0]) + in[1] + in[in_width] + in[in_width+1])>>2);
+				break;
+			}
+			in += nchannels*2;
+			data += nchannels;
+		}
+	}
+}
+
+static void generate_mip_scalar(const U8* indata, U8* mipdata, S32 width, S32 height, S32 nchannels)
+{
+	generate_mip_scalar_cols(indata, mipdata, 0, width, height, nchannels);
+}
+
+static void copy_4onto3_scalar(const U8* src_data, U8* dst_data, S32 pixels)
+{
+	for( S32 i=0; i<pixels; i++ )
+	{
+		dst_data[0] = src_data[0];
+		dst_data[1] = src_data[1];
+		dst_data[2] = src_data[2];
+		src_data += 4;
+		dst_data += 3;
+	}
+}
+
+static void copy_3onto4_scalar(const U8* src_data, U8* dst_data, S32 pixels)
+{
+	for( S32 i=0; i<pixels; i++ )
+	{
+		dst_data[0] = src_data[0];
+		dst_data[1] = src_data[1];
+		dst_data[2] = src_data[2];
+		dst_data[3] = 255;
+		src_data += 3;
+		dst_data += 4;
+	}
+}
+
+// Calculates (U8)(255*(a/255.f)*(b/255.f) + 0.5f).  Thanks, Jim Blinn!
+static inline U8 fast_fractional_mult(U8 a, U8 b)
+{
+	U32 i = a * b + 128;
+	return U8((i + (i>>8)) >> 8);
+}
+
+static void composite_4onto3_scalar(const U8* src_data, U8* dst_data, S32 pixels)
+{
+	while( pixels-- )
+	{
+		U8 alpha = src_data[3];
+		if( alpha )
+		{
+			if( 255 == alpha )
+			{
+				dst_data[0] = src_data[0];
+				dst_data[1] = src_data[1];
+				dst_data[2] = src_data[2];
+			}
+			else
+			{
+				U8 transparency = 255 - alpha;
+				dst_data[0] = fast_fractional_mult( dst_data[0], transparency ) + fast_fractional_mult( src_data[0], alpha );
+				dst_data[1] = fast_fractional_mult( dst_data[1], transparency ) + fast_fractional_mult( src_data[1], alpha );
+				dst_data[2] = fast_fractional_mult( dst_data[2], transparency ) + fast_fractional_mult( src_data[2], alpha );
+			}
+		}
+
+		src_data += 4;
+		dst_data += 3;
+	}
+}
+
+static void copy_line_scaled(const U8* in, U8* out, S32 in_pixel_len, S32 out_pixel_len, S32 in_pixel_step, S32 out_pixel_step, S32 components)
+{
+	llassert( components >= 1 && components <= 4 );
+
+	const F32 ratio = F32(in_pixel_len) / out_pixel_len; // ratio of old to new
+	const F32 norm_factor = 1.f / ratio;
+
+	S32 goff = components >= 2 ? 1 : 0;
+	S32 boff = components >= 3 ? 2 : 0;
+	for( S32 x = 0; x < out_pixel_len; x++ )
+	{
+		// Sample input pixels in range from sample0 to sample1.
+		// Avoid floating point accumulation error... don't just add ratio each time.  JC
+		const F32 sample0 = x * ratio;
+		const F32 sample1 = (x+1) * ratio;
+		const S32 index0 = llfloor(sample0);			// left integer (floor)
+		const S32 index1 = llfloor(sample1);			// right integer (floor)
+		const F32 fract0 = 1.f - (sample0 - F32(index0));	// spill over on left
+		const F32 fract1 = sample1 - F32(index1);			// spill-over on right
+
+		if( index0 == index1 )
+		{
+			// Interval is embedded in one input pixel
+			S32 t0 = x * out_pixel_step * components;
+			S32 t1 = index0 * in_pixel_step * components;
+			U8* outp = out + t0;
+			const U8* inp = in + t1;
+			for (S32 i = 0; i < components; ++i)
+			{
+				*outp = *inp;
+				++outp;
+				++inp;
+			}
+		}
+		else
+		{
+			// Left straddle
+			S32 t1 = index0 * in_pixel_step * components;
+			F32 r = in[t1 + 0] * fract0;
+			F32 g = in[t1 + goff] * fract0;
+			F32 b = in[t1 + boff] * fract0;
+			F32 a = 0;
+			if( components == 4)
+			{
+				a = in[t1 + 3] * fract0;
+			}
+
+			// Central interval
+			if (components < 4)
+			{
+				for( S32 u = index0 + 1; u < index1; u++ )
+				{
+					S32 t2 = u * in_pixel_step * components;
+					r += in[t2 + 0];
+					g += in[t2 + goff];
+					b += in[t2 + boff];
+				}
+			}
+			else
+			{
+				for( S32 u = index0 + 1; u < index1; u++ )
+				{
+					S32 t2 = u * in_pixel_step * components;
+					r += in[t2 + 0];
+					g += in[t2 + 1];
+					b += in[t2 + 2];
+					a += in[t2 + 3];
+				}
+			}
+
+			// right straddle
+			// Watch out for reading off of end of input array.
+			if( fract1 && index1 < in_pixel_len )
+			{
+				S32 t3 = index1 * in_pixel_step * components;
+				if (components < 4)
+				{
+					U8 in0 = in[t3 + 0];
+					U8 in1 = in[t3 + goff];
+					U8 in2 = in[t3 + boff];
+					r += in0 * fract1;
+					g += in1 * fract1;
+					b += in2 * fract1;
+				}
+				else
+				{
+					U8 in0 = in[t3 + 0];
+					U8 in1 = in[t3 + 1];
+					U8 in2 = in[t3 + 2];
+					U8 in3 = in[t3 + 3];
+					r += in0 * fract1;
+					g += in1 * fract1;
+					b += in2 * fract1;
+					a += in3 * fract1;
+				}
+			}
+
+			r *= norm_factor;
+			g *= norm_factor;
+			b *= norm_factor;
+			a *= norm_factor;  // skip conditional
+
+			S32 t4 = x * out_pixel_step * components;
+			out[t4 + 0] = U8(llround(r));
+			if (components >= 2)
+				out[t4 + 1] = U8(llround(g));
+			if (components >= 3)
+				out[t4 + 2] = U8(llround(b));
+			if( components == 4)
+				out[t4 + 3] = U8(llround(a));
+		}
+	}
+}
+
+static void scale_rows_scalar(const U8* in, S32 in_height, U8* out, S32 out_height, S32 width, S32 components)
+{
+	for( S32 col = 0; col < width; col++ )
+	{
+		copy_line_scaled( in + (components * col), out + (components * col), in_height, out_height, width, width, components );
+	}
+}
+
+static void scale_row_scalar(const U8* in, S32 in_width, U8* out, S32 out_width, S32 components)
+{
+	copy_line_scaled( in, out, in_width, out_width, 1, 1, components );
+}
+
+//============================================================================
+// SSE2, always available on the platforms we build for.
+//
+// The box filter kernels do the same float operations in the same order as
+// copy_line_scaled() so their results are bit identical.  llround() is
+// llfloor(x + 0.5f), which for the positive values here is a truncation.
+
+static inline void load_floats16(const U8* p, __m128* v)
+{
+	const __m128i zero = _mm_setzero_si128();
+	__m128i bytes = _mm_loadu_si128((const __m128i*)p);
+	__m128i lo = _mm_unpacklo_epi8(bytes, zero);
+	__m128i hi = _mm_unpackhi_epi8(bytes, zero);
+	v[0] = _mm_cvtepi32_ps(_mm_unpacklo_epi16(lo, zero));
+	v[1] = _mm_cvtepi32_ps(_mm_unpackhi_epi16(lo, zero));
+	v[2] = _mm_cvtepi32_ps(_mm_unpacklo_epi16(hi, zero));
+	v[3] = _mm_cvtepi32_ps(_mm_unpackhi_epi16(hi, zero));
+}
+
+static inline __m128 load_pixel_floats(const U8* p, S32 components)
+{
+	if (components == 4)
+	{
+		S32 pixel;
+		memcpy(&pixel, p, sizeof(pixel));	/* Flawfinder: ignore */
+		const __m128i zero = _mm_setzero_si128();
+		__m128i v = _mm_unpacklo_epi8(_mm_cvtsi32_si128(pixel), zero);
+		return _mm_cvtepi32_ps(_mm_unpacklo_epi16(v, zero));
+	}
+	// Three bytes, do not read past them.
+	return _mm_cvtepi32_ps(_mm_setr_epi32(p[0], p[1], p[2], 0));
+}
+
+static inline __m128i round_to_int(__m128 v)
+{
+	return _mm_cvttps_epi32(_mm_add_ps(v, _mm_set1_ps(0.5f)));
+}
+
+static void generate_mip_sse2(const U8* indata, U8* mipdata, S32 width, S32 height, S32 nchannels)
+{
+	if (nchannels != 4 && nchannels != 1)
+	{
+		generate_mip_scalar(indata, mipdata, width, height, nchannels);
+		return;
+	}
+
+	const __m128i zero = _mm_setzero_si128();
+	const __m128i low_bytes = _mm_set1_epi16(0x00ff);
+	const S32 in_row = width * 2 * nchannels;
+	// Sixteen mip bytes at a time, from 32 bytes of each of two input rows
+	const S32 step = 16 / nchannels;
+	const S32 simd_width = width - width % step;
+
+	for (S32 h = 0; h < height; h++)
+	{
+		const U8* row0 = indata + in_row * 2 * h;
+		const U8* row1 = row0 + in_row;
+		U8* out = mipdata + width * nchannels * h;
+
+		for (S32 w = 0; w < simd_width; w += step)
+		{
+			const S32 offset = w * 2 * nchannels;
+			__m128i a0 = _mm_loadu_si128((const __m128i*)(row0 + offset));
+			__m128i a1 = _mm_loadu_si128((const __m128i*)(row0 + offset + 16));
+			__m128i b0 = _mm_loadu_si128((const __m128i*)(row1 + offset));
+			__m128i b1 = _mm_loadu_si128((const __m128i*)(row1 + offset + 16));
+			__m128i sum0, sum1;
+			if (nchannels == 4)
+			{
+				// Vertical sums of four input pixels, then the two halves of
+				// each eight lane vector are a horizontal pair.
+				__m128i s0 = _mm_add_epi16(_mm_unpacklo_epi8(a0, zero), _mm_unpacklo_epi8(b0, zero));
+				__m128i s1 = _mm_add_epi16(_mm_unpackhi_epi8(a0, zero), _mm_unpackhi_epi8(b0, zero));
+				__m128i s2 = _mm_add_epi16(_mm_unpacklo_epi8(a1, zero), _mm_unpacklo_epi8(b1, zero));
+				__m128i s3 = _mm_add_epi16(_mm_unpackhi_epi8(a1, zero), _mm_unpackhi_epi8(b1, zero));
+				s0 = _mm_add_epi16(s0, _mm_srli_si128(s0, 8));
+				s1 = _mm_add_epi16(s1, _mm_srli_si128(s1, 8));
+				s2 = _mm_add_epi16(s2, _mm_srli_si128(s2, 8));
+				s3 = _mm_add_epi16(s3, _mm_srli_si128(s3, 8));
+				sum0 = _mm_unpacklo_epi64(s0, s1);
+				sum1 = _mm_unpacklo_epi64(s2, s3);
+			}
+			else
+			{
+				// Even and odd bytes hold the left and right pixel of each pair.
+				sum0 = _mm_add_epi16(_mm_add_epi16(_mm_and_si128(a0, low_bytes), _mm_srli_epi16(a0, 8)),
+									 _mm_add_epi16(_mm_and_si128(b0, low_bytes), _mm_srli_epi16(b0, 8)));
+				sum1 = _mm_add_epi16(_mm_add_epi16(_mm_and_si128(a1, low_bytes), _mm_srli_epi16(a1, 8)),
+									 _mm_add_epi16(_mm_and_si128(b1, low_bytes), _mm_srli_epi16(b1, 8)));
+			}
+			sum0 = _mm_srli_epi16(sum0, 2);
+			sum1 = _mm_srli_epi16(sum1, 2);
+			_mm_storeu_si128((__m128i*)(out + w * nchannels), _mm_packus_epi16(sum0, sum1));
+		}
+	}
+
+	if (simd_width < width)
+	{
+		generate_mip_scalar_cols(indata, mipdata, simd_width, width, height, nchannels);
+	}
+}
+
+// Row at a time instead of column at a time, sixteen channels per step.
+static void scale_rows_sse2(const U8* in, S32 in_height, U8* out, S32 out_height, S32 width, S32 components)
+{
+	const S32 row_bytes = width * components;
+	const S32 simd_bytes = row_bytes & ~15;
+	const F32 ratio = F32(in_height) / out_height; // ratio of old to new
+	const F32 norm_factor = 1.f / ratio;
+	const __m128 norm = _mm_set1_ps(norm_factor);
+
+	for( S32 y = 0; y < out_height; y++ )
+	{
+		const F32 sample0 = y * ratio;
+		const F32 sample1 = (y+1) * ratio;
+		const S32 index0 = llfloor(sample0);
+		const S32 index1 = llfloor(sample1);
+		const F32 fract0 = 1.f - (sample0 - F32(index0));
+		const F32 fract1 = sample1 - F32(index1);
+		const bool right_straddle = fract1 && index1 < in_height;
+
+		U8* out_row = out + y * row_bytes;
+		if( index0 == index1 )
+		{
+			memcpy(out_row, in + index0 * row_bytes, row_bytes);	/* Flawfinder: ignore */
+			continue;
+		}
+
+		const __m128 f0 = _mm_set1_ps(fract0);
+		const __m128 f1 = _mm_set1_ps(fract1);
+		for( S32 i = 0; i < simd_bytes; i += 16 )
+		{
+			__m128 acc[4];
+			__m128 v[4];
+			load_floats16(in + index0 * row_bytes + i, v);
+			for (S32 k = 0; k < 4; k++)
+			{
+				acc[k] = _mm_mul_ps(v[k], f0);
+			}
+			for( S32 u = index0 + 1; u < index1; u++ )
+			{
+				load_floats16(in + u * row_bytes + i, v);
+				for (S32 k = 0; k < 4; k++)
+				{
+					acc[k] = _mm_add_ps(acc[k], v[k]);
+				}
+			}
+			if( right_straddle )
+			{
+				load_floats16(in + index1 * row_bytes + i, v);
+				for (S32 k = 0; k < 4; k++)
+				{
+					acc[k] = _mm_add_ps(acc[k], _mm_mul_ps(v[k], f1));
+				}
+			}
+			__m128i lo = _mm_packs_epi32(round_to_int(_mm_mul_ps(acc[0], norm)), round_to_int(_mm_mul_ps(acc[1], norm)));
+			__m128i hi = _mm_packs_epi32(round_to_int(_mm_mul_ps(acc[2], norm)), round_to_int(_mm_mul_ps(acc[3], norm)));
+			_mm_storeu_si128((__m128i*)(out_row + i), _mm_packus_epi16(lo, hi));
+		}
+
+		for( S32 i = simd_bytes; i < row_bytes; i++ )
+		{
+			F32 c = in[index0 * row_bytes + i] * fract0;
+			for( S32 u = index0 + 1; u < index1; u++ )
+			{
+				c += in[u * row_bytes + i];
+			}
+			if( right_straddle )
+			{
+				U8 in1 = in[index1 * row_bytes + i];
+				c += in1 * fract1;
+			}
+			c *= norm_factor;
+			out_row[i] = U8(llround(c));
+		}
+	}
+}
+
+// One pixel per step, all of its channels at once.
+static void scale_row_sse2(const U8* in, S32 in_width, U8* out, S32 out_width, S32 components)
+{
+	if (components != 4 && components != 3)
+	{
+		scale_row_scalar(in, in_width, out, out_width, components);
+		return;
+	}
+
+	const F32 ratio = F32(in_width) / out_width; // ratio of old to new
+	const __m128 norm = _mm_set1_ps(1.f / ratio);
+
+	for( S32 x = 0; x < out_width; x++ )
+	{
+		const F32 sample0 = x * ratio;
+		const F32 sample1 = (x+1) * ratio;
+		const S32 index0 = llfloor(sample0);
+		const S32 index1 = llfloor(sample1);
+		const F32 fract0 = 1.f - (sample0 - F32(index0));
+		const F32 fract1 = sample1 - F32(index1);
+
+		U8* outp = out + x * components;
+		if( index0 == index1 )
+		{
+			const U8* inp = in + index0 * components;
+			for (S32 i = 0; i < components; ++i)
+			{
+				outp[i] = inp[i];
+			}
+			continue;
+		}
+
+		__m128 acc = _mm_mul_ps(load_pixel_floats(in + index0 * components, components), _mm_set1_ps(fract0));
+		for( S32 u = index0 + 1; u < index1; u++ )
+		{
+			acc = _mm_add_ps(acc, load_pixel_floats(in + u * components, components));
+		}
+		if( fract1 && index1 < in_width )
+		{
+			acc = _mm_add_ps(acc, _mm_mul_ps(load_pixel_floats(in + index1 * components, components), _mm_set1_ps(fract1)));
+		}
+		__m128i packed = round_to_int(_mm_mul_ps(acc, norm));
+		packed = _mm_packs_epi32(packed, packed);
+		S32 result = _mm_cvtsi128_si32(_mm_packus_epi16(packed, packed));
+		if (components == 4)
+		{
+			memcpy(outp, &result, sizeof(result));	/* Flawfinder: ignore */
+		}
+		else
+		{
+			outp[0] = U8(result);
+			outp[1] = U8(result >> 8);
+			outp[2] = U8(result >> 16);
+		}
+	}
+}
+
+static void generate_mip_sse41(const U8* indata, U8* mipdata, S32 width, S32 height, S32 nchannels)
+{
+	if (nchannels == 3)
+	{
+		image_mip3_sse41(indata, mipdata, width, height);
+	}
+	else
+	{
+		generate_mip_sse2(indata, mipdata, width, height, nchannels);
+	}
+}
+
+//============================================================================
+
+static const LLImageKernels::KernelSet sKernelSets[LLImageKernels::IS_COUNT] =
+{
+	{	// IS_SCALAR
+		generate_mip_scalar,
+		copy_4onto3_scalar,
+		copy_3onto4_scalar,
+		composite_4onto3_scalar,
+		scale_rows_scalar,
+		scale_row_scalar
+	},
+	{	// IS_SSE2
+		generate_mip_sse2,
+		copy_4onto3_scalar,			// needs pshufb to beat the compiler
+		copy_3onto4_scalar,
+		composite_4onto3_scalar,
+		scale_rows_sse2,
+		scale_row_sse2
+	},
+	{	// IS_SSE41
+		generate_mip_sse41,
+		image_copy4onto3_sse41,
+		image_copy3onto4_sse41,
+		image_composite4onto3_sse41,
+		scale_rows_sse2,
+		scale_row_sse2
+	}
+};
+
+// SSE2 is the baseline, initClass() moves up from there if it can.
+LLImageKernels::EInstructionSet LLImageKernels::sInstructionSet = LLImageKernels::IS_SSE2;
+const LLImageKernels::KernelSet* LLImageKernels::sKernels = &sKernelSets[LLImageKernels::IS_SSE2];
+
+//static
+void LLImageKernels::initClass()
+{
+	EInstructionSet set = isSupported(IS_SSE41) ? IS_SSE41 : IS_SSE2;
+	setInstructionSet(set);
+	LL_INFOS("Image") << "Using " << getInstructionSetName(set) << " image kernels" << LL_ENDL;
+}
+
+//static
+bool LLImageKernels::isSupported(EInstructionSet set)
+{
+	switch (set)
+	{
+	  case IS_SCALAR:
+	  case IS_SSE2:
+		return true;
+	  case IS_SSE41:
+		{
+			LLProcessorInfo info;
+			return info.hasSSSE3() && info.hasSSE41();
+		}
+	  default:
+		return false;
+	}
+}
+
+//static
+bool LLImageKernels::setInstructionSet(EInstructionSet set)
+{
+	if (!isSupported(set))
+	{
+		return false;
+	}
+	sInstructionSet = set;
+	sKernels = &sKernelSets[set];
+	return true;
+}
+
+//static
+LLImageKernels::EInstructionSet LLImageKernels::getInstructionSet()
+{
+	return sInstructionSet;
+}
+
+//static
+const char* LLImageKernels::getInstructionSetName(EInstructionSet set)
+{
+	switch (set)
+	{
+	  case IS_SCALAR:	return "scalar";
+	  case IS_SSE2:		return "SSE2";
+	  case IS_SSE41:	return "SSE4.1";
+	  default:			return "unknown";
+	}
+}
+
+//static
+const LLImageKernels::KernelSet& LLImageKernels::getKernels()
+{
+	return *sKernels;
+}
+
+//static
+void LLImageKernels::generateMip(const U8* indata, U8* mipdata, S32 width, S32 height, S32 components)
+{
+	getKernels().mGenerateMip(indata, mipdata, width, height, components);
+}
+
+//static
+void LLImageKernels::copy4onto3(const U8* src, U8* dst, S32 pixels)
+{
+	getKernels().mCopy4onto3(src, dst, pixels);
+}
+
+//static
+void LLImageKernels::copy3onto4(const U8* src, U8* dst, S32 pixels)
+{
+	getKernels().mCopy3onto4(src, dst, pixels);
+}
+
+//static
+void LLImageKernels::composite4onto3(const U8* src, U8* dst, S32 pixels)
+{
+	getKernels().mComposite4onto3(src, dst, pixels);
+}
+
+//static
+void LLImageKernels::scaleRows(const U8* in, S32 in_height, U8* out, S32 out_height, S32 width, S32 components)
+{
+	getKernels().mScaleRows(in, in_height, out, out_height, width, components);
+}
+
+//static
+void LLImageKernels::scaleRow(const U8* in, S32 in_width, U8* out, S32 out_width, S32 components)
+{
+	getKernels().mScaleRow(in, in_width, out, out_width, components);
+}
+
+//static
+void LLImageKernels::scale(const U8* in, S32 in_width, S32 in_height,
+						   U8* out, S32 out_width, S32 out_height, S32 components)
+{
+	const KernelSet& kernels = getKernels();
+
+	S32 temp_data_size = in_width * out_height * components;
+	llassert_always(temp_data_size > 0);
+	std::vector<U8> temp_buffer(temp_data_size);
+
+	// Vertical
+	kernels.mScaleRows(in, in_height, &temp_buffer[0], out_height, in_width, components);
+
+	// Horizontal
+	for( S32 row = 0; row < out_height; row++ )
+	{
+		kernels.mScaleRow(&temp_buffer[0] + (components * in_width * row), in_width,
+						  out + (components * out_width * row), out_width, components);
+	}
+}
+
+//static
+void LLImageKernels::compositeScaled4onto3(const U8* src, S32 src_width, S32 src_height,
+										   U8* dst, S32 dst_width, S32 dst_height)
+{
+	const KernelSet& kernels = getKernels();
+
+	S32 temp_data_size = src_width * dst_height * 4;
+	llassert_always(temp_data_size > 0);
+	std::vector<U8> temp_buffer(temp_data_size);
+	std::vector<U8> row_buffer(dst_width * 4);
+
+	// Vertical: scale but no composite
+	kernels.mScaleRows(src, src_height, &temp_buffer[0], dst_height, src_width, 4);
+
+	// Horizontal: scale, then composite the scaled row
+	for( S32 row = 0; row < dst_height; row++ )
+	{
+		kernels.mScaleRow(&temp_buffer[0] + (4 * src_width * row), src_width, &row_buffer[0], dst_width, 4);
+		kernels.mComposite4onto3(&row_buffer[0], dst + (3 * dst_width * row), dst_width);
+	}
+}
@@ -0,0 +1,103 @@
+/**
+ * @file llimagekernels.h
+ * @brief Scalar and SIMD versions of the inner loops of LLImageRaw
+ *
+ * $LicenseInfo:firstyear=2014&license=viewerlgpl$
+ * Second Life Viewer Source Code
+ * Copyright (C) 2014, Linden Research, Inc.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation;
+ * version 2.1 of the License only.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ * Linden Research, Inc., 945 Battery Street, San Francisco, CA  94111  USA
+ * $/LicenseInfo$
+ */
+
+#ifndef LL_LLIMAGEKERNELS_H
+#define LL_LLIMAGEKERNELS_H
+
+// The pixel loops behind LLImageRaw scaling, compositing and channel
+// conversion and LLImageBase::generateMip.  Each has a plain C++ version and,
+// where it pays off, SSE2 and SSE4.1 versions.  SSE2 is used until
+// initClass() picks the best set the CPU supports; all sets give identical
+// results.
+//
+// Images are tightly packed rows of 8 bit channels.  Scaling uses the same
+// box filter as before: every output pixel is the area weighted average of
+// the input pixels it covers, or a copy of the one it falls in when
+// enlarging.
+class LLImageKernels
+{
+public:
+	enum EInstructionSet
+	{
+		IS_SCALAR = 0,
+		IS_SSE2,
+		IS_SSE41,
+		IS_COUNT
+	};
+
+	// Picks the best instruction set supported by the CPU.
+	static void initClass();
+
+	// Forces a set, for testing and benchmarking.  Returns false, changing
+	// nothing, if the CPU does not support it.
+	static bool setInstructionSet(EInstructionSet set);
+	static EInstructionSet getInstructionSet();
+	static bool isSupported(EInstructionSet set);
+	static const char* getInstructionSetName(EInstructionSet set);
+
+	// Averages each 2x2 block of indata into one pixel of mipdata.  width and
+	// height are the dimensions of mipdata.
+	static void generateMip(const U8* indata, U8* mipdata, S32 width, S32 height, S32 components);
+
+	// Same size copies between 3 and 4 channel images, alpha is set to 255.
+	static void copy4onto3(const U8* src, U8* dst, S32 pixels);
+	static void copy3onto4(const U8* src, U8* dst, S32 pixels);
+
+	// Alpha blends 4 channel src over 3 channel dst of the same size.
+	static void composite4onto3(const U8* src, U8* dst, S32 pixels);
+
+	// Box filters width columns of in_height rows down or up to out_height rows.
+	static void scaleRows(const U8* in, S32 in_height, U8* out, S32 out_height, S32 width, S32 components);
+	// Box filters one row of in_width pixels to out_width pixels.
+	static void scaleRow(const U8* in, S32 in_width, U8* out, S32 out_width, S32 components);
+
+	// Both passes of a scale, through a temporary buffer of in_width * out_height pixels.
+	static void scale(const U8* in, S32 in_width, S32 in_height,
+					  U8* out, S32 out_width, S32 out_height, S32 components);
+
+	// Scale 4 channel src and alpha blend it over 3 channel dst.
+	static void compositeScaled4onto3(const U8* src, S32 src_width, S32 src_height,
+									  U8* dst, S32 dst_width, S32 dst_height);
+
+	// One implementation of every kernel.
+	struct KernelSet
+	{
+		void (*mGenerateMip)(const U8* indata, U8* mipdata, S32 width, S32 height, S32 components);
+		void (*mCopy4onto3)(const U8* src, U8* dst, S32 pixels);
+		void (*mCopy3onto4)(const U8* src, U8* dst, S32 pixels);
+		void (*mComposite4onto3)(const U8* src, U8* dst, S32 pixels);
+		void (*mScaleRows)(const U8* in, S32 in_height, U8* out, S32 out_height, S32 width, S32 components);
+		void (*mScaleRow)(const U8* in, S32 in_width, U8* out, S32 out_width, S32 components);
+	};
+
+private:
+	static const KernelSet& getKernels();
+
+	static EInstructionSet sInstructionSet;
+	static const KernelSet* sKernels;
+};
+
+#endif // LL_LLIMAGEKERNELS_H
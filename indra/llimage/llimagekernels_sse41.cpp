@@ -0,0 +1,221 @@
+/**
+ * @file llimagekernels_sse41.cpp
+ * @brief SSSE3 and SSE4.1 image kernels, see llimagekernels.h
+ *
+ * $LicenseInfo:firstyear=2014&license=viewerlgpl$
+ * Second Life Viewer Source Code
+ * Copyright (C) 2014, Linden Research, Inc.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation;
+ * version 2.1 of the License only.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ * Linden Research, Inc., 945 Battery Street, San Francisco, CA  94111  USA
+ * $/LicenseInfo$
+ */
+
+// This file is built with SSE4.1 code generation enabled and only runs once
+// LLImageKernels has checked the CPU, so it must not include headers with
+// inline functions: the linker could keep this file's copy of one and call
+// it from everywhere else.
+#include "stdtypes.h"
+
+#include <string.h>
+#include <tmmintrin.h>
+#include <smmintrin.h>
+
+#define Z ((char)0x80)	// pshufb index that clears the byte
+
+static inline U8 fast_fractional_mult(U8 a, U8 b)
+{
+	U32 i = a * b + 128;
+	return U8((i + (i>>8)) >> 8);
+}
+
+// fast_fractional_mult() on eight 16 bit lanes, nothing overflows 16 bits
+static inline __m128i fast_fractional_mult16(__m128i a, __m128i b)
+{
+	__m128i i = _mm_add_epi16(_mm_mullo_epi16(a, b), _mm_set1_epi16(128));
+	return _mm_srli_epi16(_mm_add_epi16(i, _mm_srli_epi16(i, 8)), 8);
+}
+
+void image_copy4onto3_sse41(const U8* src, U8* dst, S32 pixels)
+{
+	const __m128i rgb = _mm_setr_epi8(0, 1, 2, 4, 5, 6, 8, 9, 10, 12, 13, 14, Z, Z, Z, Z);
+
+	// Sixteen pixels, four loads in and three stores out
+	S32 i = 0;
+	for ( ; i + 16 <= pixels; i += 16)
+	{
+		__m128i s0 = _mm_shuffle_epi8(_mm_loadu_si128((const __m128i*)(src)), rgb);
+		__m128i s1 = _mm_shuffle_epi8(_mm_loadu_si128((const __m128i*)(src + 16)), rgb);
+		__m128i s2 = _mm_shuffle_epi8(_mm_loadu_si128((const __m128i*)(src + 32)), rgb);
+		__m128i s3 = _mm_shuffle_epi8(_mm_loadu_si128((const __m128i*)(src + 48)), rgb);
+		_mm_storeu_si128((__m128i*)(dst), _mm_or_si128(s0, _mm_slli_si128(s1, 12)));
+		_mm_storeu_si128((__m128i*)(dst + 16), _mm_or_si128(_mm_srli_si128(s1, 4), _mm_slli_si128(s2, 8)));
+		_mm_storeu_si128((__m128i*)(dst + 32), _mm_or_si128(_mm_srli_si128(s2, 8), _mm_slli_si128(s3, 4)));
+		src += 64;
+		dst += 48;
+	}
+
+	for ( ; i < pixels; i++)
+	{
+		dst[0] = src[0];
+		dst[1] = src[1];
+		dst[2] = src[2];
+		src += 4;
+		dst += 3;
+	}
+}
+
+void image_copy3onto4_sse41(const U8* src, U8* dst, S32 pixels)
+{
+	const __m128i rgbx = _mm_setr_epi8(0, 1, 2, Z, 3, 4, 5, Z, 6, 7, 8, Z, 9, 10, 11, Z);
+	const __m128i alpha = _mm_set1_epi32(0xff000000);
+
+	// Sixteen pixels, three loads in and four stores out
+	S32 i = 0;
+	for ( ; i + 16 <= pixels; i += 16)
+	{
+		__m128i i0 = _mm_loadu_si128((const __m128i*)(src));
+		__m128i i1 = _mm_loadu_si128((const __m128i*)(src + 16));
+		__m128i i2 = _mm_loadu_si128((const __m128i*)(src + 32));
+		_mm_storeu_si128((__m128i*)(dst), _mm_or_si128(_mm_shuffle_epi8(i0, rgbx), alpha));
+		_mm_storeu_si128((__m128i*)(dst + 16), _mm_or_si128(_mm_shuffle_epi8(_mm_alignr_epi8(i1, i0, 12), rgbx), alpha));
+		_mm_storeu_si128((__m128i*)(dst + 32), _mm_or_si128(_mm_shuffle_epi8(_mm_alignr_epi8(i2, i1, 8), rgbx), alpha));
+		_mm_storeu_si128((__m128i*)(dst + 48), _mm_or_si128(_mm_shuffle_epi8(_mm_srli_si128(i2, 4), rgbx), alpha));
+		src += 48;
+		dst += 64;
+	}
+
+	for ( ; i < pixels; i++)
+	{
+		dst[0] = src[0];
+		dst[1] = src[1];
+		dst[2] = src[2];
+		dst[3] = 255;
+		src += 3;
+		dst += 4;
+	}
+}
+
+// The scalar version special cases alpha 0 and 255, but the blend gives the
+// same result for those: fast_fractional_mult(x, 255) is x and
+// fast_fractional_mult(x, 0) is 0.
+void image_composite4onto3_sse41(const U8* src, U8* dst, S32 pixels)
+{
+	const __m128i rgb_lo = _mm_setr_epi8(0, Z, 1, Z, 2, Z, 4, Z, 5, Z, 6, Z, 8, Z, 9, Z);
+	const __m128i rgb_hi = _mm_setr_epi8(10, Z, 12, Z, 13, Z, 14, Z, Z, Z, Z, Z, Z, Z, Z, Z);
+	const __m128i alpha_lo = _mm_setr_epi8(3, Z, 3, Z, 3, Z, 7, Z, 7, Z, 7, Z, 11, Z, 11, Z);
+	const __m128i alpha_hi = _mm_setr_epi8(11, Z, 15, Z, 15, Z, 15, Z, Z, Z, Z, Z, Z, Z, Z, Z);
+	const __m128i opaque = _mm_set1_epi16(255);
+
+	// Four pixels, reading and rewriting sixteen bytes of dst of which the
+	// last four belong to the next pixels, so stop while there are two more.
+	S32 i = 0;
+	for ( ; i + 6 <= pixels; i += 4)
+	{
+		__m128i s = _mm_loadu_si128((const __m128i*)(src));
+		__m128i d = _mm_loadu_si128((const __m128i*)(dst));
+
+		__m128i a_lo = _mm_shuffle_epi8(s, alpha_lo);
+		__m128i a_hi = _mm_shuffle_epi8(s, alpha_hi);
+		__m128i lo = _mm_add_epi16(fast_fractional_mult16(_mm_cvtepu8_epi16(d), _mm_sub_epi16(opaque, a_lo)),
+								   fast_fractional_mult16(_mm_shuffle_epi8(s, rgb_lo), a_lo));
+		__m128i hi = _mm_add_epi16(fast_fractional_mult16(_mm_cvtepu8_epi16(_mm_srli_si128(d, 8)), _mm_sub_epi16(opaque, a_hi)),
+								   fast_fractional_mult16(_mm_shuffle_epi8(s, rgb_hi), a_hi));
+
+		// Keep the four bytes past the last pixel as they were.
+		_mm_storeu_si128((__m128i*)(dst), _mm_blend_epi16(_mm_packus_epi16(lo, hi), d, 0xc0));
+		src += 16;
+		dst += 12;
+	}
+
+	for ( ; i < pixels; i++)
+	{
+		U8 alpha = src[3];
+		if (alpha)
+		{
+			if (255 == alpha)
+			{
+				dst[0] = src[0];
+				dst[1] = src[1];
+				dst[2] = src[2];
+			}
+			else
+			{
+				U8 transparency = 255 - alpha;
+				dst[0] = fast_fractional_mult(dst[0], transparency) + fast_fractional_mult(src[0], alpha);
+				dst[1] = fast_fractional_mult(dst[1], transparency) + fast_fractional_mult(src[1], alpha);
+				dst[2] = fast_fractional_mult(dst[2], transparency) + fast_fractional_mult(src[2], alpha);
+			}
+		}
+		src += 4;
+		dst += 3;
+	}
+}
+
+// Three channel mip, four mip pixels from 24 bytes of each of two input rows.
+void image_mip3_sse41(const U8* indata, U8* mipdata, S32 width, S32 height)
+{
+	const __m128i zero = _mm_setzero_si128();
+	const __m128i pick_lo = _mm_setr_epi8(0, 1, 2, 6, 7, 8, 12, 13, 14, Z, Z, Z, Z, Z, Z, Z);
+	const __m128i pick_hi = _mm_setr_epi8(Z, Z, Z, Z, Z, Z, Z, Z, Z, 2, 3, 4, Z, Z, Z, Z);
+	const S32 in_row = width * 6;
+
+	for (S32 h = 0; h < height; h++)
+	{
+		const U8* row0 = indata + in_row * 2 * h;
+		const U8* row1 = row0 + in_row;
+		U8* out = mipdata + width * 3 * h;
+
+		S32 w = 0;
+		for ( ; w + 4 <= width; w += 4)
+		{
+			const U8* p0 = row0 + w * 6;
+			const U8* p1 = row1 + w * 6;
+			__m128i x0 = _mm_loadu_si128((const __m128i*)(p0));
+			__m128i x1 = _mm_loadu_si128((const __m128i*)(p0 + 8));
+			__m128i y0 = _mm_loadu_si128((const __m128i*)(p1));
+			__m128i y1 = _mm_loadu_si128((const __m128i*)(p1 + 8));
+
+			// Vertical sums of bytes 0-7, 8-15 and 16-23
+			__m128i a = _mm_add_epi16(_mm_cvtepu8_epi16(x0), _mm_cvtepu8_epi16(y0));
+			__m128i b = _mm_add_epi16(_mm_unpackhi_epi8(x0, zero), _mm_unpackhi_epi8(y0, zero));
+			__m128i c = _mm_add_epi16(_mm_unpackhi_epi8(x1, zero), _mm_unpackhi_epi8(y1, zero));
+
+			// Add the channel of the next pixel to every channel, the left
+			// pixels of each pair then hold the 2x2 sums.
+			a = _mm_srli_epi16(_mm_add_epi16(a, _mm_alignr_epi8(b, a, 6)), 2);
+			b = _mm_srli_epi16(_mm_add_epi16(b, _mm_alignr_epi8(c, b, 6)), 2);
+			c = _mm_srli_epi16(_mm_add_epi16(c, _mm_srli_si128(c, 6)), 2);
+
+			__m128i result = _mm_or_si128(_mm_shuffle_epi8(_mm_packus_epi16(a, b), pick_lo),
+										  _mm_shuffle_epi8(_mm_packus_epi16(c, c), pick_hi));
+			_mm_storel_epi64((__m128i*)(out), result);
+			S32 last = _mm_cvtsi128_si32(_mm_srli_si128(result, 8));
+			memcpy(out + 8, &last, sizeof(last));	/* Flawfinder: ignore */
+			out += 12;
+		}
+
+		for ( ; w < width; w++)
+		{
+			const U8* p0 = row0 + w * 6;
+			const U8* p1 = row1 + w * 6;
+			out[0] = (U8)(((U32)(p0[0]) + p0[3] + p1[0] + p1[3])>>2);
+			out[1] = (U8)(((U32)(p0[1]) + p0[4] + p1[1] + p1[4])>>2);
+			out[2] = (U8)(((U32)(p0[2]) + p0[5] + p1[2] + p1[5])>>2);
+			out += 3;
+		}
+	}
+}
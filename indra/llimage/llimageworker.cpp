@@ -32,8 +32,9 @@
 //----------------------------------------------------------------------------
 
 // MAIN THREAD
-LLImageDecodeThread::LLImageDecodeThread(bool threaded)
-	: LLQueuedThread("imagedecode", threaded)
+LLImageDecodeThread::LLImageDecodeThread(bool threaded, LLThreadPool* pool, U32 concurrency)
+	: LLQueuedThread("imagedecode", threaded, false, pool,
+					 (pool && !concurrency) ? pool->getThreadCount() : concurrency)
 {
 	mCreationMutex = new LLMutex(getAPRPool());
 }
@@ -72,7 +72,9 @@ public:
 	};
 	
 public:
-	LLImageDecodeThread(bool threaded = true);
+	// With a pool, decodes run on it, up to concurrency of them at once.
+	// A concurrency of 0 allows one per pool thread.
+	LLImageDecodeThread(bool threaded = true, LLThreadPool* pool = NULL, U32 concurrency = 0);
 	virtual ~LLImageDecodeThread();
 
 	handle_t decodeImage(LLImageFormatted* image,
@@ -0,0 +1,192 @@
+/**
+ * @file llimagekernels_test.cpp
+ * @date 2014-10
+ * @brief The SIMD image kernels must match the plain C++ ones exactly.
+ *
+ * $LicenseInfo:firstyear=2014&license=viewerlgpl$
+ * Second Life Viewer Source Code
+ * Copyright (C) 2014, Linden Research, Inc.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation;
+ * version 2.1 of the License only.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ * Linden Research, Inc., 945 Battery Street, San Francisco, CA  94111  USA
+ * $/LicenseInfo$
+ */
+
+#include "linden_common.h"
+
+#include "../llimagekernels.h"
+
+#include "../test/lltut.h"
+
+#include <vector>
+
+namespace
+{
+	typedef std::vector<U8> buffer_t;
+
+	// Deterministic noise with plenty of fully transparent and opaque bytes,
+	// plus some slack past the end so that overwrites show.
+	buffer_t make_buffer(S32 size, U32 seed)
+	{
+		buffer_t buffer(size + 32);
+		for (S32 i = 0; i < (S32)buffer.size(); i++)
+		{
+			seed = seed * 1664525 + 1013904223;
+			U8 value = (U8)(seed >> 24);
+			switch ((seed >> 8) & 7)
+			{
+			  case 0: value = 0; break;
+			  case 1: value = 255; break;
+			  default: break;
+			}
+			buffer[i] = value;
+		}
+		return buffer;
+	}
+
+	// Runs every kernel on one set of sizes with the current instruction set.
+	std::vector<buffer_t> run_kernels(S32 in_width, S32 in_height, S32 out_width, S32 out_height, S32 components)
+	{
+		std::vector<buffer_t> results;
+		buffer_t in = make_buffer(in_width * in_height * components, 1);
+		buffer_t in4 = make_buffer(in_width * in_height * 4, 2);
+
+		buffer_t scaled = make_buffer(out_width * out_height * components, 3);
+		LLImageKernels::scale(&in[0], in_width, in_height, &scaled[0], out_width, out_height, components);
+		results.push_back(scaled);
+
+		S32 mip_width = llmax(in_width / 2, 1);
+		S32 mip_height = llmax(in_height / 2, 1);
+		if (in_width >= 2 && in_height >= 2)
+		{
+			buffer_t mip = make_buffer(mip_width * mip_height * components, 4);
+			LLImageKernels::generateMip(&in[0], &mip[0], mip_width, mip_height, components);
+			results.push_back(mip);
+		}
+
+		buffer_t rgb = make_buffer(in_width * in_height * 3, 5);
+		LLImageKernels::copy4onto3(&in4[0], &rgb[0], in_width * in_height);
+		results.push_back(rgb);
+
+		buffer_t rgba = make_buffer(in_width * in_height * 4, 6);
+		LLImageKernels::copy3onto4(&in4[0], &rgba[0], in_width * in_height);
+		results.push_back(rgba);
+
+		buffer_t composited = make_buffer(in_width * in_height * 3, 7);
+		LLImageKernels::composite4onto3(&in4[0], &composited[0], in_width * in_height);
+		results.push_back(composited);
+
+		buffer_t composited_scaled = make_buffer(out_width * out_height * 3, 8);
+		LLImageKernels::compositeScaled4onto3(&in4[0], in_width, in_height,
+											  &composited_scaled[0], out_width, out_height);
+		results.push_back(composited_scaled);
+
+		return results;
+	}
+}
+
+namespace tut
+{
+	struct imagekernels_test
+	{
+		imagekernels_test() : mInstructionSet(LLImageKernels::getInstructionSet()) {}
+		~imagekernels_test() { LLImageKernels::setInstructionSet(mInstructionSet); }
+
+		LLImageKernels::EInstructionSet mInstructionSet;
+	};
+	typedef test_group<imagekernels_test> imagekernels_group_t;
+	typedef imagekernels_group_t::object imagekernels_object_t;
+	tut::imagekernels_group_t imagekernels_instance("LLImageKernels");
+
+	template<> template<>
+	void imagekernels_object_t::test<1>()
+	{
+		set_test_name("plain C++ and SSE2 are always available");
+
+		ensure("scalar", LLImageKernels::setInstructionSet(LLImageKernels::IS_SCALAR));
+		ensure_equals("scalar set", LLImageKernels::getInstructionSet(), LLImageKernels::IS_SCALAR);
+		ensure("SSE2", LLImageKernels::setInstructionSet(LLImageKernels::IS_SSE2));
+		ensure_equals("SSE2 set", LLImageKernels::getInstructionSet(), LLImageKernels::IS_SSE2);
+	}
+
+	template<> template<>
+	void imagekernels_object_t::test<2>()
+	{
+		set_test_name("every instruction set gives the same pixels");
+
+		// Odd sizes to hit the scalar tails, shrinking, growing and both.
+		const S32 sizes[][4] =
+		{
+			{ 1, 1, 1, 1 },
+			{ 2, 2, 1, 1 },
+			{ 37, 23, 37, 23 },
+			{ 64, 64, 32, 32 },
+			{ 67, 45, 13, 9 },
+			{ 13, 9, 67, 45 },
+			{ 100, 7, 33, 70 },
+			{ 256, 129, 255, 64 }
+		};
+		const S32 num_sizes = sizeof(sizes) / sizeof(sizes[0]);
+
+		for (S32 size = 0; size < num_sizes; size++)
+		{
+			for (S32 components = 1; components <= 4; components++)
+			{
+				LLImageKernels::setInstructionSet(LLImageKernels::IS_SCALAR);
+				std::vector<buffer_t> expected = run_kernels(sizes[size][0], sizes[size][1], sizes[size][2], sizes[size][3], components);
+
+				for (S32 set = LLImageKernels::IS_SSE2; set < LLImageKernels::IS_COUNT; set++)
+				{
+					if (!LLImageKernels::setInstructionSet((LLImageKernels::EInstructionSet)set))
+					{
+						continue;
+					}
+					std::vector<buffer_t> results = run_kernels(sizes[size][0], sizes[size][1], sizes[size][2], sizes[size][3], components);
+					ensure_equals("kernel count", results.size(), expected.size());
+					for (S32 kernel = 0; kernel < (S32)results.size(); kernel++)
+					{
+						std::string message = llformat("%s kernel %d, %dx%d to %dx%d, %d components",
+													   LLImageKernels::getInstructionSetName((LLImageKernels::EInstructionSet)set),
+													   kernel, sizes[size][0], sizes[size][1], sizes[size][2], sizes[size][3], components);
+						ensure(message, results[kernel] == expected[kernel]);
+					}
+				}
+			}
+		}
+	}
+
+	template<> template<>
+	void imagekernels_object_t::test<3>()
+	{
+		set_test_name("compositing blends with the source alpha");
+
+		LLImageKernels::setInstructionSet(LLImageKernels::IS_SCALAR);
+
+		// Transparent, opaque and half covering red over grey, scaled 2:1
+		const U8 src[] = { 255, 0, 0, 0,	255, 0, 0, 0,
+						   255, 0, 0, 255,	255, 0, 0, 255,
+						   255, 0, 0, 128,	255, 0, 0, 128 };
+		U8 dst[] = { 100, 100, 100,		100, 100, 100,		100, 100, 100 };
+		LLImageKernels::compositeScaled4onto3(src, 6, 1, dst, 3, 1);
+
+		ensure_equals("transparent r", (S32)dst[0], 100);
+		ensure_equals("transparent g", (S32)dst[1], 100);
+		ensure_equals("opaque r", (S32)dst[3], 255);
+		ensure_equals("opaque g", (S32)dst[4], 0);
+		ensure_equals("half r", (S32)dst[6], 178);
+		ensure_equals("half g", (S32)dst[7], 50);
+	}
+}
@@ -31,6 +31,7 @@
 #include "openjpeg.h"
 
 #include "lltimer.h"
+#include "llthreadpool.h"
 //#include "llmemory.h"
 
 const char* fallbackEngineInfoLLImageJ2CImpl()
@@ -97,6 +98,58 @@ int ceildivpow2(int a, int b)
 }
 
 
+// Images with fewer pixels than this are converted on the decoding thread,
+// handing them to the pool would cost more than it saves.
+const S32 MIN_PIXELS_FOR_PARALLEL_COPY = 256 * 256;
+const S32 MIN_ROWS_PER_CHUNK = 32;
+
+// Copies rows of the decoded components into the interleaved, bottom up
+// layout of LLImageRaw.  Rows are independent, so ranges of them can be
+// converted in parallel.
+class LLImageJ2COJRowCopier : public LLThreadPool::RangeTask
+{
+public:
+	LLImageJ2COJRowCopier(const opj_image_t* image, S32 first_channel, S32 channels,
+						  S32 width, S32 height, U8* rawp)
+	:	mImage(image),
+		mFirstChannel(first_channel),
+		mChannels(channels),
+		mWidth(width),
+		mHeight(height),
+		mRawp(rawp)
+	{
+	}
+
+	/*virtual*/ void run(S32 begin, S32 end)
+	{
+		S32 comp_width = mImage->comps[0].w;
+		for (S32 row = begin; row < end; row++)
+		{
+			// Raw images are stored bottom up
+			S32 y = mHeight - 1 - row;
+			U8* dest_row = mRawp + row * mWidth * mChannels;
+			for (S32 dest = 0; dest < mChannels; dest++)
+			{
+				const int* src = mImage->comps[mFirstChannel + dest].data + y * comp_width;
+				U8* dst = dest_row + dest;
+				for (S32 x = 0; x < mWidth; x++)
+				{
+					*dst = src[x];
+					dst += mChannels;
+				}
+			}
+		}
+	}
+
+private:
+	const opj_image_t* mImage;
+	S32 mFirstChannel;
+	S32 mChannels;
+	S32 mWidth;
+	S32 mHeight;
+	U8* mRawp;
+};
+
 LLImageJ2COJ::LLImageJ2COJ()
 	: LLImageJ2CImpl()
 {
@@ -262,32 +315,15 @@ BOOL LLImageJ2COJ::decodeImpl(LLImageJ2C &base, LLImageRaw &raw_image, F32 decod
 	// It is integer math so the formula is written in ceildivpo2.
 	// (Assuming all the components have the same width, height and
 	// factor.)
-	S32 comp_width = image->comps[0].w;
 	S32 f=image->comps[0].factor;
 	S32 width = ceildivpow2(image->x1 - image->x0, f);
 	S32 height = ceildivpow2(image->y1 - image->y0, f);
 	raw_image.resize(width, height, channels);
 	U8 *rawp = raw_image.getData();
 
-	// first_channel is what channel to start copying from
-	// dest is what channel to copy to.  first_channel comes from the
-	// argument, dest always starts writing at channel zero.
-	for (S32 comp = first_channel, dest=0; comp < first_channel + channels;
-		comp++, dest++)
+	for (S32 comp = first_channel; comp < first_channel + channels; comp++)
 	{
-		if (image->comps[comp].data)
-		{
-			S32 offset = dest;
-			for (S32 y = (height - 1); y >= 0; y--)
-			{
-				for (S32 x = 0; x < width; x++)
-				{
-					rawp[offset] = image->comps[comp].data[y*comp_width + x];
-					offset += channels;
-				}
-			}
-		}
-		else // Some rare OpenJPEG versions have this bug.
+		if (!image->comps[comp].data) // Some rare OpenJPEG versions have this bug.
 		{
 			LL_DEBUGS("Texture") << "ERROR -> decodeImpl: failed to decode image! (NULL comp data - OpenJPEG bug)" << LL_ENDL;
 			opj_image_destroy(image);
@@ -296,6 +332,20 @@ BOOL LLImageJ2COJ::decodeImpl(LLImageJ2C &base, LLImageRaw &raw_image, F32 decod
 		}
 	}
 
+	// first_channel is what channel to start copying from
+	// dest is what channel to copy to.  first_channel comes from the
+	// argument, dest always starts writing at channel zero.
+	LLImageJ2COJRowCopier copier(image, first_channel, channels, width, height, rawp);
+	LLThreadPool* pool = LLImageJ2C::getThreadPool();
+	if (pool && width * height >= MIN_PIXELS_FOR_PARALLEL_COPY)
+	{
+		pool->parallelFor(height, MIN_ROWS_PER_CHUNK, copier);
+	}
+	else
+	{
+		copier.run(0, height);
+	}
+
 	/* free image data structure */
 	opj_image_destroy(image);
 
@@ -291,6 +291,81 @@ S32 LLCamera::AABBInRegionFrustumNoFarClip(const LLVector4a& center, const LLVec
 	return AABBInFrustumNoFarClip(center, radius, mRegionPlanes);
 }
 
+void LLCamera::AABBInFrustum4(const LLBoxes4& boxes, S32* results, const LLPlane* planes)
+{
+	AABBInFrustum4(boxes, results, planes ? planes : mAgentPlanes, AGENT_PLANE_USER_CLIP_NUM);
+}
+
+void LLCamera::AABBInRegionFrustum4(const LLBoxes4& boxes, S32* results)
+{
+	AABBInFrustum4(boxes, results, mRegionPlanes, AGENT_PLANE_USER_CLIP_NUM);
+}
+
+void LLCamera::AABBInFrustumNoFarClip4(const LLBoxes4& boxes, S32* results, const LLPlane* planes)
+{
+	AABBInFrustum4(boxes, results, planes ? planes : mAgentPlanes, AGENT_PLANE_FAR);
+}
+
+void LLCamera::AABBInRegionFrustumNoFarClip4(const LLBoxes4& boxes, S32* results)
+{
+	AABBInFrustum4(boxes, results, mRegionPlanes, AGENT_PLANE_FAR);
+}
+
+// The single box test with each plane broadcast across four boxes.  The
+// dot products add up in the same order as LLVector4a::dot3(), so every
+// box gets exactly the result the single box test gives it.
+void LLCamera::AABBInFrustum4(const LLBoxes4& boxes, S32* results, const LLPlane* planes, U32 skip_plane)
+{
+	U32 outside = 0;
+	U32 partial = 0;
+	LLVector4a normal[3], d, rscale, minp, maxp, dot_min, dot_max, term;
+	U32 max_planes = llmin(mPlaneCount, (U32) AGENT_PLANE_USER_CLIP_NUM);		// mAgentPlanes[] size is 7
+	for (U32 i = 0; i < max_planes; i++)
+	{
+		U8 mask = mPlaneMask[i];
+		if (i == skip_plane || mask >= PLANE_MASK_NUM)
+		{
+			continue;
+		}
+
+		const LLPlane& p(planes[i]);
+		d.splat(-p[3]);
+		for (S32 axis = 0; axis < 3; ++axis)
+		{
+			normal[axis].splat(p[axis]);
+			rscale.splat(sFrustumScaler[mask][axis]);
+			rscale.mul(boxes.mRadius[axis]);
+			minp.setSub(boxes.mCenter[axis], rscale);
+			maxp.setAdd(boxes.mCenter[axis], rscale);
+			if (axis == 0)
+			{
+				dot_min.setMul(normal[axis], minp);
+				dot_max.setMul(normal[axis], maxp);
+			}
+			else
+			{
+				term.setMul(normal[axis], minp);
+				dot_min.add(term);
+				term.setMul(normal[axis], maxp);
+				dot_max.add(term);
+			}
+		}
+
+		outside |= dot_min.greaterThan(d).getGatheredBits();
+		partial |= dot_max.greaterThan(d).getGatheredBits();
+		if (outside == LLVector4Logical::MASK_XYZW)
+		{
+			break;
+		}
+	}
+
+	for (S32 i = 0; i < LLBoxes4::COUNT; i++)
+	{
+		U32 bit = 1 << i;
+		results[i] = (outside & bit) ? 0 : ((partial & bit) ? 1 : 2);
+	}
+}
+
 int LLCamera::sphereInFrustumQuick(const LLVector3 &sphere_center, const F32 radius) 
 {
 	LLVector3 dist = sphere_center-mFrustCenter;
@@ -51,6 +51,37 @@ const F32 MIN_FAR_PLANE 	= 0.2f;
 static const F32 MIN_FIELD_OF_VIEW = 5.0f * DEG_TO_RAD;
 static const F32 MAX_FIELD_OF_VIEW = 175.f * DEG_TO_RAD;
 
+// Centers and radii of four axis aligned boxes laid out one axis per
+// vector, so the AABBIn*Frustum4() tests can do all four at once.
+LL_ALIGN_PREFIX(16)
+class LLBoxes4
+{
+public:
+	enum { COUNT = 4 };
+
+	void set(S32 index, const LLVector4a& center, const LLVector4a& radius)
+	{
+		for (S32 axis = 0; axis < 3; ++axis)
+		{
+			mCenter[axis].getF32ptr()[index] = center[axis];
+			mRadius[axis].getF32ptr()[index] = radius[axis];
+		}
+	}
+
+	void shift(const LLVector4a& offset)
+	{
+		LLVector4a t;
+		for (S32 axis = 0; axis < 3; ++axis)
+		{
+			t.splat(offset[axis]);
+			mCenter[axis].add(t);
+		}
+	}
+
+	LL_ALIGN_16(LLVector4a mCenter[3]);
+	LL_ALIGN_16(LLVector4a mRadius[3]);
+} LL_ALIGN_POSTFIX(16);
+
 // An LLCamera is an LLCoorFrame with a view frustum.
 // This means that it has several methods for moving it around 
 // that are inherited from the LLCoordFrame() class :
@@ -208,6 +239,14 @@ public:
 	S32 AABBInFrustumNoFarClip(const LLVector4a& center, const LLVector4a& radius, const LLPlane* planes = NULL);
 	S32 AABBInRegionFrustumNoFarClip(const LLVector4a& center, const LLVector4a& radius);
 
+	// Same as the above for each of four boxes at once, results[i] is what
+	// the single box test returns for box i.  Every box is tested, so fill
+	// the unused ones with anything.
+	void AABBInFrustum4(const LLBoxes4& boxes, S32* results, const LLPlane* planes = NULL);
+	void AABBInRegionFrustum4(const LLBoxes4& boxes, S32* results);
+	void AABBInFrustumNoFarClip4(const LLBoxes4& boxes, S32* results, const LLPlane* planes = NULL);
+	void AABBInRegionFrustumNoFarClip4(const LLBoxes4& boxes, S32* results);
+
 	//does a quick 'n dirty sphere-sphere check
 	S32 sphereInFrustumQuick(const LLVector3 &sphere_center, const F32 radius); 
 
@@ -227,6 +266,9 @@ protected:
 	void calculateFrustumPlanes(F32 left, F32 right, F32 top, F32 bottom);
 	void calculateFrustumPlanesFromWindow(F32 x1, F32 y1, F32 x2, F32 y2);
 	void calculateWorldFrustumPlanes();
+
+private:
+	void AABBInFrustum4(const LLBoxes4& boxes, S32* results, const LLPlane* planes, U32 skip_plane);
 } LL_ALIGN_POSTFIX(16);
 
 
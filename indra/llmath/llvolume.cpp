@@ -47,6 +47,7 @@
 #include "llvolume.h"
 #include "llvolumeoctree.h"
 #include "llstl.h"
+#include "llsdarena.h"
 #include "llsdserialize.h"
 #include "llvector4a.h"
 #include "llmatrix4a.h"
@@ -2412,7 +2413,9 @@ bool LLVolumeFace::VertexData::compareNormal(const LLVolumeFace::VertexData& rhs
 bool LLVolume::unpackVolumeFaces(std::istream& is, S32 size)
 {
 	//input stream is now pointing at a zlib compressed block of LLSD
-	//decompress block
+	//decompress block, the LLSD only lives until the faces are unpacked
+	LLSDArena arena;
+	LLSDArena::Scope scope(arena);
 	LLSD mdl;
 	if (!unzip_llsd(mdl, is, size))
 	{
@@ -2420,6 +2423,26 @@ bool LLVolume::unpackVolumeFaces(std::istream& is, S32 size)
 		return false;
 	}
 	
+	return unpackVolumeFacesInternal(mdl);
+}
+
+bool LLVolume::unpackVolumeFaces(const U8* in, S32 size)
+{
+	//in is pointing at a zlib compressed block of LLSD
+	LLSDArena arena;
+	LLSDArena::Scope scope(arena);
+	LLSD mdl;
+	if (!unzip_llsd(mdl, in, size))
+	{
+		LL_DEBUGS("MeshStreaming") << "Failed to unzip LLSD blob for LoD, will probably fetch from sim again." << LL_ENDL;
+		return false;
+	}
+
+	return unpackVolumeFacesInternal(mdl);
+}
+
+bool LLVolume::unpackVolumeFacesInternal(LLSD& mdl)
+{
 	{
 		U32 face_count = mdl.size();
 
@@ -2740,6 +2763,186 @@ void LLVolume::cacheOptimize()
 	}
 }
 
+namespace
+{
+	const U32 DECODED_FACE_WEIGHTS = 0x1;
+	const U32 DECODED_FACE_TANGENTS = 0x2;
+
+	struct DecodedFacesHeader
+	{
+		U32 mNumFaces;
+		U32 mReserved[3];
+	};
+
+	struct DecodedFaceHeader
+	{
+		S32 mNumVertices;
+		S32 mNumIndices;
+		U32 mFlags;
+		U32 mReserved;
+		F32 mExtents[12];	// min, max, center
+		F32 mTexCoordExtents[4];
+	};
+
+	inline U32 decoded_pad(U32 size)
+	{
+		return (size + 0xF) & ~0xF;
+	}
+
+	// For sizes read from a file, which must not wrap
+	inline U64 decoded_pad64(U64 size)
+	{
+		return (size + 0xF) & ~(U64)0xF;
+	}
+
+	inline void decoded_append(std::vector<U8>& out, const void* data, U32 size)
+	{
+		U32 offset = out.size();
+		out.resize(offset + decoded_pad(size), 0);
+		if (size)
+		{
+			memcpy(&out[offset], data, size);
+		}
+	}
+}
+
+void LLVolume::packDecodedFaces(std::vector<U8>& out) const
+{
+	DecodedFacesHeader header;
+	memset(&header, 0, sizeof(header));
+	header.mNumFaces = mVolumeFaces.size();
+	out.clear();
+	decoded_append(out, &header, sizeof(header));
+
+	for (U32 i = 0; i < mVolumeFaces.size(); ++i)
+	{
+		const LLVolumeFace& face = mVolumeFaces[i];
+
+		DecodedFaceHeader face_header;
+		memset(&face_header, 0, sizeof(face_header));
+		face_header.mNumVertices = face.mNumVertices;
+		face_header.mNumIndices = face.mNumIndices;
+		face_header.mFlags = (face.mWeights ? DECODED_FACE_WEIGHTS : 0) | (face.mTangents ? DECODED_FACE_TANGENTS : 0);
+		memcpy(face_header.mExtents, face.mExtents, sizeof(face_header.mExtents));
+		memcpy(face_header.mTexCoordExtents, face.mTexCoordExtents, sizeof(face_header.mTexCoordExtents));
+		decoded_append(out, &face_header, sizeof(face_header));
+
+		U32 num_verts = face.mNumVertices;
+		decoded_append(out, face.mPositions, num_verts * sizeof(LLVector4a));
+		decoded_append(out, face.mNormals, num_verts * sizeof(LLVector4a));
+		decoded_append(out, face.mTexCoords, num_verts * sizeof(LLVector2));
+		decoded_append(out, face.mIndices, face.mNumIndices * sizeof(U16));
+		if (face.mWeights)
+		{
+			decoded_append(out, face.mWeights, num_verts * sizeof(LLVector4a));
+		}
+		if (face.mTangents)
+		{
+			decoded_append(out, face.mTangents, num_verts * sizeof(LLVector4a));
+		}
+	}
+}
+
+bool LLVolume::unpackDecodedFaces(const U8* in, S32 size)
+{
+	U64 offset = sizeof(DecodedFacesHeader);
+	if (size < (S32)offset)
+	{
+		return false;
+	}
+
+	const DecodedFacesHeader* header = (const DecodedFacesHeader*)in;
+	if (header->mNumFaces == 0 || header->mNumFaces > (U32)LL_SCULPT_MESH_MAX_FACES)
+	{
+		return false;
+	}
+
+	std::vector<LLVolumeFace> faces(header->mNumFaces);
+	for (U32 i = 0; i < faces.size(); ++i)
+	{
+		if (offset + sizeof(DecodedFaceHeader) > (U64)size)
+		{
+			return false;
+		}
+		const DecodedFaceHeader* face_header = (const DecodedFaceHeader*)(in + offset);
+		offset += decoded_pad(sizeof(DecodedFaceHeader));
+
+		S32 num_verts = face_header->mNumVertices;
+		S32 num_indices = face_header->mNumIndices;
+		if (num_verts < 0 || num_verts > 65536 || num_indices < 0
+			|| (U64)num_indices * sizeof(U16) > (U64)size - offset
+			|| (num_indices && !num_verts))
+		{
+			return false;
+		}
+
+		U64 vert_size = decoded_pad64((U64)num_verts * sizeof(LLVector4a));
+		U64 tc_size = decoded_pad64((U64)num_verts * sizeof(LLVector2));
+		U64 index_size = decoded_pad64((U64)num_indices * sizeof(U16));
+		U64 face_size = vert_size * 2 + tc_size + index_size;
+		if (face_header->mFlags & DECODED_FACE_WEIGHTS)
+		{
+			face_size += vert_size;
+		}
+		if (face_header->mFlags & DECODED_FACE_TANGENTS)
+		{
+			face_size += vert_size;
+		}
+		if (offset + face_size > (U64)size)
+		{
+			return false;
+		}
+
+		LLVolumeFace& face = faces[i];
+		face.resizeVertices(num_verts);
+		face.resizeIndices(num_indices);
+		memcpy(face.mExtents, face_header->mExtents, sizeof(face_header->mExtents));
+		memcpy(face.mTexCoordExtents, face_header->mTexCoordExtents, sizeof(face_header->mTexCoordExtents));
+
+		if (num_verts)
+		{
+			memcpy(face.mPositions, in + offset, num_verts * sizeof(LLVector4a));
+			offset += vert_size;
+			memcpy(face.mNormals, in + offset, num_verts * sizeof(LLVector4a));
+			offset += vert_size;
+			memcpy(face.mTexCoords, in + offset, num_verts * sizeof(LLVector2));
+			offset += tc_size;
+		}
+		if (num_indices)
+		{
+			memcpy(face.mIndices, in + offset, num_indices * sizeof(U16));
+			offset += index_size;
+
+			for (S32 j = 0; j < num_indices; ++j)
+			{
+				if (face.mIndices[j] >= num_verts)
+				{
+					return false;
+				}
+			}
+		}
+		if (face_header->mFlags & DECODED_FACE_WEIGHTS)
+		{
+			face.allocateWeights(num_verts);
+			memcpy(face.mWeights, in + offset, num_verts * sizeof(LLVector4a));
+			offset += vert_size;
+		}
+		if (face_header->mFlags & DECODED_FACE_TANGENTS)
+		{
+			face.allocateTangents(num_verts);
+			memcpy(face.mTangents, in + offset, num_verts * sizeof(LLVector4a));
+			offset += vert_size;
+		}
+
+		// Indices were reordered for the vertex cache before packing
+		face.mOptimized = TRUE;
+	}
+
+	mVolumeFaces.swap(faces);
+	mSculptLevel = 0;
+	return true;
+}
+
 
 S32	LLVolume::getNumFaces() const
 {
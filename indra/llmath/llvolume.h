@@ -1059,6 +1059,12 @@ public:
 	void copyVolumeFaces(const LLVolume* volume);
 	void cacheOptimize();
 
+	// Decoded and optimized mesh faces as one flat block for caching on
+	// disk.  Every array starts 16 byte aligned and is laid out as
+	// LLVolumeFace keeps it, so unpacking is a copy per array.
+	void packDecodedFaces(std::vector<U8>& out) const;
+	bool unpackDecodedFaces(const U8* in, S32 size);
+
 private:
 	void sculptGenerateMapVertices(U16 sculpt_width, U16 sculpt_height, S8 sculpt_components, const U8* sculpt_data, U8 sculpt_type);
 	F32 sculptGetSurfaceArea();
@@ -1069,8 +1075,11 @@ private:
 protected:
 	BOOL generate();
 	void createVolumeFaces();
+	bool unpackVolumeFacesInternal(LLSD& mdl);
 public:
 	virtual bool unpackVolumeFaces(std::istream& is, S32 size);
+	// Same as above for a block already in memory
+	bool unpackVolumeFaces(const U8* in, S32 size);
 
 	virtual void setMeshAssetLoaded(BOOL loaded);
 	virtual BOOL isMeshAssetLoaded();
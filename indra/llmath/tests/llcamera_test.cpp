@@ -0,0 +1,192 @@
+/**
+ * @file llcamera_test.cpp
+ * @date 2014-10
+ * @brief Batched frustum tests of LLCamera checked against the single box ones.
+ *
+ * $LicenseInfo:firstyear=2014&license=viewerlgpl$
+ * Second Life Viewer Source Code
+ * Copyright (C) 2014, Linden Research, Inc.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation;
+ * version 2.1 of the License only.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ * Linden Research, Inc., 945 Battery Street, San Francisco, CA  94111  USA
+ * $/LicenseInfo$
+ */
+
+#include "linden_common.h"
+
+#include "../llcamera.h"
+#include "lltimer.h"
+
+#include "../test/lltut.h"
+#include "../test/lltestrandom.h"
+
+#include <vector>
+
+namespace
+{
+	// Frustum corners the way LLViewerCamera unprojects them, near then
+	// far, each counter clockwise from the bottom left as seen by the camera
+	void setup_camera(LLCamera& camera, const LLVector3& origin, F32 far_plane)
+	{
+		camera.setOrigin(origin);
+		camera.setFar(far_plane);
+
+		F32 half_height = tanf(camera.getView() * 0.5f);
+		F32 half_width = half_height * camera.getAspect();
+		const F32 sides[4][2] = { { -1.f, -1.f }, { 1.f, -1.f }, { 1.f, 1.f }, { -1.f, 1.f } };
+
+		LLVector3 frust[LLCamera::AGENT_FRUSTRUM_NUM];
+		for (S32 i = 0; i < LLCamera::AGENT_FRUSTRUM_NUM; i++)
+		{
+			F32 dist = i < 4 ? camera.getNear() : camera.getFar();
+			const F32* side = sides[i % 4];
+			// Camera looks down +x with +y to the left and +z up
+			frust[i] = origin + camera.getAtAxis() * dist
+					   - camera.getLeftAxis() * (side[0] * half_width * dist)
+					   + camera.getUpAxis() * (side[1] * half_height * dist);
+		}
+		camera.calcAgentFrustumPlanes(frust);
+	}
+
+	void random_box(LLTestRandom& random, const LLVector3& origin, F32 reach, LLVector4a& center, LLVector4a& radius)
+	{
+		center.set(origin.mV[VX] + random.next(-reach, reach),
+				   origin.mV[VY] + random.next(-reach, reach),
+				   origin.mV[VZ] + random.next(-reach * 0.25f, reach * 0.25f));
+		F32 size = random.next(0.f, 1.f) < 0.1f ? 32.f : 4.f;
+		radius.set(random.next(0.f, size), random.next(0.f, size), random.next(0.f, size));
+	}
+}
+
+namespace tut
+{
+	struct camera_test
+	{
+	};
+	typedef test_group<camera_test> camera_group_t;
+	typedef camera_group_t::object camera_object_t;
+	tut::camera_group_t camera_instance("LLCamera");
+
+	template<> template<>
+	void camera_object_t::test<1>()
+	{
+		set_test_name("batched AABB tests match the single box tests");
+
+		LLTestRandom random(0xca3e);
+		LLCamera camera;
+		LLVector3 origin(128.f, 128.f, 30.f);
+		setup_camera(camera, origin, 128.f);
+		camera.calcRegionFrustumPlanes(LLVector3(256.f, 0.f, 0.f), 96.f);
+
+		S32 counts[3] = { 0, 0, 0 };
+		for (S32 pass = 0; pass < 2; pass++)
+		{
+			if (pass == 1)
+			{
+				// A water plane, as the reflection pass clips to
+				LLPlane plane(LLVector3(0.f, 0.f, 1.f), -20.f);
+				camera.setUserClipPlane(plane);
+				camera.calcRegionFrustumPlanes(LLVector3(256.f, 0.f, 0.f), 96.f);
+			}
+
+			for (S32 round = 0; round < 5000; round++)
+			{
+				LLBoxes4 boxes;
+				LLVector4a center[LLBoxes4::COUNT], radius[LLBoxes4::COUNT];
+				for (S32 i = 0; i < LLBoxes4::COUNT; i++)
+				{
+					random_box(random, origin, 160.f, center[i], radius[i]);
+					boxes.set(i, center[i], radius[i]);
+				}
+
+				S32 results[4][LLBoxes4::COUNT];
+				camera.AABBInFrustum4(boxes, results[0]);
+				camera.AABBInFrustumNoFarClip4(boxes, results[1]);
+				camera.AABBInRegionFrustum4(boxes, results[2]);
+				camera.AABBInRegionFrustumNoFarClip4(boxes, results[3]);
+				for (S32 i = 0; i < LLBoxes4::COUNT; i++)
+				{
+					ensure_equals("frustum", results[0][i], camera.AABBInFrustum(center[i], radius[i]));
+					ensure_equals("no far clip", results[1][i], camera.AABBInFrustumNoFarClip(center[i], radius[i]));
+					ensure_equals("region", results[2][i], camera.AABBInRegionFrustum(center[i], radius[i]));
+					ensure_equals("region no far clip", results[3][i], camera.AABBInRegionFrustumNoFarClip(center[i], radius[i]));
+					counts[results[0][i]]++;
+				}
+			}
+		}
+
+		// Otherwise the above proves little
+		ensure("some outside", counts[0] > 0);
+		ensure("some partly inside", counts[1] > 0);
+		ensure("some inside", counts[2] > 0);
+	}
+
+	template<> template<>
+	void camera_object_t::test<2>()
+	{
+		set_test_name("culling benchmark");
+
+		// Children of a few thousand partly visible octree nodes, eight each
+		const S32 NODES = 4096;
+		const S32 CHILDREN = 2 * LLBoxes4::COUNT;
+		const S32 PASSES = 50;
+
+		LLTestRandom random(0xc011);
+		LLCamera camera;
+		LLVector3 origin(128.f, 128.f, 30.f);
+		setup_camera(camera, origin, 256.f);
+
+		std::vector<LLVector4a> bounds(NODES * CHILDREN * 2);
+		LLBoxes4* boxes = (LLBoxes4*) ll_aligned_malloc_16(sizeof(LLBoxes4) * NODES * 2);
+		for (S32 i = 0; i < NODES * CHILDREN; i++)
+		{
+			random_box(random, origin, 300.f, bounds[i * 2], bounds[i * 2 + 1]);
+			boxes[i / LLBoxes4::COUNT].set(i % LLBoxes4::COUNT, bounds[i * 2], bounds[i * 2 + 1]);
+		}
+
+		LLTimer timer;
+		S32 single_visible = 0;
+		for (S32 pass = 0; pass < PASSES; pass++)
+		{
+			for (S32 i = 0; i < NODES * CHILDREN; i++)
+			{
+				single_visible += camera.AABBInFrustumNoFarClip(bounds[i * 2], bounds[i * 2 + 1]) != 0;
+			}
+		}
+		F64 single_time = timer.getElapsedTimeF64();
+
+		timer.reset();
+		S32 batched_visible = 0;
+		S32 results[LLBoxes4::COUNT];
+		for (S32 pass = 0; pass < PASSES; pass++)
+		{
+			for (S32 i = 0; i < NODES * 2; i++)
+			{
+				camera.AABBInFrustumNoFarClip4(boxes[i], results);
+				for (S32 j = 0; j < LLBoxes4::COUNT; j++)
+				{
+					batched_visible += results[j] != 0;
+				}
+			}
+		}
+		F64 batched_time = timer.getElapsedTimeF64();
+		ll_aligned_free_16(boxes);
+
+		LL_INFOS() << NODES * CHILDREN << " boxes x " << PASSES << ": one at a time "
+				   << single_time * 1000.0 << " ms, four at a time " << batched_time * 1000.0 << " ms" << LL_ENDL;
+		ensure_equals("same boxes visible", batched_visible, single_visible);
+	}
+}
@@ -0,0 +1,196 @@
+/**
+ * @file llvolume_test.cpp
+ * @date 2014-10
+ * @brief LLVolume decoded face packing, round trip and damaged input.
+ *
+ * $LicenseInfo:firstyear=2014&license=viewerlgpl$
+ * Second Life Viewer Source Code
+ * Copyright (C) 2014, Linden Research, Inc.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation;
+ * version 2.1 of the License only.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ * Linden Research, Inc., 945 Battery Street, San Francisco, CA  94111  USA
+ * $/LicenseInfo$
+ */
+
+#include "linden_common.h"
+
+#include "../llvolume.h"
+#include "llpointer.h"
+
+#include "../test/lltut.h"
+
+#include <vector>
+
+namespace
+{
+	// Gives the tests the faces to fill in and compare
+	class TestVolume : public LLVolume
+	{
+	public:
+		TestVolume(const LLVolumeParams& params) : LLVolume(params, 1.f) {}
+		LLVolumeFace& getFace(S32 f) { return mVolumeFaces[f]; }
+	};
+
+	LLPointer<TestVolume> make_box()
+	{
+		LLVolumeParams params;
+		params.setType(LL_PCODE_PROFILE_SQUARE, LL_PCODE_PATH_LINE);
+		return new TestVolume(params);
+	}
+
+	void fill(LLVector4a* dest, S32 count, F32 seed)
+	{
+		for (S32 i = 0; i < count; ++i)
+		{
+			dest[i].set(seed + i, seed - i, seed * i, 1.f / (i + 1));
+		}
+	}
+
+	bool same(const void* a, const void* b, size_t size)
+	{
+		return (!a && !b) || (a && b && !memcmp(a, b, size));
+	}
+
+	// Where the first index of the first face lies in a packed buffer
+	U32 first_index_offset(const LLVolumeFace& face)
+	{
+		const U32 vert_size = (face.mNumVertices * sizeof(LLVector4a) + 0xF) & ~0xF;
+		const U32 tc_size = (face.mNumVertices * sizeof(LLVector2) + 0xF) & ~0xF;
+		// Faces header, then the first face's header, then its vertices
+		return 16 + 80 + vert_size * 2 + tc_size;
+	}
+}
+
+namespace tut
+{
+	struct volume_test
+	{
+		volume_test()
+		:	mVolume(make_box())
+		{
+			// Some faces rigged, some with tangents, one with both
+			LLVolumeFace& rigged = mVolume->getFace(0);
+			rigged.allocateWeights(rigged.mNumVertices);
+			fill(rigged.mWeights, rigged.mNumVertices, 2.f);
+			LLVolumeFace& tangents = mVolume->getFace(1);
+			tangents.allocateTangents(tangents.mNumVertices);
+			fill(tangents.mTangents, tangents.mNumVertices, 3.f);
+			LLVolumeFace& both = mVolume->getFace(2);
+			both.allocateWeights(both.mNumVertices);
+			fill(both.mWeights, both.mNumVertices, 4.f);
+			both.allocateTangents(both.mNumVertices);
+			fill(both.mTangents, both.mNumVertices, 5.f);
+
+			mVolume->packDecodedFaces(mPacked);
+		}
+
+		// Unpacks data into a fresh volume, which must keep its own faces on failure
+		bool unpack(const std::vector<U8>& data, S32 size)
+		{
+			LLPointer<TestVolume> volume = make_box();
+			S32 faces = volume->getNumVolumeFaces();
+			bool unpacked = volume->unpackDecodedFaces(size ? &data[0] : NULL, size);
+			ensure("faces kept on failure", unpacked || volume->getNumVolumeFaces() == faces);
+			return unpacked;
+		}
+
+		LLPointer<TestVolume> mVolume;
+		std::vector<U8> mPacked;
+	};
+	typedef test_group<volume_test> volume_group_t;
+	typedef volume_group_t::object volume_object_t;
+	tut::volume_group_t volume_instance("LLVolume");
+
+	template<> template<>
+	void volume_object_t::test<1>()
+	{
+		set_test_name("decoded faces round trip");
+
+		LLPointer<TestVolume> volume = make_box();
+		ensure("has faces", mVolume->getNumVolumeFaces() > 2);
+		ensure("unpacked", volume->unpackDecodedFaces(&mPacked[0], (S32)mPacked.size()));
+		ensure_equals("face count", volume->getNumVolumeFaces(), mVolume->getNumVolumeFaces());
+
+		for (S32 f = 0; f < mVolume->getNumVolumeFaces(); ++f)
+		{
+			const LLVolumeFace& src = mVolume->getVolumeFace(f);
+			const LLVolumeFace& dst = volume->getVolumeFace(f);
+			const S32 num_verts = src.mNumVertices;
+			ensure_equals("vertices", dst.mNumVertices, num_verts);
+			ensure_equals("indices", dst.mNumIndices, src.mNumIndices);
+			ensure("positions", same(dst.mPositions, src.mPositions, num_verts * sizeof(LLVector4a)));
+			ensure("normals", same(dst.mNormals, src.mNormals, num_verts * sizeof(LLVector4a)));
+			ensure("texcoords", same(dst.mTexCoords, src.mTexCoords, num_verts * sizeof(LLVector2)));
+			ensure("index data", same(dst.mIndices, src.mIndices, src.mNumIndices * sizeof(U16)));
+			ensure("weights", same(dst.mWeights, src.mWeights, num_verts * sizeof(LLVector4a)));
+			ensure("tangents", same(dst.mTangents, src.mTangents, num_verts * sizeof(LLVector4a)));
+			ensure("extents", same(dst.mExtents, src.mExtents, 2 * sizeof(LLVector4a)));
+			ensure("texcoord extents", same(dst.mTexCoordExtents, src.mTexCoordExtents, 2 * sizeof(LLVector2)));
+		}
+		ensure("face 0 rigged", volume->getVolumeFace(0).mWeights && !volume->getVolumeFace(0).mTangents);
+		ensure("face 1 tangents", !volume->getVolumeFace(1).mWeights && volume->getVolumeFace(1).mTangents);
+		ensure("face 2 both", volume->getVolumeFace(2).mWeights && volume->getVolumeFace(2).mTangents);
+	}
+
+	template<> template<>
+	void volume_object_t::test<2>()
+	{
+		set_test_name("truncated decoded faces are refused");
+
+		const S32 size = (S32)mPacked.size();
+		ensure("whole", unpack(mPacked, size));
+		for (S32 cut = 0; cut < size; cut += 13)
+		{
+			ensure("cut short", !unpack(mPacked, cut));
+		}
+		ensure("one byte short", !unpack(mPacked, size - 1));
+	}
+
+	template<> template<>
+	void volume_object_t::test<3>()
+	{
+		set_test_name("bad face counts and indices are refused");
+
+		std::vector<U8> data = mPacked;
+		U32 num_faces = LL_SCULPT_MESH_MAX_FACES + 1;
+		memcpy(&data[0], &num_faces, sizeof(num_faces));
+		ensure("too many faces", !unpack(data, (S32)data.size()));
+
+		num_faces = 0;
+		memcpy(&data[0], &num_faces, sizeof(num_faces));
+		ensure("no faces", !unpack(data, (S32)data.size()));
+
+		// More faces than were packed, but few enough to be allowed
+		num_faces = mVolume->getNumVolumeFaces() + 1;
+		ensure("room for one more", num_faces <= (U32)LL_SCULPT_MESH_MAX_FACES);
+		memcpy(&data[0], &num_faces, sizeof(num_faces));
+		ensure("faces missing", !unpack(data, (S32)data.size()));
+
+		data = mPacked;
+		const LLVolumeFace& face = mVolume->getVolumeFace(0);
+		U16 index = (U16)face.mNumVertices;
+		memcpy(&data[first_index_offset(face)], &index, sizeof(index));
+		ensure("index past the vertices", !unpack(data, (S32)data.size()));
+
+		// Put back, the same buffer is good again
+		memcpy(&data[first_index_offset(face)], &face.mIndices[0], sizeof(U16));
+		ensure("index restored", unpack(data, (S32)data.size()));
+
+		S32 num_verts = -1;
+		memcpy(&data[16], &num_verts, sizeof(num_verts));
+		ensure("negative vertex count", !unpack(data, (S32)data.size()));
+	}
+}
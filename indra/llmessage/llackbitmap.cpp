@@ -0,0 +1,146 @@
+/**
+ * @file llackbitmap.cpp
+ * @brief Packet ids waiting to be acked, one bit each.
+ *
+ * $LicenseInfo:firstyear=2014&license=viewerlgpl$
+ * Second Life Viewer Source Code
+ * Copyright (C) 2014, Linden Research, Inc.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation;
+ * version 2.1 of the License only.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ * Linden Research, Inc., 945 Battery Street, San Francisco, CA  94111  USA
+ * $/LicenseInfo$
+ */
+
+#include "linden_common.h"
+
+#include "llackbitmap.h"
+
+#include <algorithm>
+
+#include "llcircuit.h"
+
+static const S32 WORD_BITS = 32;
+// Packet ids wrap at LL_MAX_OUT_PACKET_ID, so word indices wrap at this
+static const U32 WORD_INDEX_MASK = (LL_MAX_OUT_PACKET_ID - 1) / WORD_BITS;
+// 32768 ids, far more than a frame brings in
+static const S32 MAX_WORDS = 1024;
+
+LLAckBitmap::LLAckBitmap()
+:	mFirstWord(0),
+	mSize(0)
+{
+}
+
+void LLAckBitmap::add(TPACKETID packet_id)
+{
+	U32 word = packet_id / WORD_BITS;
+	U32 bit = 1U << (packet_id % WORD_BITS);
+
+	std::vector<TPACKETID>::iterator outlier = std::lower_bound(mOutliers.begin(), mOutliers.end(), packet_id);
+	if (outlier != mOutliers.end() && *outlier == packet_id)
+	{
+		return;
+	}
+
+	if (packet_id >= LL_MAX_OUT_PACKET_ID)
+	{
+		// Not a packet id a circuit sends, no place in the window
+		mOutliers.insert(outlier, packet_id);
+		++mSize;
+		return;
+	}
+
+	if (mWords.empty())
+	{
+		mFirstWord = word;
+		mWords.push_back(0);
+	}
+
+	// Distance from the first word, either way round the id space
+	U32 ahead = (word - mFirstWord) & WORD_INDEX_MASK;
+	U32 behind = (mFirstWord - word) & WORD_INDEX_MASK;
+	if (ahead < (U32)MAX_WORDS)
+	{
+		if (ahead >= mWords.size())
+		{
+			mWords.resize(ahead + 1, 0);
+		}
+	}
+	else if (behind + mWords.size() <= (U32)MAX_WORDS)
+	{
+		mWords.insert(mWords.begin(), behind, 0);
+		mFirstWord = word;
+		ahead = 0;
+	}
+	else
+	{
+		mOutliers.insert(outlier, packet_id);
+		++mSize;
+		return;
+	}
+
+	U32& bits = mWords[ahead];
+	if (!(bits & bit))
+	{
+		bits |= bit;
+		++mSize;
+	}
+}
+
+S32 LLAckBitmap::take(S32 max_count, std::vector<TPACKETID>& packet_ids)
+{
+	S32 taken = 0;
+
+	while (taken < max_count && !mWords.empty())
+	{
+		U32& bits = mWords.front();
+		TPACKETID first_id = mFirstWord * WORD_BITS;
+		for (S32 n = 0; bits && taken < max_count; ++n)
+		{
+			if (bits & (1U << n))
+			{
+				bits &= ~(1U << n);
+				packet_ids.push_back(first_id + n);
+				++taken;
+			}
+		}
+		if (!bits)
+		{
+			mWords.pop_front();
+			mFirstWord = (mFirstWord + 1) & WORD_INDEX_MASK;
+		}
+	}
+
+	S32 outliers = llmin(max_count - taken, (S32)mOutliers.size());
+	packet_ids.insert(packet_ids.end(), mOutliers.begin(), mOutliers.begin() + outliers);
+	mOutliers.erase(mOutliers.begin(), mOutliers.begin() + outliers);
+	taken += outliers;
+
+	mSize -= taken;
+	if (!mSize)
+	{
+		clear();
+	}
+	return taken;
+}
+
+void LLAckBitmap::clear()
+{
+	mWords.clear();
+	mOutliers.clear();
+	mFirstWord = 0;
+	mSize = 0;
+}
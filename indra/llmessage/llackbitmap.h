@@ -0,0 +1,61 @@
+/**
+ * @file llackbitmap.h
+ * @brief Packet ids waiting to be acked, one bit each.
+ *
+ * $LicenseInfo:firstyear=2014&license=viewerlgpl$
+ * Second Life Viewer Source Code
+ * Copyright (C) 2014, Linden Research, Inc.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation;
+ * version 2.1 of the License only.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ * Linden Research, Inc., 945 Battery Street, San Francisco, CA  94111  USA
+ * $/LicenseInfo$
+ */
+
+#ifndef LL_LLACKBITMAP_H
+#define LL_LLACKBITMAP_H
+
+#include <deque>
+#include <vector>
+
+// Reliable packets come in close to id order, so the ids still to be acked
+// are kept as a window of bits starting at the lowest one, wrapping with
+// the ids at LL_MAX_OUT_PACKET_ID.  Adding an id twice, as happens when a
+// resend crosses our ack, acks it once.  The rare id far outside the window
+// is kept aside in id order.
+class LLAckBitmap
+{
+public:
+	LLAckBitmap();
+
+	void add(TPACKETID packet_id);
+
+	// Moves up to max_count ids onto packet_ids: the window lowest first,
+	// counting ids past the wrap as above the ones before it, then the ids
+	// kept aside lowest first.  Returns how many were moved.
+	S32 take(S32 max_count, std::vector<TPACKETID>& packet_ids);
+
+	S32 size() const { return mSize; }
+	bool empty() const { return mSize == 0; }
+	void clear();
+
+private:
+	std::deque<U32>			mWords;		// bit n of word w is id (mFirstWord + w) * 32 + n
+	U32						mFirstWord;
+	std::vector<TPACKETID>	mOutliers;	// sorted
+	S32						mSize;
+};
+
+#endif // LL_LLACKBITMAP_H
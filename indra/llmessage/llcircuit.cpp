@@ -66,6 +66,21 @@ const F32Seconds TARGET_PERIOD_LENGTH(5.f);
 const F32Seconds LL_DUPLICATE_SUPPRESSION_TIMEOUT(60.f); //this can be long, as time-based cleanup is
 													// only done when wrapping packetids, now...
 
+// Resolution of the reliable packet resend wheel
+const F64 RESEND_TICKS_PER_SECOND = 100.0;
+
+// Resend wheel tick a time falls in
+static U64 get_resend_tick(const F64Seconds time)
+{
+	return (U64)(time.value() * RESEND_TICKS_PER_SECOND);
+}
+
+// First resend wheel tick entirely after time
+static U64 get_resend_tick_after(const F64Seconds time)
+{
+	return get_resend_tick(time) + 1;
+}
+
 LLCircuitData::LLCircuitData(const LLHost &host, TPACKETID in_id, 
 							 const F32Seconds circuit_heartbeat_interval, const F32Seconds circuit_timeout)
 :	mHost (host),
@@ -229,6 +244,7 @@ void LLCircuitData::ackReliablePacket(TPACKETID packet_num)
 		mUnackedPacketBytes -= packetp->mBufferLength;
 
 		// Cleanup
+		mResendWheel.cancel(packetp);
 		delete packetp;
 		mUnackedPackets.erase(iter);
 		return;
@@ -263,6 +279,7 @@ void LLCircuitData::ackReliablePacket(TPACKETID packet_num)
 		mUnackedPacketBytes -= packetp->mBufferLength;
 
 		// Cleanup
+		mResendWheel.cancel(packetp);
 		delete packetp;
 		mFinalRetryPackets.erase(iter);
 	}
@@ -280,19 +297,30 @@ S32 LLCircuitData::resendUnackedPackets(const F64Seconds now)
 	S32 resent_packets = 0;
 	LLReliablePacket *packetp;
 
+	// Only the packets whose expiration time has passed come off the wheel,
+	// however many are waiting for an ack.  They come in expiration order
+	// rather than packet id order, resends were never in order anyway.
+	mExpiredPackets.clear();
+	mResendWheel.advance(get_resend_tick(now), mExpiredPackets);
 
-	//
-	// Theoretically we should search through the list for the packet with the oldest
-	// packet ID, as otherwise when we WRAP we will resend reliable packets out of order.
-	// Since resends are ALREADY out of order, and wrapping is highly rare (16+million packets),
-	// I'm not going to worry about this for now - djs
-	//
-
-	reliable_iter iter;
 	BOOL have_resend_overflow = FALSE;
-	for (iter = mUnackedPackets.begin(); iter != mUnackedPackets.end();)
+	BOOL resends_stopped = FALSE;
+	for (std::vector<LLTimerWheelNode*>::iterator iter = mExpiredPackets.begin(); iter != mExpiredPackets.end(); ++iter)
 	{
-		packetp = iter->second;
+		packetp = static_cast<LLReliablePacket*>(*iter);
+		if (!packetp->mRetries)
+		{
+			// Already on the final list, failed below
+			continue;
+		}
+
+		if (resends_stopped)
+		{
+			// Still expired, try again on the next pass
+			mResendWheel.schedule(packetp, mResendWheel.getCurrentTick());
+			*iter = NULL;
+			continue;
+		}
 
 		// Only check overflow if we haven't had one yet.
 		if (!have_resend_overflow)
@@ -308,19 +336,12 @@ S32 LLCircuitData::resendUnackedPackets(const F64Seconds now)
 			// If we have too many unacked packets, we need to start dropping expired ones.
 			if (mUnackedPacketBytes > 512000)
 			{
-				if (now > packetp->mExpirationTime)
-				{
-					// This circuit has overflowed.  Do not retry.  Do not pass go.
-					packetp->mRetries = 0;
-					// Remove it from this list and add it to the final list.
-					mUnackedPackets.erase(iter++);
-					mFinalRetryPackets[packetp->mPacketID] = packetp;
-				}
-				else
-				{
-					++iter;
-				}
-				// Move on to the next unacked packet.
+				// This circuit has overflowed.  Do not retry.  Do not pass go.
+				packetp->mRetries = 0;
+				// Remove it from this list and add it to the final list,
+				// it has expired so it fails below.
+				mUnackedPackets.erase(packetp->mPacketID);
+				mFinalRetryPackets[packetp->mPacketID] = packetp;
 				continue;
 			}
 			
@@ -331,104 +352,91 @@ S32 LLCircuitData::resendUnackedPackets(const F64Seconds now)
 						<< " bytes of reliable messages waiting" << LL_ENDL;
 			}
 			// Stop resending.  There are less than 512000 unacked packets.
-			break;
+			resends_stopped = TRUE;
+			mResendWheel.schedule(packetp, mResendWheel.getCurrentTick());
+			*iter = NULL;
+			continue;
 		}
 
-		if (now > packetp->mExpirationTime)
-		{
-			packetp->mRetries--;
-			
-			// retry		
-			mCurrentResendCount++;
-
-			gMessageSystem->mResentPackets++;
+		packetp->mRetries--;
+		
+		// retry		
+		mCurrentResendCount++;
 
-			if(gMessageSystem->mVerboseLog)
-			{
-				std::ostringstream str;
-				str << "MSG: -> " << packetp->mHost
-					<< "\tRESENDING RELIABLE:\t" << packetp->mPacketID;
-				LL_INFOS() << str.str() << LL_ENDL;
-			}
+		gMessageSystem->mResentPackets++;
 
-			packetp->mBuffer[0] |= LL_RESENT_FLAG;  // tag packet id as being a resend	
+		if(gMessageSystem->mVerboseLog)
+		{
+			std::ostringstream str;
+			str << "MSG: -> " << packetp->mHost
+				<< "\tRESENDING RELIABLE:\t" << packetp->mPacketID;
+			LL_INFOS() << str.str() << LL_ENDL;
+		}
 
-			gMessageSystem->mPacketRing.sendPacket(packetp->mSocket, 
-											   (char *)packetp->mBuffer, packetp->mBufferLength, 
-											   packetp->mHost);
+		packetp->mBuffer[0] |= LL_RESENT_FLAG;  // tag packet id as being a resend	
 
-			mThrottles.throttleOverflow(TC_RESEND, packetp->mBufferLength * 8.f);
+		gMessageSystem->mPacketRing.sendPacket(packetp->mSocket, 
+										   (char *)packetp->mBuffer, packetp->mBufferLength, 
+										   packetp->mHost);
 
-			// The new method, retry time based on ping
-			if (packetp->mPingBasedRetry)
-			{
-				packetp->mExpirationTime = now + llmax(LL_MINIMUM_RELIABLE_TIMEOUT_SECONDS, F32Seconds(LL_RELIABLE_TIMEOUT_FACTOR * getPingDelayAveraged()));
-			}
-			else
-			{
-				// custom, constant retry time
-				packetp->mExpirationTime = now + packetp->mTimeout;
-			}
+		mThrottles.throttleOverflow(TC_RESEND, packetp->mBufferLength * 8.f);
 
-			if (!packetp->mRetries)
-			{
-				// Last resend, remove it from this list and add it to the final list.
-				mUnackedPackets.erase(iter++);
-				mFinalRetryPackets[packetp->mPacketID] = packetp;
-			}
-			else
-			{
-				// Don't remove it yet, it still gets to try to resend at least once.
-				++iter;
-			}
-			resent_packets++;
+		// The new method, retry time based on ping
+		if (packetp->mPingBasedRetry)
+		{
+			packetp->mExpirationTime = now + llmax(LL_MINIMUM_RELIABLE_TIMEOUT_SECONDS, F32Seconds(LL_RELIABLE_TIMEOUT_FACTOR * getPingDelayAveraged()));
 		}
 		else
 		{
-			// Don't need to do anything with this packet, keep iterating.
-			++iter;
+			// custom, constant retry time
+			packetp->mExpirationTime = now + packetp->mTimeout;
 		}
+		mResendWheel.schedule(packetp, get_resend_tick_after(packetp->mExpirationTime));
+		*iter = NULL;
+
+		if (!packetp->mRetries)
+		{
+			// Last resend, remove it from this list and add it to the final list.
+			mUnackedPackets.erase(packetp->mPacketID);
+			mFinalRetryPackets[packetp->mPacketID] = packetp;
+		}
+		resent_packets++;
 	}
 
 
-	for (iter = mFinalRetryPackets.begin(); iter != mFinalRetryPackets.end();)
+	for (std::vector<LLTimerWheelNode*>::iterator iter = mExpiredPackets.begin(); iter != mExpiredPackets.end(); ++iter)
 	{
-		packetp = iter->second;
-		if (now > packetp->mExpirationTime)
+		if (!*iter)
 		{
-			// fail (too many retries)
-			//LL_INFOS() << "Packet " << packetp->mPacketID << " removed from the pending list: exceeded retry limit" << LL_ENDL;
-			//if (packetp->mMessageName)
-			//{
-			//	LL_INFOS() << "Packet name " << packetp->mMessageName << LL_ENDL;
-			//}
-			gMessageSystem->mFailedResendPackets++;
-
-			if(gMessageSystem->mVerboseLog)
-			{
-				std::ostringstream str;
-				str << "MSG: -> " << packetp->mHost << "\tABORTING RELIABLE:\t"
-					<< packetp->mPacketID;
-				LL_INFOS() << str.str() << LL_ENDL;
-			}
-
-			if (packetp->mCallback)
-			{
-				packetp->mCallback(packetp->mCallbackData,LL_ERR_TCP_TIMEOUT);
-			}
+			// Resent or put back on the wheel
+			continue;
+		}
 
-			// Update stats
-			mUnackedPacketCount--;
-			mUnackedPacketBytes -= packetp->mBufferLength;
+		// fail (too many retries)
+		packetp = static_cast<LLReliablePacket*>(*iter);
+		gMessageSystem->mFailedResendPackets++;
 
-			mFinalRetryPackets.erase(iter++);
-			delete packetp;
+		if(gMessageSystem->mVerboseLog)
+		{
+			std::ostringstream str;
+			str << "MSG: -> " << packetp->mHost << "\tABORTING RELIABLE:\t"
+				<< packetp->mPacketID;
+			LL_INFOS() << str.str() << LL_ENDL;
 		}
-		else
+
+		if (packetp->mCallback)
 		{
-			++iter;
+			packetp->mCallback(packetp->mCallbackData,LL_ERR_TCP_TIMEOUT);
 		}
+
+		// Update stats
+		mUnackedPacketCount--;
+		mUnackedPacketBytes -= packetp->mBufferLength;
+
+		mFinalRetryPackets.erase(packetp->mPacketID);
+		delete packetp;
 	}
+	mExpiredPackets.clear();
 
 	return mUnackedPacketCount;
 }
@@ -587,6 +595,13 @@ void LLCircuitData::addReliablePacket(S32 mSocket, U8 *buf_ptr, S32 buf_len, LLR
 	{
 		mFinalRetryPackets[packet_info->mPacketID] = packet_info;
 	}
+
+	if (mResendWheel.empty())
+	{
+		// Not advanced while there was nothing on it
+		mResendWheel.setCurrentTick(get_resend_tick(LLMessageSystem::getMessageTimeSeconds()));
+	}
+	mResendWheel.schedule(packet_info, get_resend_tick_after(packet_info->mExpirationTime));
 }
 
 
@@ -1099,7 +1114,7 @@ BOOL LLCircuitData::collectRAck(TPACKETID packet_num)
 		gMessageSystem->mCircuitInfo.mSendAckMap[mHost] = this;
 	}
 
-	mAcks.push_back(packet_num);
+	mAcks.add(packet_num);
 	return TRUE;
 }
 
@@ -1113,9 +1128,11 @@ void LLCircuit::sendAcks()
 	{
 		cd = (*it).second;
 
-		S32 count = (S32)cd->mAcks.size();
-		if(count > 0)
+		if(!cd->mAcks.empty())
 		{
+			std::vector<TPACKETID> acks;
+			S32 count = cd->mAcks.take(cd->mAcks.size(), acks);
+
 			// send the packet acks
 			S32 acks_this_packet = 0;
 			for(S32 i = 0; i < count; ++i)
@@ -1125,7 +1142,7 @@ void LLCircuit::sendAcks()
 					gMessageSystem->newMessageFast(_PREHASH_PacketAck);
 				}
 				gMessageSystem->nextBlockFast(_PREHASH_Packets);
-				gMessageSystem->addU32Fast(_PREHASH_ID, cd->mAcks[i]);
+				gMessageSystem->addU32Fast(_PREHASH_ID, acks[i]);
 				++acks_this_packet;
 				if(acks_this_packet > 250)
 				{
@@ -1143,12 +1160,9 @@ void LLCircuit::sendAcks()
 				std::ostringstream str;
 				str << "MSG: -> " << cd->mHost << "\tPACKET ACKS:\t";
 				std::ostream_iterator<TPACKETID> append(str, " ");
-				std::copy(cd->mAcks.begin(), cd->mAcks.end(), append);
+				std::copy(acks.begin(), acks.end(), append);
 				LL_INFOS() << str.str() << LL_ENDL;
 			}
-
-			// empty out the acks list
-			cd->mAcks.clear();
 		}
 	}
 
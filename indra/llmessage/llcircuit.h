@@ -33,12 +33,15 @@
 
 #include "llerror.h"
 
+#include "llackbitmap.h"
+
 #include "lltimer.h"
 #include "net.h"
 #include "llhost.h"
 #include "llpacketack.h"
 #include "lluuid.h"
 #include "llthrottle.h"
+#include "lltimerwheel.h"
 
 //
 // Constants
@@ -236,13 +239,18 @@ protected:
 
 	packet_time_map							mPotentialLostPackets;
 	packet_time_map							mRecentlyReceivedReliablePackets;
-	std::vector<TPACKETID> mAcks;
+	LLAckBitmap mAcks;
 
 	typedef std::map<TPACKETID, LLReliablePacket *> reliable_map;
 	typedef reliable_map::iterator					reliable_iter;
 
+	// The maps find a packet by id when it is acked, the wheel finds the
+	// ones whose expiration time has passed.  A packet on mFinalRetryPackets
+	// has no retries left.
 	reliable_map							mUnackedPackets;
 	reliable_map							mFinalRetryPackets;
+	LLTimerWheel							mResendWheel;
+	std::vector<LLTimerWheelNode*>			mExpiredPackets;	// only used by resendUnackedPackets()
 
 	S32										mUnackedPacketCount;
 	S32										mUnackedPacketBytes;
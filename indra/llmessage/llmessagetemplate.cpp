@@ -171,6 +171,46 @@ std::ostream& operator<<(std::ostream& s, LLMessageTemplate &msg)
 	return s;
 }
 
+bool LLMessageTemplate::getFieldIndex(const char* block_name, const char* var_name, S32& block_index, S32& var_index) const
+{
+	// Names come from LLMessageStringTable, so their addresses are spread
+	// out and identify them
+	uintptr_t key = ((uintptr_t)block_name >> 3) ^ ((uintptr_t)var_name >> 2);
+	FieldIndexEntry& entry = mFieldIndexCache[(key ^ (key >> 7)) & (FIELD_INDEX_CACHE_SIZE - 1)];
+	if (entry.mBlockName == block_name && entry.mVarName == var_name && block_name)
+	{
+		block_index = entry.mBlockIndex;
+		var_index = entry.mVarIndex;
+		return true;
+	}
+
+	block_index = getBlockIndex(block_name);
+	var_index = -1;
+	if (block_index < 0)
+	{
+		return false;
+	}
+	if (var_name)
+	{
+		var_index = getBlock(block_index)->getVariableIndex(var_name);
+		if (var_index < 0)
+		{
+			return false;
+		}
+	}
+
+	entry.mBlockName = block_name;
+	entry.mVarName = var_name;
+	entry.mBlockIndex = block_index;
+	entry.mVarIndex = var_index;
+	return true;
+}
+
+void LLMessageTemplate::clearFieldIndexCache()
+{
+	memset(mFieldIndexCache, 0, sizeof(mFieldIndexCache));
+}
+
 void LLMessageTemplate::banUdp()
 {
 	static const char* deprecation[] = {
@@ -141,16 +141,16 @@ public:
 class LLMessageVariable
 {
 public:
-	LLMessageVariable() : mName(NULL), mType(MVT_NULL), mSize(-1)
+	LLMessageVariable() : mName(NULL), mType(MVT_NULL), mSize(-1), mOffset(-1)
 	{
 	}
 
-	LLMessageVariable(char *name) : mType(MVT_NULL), mSize(-1)
+	LLMessageVariable(char *name) : mType(MVT_NULL), mSize(-1), mOffset(-1)
 	{
 		mName = name;
 	}
 
-	LLMessageVariable(const char *name, const EMsgVariableType type, const S32 size) : mType(type), mSize(size) 
+	LLMessageVariable(const char *name, const EMsgVariableType type, const S32 size) : mType(type), mSize(size), mOffset(-1)
 	{
 		mName = LLMessageStringTable::getInstance()->getString(name); 
 	}
@@ -162,10 +162,14 @@ public:
 	EMsgVariableType getType() const				{ return mType; }
 	S32	getSize() const								{ return mSize; }
 	char *getName() const							{ return mName; }
+	// Offset from the start of the block, -1 if a variable sized field comes first
+	S32 getOffset() const							{ return mOffset; }
+	void setOffset(S32 offset)						{ mOffset = offset; }
 protected:
 	char				*mName;
 	EMsgVariableType	mType;
 	S32					mSize;
+	S32					mOffset;
 };
 
 
@@ -199,6 +203,7 @@ public:
 			LL_ERRS() << name << " has already been used as a variable name!" << LL_ENDL;
 		}
 		*varp = new LLMessageVariable(name, type, size);
+		(*varp)->setOffset(mTotalSize);
 		if (((*varp)->getType() != MVT_VARIABLE)
 			&&(mTotalSize != -1))
 		{
@@ -226,6 +231,18 @@ public:
 		return iter != mMemberVariables.end()? *iter : NULL;
 	}
 
+	// Position in mMemberVariables, which is also the order on the wire, -1 if absent
+	S32 getVariableIndex(const char* name) const
+	{
+		message_variable_map_t::const_iterator iter = mMemberVariables.find(name);
+		return iter != mMemberVariables.end()? (S32)(iter - mMemberVariables.begin()) : -1;
+	}
+
+	const LLMessageVariable* getVariable(S32 index) const
+	{
+		return *(mMemberVariables.begin() + index);
+	}
+
 	friend std::ostream&	 operator<<(std::ostream& s, LLMessageBlock &msg);
 
 	typedef LLIndexedVector<LLMessageVariable*, const char *, 8> message_variable_map_t;
@@ -292,6 +309,7 @@ public:
 		mUserData(NULL)
 	{ 
 		mName = LLMessageStringTable::getInstance()->getString(name);
+		clearFieldIndexCache();
 	}
 
 	~LLMessageTemplate()
@@ -301,6 +319,7 @@ public:
 
 	void addBlock(LLMessageBlock *blockp)
 	{
+		clearFieldIndexCache();
 		LLMessageBlock** member_blockp = &mMemberBlocks[blockp->mName];
 		if (*member_blockp != NULL)
 		{
@@ -408,6 +427,38 @@ public:
 		return iter != mMemberBlocks.end()? *iter : NULL;
 	}
 
+	// Position in mMemberBlocks, which is also the order on the wire, -1 if absent
+	S32 getBlockIndex(const char* name) const
+	{
+		message_block_map_t::const_iterator iter = mMemberBlocks.find((char*)name);
+		return iter != mMemberBlocks.end()? (S32)(iter - mMemberBlocks.begin()) : -1;
+	}
+
+	const LLMessageBlock* getBlock(S32 index) const
+	{
+		return *(mMemberBlocks.begin() + index);
+	}
+
+	// getBlockIndex() and LLMessageBlock::getVariableIndex() for the name
+	// pointers a getter was called with, var_name NULL for the block alone.
+	// Handlers pass the same prehashed names for every message, so the
+	// answer is remembered by pointer and the index maps are only searched
+	// the first time.  False if the block or variable is not in the template.
+	bool getFieldIndex(const char* block_name, const char* var_name, S32& block_index, S32& var_index) const;
+
+private:
+	void clearFieldIndexCache();
+
+	struct FieldIndexEntry
+	{
+		const char* mBlockName;
+		const char* mVarName;
+		S32 mBlockIndex;
+		S32 mVarIndex;
+	};
+	static const S32 FIELD_INDEX_CACHE_SIZE = 64;	// power of two
+	mutable FieldIndexEntry mFieldIndexCache[FIELD_INDEX_CACHE_SIZE];
+
 public:
 	typedef LLIndexedVector<LLMessageBlock*, char*, 8> message_block_map_t;
 	message_block_map_t						mMemberBlocks;
@@ -28,6 +28,7 @@
 #define LL_LLPACKETACK_H
 
 #include "llhost.h"
+#include "lltimerwheel.h"
 #include "llunits.h"
 
 class LLReliablePacketParams
@@ -78,7 +79,8 @@ public:
 	};
 };
 
-class LLReliablePacket
+// On its circuit's resend wheel until acked or given up on
+class LLReliablePacket : public LLTimerWheelNode
 {
 public:
 	LLReliablePacket(
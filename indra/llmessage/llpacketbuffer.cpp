@@ -34,24 +34,9 @@
 
 ///////////////////////////////////////////////////////////
 
-LLPacketBuffer::LLPacketBuffer(const LLHost &host, const char *datap, const S32 size) : mHost(host)
+LLPacketBuffer::LLPacketBuffer(const LLHost &host, const char *datap, const S32 size)
 {
-	mSize = 0;
-	mData[0] = '!';
-
-	if (size > NET_BUFFER_SIZE)
-	{
-		LL_ERRS() << "Sending packet > " << NET_BUFFER_SIZE << " of size " << size << LL_ENDL;
-	}
-	else
-	{
-		if (datap != NULL)
-		{
-			memcpy(mData, datap, size);
-			mSize = size;
-		}
-	}
-	
+	set(host, datap, size);
 }
 
 LLPacketBuffer::LLPacketBuffer (S32 hSocket)
@@ -59,6 +44,12 @@ LLPacketBuffer::LLPacketBuffer (S32 hSocket)
 	init(hSocket);
 }
 
+LLPacketBuffer::LLPacketBuffer()
+:	mSize(0)
+{
+	mData[0] = '!';
+}
+
 ///////////////////////////////////////////////////////////
 
 LLPacketBuffer::~LLPacketBuffer ()
@@ -74,3 +65,64 @@ void LLPacketBuffer::init (S32 hSocket)
 	mReceivingIF = ::get_receiving_interface();
 }
 
+void LLPacketBuffer::set(const LLHost &host, const char *datap, const S32 size)
+{
+	mHost = host;
+	mSize = 0;
+	mData[0] = '!';
+
+	if (size > (S32)sizeof(mData))
+	{
+		LL_ERRS() << "Sending packet > " << sizeof(mData) << " of size " << size << LL_ENDL;
+	}
+	else
+	{
+		if (datap != NULL)
+		{
+			memcpy(mData, datap, size);
+			mSize = size;
+		}
+	}
+}
+
+//static
+S32 LLPacketBuffer::receiveBatch(S32 hSocket, LLPacketBuffer *buffers, S32 count)
+{
+	LLNetDatagram datagrams[NET_BATCH_MAX];
+	count = llmin(count, NET_BATCH_MAX);
+	for (S32 i = 0; i < count; ++i)
+	{
+		datagrams[i].mData = buffers[i].mData;
+		datagrams[i].mCapacity = sizeof(buffers[i].mData);
+	}
+
+	S32 received = receive_packets(hSocket, datagrams, count);
+	for (S32 i = 0; i < received; ++i)
+	{
+		LLPacketBuffer& buffer = buffers[i];
+		buffer.mSize = datagrams[i].mSize;
+		buffer.mHost = LLHost(datagrams[i].mAddress, datagrams[i].mPort);
+		buffer.mReceivingIF = LLHost(datagrams[i].mReceivingIF, INVALID_PORT);
+	}
+	return received;
+}
+
+//static
+S32 LLPacketBuffer::sendBatch(S32 hSocket, const LLPacketBuffer *buffers, S32 count)
+{
+	LLNetDatagram datagrams[NET_BATCH_MAX];
+	count = llmin(count, NET_BATCH_MAX);
+	for (S32 i = 0; i < count; ++i)
+	{
+		const LLPacketBuffer& buffer = buffers[i];
+		// send_packets() does not write through mData
+		datagrams[i].mData = const_cast<char*>(buffer.mData);
+		datagrams[i].mCapacity = buffer.mSize;
+		datagrams[i].mSize = buffer.mSize;
+		datagrams[i].mAddress = buffer.mHost.getAddress();
+		datagrams[i].mPort = buffer.mHost.getPort();
+		datagrams[i].mReceivingIF = INVALID_HOST_IP_ADDRESS;
+	}
+	return send_packets(hSocket, datagrams, count);
+}
+
@@ -30,12 +30,14 @@
 
 #include "net.h"		// for NET_BUFFER_SIZE
 #include "llhost.h"
+#include "llproxy.h"	// for SOCKS_HEADER_SIZE
 
 class LLPacketBuffer
 {
 public:
 	LLPacketBuffer(const LLHost &host, const char *datap, const S32 size);
 	LLPacketBuffer(S32 hSocket);           // receive a packet
+	LLPacketBuffer();                      // empty, for the batch rings of LLPacketRing
 	~LLPacketBuffer();
 
 	S32			getSize() const					{ return mSize; }
@@ -43,9 +45,16 @@ public:
 	LLHost		getHost() const					{ return mHost; }
 	LLHost		getReceivingInterface() const	{ return mReceivingIF; }
 	void init(S32 hSocket);
+	void set(const LLHost &host, const char *datap, const S32 size);
+
+	// Receive into, or send from, count buffers with as few system calls as the
+	// OS allows.  Return the number of packets received or sent.
+	static S32 receiveBatch(S32 hSocket, LLPacketBuffer *buffers, S32 count);
+	static S32 sendBatch(S32 hSocket, const LLPacketBuffer *buffers, S32 count);
 
 protected:
-	char	mData[NET_BUFFER_SIZE];        // packet data		/* Flawfinder : ignore */
+	// packet data, with room for the SOCKS 5 header of a proxied full-size packet
+	char	mData[NET_BUFFER_SIZE + SOCKS_HEADER_SIZE];		/* Flawfinder : ignore */
 	S32		mSize;          // size of buffer in bytes
 	LLHost	mHost;         // source/dest IP and port
 	LLHost	mReceivingIF;         // source/dest IP and port
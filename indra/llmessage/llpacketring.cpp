@@ -55,14 +55,23 @@ LLPacketRing::LLPacketRing () :
 	mInBufferLength(0),
 	mOutBufferLength(0),
 	mDropPercentage(0.0f),
-	mPacketsToDrop(0x0)
+	mPacketsToDrop(0x0),
+	mReceiveBatchCount(0),
+	mReceiveBatchNext(0),
+	mSendBatchCount(0),
+	mSendBatchFailed(0),
+	mSendBatching(FALSE)
 {
+	mReceiveBatch = new LLPacketBuffer[NET_BATCH_MAX];
+	mSendBatch = new LLPacketBuffer[NET_BATCH_MAX];
 }
 
 ///////////////////////////////////////////////////////////
 LLPacketRing::~LLPacketRing ()
 {
 	cleanup();
+	delete[] mReceiveBatch;
+	delete[] mSendBatch;
 }
 	
 ///////////////////////////////////////////////////////////
@@ -83,6 +92,12 @@ void LLPacketRing::cleanup ()
 		delete packetp;
 		mSendQueue.pop();
 	}
+
+	mReceiveBatchCount = 0;
+	mReceiveBatchNext = 0;
+	mSendBatchCount = 0;
+	mSendBatchFailed = 0;
+	mSendBatching = FALSE;
 }
 
 ///////////////////////////////////////////////////////////
@@ -224,33 +239,7 @@ S32 LLPacketRing::receivePacket (S32 socket, char *datap)
 	else
 	{
 		// no delay, pull straight from net
-		if (LLProxy::isSOCKSProxyEnabled())
-		{
-			U8 buffer[NET_BUFFER_SIZE + SOCKS_HEADER_SIZE];
-			packet_size = receive_packet(socket, static_cast<char*>(static_cast<void*>(buffer)));
-			
-			if (packet_size > SOCKS_HEADER_SIZE)
-			{
-				// *FIX We are assuming ATYP is 0x01 (IPv4), not 0x03 (hostname) or 0x04 (IPv6)
-				memcpy(datap, buffer + SOCKS_HEADER_SIZE, packet_size - SOCKS_HEADER_SIZE);
-				proxywrap_t * header = static_cast<proxywrap_t*>(static_cast<void*>(buffer));
-				mLastSender.setAddress(header->addr);
-				mLastSender.setPort(ntohs(header->port));
-
-				packet_size -= SOCKS_HEADER_SIZE; // The unwrapped packet size
-			}
-			else
-			{
-				packet_size = 0;
-			}
-		}
-		else
-		{
-			packet_size = receive_packet(socket, datap);
-			mLastSender = ::get_sender();
-		}
-
-		mLastReceivingIF = ::get_receiving_interface();
+		packet_size = receiveBatched(socket, datap);
 
 		if (packet_size)  // did we actually get a packet?
 		{
@@ -270,6 +259,84 @@ S32 LLPacketRing::receivePacket (S32 socket, char *datap)
 	return packet_size;
 }
 
+S32 LLPacketRing::receiveBatched(S32 socket, char *datap)
+{
+	if (mReceiveBatchNext >= mReceiveBatchCount)
+	{
+		mReceiveBatchNext = 0;
+		mReceiveBatchCount = LLPacketBuffer::receiveBatch(socket, mReceiveBatch, NET_BATCH_MAX);
+		if (!mReceiveBatchCount)
+		{
+			mLastReceivingIF = LLHost();
+			return 0;
+		}
+	}
+
+	const LLPacketBuffer& packet = mReceiveBatch[mReceiveBatchNext++];
+	S32 packet_size = packet.getSize();
+	mLastReceivingIF = packet.getReceivingInterface();
+
+	if (usesSOCKSProxy())
+	{
+		if (packet_size > SOCKS_HEADER_SIZE)
+		{
+			// *FIX We are assuming ATYP is 0x01 (IPv4), not 0x03 (hostname) or 0x04 (IPv6)
+			memcpy(datap, packet.getData() + SOCKS_HEADER_SIZE, packet_size - SOCKS_HEADER_SIZE);
+			const proxywrap_t * header = static_cast<const proxywrap_t*>(static_cast<const void*>(packet.getData()));
+			mLastSender.setAddress(header->addr);
+			mLastSender.setPort(ntohs(header->port));
+
+			packet_size -= SOCKS_HEADER_SIZE; // The unwrapped packet size
+		}
+		else
+		{
+			packet_size = 0;
+		}
+	}
+	else
+	{
+		memcpy(datap, packet.getData(), packet_size);	/*Flawfinder: ignore*/
+		mLastSender = packet.getHost();
+	}
+
+	return packet_size;
+}
+
+void LLPacketRing::beginSendBatch()
+{
+	mSendBatching = TRUE;
+}
+
+S32 LLPacketRing::endSendBatch(int h_socket)
+{
+	flushSendBatch(h_socket);
+	mSendBatching = FALSE;
+
+	S32 failed = mSendBatchFailed;
+	mSendBatchFailed = 0;
+	return failed;
+}
+
+void LLPacketRing::flushSendBatch(int h_socket)
+{
+	if (mSendBatchCount)
+	{
+		S32 sent = LLPacketBuffer::sendBatch(h_socket, mSendBatch, mSendBatchCount);
+		mSendBatchFailed += mSendBatchCount - sent;
+		mSendBatchCount = 0;
+	}
+}
+
+BOOL LLPacketRing::queueSendBatch(int h_socket, const char * send_buffer, S32 buf_size, LLHost host)
+{
+	if (mSendBatchCount == NET_BATCH_MAX)
+	{
+		flushSendBatch(h_socket);
+	}
+	mSendBatch[mSendBatchCount++].set(host, send_buffer, buf_size);
+	return TRUE;
+}
+
 BOOL LLPacketRing::sendPacket(int h_socket, char * send_buffer, S32 buf_size, LLHost host)
 {
 	BOOL status = TRUE;
@@ -349,6 +416,10 @@ BOOL LLPacketRing::sendPacketImpl(int h_socket, const char * send_buffer, S32 bu
 	
 	if (!LLProxy::isSOCKSProxyEnabled())
 	{
+		if (mSendBatching)
+		{
+			return queueSendBatch(h_socket, send_buffer, buf_size, host);
+		}
 		return send_packet(h_socket, send_buffer, buf_size, host.getAddress(), host.getPort());
 	}
 
@@ -363,6 +434,12 @@ BOOL LLPacketRing::sendPacketImpl(int h_socket, const char * send_buffer, S32 bu
 
 	memcpy(headered_send_buffer + SOCKS_HEADER_SIZE, send_buffer, buf_size);
 
+	if (mSendBatching)
+	{
+		return queueSendBatch(h_socket, headered_send_buffer, buf_size + SOCKS_HEADER_SIZE,
+							  LLProxy::getInstance()->getUDPProxy());
+	}
+
 	return send_packet(	h_socket,
 						headered_send_buffer,
 						buf_size + SOCKS_HEADER_SIZE,
@@ -40,7 +40,7 @@ class LLPacketRing
 {
 public:
 	LLPacketRing();         
-    ~LLPacketRing();
+	virtual ~LLPacketRing();
 
 	void cleanup();
 
@@ -52,9 +52,18 @@ public:
 	void setOutBandwidth(const F32 bps);
 	S32  receivePacket (S32 socket, char *datap);
 	S32  receiveFromRing (S32 socket, char *datap);
+	// Packets already read off the socket but not handed out yet
+	BOOL hasBatchedPackets() const				{ return mReceiveBatchNext < mReceiveBatchCount; }
 
 	BOOL sendPacket(int h_socket, char * send_buffer, S32 buf_size, LLHost host);
 
+	// Packets sent between these two go out NET_BATCH_MAX per system call,
+	// for the acks and resends of LLMessageSystem::processAcks().  While
+	// batching sendPacket() reports queued packets as sent, endSendBatch()
+	// returns the number that failed.
+	void beginSendBatch();
+	S32  endSendBatch(int h_socket);
+
 	inline LLHost getLastSender();
 	inline LLHost getLastReceivingInterface();
 
@@ -83,8 +92,24 @@ protected:
 	LLHost mLastSender;
 	LLHost mLastReceivingIF;
 
+	// Preallocated NET_BATCH_MAX buffer rings.  Received packets are handed
+	// out from mReceiveBatch one per receivePacket() until it runs dry.
+	LLPacketBuffer* mReceiveBatch;
+	S32 mReceiveBatchCount;
+	S32 mReceiveBatchNext;
+	LLPacketBuffer* mSendBatch;
+	S32 mSendBatchCount;
+	S32 mSendBatchFailed;
+	BOOL mSendBatching;
+
+	// Whether packets arrive wrapped in a SOCKS 5 UDP header
+	virtual bool usesSOCKSProxy() const			{ return LLProxy::isSOCKSProxyEnabled(); }
+
 private:
 	BOOL sendPacketImpl(int h_socket, const char * send_buffer, S32 buf_size, LLHost host);
+	S32  receiveBatched(S32 socket, char *datap);
+	BOOL queueSendBatch(int h_socket, const char * send_buffer, S32 buf_size, LLHost host);
+	void flushSendBatch(int h_socket);
 };
 
 
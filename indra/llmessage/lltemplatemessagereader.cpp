@@ -44,7 +44,6 @@ LLTemplateMessageReader::LLTemplateMessageReader(message_template_number_map_t&
 												 number_template_map) :
 	mReceiveSize(0),
 	mCurrentRMessageTemplate(NULL),
-	mCurrentRMessageData(NULL),
 	mMessageNumbers(number_template_map)
 {
 }
@@ -52,8 +51,6 @@ LLTemplateMessageReader::LLTemplateMessageReader(message_template_number_map_t&
 //virtual 
 LLTemplateMessageReader::~LLTemplateMessageReader()
 {
-	delete mCurrentRMessageData;
-	mCurrentRMessageData = NULL;
 }
 
 //virtual
@@ -61,8 +58,39 @@ void LLTemplateMessageReader::clearMessage()
 {
 	mReceiveSize = -1;
 	mCurrentRMessageTemplate = NULL;
-	delete mCurrentRMessageData;
-	mCurrentRMessageData = NULL;
+	mBlocks.clear();
+	mInstances.clear();
+	mFields.clear();
+}
+
+S32 LLTemplateMessageReader::getNumberOfBlocks(S32 block_index) const
+{
+	if (block_index < 0 || block_index >= (S32)mBlocks.size())
+	{
+		return 0;
+	}
+	return mBlocks[block_index].mCount;
+}
+
+const U8* LLTemplateMessageReader::getFieldData(S32 block_index, S32 var_index, S32 blocknum, S32& size) const
+{
+	size = 0;
+	if (blocknum < 0 || blocknum >= getNumberOfBlocks(block_index))
+	{
+		return NULL;
+	}
+
+	const InstanceEntry& instance = mInstances[mBlocks[block_index].mFirstInstance + blocknum];
+	if (instance.mFirstField < 0)
+	{
+		const LLMessageVariable* var = mCurrentRMessageTemplate->getBlock(block_index)->getVariable(var_index);
+		size = var->getSize();
+		return &mDecodeBuffer[0] + instance.mOffset + var->getOffset();
+	}
+
+	const FieldEntry& field = mFields[instance.mFirstField + var_index];
+	size = field.mSize;
+	return &mDecodeBuffer[0] + field.mOffset;
 }
 
 void LLTemplateMessageReader::getData(const char *blockname, const char *varname, void *datap, S32 size, S32 blocknum, S32 max_size)
@@ -74,79 +102,76 @@ void LLTemplateMessageReader::getData(const char *blockname, const char *varname
 		return;
 	}
 
-	if (!mCurrentRMessageData)
+	if (!mCurrentRMessageTemplate)
 	{
-		LL_ERRS() << "Invalid mCurrentMessageData in getData!" << LL_ENDL;
+		LL_ERRS() << "Invalid mCurrentRMessageTemplate in getData!" << LL_ENDL;
 		return;
 	}
 
-	char *bnamep = (char *)blockname + blocknum; // this works because it's just a hash.  The bnamep is never derefference
-	char *vnamep = (char *)varname; 
-
-	LLMsgData::msg_blk_data_map_t::const_iterator iter = mCurrentRMessageData->mMemberBlocks.find(bnamep);
-
-	if (iter == mCurrentRMessageData->mMemberBlocks.end())
+	S32 block_index, var_index;
+	bool found = mCurrentRMessageTemplate->getFieldIndex(blockname, varname, block_index, var_index);
+	if (blocknum >= getNumberOfBlocks(block_index))
 	{
 		LL_ERRS() << "Block " << blockname << " #" << blocknum
-			<< " not in message " << mCurrentRMessageData->mName << LL_ENDL;
+			<< " not in message " << mCurrentRMessageTemplate->mName << LL_ENDL;
 		return;
 	}
 
-	LLMsgBlkData *msg_block_data = iter->second;
-	LLMsgBlkData::msg_var_data_map_t &var_data_map = msg_block_data->mMemberVarData;
-
-	if (var_data_map.find(vnamep) == var_data_map.end())
+	if (!found)
 	{
-		LL_ERRS() << "Variable "<< vnamep << " not in message "
-			<< mCurrentRMessageData->mName<< " block " << bnamep << LL_ENDL;
+		LL_ERRS() << "Variable "<< varname << " not in message "
+			<< mCurrentRMessageTemplate->mName << " block " << blockname << LL_ENDL;
 		return;
 	}
 
-	LLMsgVarData& vardata = msg_block_data->mMemberVarData[vnamep];
+	S32 vardata_size = 0;
+	const U8* vardata = getFieldData(block_index, var_index, blocknum, vardata_size);
 
-	if (size && size != vardata.getSize())
+	if (size && size != vardata_size)
 	{
-		LL_ERRS() << "Msg " << mCurrentRMessageData->mName 
-			<< " variable " << vnamep
-			<< " is size " << vardata.getSize()
+		LL_ERRS() << "Msg " << mCurrentRMessageTemplate->mName 
+			<< " variable " << varname
+			<< " is size " << vardata_size
 			<< " but copying into buffer of size " << size
 			<< LL_ENDL;
 		return;
 	}
 
-
-	const S32 vardata_size = vardata.getSize();
 	if( max_size >= vardata_size )
 	{   
+#ifdef LL_BIG_ENDIAN
+		htonmemcpy(datap, vardata, mCurrentRMessageTemplate->getBlock(block_index)->getVariable(var_index)->getType(), vardata_size);
+#else
+		// Fields sit unaligned in the packet, constant size copies become single loads
 		switch( vardata_size )
 		{ 
 		case 1:
-			*((U8*)datap) = *((U8*)vardata.getData());
+			*((U8*)datap) = *vardata;
 			break;
 		case 2:
-			*((U16*)datap) = *((U16*)vardata.getData());
+			memcpy(datap, vardata, 2);
 			break;
 		case 4:
-			*((U32*)datap) = *((U32*)vardata.getData());
+			memcpy(datap, vardata, 4);
 			break;
 		case 8:
-			((U32*)datap)[0] = ((U32*)vardata.getData())[0];
-			((U32*)datap)[1] = ((U32*)vardata.getData())[1];
+			memcpy(datap, vardata, 8);
 			break;
 		default:
-			memcpy(datap, vardata.getData(), vardata_size);
+			memcpy(datap, vardata, vardata_size);
 			break;
 		}
+#endif
 	}
 	else
 	{
-		LL_WARNS() << "Msg " << mCurrentRMessageData->mName 
-			<< " variable " << vnamep
-			<< " is size " << vardata.getSize()
+		LL_WARNS() << "Msg " << mCurrentRMessageTemplate->mName 
+			<< " variable " << varname
+			<< " is size " << vardata_size
 			<< " but truncated to max size of " << max_size
 			<< LL_ENDL;
 
-		memcpy(datap, vardata.getData(), max_size);
+		memcpy(datap, vardata, max_size);
 	}
 }
 
@@ -159,22 +184,15 @@ S32 LLTemplateMessageReader::getNumberOfBlocks(const char *blockname)
 		return -1;
 	}
 
-	if (!mCurrentRMessageData)
+	if (!mCurrentRMessageTemplate)
 	{
-		LL_ERRS() << "Invalid mCurrentRMessageData in getData!" << LL_ENDL;
+		LL_ERRS() << "Invalid mCurrentRMessageTemplate in getData!" << LL_ENDL;
 		return -1;
 	}
 
-	char *bnamep = (char *)blockname; 
-
-	LLMsgData::msg_blk_data_map_t::const_iterator iter = mCurrentRMessageData->mMemberBlocks.find(bnamep);
-	
-	if (iter == mCurrentRMessageData->mMemberBlocks.end())
-	{
-		return 0;
-	}
-
-	return (iter->second)->mBlockNumber;
+	S32 block_index, var_index;
+	mCurrentRMessageTemplate->getFieldIndex(blockname, NULL, block_index, var_index);
+	return getNumberOfBlocks(block_index);
 }
 
 S32 LLTemplateMessageReader::getSize(const char *blockname, const char *varname)
@@ -186,43 +204,39 @@ S32 LLTemplateMessageReader::getSize(const char *blockname, const char *varname)
 		return LL_MESSAGE_ERROR;
 	}
 
-	if (!mCurrentRMessageData)
+	if (!mCurrentRMessageTemplate)
 	{	// This is a serious error - crash
-		LL_ERRS() << "Invalid mCurrentRMessageData in getData!" << LL_ENDL;
+		LL_ERRS() << "Invalid mCurrentRMessageTemplate in getData!" << LL_ENDL;
 		return LL_MESSAGE_ERROR;
 	}
 
-	char *bnamep = (char *)blockname; 
-
-	LLMsgData::msg_blk_data_map_t::const_iterator iter = mCurrentRMessageData->mMemberBlocks.find(bnamep);
-	
-	if (iter == mCurrentRMessageData->mMemberBlocks.end())
+	S32 block_index, var_index;
+	bool found = mCurrentRMessageTemplate->getFieldIndex(blockname, varname, block_index, var_index);
+	if (!getNumberOfBlocks(block_index))
 	{	// don't crash
-		LL_INFOS() << "Block " << bnamep << " not in message "
-			<< mCurrentRMessageData->mName << LL_ENDL;
+		LL_INFOS() << "Block " << blockname << " not in message "
+			<< mCurrentRMessageTemplate->mName << LL_ENDL;
 		return LL_BLOCK_NOT_IN_MESSAGE;
 	}
 
-	char *vnamep = (char *)varname; 
-
-	LLMsgBlkData* msg_data = iter->second;
-	LLMsgVarData& vardata = msg_data->mMemberVarData[vnamep];
-	
-	if (!vardata.getName())
+	const LLMessageBlock* block = mCurrentRMessageTemplate->getBlock(block_index);
+	if (!found)
 	{	// don't crash
 		LL_INFOS() << "Variable " << varname << " not in message "
-			<< mCurrentRMessageData->mName << " block " << bnamep << LL_ENDL;
+			<< mCurrentRMessageTemplate->mName << " block " << blockname << LL_ENDL;
 		return LL_VARIABLE_NOT_IN_BLOCK;
 	}
 
-	if (mCurrentRMessageTemplate->mMemberBlocks[bnamep]->mType != MBT_SINGLE)
+	if (block->mType != MBT_SINGLE)
 	{	// This is a serious error - crash
-		LL_ERRS() << "Block " << bnamep << " isn't type MBT_SINGLE,"
+		LL_ERRS() << "Block " << blockname << " isn't type MBT_SINGLE,"
 			" use getSize with blocknum argument!" << LL_ENDL;
 		return LL_MESSAGE_ERROR;
 	}
 
-	return vardata.getSize();
+	S32 size = 0;
+	getFieldData(block_index, var_index, 0, size);
+	return size;
 }
 
 S32 LLTemplateMessageReader::getSize(const char *blockname, S32 blocknum, const char *varname)
@@ -234,35 +248,31 @@ S32 LLTemplateMessageReader::getSize(const char *blockname, S32 blocknum, const
 		return LL_MESSAGE_ERROR;
 	}
 
-	if (!mCurrentRMessageData)
+	if (!mCurrentRMessageTemplate)
 	{	// This is a serious error - crash
-		LL_ERRS() << "Invalid mCurrentRMessageData in getData!" << LL_ENDL;
+		LL_ERRS() << "Invalid mCurrentRMessageTemplate in getData!" << LL_ENDL;
 		return LL_MESSAGE_ERROR;
 	}
 
-	char *bnamep = (char *)blockname + blocknum; 
-	char *vnamep = (char *)varname; 
-
-	LLMsgData::msg_blk_data_map_t::const_iterator iter = mCurrentRMessageData->mMemberBlocks.find(bnamep);
-	
-	if (iter == mCurrentRMessageData->mMemberBlocks.end())
+	S32 block_index, var_index;
+	bool found = mCurrentRMessageTemplate->getFieldIndex(blockname, varname, block_index, var_index);
+	if (blocknum >= getNumberOfBlocks(block_index))
 	{	// don't crash
-		LL_INFOS() << "Block " << bnamep << " not in message " 
-			<< mCurrentRMessageData->mName << LL_ENDL;
+		LL_INFOS() << "Block " << blockname << " #" << blocknum << " not in message " 
+			<< mCurrentRMessageTemplate->mName << LL_ENDL;
 		return LL_BLOCK_NOT_IN_MESSAGE;
 	}
 
-	LLMsgBlkData* msg_data = iter->second;
-	LLMsgVarData& vardata = msg_data->mMemberVarData[vnamep];
-	
-	if (!vardata.getName())
+	if (!found)
 	{	// don't crash
-		LL_INFOS() << "Variable " << vnamep << " not in message "
-			<<  mCurrentRMessageData->mName << " block " << bnamep << LL_ENDL;
+		LL_INFOS() << "Variable " << varname << " not in message "
+			<<  mCurrentRMessageTemplate->mName << " block " << blockname << LL_ENDL;
 		return LL_VARIABLE_NOT_IN_BLOCK;
 	}
 
-	return vardata.getSize();
+	S32 size = 0;
+	getFieldData(block_index, var_index, blocknum, size);
+	return size;
 }
 
 void LLTemplateMessageReader::getBinaryData(const char *blockname, 
@@ -555,22 +565,25 @@ BOOL LLTemplateMessageReader::decodeData(const U8* buffer, const LLHost& sender
 {
 	llassert( mReceiveSize >= 0 );
 	llassert( mCurrentRMessageTemplate);
-	llassert( !mCurrentRMessageData );
-	delete mCurrentRMessageData; // just to make sure
 
 	// The offset tells us how may bytes to skip after the end of the
 	// message name.
 	U8 offset = buffer[PHL_OFFSET];
 	S32 decode_pos = LL_PACKET_ID_SIZE + (S32)(mCurrentRMessageTemplate->mFrequency) + offset;
 
-	// create base working data set
-	mCurrentRMessageData = new LLMsgData(mCurrentRMessageTemplate->mName);
+	// Handlers read from a copy, the receive buffer is reused for zero
+	// expansion and the next packet.
+	mDecodeBuffer.assign(buffer, buffer + mReceiveSize);
+	mBlocks.resize(mCurrentRMessageTemplate->mMemberBlocks.size());
+	mInstances.clear();
+	mFields.clear();
 	
-	// loop through the template building the data structure as we go
+	// loop through the template recording where each block and field lands
+	S32 block_index = 0;
 	LLMessageTemplate::message_block_map_t::const_iterator iter;
 	for(iter = mCurrentRMessageTemplate->mMemberBlocks.begin();
 		iter != mCurrentRMessageTemplate->mMemberBlocks.end();
-		++iter)
+		++iter, ++block_index)
 	{
 		LLMessageBlock* mbci = *iter;
 		U8	repeat_number;
@@ -613,36 +626,40 @@ BOOL LLTemplateMessageReader::decodeData(const U8* buffer, const LLHost& sender
 			return FALSE;
 		}
 
-		LLMsgBlkData* cur_data_block = NULL;
+		BlockEntry& block_entry = mBlocks[block_index];
+		block_entry.mFirstInstance = (S32)mInstances.size();
+		block_entry.mCount = repeat_number;
 
 		// now loop through the block
 		for (i = 0; i < repeat_number; i++)
 		{
-			if (i)
-			{
-				// build new name to prevent collisions
-				// TODO: This should really change to a vector
-				cur_data_block = new LLMsgBlkData(mbci->mName, repeat_number);
-				cur_data_block->mName = mbci->mName + i;
-			}
-			else
+			InstanceEntry instance;
+			instance.mOffset = decode_pos;
+
+			if (mbci->mTotalSize != -1)
 			{
-				cur_data_block = new LLMsgBlkData(mbci->mName, repeat_number);
-			}
+				// fixed size, the template has the field offsets
+				instance.mFirstField = -1;
+				if ((decode_pos + mbci->mTotalSize) > mReceiveSize)
+				{
+					logRanOffEndOfPacket(sender, decode_pos, mbci->mTotalSize);
 
-			// add the block to the message
-			mCurrentRMessageData->addBlock(cur_data_block);
+					// default to 0s.
+					mDecodeBuffer.resize(llmax((S32)mDecodeBuffer.size(), decode_pos + mbci->mTotalSize), 0);
+				}
+				decode_pos += mbci->mTotalSize;
+				mInstances.push_back(instance);
+				continue;
+			}
 
 			// now read the variables
+			instance.mFirstField = (S32)mFields.size();
 			for (LLMessageBlock::message_variable_map_t::const_iterator iter = 
 					 mbci->mMemberVariables.begin();
 				 iter != mbci->mMemberVariables.end(); iter++)
 			{
 				const LLMessageVariable& mvci = **iter;
-
-				// ok, build out the variables
-				// add variable block
-				cur_data_block->addVariable(mvci.getName(), mvci.getType());
+				FieldEntry field;
 
 				// what type of variable?
 				if (mvci.getType() == MVT_VARIABLE)
@@ -682,37 +699,39 @@ BOOL LLTemplateMessageReader::decodeData(const U8* buffer, const LLHost& sender
 					}
 					decode_pos += data_size;
 
-					cur_data_block->addData(mvci.getName(), &buffer[decode_pos], tsize, mvci.getType());
+					if ((decode_pos + (S32)tsize) > mReceiveSize)
+					{
+						logRanOffEndOfPacket(sender, decode_pos, tsize);
+
+						// default to 0 length variable blocks
+						tsize = 0;
+					}
+
+					field.mOffset = decode_pos;
+					field.mSize = tsize;
 					decode_pos += tsize;
 				}
 				else
 				{
 					// fixed!
-					// so, copy data pointer and set data size to fixed size
 					if ((decode_pos + mvci.getSize()) > mReceiveSize)
 					{
 						logRanOffEndOfPacket(sender, decode_pos, mvci.getSize());
 
 						// default to 0s.
-						U32 size = mvci.getSize();
-						std::vector<U8> data(size, 0);
-						cur_data_block->addData(mvci.getName(), &(data[0]), 
-												size, mvci.getType());
-					}
-					else
-					{
-						cur_data_block->addData(mvci.getName(), 
-												&buffer[decode_pos], 
-												mvci.getSize(), 
-												mvci.getType());
+						mDecodeBuffer.resize(llmax((S32)mDecodeBuffer.size(), decode_pos + mvci.getSize()), 0);
 					}
+					field.mOffset = decode_pos;
+					field.mSize = mvci.getSize();
 					decode_pos += mvci.getSize();
 				}
+				mFields.push_back(field);
 			}
+			mInstances.push_back(instance);
 		}
 	}
 
-	if (mCurrentRMessageData->mMemberBlocks.empty()
+	if (mInstances.empty()
 		&& !mCurrentRMessageTemplate->mMemberBlocks.empty())
 	{
 		LL_DEBUGS() << "Empty message '" << mCurrentRMessageTemplate->mName << "' (no blocks)" << LL_ENDL;
@@ -847,5 +866,29 @@ void LLTemplateMessageReader::copyToBuilder(LLMessageBuilder& builder) const
     {
         return;
     }
-	builder.copyFromMessageData(*mCurrentRMessageData);
+
+	// Builders take the name keyed LLMsgData, build one from the layout
+	LLMsgData data(mCurrentRMessageTemplate->mName);
+	for (S32 block_index = 0; block_index < (S32)mBlocks.size(); ++block_index)
+	{
+		const LLMessageBlock* block = mCurrentRMessageTemplate->getBlock(block_index);
+		S32 count = mBlocks[block_index].mCount;
+		for (S32 i = 0; i < count; ++i)
+		{
+			// the builders expect repeated blocks keyed by name + i
+			LLMsgBlkData* block_data = new LLMsgBlkData(block->mName, count);
+			block_data->mName = block->mName + i;
+			data.addBlock(block_data);
+
+			for (S32 var_index = 0; var_index < (S32)block->mMemberVariables.size(); ++var_index)
+			{
+				const LLMessageVariable* var = block->getVariable(var_index);
+				S32 size = 0;
+				const U8* field = getFieldData(block_index, var_index, i, size);
+				block_data->addVariable(var->getName(), var->getType());
+				block_data->addData(var->getName(), field, size, var->getType());
+			}
+		}
+	}
+	builder.copyFromMessageData(data);
 }
@@ -30,9 +30,9 @@
 #include "llmessagereader.h"
 
 #include <map>
+#include <vector>
 
 class LLMessageTemplate;
-class LLMsgData;
 
 class LLTemplateMessageReader : public LLMessageReader
 {
@@ -105,6 +105,14 @@ public:
 	bool isTrusted() const;
 	bool isBanned(bool trusted_source) const;
 	bool isUdpBanned() const;
+
+	// Index based access to the current message, no name lookups.  Indices
+	// come from LLMessageTemplate::getBlockIndex() and
+	// LLMessageBlock::getVariableIndex() and never change once the template
+	// is loaded, so hot handlers can resolve them once.
+	S32 getNumberOfBlocks(S32 block_index) const;
+	// Field in network byte order, NULL if the message has no such block instance
+	const U8* getFieldData(S32 block_index, S32 var_index, S32 blocknum, S32& size) const;
 	
 private:
 
@@ -120,8 +128,31 @@ private:
 
 	S32	mReceiveSize;
 	LLMessageTemplate* mCurrentRMessageTemplate;
-	LLMsgData* mCurrentRMessageData;
 	message_template_number_map_t& mMessageNumbers;
+
+	// The current message is decoded into where each block instance, and for
+	// blocks with variable sized fields each field, sits in a copy of the
+	// packet.  Fixed size blocks take their field offsets from the template.
+	// The vectors keep their capacity, decoding does not allocate once warm.
+	struct BlockEntry
+	{
+		S32 mFirstInstance;		// into mInstances
+		S32 mCount;
+	};
+	struct InstanceEntry
+	{
+		S32 mOffset;			// into mDecodeBuffer
+		S32 mFirstField;		// into mFields, -1 for fixed size blocks
+	};
+	struct FieldEntry
+	{
+		S32 mOffset;
+		S32 mSize;
+	};
+	std::vector<U8> mDecodeBuffer;
+	std::vector<BlockEntry> mBlocks;		// by template block index
+	std::vector<InstanceEntry> mInstances;
+	std::vector<FieldEntry> mFields;
 };
 
 #endif // LL_LLTEMPLATEMESSAGEREADER_H
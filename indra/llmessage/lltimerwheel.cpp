@@ -0,0 +1,161 @@
+/**
+ * @file lltimerwheel.cpp
+ * @brief Hierarchical timer wheel over intrusive nodes.
+ *
+ * $LicenseInfo:firstyear=2014&license=viewerlgpl$
+ * Second Life Viewer Source Code
+ * Copyright (C) 2014, Linden Research, Inc.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation;
+ * version 2.1 of the License only.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ * Linden Research, Inc., 945 Battery Street, San Francisco, CA  94111  USA
+ * $/LicenseInfo$
+ */
+
+#include "linden_common.h"
+
+#include "lltimerwheel.h"
+
+LLTimerWheel::LLTimerWheel()
+:	mCurrentTick(0),
+	mSize(0)
+{
+	for (S32 level = 0; level < LEVEL_COUNT; ++level)
+	{
+		for (S32 slot = 0; slot < SLOT_COUNT; ++slot)
+		{
+			LLTimerWheelNode* head = &mSlots[level][slot];
+			head->mWheelPrev = head;
+			head->mWheelNext = head;
+		}
+	}
+}
+
+LLTimerWheel::~LLTimerWheel()
+{
+	// Nodes belong to the caller, they are just left linked
+}
+
+void LLTimerWheel::setCurrentTick(U64 tick)
+{
+	llassert(empty());
+	mCurrentTick = tick;
+}
+
+void LLTimerWheel::schedule(LLTimerWheelNode* node, U64 tick)
+{
+	if (node->isScheduled())
+	{
+		unlink(node);
+	}
+	else
+	{
+		++mSize;
+	}
+	node->mWheelTick = tick;
+	insert(node);
+}
+
+void LLTimerWheel::cancel(LLTimerWheelNode* node)
+{
+	if (node->isScheduled())
+	{
+		unlink(node);
+		--mSize;
+	}
+}
+
+void LLTimerWheel::advance(U64 tick, std::vector<LLTimerWheelNode*>& expired)
+{
+	while (mSize && mCurrentTick <= tick)
+	{
+		S32 index = (S32)(mCurrentTick & SLOT_MASK);
+		if (!index)
+		{
+			// Starting a new turn of level 0, bring down what is due in it.
+			// Each level turns over once the one below has.
+			for (S32 level = 1; level < LEVEL_COUNT; ++level)
+			{
+				cascade(level);
+				if ((mCurrentTick >> (LEVEL_BITS * level)) & SLOT_MASK)
+				{
+					break;
+				}
+			}
+		}
+
+		LLTimerWheelNode* head = &mSlots[0][index];
+		while (head->mWheelNext != head)
+		{
+			LLTimerWheelNode* node = head->mWheelNext;
+			unlink(node);
+			--mSize;
+			expired.push_back(node);
+		}
+		++mCurrentTick;
+	}
+
+	// Nothing left to step through the rest for
+	if (mCurrentTick <= tick)
+	{
+		mCurrentTick = tick + 1;
+	}
+}
+
+void LLTimerWheel::insert(LLTimerWheelNode* node)
+{
+	U64 tick = llmax(node->mWheelTick, mCurrentTick);
+	U64 delta = tick - mCurrentTick;
+
+	S32 level = 0;
+	while (level < LEVEL_COUNT - 1 && delta >> (LEVEL_BITS * (level + 1)))
+	{
+		++level;
+	}
+	const U64 reach = (U64)1 << (LEVEL_BITS * LEVEL_COUNT);
+	if (delta >= reach)
+	{
+		// Park it at the far end, the cascade from there puts it back
+		tick = mCurrentTick + reach - 1;
+	}
+
+	LLTimerWheelNode* head = &mSlots[level][(tick >> (LEVEL_BITS * level)) & SLOT_MASK];
+	node->mWheelPrev = head->mWheelPrev;
+	node->mWheelNext = head;
+	head->mWheelPrev->mWheelNext = node;
+	head->mWheelPrev = node;
+}
+
+void LLTimerWheel::cascade(S32 level)
+{
+	LLTimerWheelNode* head = &mSlots[level][(mCurrentTick >> (LEVEL_BITS * level)) & SLOT_MASK];
+
+	// Everything here is due within this turn of the level below
+	while (head->mWheelNext != head)
+	{
+		LLTimerWheelNode* node = head->mWheelNext;
+		unlink(node);
+		insert(node);
+	}
+}
+
+//static
+void LLTimerWheel::unlink(LLTimerWheelNode* node)
+{
+	node->mWheelPrev->mWheelNext = node->mWheelNext;
+	node->mWheelNext->mWheelPrev = node->mWheelPrev;
+	node->mWheelPrev = NULL;
+	node->mWheelNext = NULL;
+}
@@ -0,0 +1,99 @@
+/**
+ * @file lltimerwheel.h
+ * @brief Hierarchical timer wheel over intrusive nodes.
+ *
+ * $LicenseInfo:firstyear=2014&license=viewerlgpl$
+ * Second Life Viewer Source Code
+ * Copyright (C) 2014, Linden Research, Inc.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation;
+ * version 2.1 of the License only.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ * Linden Research, Inc., 945 Battery Street, San Francisco, CA  94111  USA
+ * $/LicenseInfo$
+ */
+
+#ifndef LL_LLTIMERWHEEL_H
+#define LL_LLTIMERWHEEL_H
+
+#include <vector>
+
+// Derive from this to go on an LLTimerWheel.  A node is on at most one
+// wheel, and must be cancelled before it is destroyed while scheduled.
+class LLTimerWheelNode
+{
+public:
+	LLTimerWheelNode() : mWheelPrev(NULL), mWheelNext(NULL), mWheelTick(0) {}
+
+	bool isScheduled() const { return mWheelNext != NULL; }
+	// Tick the node was last scheduled for
+	U64 getWheelTick() const { return mWheelTick; }
+
+private:
+	friend class LLTimerWheel;
+
+	LLTimerWheelNode* mWheelPrev;
+	LLTimerWheelNode* mWheelNext;
+	U64 mWheelTick;
+};
+
+// Deadlines in whole ticks, the caller picks what a tick is.  Each level
+// has 64 slots, each slot of a level spanning the whole of the level
+// below, so scheduling and cancelling are O(1) and advancing costs one
+// step per tick passed plus the nodes that expire.  Nodes further out
+// than the top level reaches (64^4 ticks) wait at its far end and are
+// rescheduled from there.
+class LLTimerWheel
+{
+public:
+	LLTimerWheel();
+	~LLTimerWheel();
+
+	// Only while empty, an idle wheel would otherwise step through all
+	// the ticks it missed on the next advance()
+	void setCurrentTick(U64 tick);
+	// Next tick advance() will expire
+	U64 getCurrentTick() const { return mCurrentTick; }
+
+	// Schedules or reschedules node.  A tick advance() already passed
+	// counts as the current one.
+	void schedule(LLTimerWheelNode* node, U64 tick);
+	void cancel(LLTimerWheelNode* node);
+
+	// Removes every node due at or before tick and appends it to expired,
+	// earliest tick first
+	void advance(U64 tick, std::vector<LLTimerWheelNode*>& expired);
+
+	S32 size() const { return mSize; }
+	bool empty() const { return mSize == 0; }
+
+private:
+	void insert(LLTimerWheelNode* node);
+	void cascade(S32 level);
+
+	static void unlink(LLTimerWheelNode* node);
+
+private:
+	static const S32 LEVEL_BITS = 6;
+	static const S32 SLOT_COUNT = 1 << LEVEL_BITS;
+	static const S32 LEVEL_COUNT = 4;
+	static const U64 SLOT_MASK = SLOT_COUNT - 1;
+
+	// Circular lists, the heads are never on them as nodes
+	LLTimerWheelNode mSlots[LEVEL_COUNT][SLOT_COUNT];
+	U64 mCurrentTick;
+	S32 mSize;
+};
+
+#endif // LL_LLTIMERWHEEL_H
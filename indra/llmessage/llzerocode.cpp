@@ -0,0 +1,185 @@
+/** 
+ * @file llzerocode.cpp
+ * @brief Zero coding of message bodies.
+ *
+ * $LicenseInfo:firstyear=2014&license=viewerlgpl$
+ * Second Life Viewer Source Code
+ * Copyright (C) 2014, Linden Research, Inc.
+ * 
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation;
+ * version 2.1 of the License only.
+ * 
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ * 
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ * 
+ * Linden Research, Inc., 945 Battery Street, San Francisco, CA  94111  USA
+ * $/LicenseInfo$
+ */
+
+#include "linden_common.h"
+
+#include "llzerocode.h"
+
+#include <emmintrin.h>
+
+#if LL_MSVC
+#include <intrin.h>
+#endif
+
+// Longest run a single 0 [count] pair codes
+static const S32 MAX_ZERO_RUN = 255;
+
+static inline S32 lowest_set_bit(U32 mask)
+{
+#if LL_MSVC
+	unsigned long index;
+	_BitScanForward(&index, mask);
+	return (S32)index;
+#else
+	return __builtin_ctz(mask);
+#endif
+}
+
+// Length of the span of non zero bytes starting at p
+static inline S32 literal_span(const U8* p, const U8* end)
+{
+	const U8* start = p;
+	const __m128i zero = _mm_setzero_si128();
+	while (end - p >= 16)
+	{
+		U32 mask = _mm_movemask_epi8(_mm_cmpeq_epi8(_mm_loadu_si128((const __m128i*)p), zero));
+		if (mask)
+		{
+			return (S32)(p - start) + lowest_set_bit(mask);
+		}
+		p += 16;
+	}
+	while (p < end && *p)
+	{
+		++p;
+	}
+	return (S32)(p - start);
+}
+
+// Length of the run of zero bytes starting at p
+static inline S32 zero_span(const U8* p, const U8* end)
+{
+	const U8* start = p;
+	const __m128i zero = _mm_setzero_si128();
+	while (end - p >= 16)
+	{
+		U32 mask = _mm_movemask_epi8(_mm_cmpeq_epi8(_mm_loadu_si128((const __m128i*)p), zero)) ^ 0xffff;
+		if (mask)
+		{
+			return (S32)(p - start) + lowest_set_bit(mask);
+		}
+		p += 16;
+	}
+	while (p < end && !*p)
+	{
+		++p;
+	}
+	return (S32)(p - start);
+}
+
+S32 ll_zero_code_size(const U8* src, S32 src_size)
+{
+	const U8* in = src;
+	const U8* end = src + src_size;
+	S32 size = 0;
+	while (in < end)
+	{
+		S32 literal = literal_span(in, end);
+		size += literal;
+		in += literal;
+		if (in == end)
+		{
+			break;
+		}
+
+		S32 zeros = zero_span(in, end);
+		size += 2 * ((zeros + MAX_ZERO_RUN - 1) / MAX_ZERO_RUN);
+		in += zeros;
+	}
+	return size;
+}
+
+S32 ll_zero_code(const U8* src, S32 src_size, U8* dst)
+{
+	const U8* in = src;
+	const U8* end = src + src_size;
+	U8* out = dst;
+	while (in < end)
+	{
+		S32 literal = literal_span(in, end);
+		memcpy(out, in, literal);
+		out += literal;
+		in += literal;
+		if (in == end)
+		{
+			break;
+		}
+
+		S32 zeros = zero_span(in, end);
+		in += zeros;
+		for (; zeros > 0; zeros -= MAX_ZERO_RUN)
+		{
+			*out++ = 0;
+			*out++ = (U8)llmin(zeros, MAX_ZERO_RUN);
+		}
+	}
+	return (S32)(out - dst);
+}
+
+S32 ll_zero_code_expand(const U8* src, S32 src_size, U8* dst, S32 dst_size)
+{
+	const U8* in = src;
+	const U8* end = src + src_size;
+	U8* out = dst;
+	U8* out_end = dst + dst_size;
+	while (in < end)
+	{
+		S32 literal = literal_span(in, end);
+		if (literal > out_end - out)
+		{
+			return -1;
+		}
+		memcpy(out, in, literal);
+		out += literal;
+		in += literal;
+		if (in == end)
+		{
+			break;
+		}
+
+		// A 0 [count] pair, or 0 0 ... [count] from older coders.  A 0 at
+		// the very end stands for itself.
+		S32 zeros = 1;
+		++in;
+		while (in < end && !*in)
+		{
+			zeros += 256;
+			++in;
+		}
+		if (in < end)
+		{
+			zeros += *in - 1;
+			++in;
+		}
+		if (zeros > out_end - out)
+		{
+			return -1;
+		}
+		memset(out, 0, zeros);
+		out += zeros;
+	}
+	return (S32)(out - dst);
+}
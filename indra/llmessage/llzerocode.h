@@ -0,0 +1,48 @@
+/** 
+ * @file llzerocode.h
+ * @brief Zero coding of message bodies.
+ *
+ * $LicenseInfo:firstyear=2014&license=viewerlgpl$
+ * Second Life Viewer Source Code
+ * Copyright (C) 2014, Linden Research, Inc.
+ * 
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation;
+ * version 2.1 of the License only.
+ * 
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ * 
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ * 
+ * Linden Research, Inc., 945 Battery Street, San Francisco, CA  94111  USA
+ * $/LicenseInfo$
+ */
+
+#ifndef LL_LLZEROCODE_H
+#define LL_LLZEROCODE_H
+
+// Sequential zero bytes are encoded as 0 [U8 count], longer runs than 255
+// as several of those.  Older coders wrote 0 0 [count] for runs over 256,
+// each extra 0 adding 256, expansion still accepts that.
+//
+// These work on the body of a packet, callers copy the LL_PACKET_ID_SIZE
+// header themselves.  Literal spans and zero runs are found 16 bytes at a
+// time with SSE2.
+
+// Size src would have once coded
+S32 ll_zero_code_size(const U8* src, S32 src_size);
+
+// Codes src into dst, which must hold 2 * src_size bytes.  Returns the coded size.
+S32 ll_zero_code(const U8* src, S32 src_size, U8* dst);
+
+// Expands src into dst.  Returns the expanded size, or -1 if it does not fit
+// in dst_size bytes.
+S32 ll_zero_code_expand(const U8* src, S32 src_size, U8* dst, S32 dst_size);
+
+#endif // LL_LLZEROCODE_H
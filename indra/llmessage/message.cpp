@@ -71,6 +71,7 @@
 #include "lltransfermanager.h"
 #include "lluuid.h"
 #include "llxfermanager.h"
+#include "llzerocode.h"
 #include "llquaternion.h"
 #include "u64.h"
 #include "v3dmath.h"
@@ -403,6 +404,11 @@ void LLMessageSystem::clearReceiveState()
 
 BOOL LLMessageSystem::poll(F32 seconds)
 {
+	if (mPacketRing.hasBatchedPackets())
+	{
+		return TRUE;
+	}
+
 	S32 num_socks;
 	apr_status_t status;
 	status = apr_poll(&(mPollInfop->mPollFD), 1, &num_socks,(U64)(seconds*1000000.f));
@@ -819,12 +825,16 @@ void LLMessageSystem::processAcks()
 		// Check the status of circuits
 		mCircuitInfo.updateWatchDogTimers(this);
 
+		mPacketRing.beginSendBatch();
+
 		//resend any necessary packets
 		mCircuitInfo.resendUnackedPackets(mUnackedListDepth, mUnackedListSize);
 
 		//cycle through ack list for each host we need to send acks to
 		mCircuitInfo.sendAcks();
 
+		mSendPacketFailureCount += mPacketRing.endSendBatch(mSocket);
+
 		if (!mDenyTrustedCircuitSet.empty())
 		{
 			LL_INFOS("Messaging") << "Sending queued DenyTrustedCircuit messages." << LL_ENDL;
@@ -1282,7 +1292,7 @@ S32 LLMessageSystem::sendMessage(const LLHost &host)
 
 	// tack packet acks onto the end of this message
 	S32 space_left = (MTUBYTES - buffer_length) / sizeof(TPACKETID); // space left for packet ids
-	S32 ack_count = (S32)cdp->mAcks.size();
+	S32 ack_count = cdp->mAcks.size();
 	BOOL is_ack_appended = FALSE;
 	std::vector<TPACKETID> acks;
 	if((space_left > 0) && (ack_count > 0) && 
@@ -1292,11 +1302,10 @@ S32 LLMessageSystem::sendMessage(const LLHost &host)
 		S32 append_ack_count = llmin(space_left, ack_count);
 		const S32 MAX_ACKS = 250;
 		append_ack_count = llmin(append_ack_count, MAX_ACKS);
-		std::vector<TPACKETID>::iterator iter = cdp->mAcks.begin();
-		std::vector<TPACKETID>::iterator last = cdp->mAcks.begin();
-		last += append_ack_count;
+		std::vector<TPACKETID> append_acks;
+		cdp->mAcks.take(append_ack_count, append_acks);
 		TPACKETID packet_id;
-		for( ; iter != last ; ++iter)
+		for(std::vector<TPACKETID>::iterator iter = append_acks.begin(); iter != append_acks.end(); ++iter)
 		{
 			// grab the next packet id.
 			packet_id = (*iter);
@@ -1328,9 +1337,6 @@ S32 LLMessageSystem::sendMessage(const LLHost &host)
 			}
 		}
 
-		// clean up the source
-		cdp->mAcks.erase(cdp->mAcks.begin(), last);
-
 		// tack the count in the final byte
 		U8 count = (U8)append_ack_count;
 		buf_ptr[buffer_length++] = count;
@@ -2814,54 +2820,9 @@ S32 LLMessageSystem::zeroCodeAdjustCurrentSendTotal()
 	// TODO: babbage: remove this horror
 	mMessageBuilder->setBuilt(FALSE);
 
-	S32 count = mSendSize;
-	
-	S32 net_gain = 0;
-	U8 num_zeroes = 0;
-	
-	U8 *inptr = (U8 *)mSendBuffer;
-
-// skip the packet id field
-
-	for (U32 ii = 0; ii < LL_PACKET_ID_SIZE; ++ii)
-	{
-		count--;
-		inptr++;
-	}
-
-// don't actually build, just test
-
-// sequential zero bytes are encoded as 0 [U8 count] 
-// with 0 0 [count] representing wrap (>256 zeroes)
-
-	while (count--)
-	{
-		if (!(*inptr))   // in a zero count
-		{
-			if (num_zeroes)
-			{
-				if (++num_zeroes > 254)
-				{
-					num_zeroes = 0;
-				}
-				net_gain--;   // subseqent zeroes save one
-			}
-			else
-			{
-				net_gain++;  // starting a zero count adds one
-				num_zeroes = 1;
-			}
-			inptr++;
-		}
-		else
-		{
-			if (num_zeroes)
-			{
-				num_zeroes = 0;
-			}
-			inptr++;
-		}
-	}
+	// skip the packet id field, don't actually build, just size
+	S32 body_size = mSendSize - LL_PACKET_ID_SIZE;
+	S32 net_gain = ll_zero_code_size(mSendBuffer + LL_PACKET_ID_SIZE, body_size) - body_size;
 	if (net_gain < 0)
 	{
 		return net_gain;
@@ -2896,72 +2857,23 @@ S32 LLMessageSystem::zeroCodeExpand(U8** data, S32* data_size)
 	
 	*data[0] &= (~LL_ZERO_CODE_FLAG);
 
-	S32 count = (*data_size);  
-	
 	U8 *inptr = (U8 *)*data;
-	U8 *outptr = (U8 *)mEncodedRecvBuffer;
 
 // skip the packet id field
 
-	for (U32 ii = 0; ii < LL_PACKET_ID_SIZE; ++ii)
-	{
-		count--;
-		*outptr++ = *inptr++;
-	}
-
-// reconstruct encoded packet, keeping track of net size gain
+	S32 header_size = llmin(in_size, (S32)LL_PACKET_ID_SIZE);
+	memcpy(mEncodedRecvBuffer, inptr, header_size);	/* Flawfinder: ignore */
 
-// sequential zero bytes are encoded as 0 [U8 count] 
-// with 0 0 [count] representing wrap (>256 zeroes)
-
-	while (count--)
+	S32 body_size = ll_zero_code_expand(inptr + header_size, in_size - header_size,
+										mEncodedRecvBuffer + header_size, MAX_BUFFER_SIZE - header_size);
+	if (body_size < 0)
 	{
-		if (outptr > (&mEncodedRecvBuffer[MAX_BUFFER_SIZE-1]))
-		{
-			LL_WARNS("Messaging") << "attempt to write past reasonable encoded buffer size 1" << LL_ENDL;
-			callExceptionFunc(MX_WROTE_PAST_BUFFER_SIZE);
-			outptr = mEncodedRecvBuffer;					
-			break;
-		}
-		if (!((*outptr++ = *inptr++)))
-		{
-			while (((count--)) && (!(*inptr)))
-			{
-				*outptr++ = *inptr++;
-  				if (outptr > (&mEncodedRecvBuffer[MAX_BUFFER_SIZE-256]))
-  				{
-  					LL_WARNS("Messaging") << "attempt to write past reasonable encoded buffer size 2" << LL_ENDL;
-					callExceptionFunc(MX_WROTE_PAST_BUFFER_SIZE);
-					outptr = mEncodedRecvBuffer;
-					count = -1;
-					break;
-  				}
-				memset(outptr,0,255);
-				outptr += 255;
-			}
-			
-			if (count < 0)
-			{
-				break;
-			}
-
-			else
-			{
-  				if (outptr > (&mEncodedRecvBuffer[MAX_BUFFER_SIZE-(*inptr)]))
-				{
-  					LL_WARNS("Messaging") << "attempt to write past reasonable encoded buffer size 3" << LL_ENDL;
-					callExceptionFunc(MX_WROTE_PAST_BUFFER_SIZE);
-					outptr = mEncodedRecvBuffer;					
-				}
-				memset(outptr,0,(*inptr) - 1);
-				outptr += ((*inptr) - 1);
-				inptr++;
-			}
-		}		
+		LL_WARNS("Messaging") << "attempt to write past reasonable encoded buffer size" << LL_ENDL;
+		callExceptionFunc(MX_WROTE_PAST_BUFFER_SIZE);
 	}
 	
 	*data = mEncodedRecvBuffer;
-	*data_size = (S32)(outptr - mEncodedRecvBuffer);
+	*data_size = (body_size < 0) ? 0 : header_size + body_size;
 	mUncompressedBytesIn += *data_size;
 
 	return(in_size);
@@ -42,6 +42,13 @@
 	#include <errno.h>
 #endif
 
+#if LL_LINUX && defined(__GLIBC__) && (__GLIBC__ > 2 || (__GLIBC__ == 2 && __GLIBC_MINOR__ >= 14))
+// recvmmsg() came with glibc 2.12, sendmmsg() with 2.14
+#define LL_NET_MMSG 1
+#else
+#define LL_NET_MMSG 0
+#endif
+
 // linden library includes
 #include "llerror.h"
 #include "llhost.h"
@@ -179,6 +186,40 @@ U32 ip_string_to_u32(const char* ip_string)
 	return ip;
 }
 
+// One system call per datagram, for platforms without batched socket calls
+static S32 receive_packets_loop(int hSocket, LLNetDatagram* datagrams, S32 count)
+{
+	S32 received = 0;
+	while (received < count)
+	{
+		LLNetDatagram& datagram = datagrams[received];
+		datagram.mSize = receive_packet(hSocket, datagram.mData, datagram.mCapacity);
+		if (datagram.mSize <= 0)
+		{
+			break;
+		}
+		datagram.mAddress = get_sender_ip();
+		datagram.mPort = get_sender_port();
+		datagram.mReceivingIF = get_receiving_interface_ip();
+		++received;
+	}
+	return received;
+}
+
+static S32 send_packets_loop(int hSocket, const LLNetDatagram* datagrams, S32 count)
+{
+	S32 sent = 0;
+	for (S32 i = 0; i < count; ++i)
+	{
+		const LLNetDatagram& datagram = datagrams[i];
+		if (send_packet(hSocket, datagram.mData, datagram.mSize, datagram.mAddress, datagram.mPort))
+		{
+			++sent;
+		}
+	}
+	return sent;
+}
+
 
 //////////////////////////////////////////////////////////////////////////////////////////
 // Windows Versions
@@ -317,7 +358,7 @@ void end_net(S32& socket_out)
 	WSACleanup();
 }
 
-S32 receive_packet(int hSocket, char * receiveBuffer)
+S32 receive_packet(int hSocket, char * receiveBuffer, S32 size)
 {
 	//  Receives data asynchronously from the socket set by initNet().
 	//  Returns the number of bytes received into dataReceived, or zero
@@ -325,7 +366,7 @@ S32 receive_packet(int hSocket, char * receiveBuffer)
 	int nRet;
 	int addr_size = sizeof(struct sockaddr_in);
 
-	nRet = recvfrom(hSocket, receiveBuffer, NET_BUFFER_SIZE, 0, (struct sockaddr*)&stSrcAddr, &addr_size);
+	nRet = recvfrom(hSocket, receiveBuffer, size, 0, (struct sockaddr*)&stSrcAddr, &addr_size);
 	if (nRet == SOCKET_ERROR ) 
 	{
 		if (WSAEWOULDBLOCK == WSAGetLastError())
@@ -523,12 +564,30 @@ void end_net(S32& socket_out)
 }
 
 #if LL_LINUX
+// Destination address of a datagram received with IP_PKTINFO on
+static void get_destip(struct msghdr* msg, U32* dstip)
+{
+	for (struct cmsghdr* cmsgptr = CMSG_FIRSTHDR(msg); cmsgptr != NULL; cmsgptr = CMSG_NXTHDR(msg, cmsgptr))
+	{
+		if( cmsgptr->cmsg_level == SOL_IP && cmsgptr->cmsg_type == IP_PKTINFO )
+		{
+			in_pktinfo *pktinfo = (in_pktinfo *)CMSG_DATA(cmsgptr);
+			if( pktinfo )
+			{
+				// Two choices. routed and specified. ipi_addr is routed, ipi_spec_dst is
+				// routed. We should stay with specified until we go to multiple
+				// interfaces
+				*dstip = pktinfo->ipi_spec_dst.s_addr;
+			}
+		}
+	}
+}
+
 static int recvfrom_destip( int socket, void *buf, int len, struct sockaddr *from, socklen_t *fromlen, U32 *dstip )
 {
 	int size;
 	struct iovec iov[1];
 	char cmsg[CMSG_SPACE(sizeof(struct in_pktinfo))];
-	struct cmsghdr *cmsgptr;
 	struct msghdr msg = {0};
 
 	iov[0].iov_base = buf;
@@ -549,26 +608,13 @@ static int recvfrom_destip( int socket, void *buf, int len, struct sockaddr *fro
 		return -1;
 	}
 
-	for (cmsgptr = CMSG_FIRSTHDR(&msg); cmsgptr != NULL; cmsgptr = CMSG_NXTHDR( &msg, cmsgptr))
-	{
-		if( cmsgptr->cmsg_level == SOL_IP && cmsgptr->cmsg_type == IP_PKTINFO )
-		{
-			in_pktinfo *pktinfo = (in_pktinfo *)CMSG_DATA(cmsgptr);
-			if( pktinfo )
-			{
-				// Two choices. routed and specified. ipi_addr is routed, ipi_spec_dst is
-				// routed. We should stay with specified until we go to multiple
-				// interfaces
-				*dstip = pktinfo->ipi_spec_dst.s_addr;
-			}
-		}
-	}
+	get_destip(&msg, dstip);
 
 	return size;
 }
 #endif
 
-int receive_packet(int hSocket, char * receiveBuffer)
+int receive_packet(int hSocket, char * receiveBuffer, S32 size)
 {
 	//  Receives data asynchronously from the socket set by initNet().
 	//  Returns the number of bytes received into dataReceived, or zero
@@ -580,10 +626,10 @@ int receive_packet(int hSocket, char * receiveBuffer)
 	gsnReceivingIFAddr = INVALID_HOST_IP_ADDRESS;
 
 #if LL_LINUX
-	nRet = recvfrom_destip(hSocket, receiveBuffer, NET_BUFFER_SIZE, (struct sockaddr*)&stSrcAddr, &addr_size, &gsnReceivingIFAddr);
+	nRet = recvfrom_destip(hSocket, receiveBuffer, size, (struct sockaddr*)&stSrcAddr, &addr_size, &gsnReceivingIFAddr);
 #else	
 	int recv_flags = 0;
-	nRet = recvfrom(hSocket, receiveBuffer, NET_BUFFER_SIZE, recv_flags, (struct sockaddr*)&stSrcAddr, &addr_size);
+	nRet = recvfrom(hSocket, receiveBuffer, size, recv_flags, (struct sockaddr*)&stSrcAddr, &addr_size);
 #endif
 
 	if (nRet == -1)
@@ -658,6 +704,146 @@ BOOL send_packet(int hSocket, const char * sendBuffer, int size, U32 recipient,
 	return success;
 }
 
+#if LL_NET_MMSG
+// Set when the kernel predates recvmmsg()/sendmmsg() (2.6.33 and 3.0)
+static bool sNoMMsg = false;
+
+S32 receive_packets(int hSocket, LLNetDatagram* datagrams, S32 count)
+{
+	count = llmin(count, NET_BATCH_MAX);
+	if (sNoMMsg || count <= 0)
+	{
+		return receive_packets_loop(hSocket, datagrams, count);
+	}
+
+	struct mmsghdr msgs[NET_BATCH_MAX];
+	struct iovec iovs[NET_BATCH_MAX];
+	struct sockaddr_in addrs[NET_BATCH_MAX];
+	char cmsgs[NET_BATCH_MAX][CMSG_SPACE(sizeof(struct in_pktinfo))];
+
+	memset(msgs, 0, sizeof(struct mmsghdr) * count);
+	for (S32 i = 0; i < count; ++i)
+	{
+		iovs[i].iov_base = datagrams[i].mData;
+		iovs[i].iov_len = datagrams[i].mCapacity;
+
+		struct msghdr& msg = msgs[i].msg_hdr;
+		msg.msg_name = &addrs[i];
+		msg.msg_namelen = sizeof(struct sockaddr_in);
+		msg.msg_iov = &iovs[i];
+		msg.msg_iovlen = 1;
+		msg.msg_control = cmsgs[i];
+		msg.msg_controllen = sizeof(cmsgs[i]);
+	}
+
+	int received = recvmmsg(hSocket, msgs, count, MSG_DONTWAIT, NULL);
+	if (received < 0)
+	{
+		if (errno == ENOSYS)
+		{
+			LL_WARNS() << "recvmmsg() not supported, receiving one packet per call" << LL_ENDL;
+			sNoMMsg = true;
+			return receive_packets_loop(hSocket, datagrams, count);
+		}
+		// Nothing waiting, or an error that receive_packet() would also swallow
+		return 0;
+	}
+
+	for (S32 i = 0; i < received; ++i)
+	{
+		LLNetDatagram& datagram = datagrams[i];
+		datagram.mSize = msgs[i].msg_len;
+		datagram.mAddress = addrs[i].sin_addr.s_addr;
+		datagram.mPort = ntohs(addrs[i].sin_port);
+		datagram.mReceivingIF = INVALID_HOST_IP_ADDRESS;
+		get_destip(&msgs[i].msg_hdr, &datagram.mReceivingIF);
+	}
+
+	return received;
+}
+
+S32 send_packets(int hSocket, const LLNetDatagram* datagrams, S32 count)
+{
+	count = llmin(count, NET_BATCH_MAX);
+	if (sNoMMsg || count <= 0)
+	{
+		return send_packets_loop(hSocket, datagrams, count);
+	}
+
+	struct mmsghdr msgs[NET_BATCH_MAX];
+	struct iovec iovs[NET_BATCH_MAX];
+	struct sockaddr_in addrs[NET_BATCH_MAX];
+
+	memset(msgs, 0, sizeof(struct mmsghdr) * count);
+	memset(addrs, 0, sizeof(struct sockaddr_in) * count);
+	for (S32 i = 0; i < count; ++i)
+	{
+		const LLNetDatagram& datagram = datagrams[i];
+		iovs[i].iov_base = datagram.mData;
+		iovs[i].iov_len = datagram.mSize;
+
+		addrs[i].sin_family = AF_INET;
+		addrs[i].sin_addr.s_addr = datagram.mAddress;
+		addrs[i].sin_port = htons(datagram.mPort);
+
+		struct msghdr& msg = msgs[i].msg_hdr;
+		msg.msg_name = &addrs[i];
+		msg.msg_namelen = sizeof(struct sockaddr_in);
+		msg.msg_iov = &iovs[i];
+		msg.msg_iovlen = 1;
+	}
+
+	// sendmmsg() stops at the first datagram it fails on, that one gets the
+	// same retries as send_packet() and is dropped if they fail.
+	S32 next = 0;
+	S32 sent = 0;
+	S32 send_attempts = 0;
+	while (next < count)
+	{
+		int ret = sendmmsg(hSocket, msgs + next, count - next, 0);
+		if (ret > 0)
+		{
+			next += ret;
+			sent += ret;
+			send_attempts = 0;
+			continue;
+		}
+
+		if (ret < 0 && errno == ENOSYS)
+		{
+			LL_WARNS() << "sendmmsg() not supported, sending one packet per call" << LL_ENDL;
+			sNoMMsg = true;
+			return sent + send_packets_loop(hSocket, datagrams + next, count - next);
+		}
+
+		if (ret < 0 && (errno == EAGAIN || errno == ECONNREFUSED) && ++send_attempts < 3)
+		{
+			LL_INFOS() << "sendmmsg() failed: " << strerror(errno) << ", resending (attempt " << send_attempts << ")" << LL_ENDL;
+			continue;
+		}
+
+		LL_INFOS() << "sendmmsg() failed: " << errno << ", " << strerror(errno) << LL_ENDL;
+		LL_INFOS() << inet_ntoa(addrs[next].sin_addr) << ":" << datagrams[next].mPort << LL_ENDL;
+		++next;
+		send_attempts = 0;
+	}
+
+	return sent;
+}
+#endif // LL_NET_MMSG
+
+#endif
+
+#if !LL_NET_MMSG
+S32 receive_packets(int hSocket, LLNetDatagram* datagrams, S32 count)
+{
+	return receive_packets_loop(hSocket, datagrams, llmin(count, NET_BATCH_MAX));
+}
+
+S32 send_packets(int hSocket, const LLNetDatagram* datagrams, S32 count)
+{
+	return send_packets_loop(hSocket, datagrams, count);
+}
 #endif
 
 //EOF
@@ -40,11 +40,33 @@ class LLHost;
 S32		start_net(S32& socket_out, int& nPort);								
 void	end_net(S32& socket_out);
 
-// returns size of packet or -1 in case of error
-S32		receive_packet(int hSocket, char * receiveBuffer);
+// returns size of packet or -1 in case of error.  receiveBuffer holds size bytes.
+S32		receive_packet(int hSocket, char * receiveBuffer, S32 size = NET_BUFFER_SIZE);
 
 BOOL	send_packet(int hSocket, const char *sendBuffer, int size, U32 recipient, int nPort);	// Returns TRUE on success.
 
+// Most datagrams moved by one receive_packets() or send_packets() call
+const S32	NET_BATCH_MAX = 32;
+
+// One datagram of a batched receive or send.
+struct LLNetDatagram
+{
+	char*	mData;
+	S32		mCapacity;		// receive only, bytes mData holds
+	S32		mSize;			// bytes received, or to send
+	U32		mAddress;		// sender on receive, recipient on send
+	U32		mPort;
+	U32		mReceivingIF;	// receive only, INVALID_HOST_IP_ADDRESS when unknown
+};
+
+// Batched versions of the above, one system call for the whole batch where the OS
+// has recvmmsg()/sendmmsg(), a loop elsewhere.  Senders come back in the datagrams,
+// use get_sender() only after receive_packet().
+// Returns the number of datagrams received, 0 when none are waiting.
+S32		receive_packets(int hSocket, LLNetDatagram* datagrams, S32 count);
+// Returns the number of datagrams sent.
+S32		send_packets(int hSocket, const LLNetDatagram* datagrams, S32 count);
+
 //void	get_sender(char * tmp);
 LLHost	get_sender();
 U32		get_sender_port();
@@ -0,0 +1,157 @@
+/**
+ * @file llackbitmap_test.cpp
+ * @date 2014-10
+ * @brief LLAckBitmap checked against a set of packet ids.
+ *
+ * $LicenseInfo:firstyear=2014&license=viewerlgpl$
+ * Second Life Viewer Source Code
+ * Copyright (C) 2014, Linden Research, Inc.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation;
+ * version 2.1 of the License only.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ * Linden Research, Inc., 945 Battery Street, San Francisco, CA  94111  USA
+ * $/LicenseInfo$
+ */
+
+#include "linden_common.h"
+
+#include "../llackbitmap.h"
+#include "../llcircuit.h"
+
+#include "../test/lltut.h"
+#include "../test/lltestrandom.h"
+
+#include <algorithm>
+#include <set>
+
+namespace tut
+{
+	struct ackbitmap_test
+	{
+	};
+	typedef test_group<ackbitmap_test> ackbitmap_group_t;
+	typedef ackbitmap_group_t::object ackbitmap_object_t;
+	tut::ackbitmap_group_t ackbitmap_instance("LLAckBitmap");
+
+	template<> template<>
+	void ackbitmap_object_t::test<1>()
+	{
+		set_test_name("duplicates, order and partial takes");
+
+		LLAckBitmap acks;
+		const TPACKETID ids[] = { 100, 37, 100, 64, 95, 37, 1000, 36 };
+		for (S32 i = 0; i < (S32)(sizeof(ids) / sizeof(ids[0])); ++i)
+		{
+			acks.add(ids[i]);
+		}
+		ensure_equals("duplicates once", acks.size(), 6);
+
+		std::vector<TPACKETID> taken;
+		ensure_equals("partial take", acks.take(4, taken), 4);
+		ensure_equals("left", acks.size(), 2);
+		ensure_equals("lowest first", taken[0], (TPACKETID)36);
+		ensure_equals("then", taken[1], (TPACKETID)37);
+		ensure_equals("then", taken[2], (TPACKETID)64);
+		ensure_equals("then", taken[3], (TPACKETID)95);
+
+		// Below what is left, in front of the window
+		acks.add(5);
+		ensure_equals("rest", acks.take(10, taken), 3);
+		ensure_equals("front", taken[4], (TPACKETID)5);
+		ensure_equals("rest 1", taken[5], (TPACKETID)100);
+		ensure_equals("rest 2", taken[6], (TPACKETID)1000);
+		ensure("empty", acks.empty());
+		ensure_equals("nothing more", acks.take(10, taken), 0);
+	}
+
+	template<> template<>
+	void ackbitmap_object_t::test<2>()
+	{
+		set_test_name("wrapping ids and outliers against a set");
+
+		LLTestRandom random(0xacc);
+		LLAckBitmap acks;
+		std::set<TPACKETID> reference;
+
+		// Start just short of the end of the id space so it wraps
+		TPACKETID next_id = LL_MAX_OUT_PACKET_ID - 5000;
+		for (S32 round = 0; round < 20000; ++round)
+		{
+			S32 count = random.next(20);
+			for (S32 i = 0; i < count; ++i)
+			{
+				TPACKETID packet_id;
+				switch (random.next(10))
+				{
+				case 0:
+					// A resend of something recent
+					packet_id = (next_id - random.next(100)) % LL_MAX_OUT_PACKET_ID;
+					break;
+				case 1:
+					// Nowhere near, a confused or hostile sender
+					packet_id = random.next(0xffffff) * 256;
+					break;
+				default:
+					packet_id = next_id;
+					next_id = (next_id + 1) % LL_MAX_OUT_PACKET_ID;
+					break;
+				}
+				acks.add(packet_id);
+				reference.insert(packet_id);
+			}
+			ensure_equals("size", acks.size(), (S32)reference.size());
+
+			std::vector<TPACKETID> taken;
+			S32 take_count = random.next(30);
+			S32 taken_count = acks.take(take_count, taken);
+			ensure_equals("taken", taken_count, llmin(take_count, (S32)reference.size()));
+			for (std::vector<TPACKETID>::iterator iter = taken.begin(); iter != taken.end(); ++iter)
+			{
+				ensure("was added", reference.erase(*iter) == 1);
+			}
+		}
+
+		std::vector<TPACKETID> taken;
+		acks.take(acks.size(), taken);
+		ensure_equals("all taken", taken.size(), reference.size());
+		ensure("empty", acks.empty());
+	}
+
+	template<> template<>
+	void ackbitmap_object_t::test<3>()
+	{
+		set_test_name("order across the id wrap");
+
+		LLAckBitmap acks;
+		const TPACKETID ids[] = { 2, LL_MAX_OUT_PACKET_ID - 1, 0x800000, 0, 0x10000000, LL_MAX_OUT_PACKET_ID - 40, 1 };
+		for (S32 i = 0; i < (S32)(sizeof(ids) / sizeof(ids[0])); ++i)
+		{
+			acks.add(ids[i]);
+		}
+		ensure_equals("all kept", acks.size(), 7);
+
+		// The window runs from before the wrap to after it, then the ids kept aside
+		std::vector<TPACKETID> taken;
+		ensure_equals("taken", acks.take(10, taken), 7);
+		ensure_equals("before the wrap", taken[0], LL_MAX_OUT_PACKET_ID - 40);
+		ensure_equals("last before the wrap", taken[1], LL_MAX_OUT_PACKET_ID - 1);
+		ensure_equals("wrapped", taken[2], (TPACKETID)0);
+		ensure_equals("wrapped 1", taken[3], (TPACKETID)1);
+		ensure_equals("wrapped 2", taken[4], (TPACKETID)2);
+		ensure_equals("aside", taken[5], (TPACKETID)0x800000);
+		ensure_equals("aside past the id space", taken[6], (TPACKETID)0x10000000);
+		ensure("empty", acks.empty());
+	}
+}
@@ -0,0 +1,252 @@
+/**
+ * @file llpacketring_test.cpp
+ * @date 2014-10
+ * @brief LLPacketRing batched receive and send over loopback sockets.
+ *
+ * $LicenseInfo:firstyear=2014&license=viewerlgpl$
+ * Second Life Viewer Source Code
+ * Copyright (C) 2014, Linden Research, Inc.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation;
+ * version 2.1 of the License only.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ * Linden Research, Inc., 945 Battery Street, San Francisco, CA  94111  USA
+ * $/LicenseInfo$
+ */
+
+#include "linden_common.h"
+
+#if LL_WINDOWS
+	#include <winsock2.h>
+#else
+	#include <sys/socket.h>
+	#include <netinet/in.h>
+#endif
+
+#include "../llpacketring.h"
+#include "../net.h"
+#include "llformat.h"
+#include "lltimer.h"
+
+#include "../test/lltut.h"
+
+#include <vector>
+
+namespace
+{
+	// Loopback delivery is immediate on Linux, give other platforms a moment
+	const F32 RECEIVE_TIMEOUT = 2.f;
+
+	std::string make_payload(S32 index, S32 size)
+	{
+		std::string payload = llformat("packet %d ", index);
+		payload.resize(llmax((S32)payload.size(), size), 'x');
+		return payload;
+	}
+}
+
+namespace tut
+{
+	struct packetring_test
+	{
+		packetring_test()
+		:	mSender(-1),
+			mReceiver(-1),
+			mSenderPort(NET_USE_OS_ASSIGNED_PORT),
+			mReceiverPort(NET_USE_OS_ASSIGNED_PORT)
+		{
+			start_net(mSender, mSenderPort);
+			start_net(mReceiver, mReceiverPort);
+			mReceiverHost = LLHost(LOOPBACK_ADDRESS_STRING, mReceiverPort);
+		}
+
+		~packetring_test()
+		{
+			end_net(mSender);
+			end_net(mReceiver);
+		}
+
+		// Receives through ring until count packets arrived or the timeout hit
+		S32 receive(LLPacketRing& ring, S32 count, std::vector<std::string>* payloads = NULL)
+		{
+			char buffer[NET_BUFFER_SIZE];
+			S32 received = 0;
+			LLTimer timer;
+			while (received < count && timer.getElapsedTimeF32() < RECEIVE_TIMEOUT)
+			{
+				S32 size = ring.receivePacket(mReceiver, buffer);
+				if (size > 0)
+				{
+					if (payloads)
+					{
+						payloads->push_back(std::string(buffer, size));
+					}
+					++received;
+				}
+			}
+			return received;
+		}
+
+		// The same with one receive_packet() call per packet
+		S32 receiveUnbatched(S32 count)
+		{
+			char buffer[NET_BUFFER_SIZE];
+			S32 received = 0;
+			LLTimer timer;
+			while (received < count && timer.getElapsedTimeF32() < RECEIVE_TIMEOUT)
+			{
+				if (receive_packet(mReceiver, buffer) > 0)
+				{
+					++received;
+				}
+			}
+			return received;
+		}
+
+		// A ring behind a SOCKS 5 proxy, without the proxy handshake
+		class ProxiedPacketRing : public LLPacketRing
+		{
+		protected:
+			/*virtual*/ bool usesSOCKSProxy() const	{ return true; }
+		};
+
+		S32 mSender;
+		S32 mReceiver;
+		int mSenderPort;
+		int mReceiverPort;
+		LLHost mReceiverHost;
+	};
+	typedef test_group<packetring_test> packetring_group_t;
+	typedef packetring_group_t::object packetring_object_t;
+	tut::packetring_group_t packetring_instance("LLPacketRing");
+
+	template<> template<>
+	void packetring_object_t::test<1>()
+	{
+		set_test_name("batched send and receive");
+
+		// More than one batch each way
+		const S32 COUNT = NET_BATCH_MAX * 3 + 5;
+
+		LLPacketRing send_ring;
+		send_ring.beginSendBatch();
+		for (S32 i = 0; i < COUNT; ++i)
+		{
+			std::string payload = make_payload(i, 100);
+			ensure("queued", send_ring.sendPacket(mSender, &payload[0], (S32)payload.size(), mReceiverHost));
+		}
+		ensure_equals("no send failures", send_ring.endSendBatch(mSender), 0);
+
+		LLPacketRing receive_ring;
+		std::vector<std::string> payloads;
+		ensure_equals("all received", receive(receive_ring, COUNT, &payloads), COUNT);
+		for (S32 i = 0; i < COUNT; ++i)
+		{
+			ensure_equals("payload in order", payloads[i], make_payload(i, 100));
+		}
+		ensure_equals("sender port", (S32)receive_ring.getLastSender().getPort(), (S32)mSenderPort);
+		ensure("batch drained", !receive_ring.hasBatchedPackets());
+	}
+
+	template<> template<>
+	void packetring_object_t::test<2>()
+	{
+		set_test_name("receive after the batch runs dry");
+
+		LLPacketRing receive_ring;
+		char buffer[NET_BUFFER_SIZE];
+
+		for (S32 round = 0; round < 2; ++round)
+		{
+			for (S32 i = 0; i < 3; ++i)
+			{
+				std::string payload = make_payload(i, 50);
+				ensure("sent", send_packet(mSender, payload.data(), (S32)payload.size(),
+										   mReceiverHost.getAddress(), mReceiverHost.getPort()));
+			}
+			ensure_equals("round received", receive(receive_ring, 3), 3);
+			ensure_equals("nothing left", receive_ring.receivePacket(mReceiver, buffer), 0);
+		}
+	}
+
+	template<> template<>
+	void packetring_object_t::test<3>()
+	{
+		set_test_name("loopback benchmark");
+
+		// Acks and object updates are a few hundred bytes, resends up to the MTU
+		const S32 ROUNDS = 500;
+		const S32 PACKET_SIZE = 400;
+		std::string payload = make_payload(0, PACKET_SIZE);
+
+		LLTimer timer;
+		S32 unbatched = 0;
+		for (S32 round = 0; round < ROUNDS; ++round)
+		{
+			for (S32 i = 0; i < NET_BATCH_MAX; ++i)
+			{
+				send_packet(mSender, payload.data(), PACKET_SIZE,
+							mReceiverHost.getAddress(), mReceiverHost.getPort());
+			}
+			unbatched += receiveUnbatched(NET_BATCH_MAX);
+		}
+		F64 unbatched_time = timer.getElapsedTimeF64();
+
+		LLPacketRing send_ring;
+		LLPacketRing receive_ring;
+		timer.reset();
+		S32 batched = 0;
+		for (S32 round = 0; round < ROUNDS; ++round)
+		{
+			send_ring.beginSendBatch();
+			for (S32 i = 0; i < NET_BATCH_MAX; ++i)
+			{
+				send_ring.sendPacket(mSender, &payload[0], PACKET_SIZE, mReceiverHost);
+			}
+			send_ring.endSendBatch(mSender);
+			batched += receive(receive_ring, NET_BATCH_MAX);
+		}
+		F64 batched_time = timer.getElapsedTimeF64();
+
+		LL_INFOS() << ROUNDS * NET_BATCH_MAX << " packets of " << PACKET_SIZE << " bytes: one per call "
+				   << unbatched_time * 1000.0 << " ms, batched " << batched_time * 1000.0 << " ms" << LL_ENDL;
+		ensure_equals("unbatched all received", unbatched, ROUNDS * NET_BATCH_MAX);
+		ensure_equals("batched all received", batched, ROUNDS * NET_BATCH_MAX);
+	}
+
+	template<> template<>
+	void packetring_object_t::test<4>()
+	{
+		set_test_name("proxied full-size packet");
+
+		// What the proxy relays: a SOCKS 5 UDP header, then a full-size packet
+		const LLHost origin("10.1.2.3", 13000);
+		std::string payload = make_payload(7, NET_BUFFER_SIZE);
+		std::string wrapped(SOCKS_HEADER_SIZE, '\0');
+		proxywrap_t* header = static_cast<proxywrap_t*>(static_cast<void*>(&wrapped[0]));
+		header->atype = ADDRESS_IPV4;
+		header->addr = origin.getAddress();
+		header->port = htons(origin.getPort());
+		wrapped += payload;
+		ensure("sent", send_packet(mSender, wrapped.data(), (S32)wrapped.size(),
+								   mReceiverHost.getAddress(), mReceiverHost.getPort()));
+
+		ProxiedPacketRing receive_ring;
+		std::vector<std::string> payloads;
+		ensure_equals("received", receive(receive_ring, 1, &payloads), 1);
+		ensure_equals("unwrapped size", (S32)payloads[0].size(), NET_BUFFER_SIZE);
+		ensure("unwrapped payload", payloads[0] == payload);
+		ensure_equals("origin", receive_ring.getLastSender(), origin);
+	}
+}
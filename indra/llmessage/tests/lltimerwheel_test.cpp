@@ -0,0 +1,159 @@
+/**
+ * @file lltimerwheel_test.cpp
+ * @date 2014-10
+ * @brief LLTimerWheel checked against a sorted map of deadlines.
+ *
+ * $LicenseInfo:firstyear=2014&license=viewerlgpl$
+ * Second Life Viewer Source Code
+ * Copyright (C) 2014, Linden Research, Inc.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation;
+ * version 2.1 of the License only.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ * Linden Research, Inc., 945 Battery Street, San Francisco, CA  94111  USA
+ * $/LicenseInfo$
+ */
+
+#include "linden_common.h"
+
+#include "../lltimerwheel.h"
+
+#include "../test/lltut.h"
+#include "../test/lltestrandom.h"
+
+#include <algorithm>
+#include <map>
+#include <vector>
+
+namespace
+{
+	class Timer : public LLTimerWheelNode
+	{
+	public:
+		Timer() : mDeadline(0) {}
+		U64 mDeadline;
+	};
+}
+
+namespace tut
+{
+	struct timerwheel_test
+	{
+	};
+	typedef test_group<timerwheel_test> timerwheel_group_t;
+	typedef timerwheel_group_t::object timerwheel_object_t;
+	tut::timerwheel_group_t timerwheel_instance("LLTimerWheel");
+
+	template<> template<>
+	void timerwheel_object_t::test<1>()
+	{
+		set_test_name("deadlines across levels");
+
+		LLTimerWheel wheel;
+		wheel.setCurrentTick(1000);
+
+		// Due now, in each level, past the top level and already passed
+		const U64 deadlines[] = { 1000, 1001, 1063, 1064, 1065, 5000, 300000, 20000000, 40000000, 10 };
+		const S32 COUNT = sizeof(deadlines) / sizeof(deadlines[0]);
+		Timer timers[COUNT];
+		for (S32 i = 0; i < COUNT; ++i)
+		{
+			timers[i].mDeadline = llmax(deadlines[i], (U64)1000);
+			wheel.schedule(&timers[i], deadlines[i]);
+		}
+		ensure_equals("all scheduled", wheel.size(), COUNT);
+
+		std::vector<LLTimerWheelNode*> expired;
+		U64 tick = 999;
+		S32 seen = 0;
+		while (seen < COUNT)
+		{
+			// Bigger steps further out, like a stalled frame
+			tick += tick < 400000 ? 1 : 997;
+			expired.clear();
+			wheel.advance(tick, expired);
+			for (std::vector<LLTimerWheelNode*>::iterator iter = expired.begin(); iter != expired.end(); ++iter)
+			{
+				Timer* timer = static_cast<Timer*>(*iter);
+				ensure("not early", timer->mDeadline <= tick);
+				ensure("not late", timer->mDeadline > tick - (tick <= 400000 ? 1 : 997));
+				ensure("unscheduled", !timer->isScheduled());
+				++seen;
+			}
+		}
+		ensure("empty", wheel.empty());
+	}
+
+	template<> template<>
+	void timerwheel_object_t::test<2>()
+	{
+		set_test_name("random schedule, cancel and advance against a map");
+
+		LLTestRandom random(0x7177);
+		const S32 COUNT = 2000;
+		std::vector<Timer> timers(COUNT);
+		std::multimap<U64, Timer*> reference;
+
+		LLTimerWheel wheel;
+		U64 now = 123456;
+		wheel.setCurrentTick(now);
+
+		for (S32 round = 0; round < 20000; ++round)
+		{
+			Timer* timer = &timers[random.next(COUNT)];
+			if (timer->isScheduled())
+			{
+				std::multimap<U64, Timer*>::iterator iter = reference.lower_bound(timer->mDeadline);
+				while (iter->second != timer)
+				{
+					++iter;
+				}
+				reference.erase(iter);
+			}
+
+			if (random.next(4))
+			{
+				// Mostly resend timeouts of a second or so, a few long ones
+				timer->mDeadline = now + 1 + (random.next(8) ? random.next(300) : random.next(500000));
+				wheel.schedule(timer, timer->mDeadline);
+				reference.insert(std::make_pair(timer->mDeadline, timer));
+			}
+			else
+			{
+				wheel.cancel(timer);
+			}
+			ensure_equals("size", wheel.size(), (S32)reference.size());
+
+			now += random.next(3);
+			std::vector<LLTimerWheelNode*> expired;
+			wheel.advance(now, expired);
+
+			std::vector<LLTimerWheelNode*> expected;
+			while (!reference.empty() && reference.begin()->first <= now)
+			{
+				expected.push_back(reference.begin()->second);
+				reference.erase(reference.begin());
+			}
+			ensure_equals("expired count", expired.size(), expected.size());
+			U64 last = 0;
+			for (size_t i = 0; i < expired.size(); ++i)
+			{
+				U64 deadline = static_cast<Timer*>(expired[i])->mDeadline;
+				ensure("in deadline order", deadline >= last);
+				ensure("expected", std::find(expected.begin(), expected.end(), expired[i]) != expected.end());
+				last = deadline;
+			}
+		}
+	}
+}
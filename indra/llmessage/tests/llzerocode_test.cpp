@@ -0,0 +1,286 @@
+/**
+ * @file llzerocode_test.cpp
+ * @date 2014-10
+ * @brief Zero coding checked byte for byte against the original loops.
+ *
+ * $LicenseInfo:firstyear=2014&license=viewerlgpl$
+ * Second Life Viewer Source Code
+ * Copyright (C) 2014, Linden Research, Inc.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation;
+ * version 2.1 of the License only.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ * Linden Research, Inc., 945 Battery Street, San Francisco, CA  94111  USA
+ * $/LicenseInfo$
+ */
+
+#include "linden_common.h"
+
+#include "../llzerocode.h"
+#include "lltimer.h"
+
+#include "../test/lltut.h"
+#include "../test/lltestrandom.h"
+
+#include <vector>
+
+namespace
+{
+	// Same as MAX_BUFFER_SIZE, without pulling in message.h
+	const S32 BUFFER_SIZE = 0x2000;
+
+	// The byte at a time coder from LLTemplateMessageBuilder, minus the header
+	S32 reference_code(const U8* src, S32 src_size, U8* dst)
+	{
+		S32 count = src_size;
+		U8 num_zeroes = 0;
+		const U8* inptr = src;
+		U8* outptr = dst;
+
+		while (count--)
+		{
+			if (!(*inptr))   // in a zero count
+			{
+				if (num_zeroes)
+				{
+					if (++num_zeroes > 254)
+					{
+						*outptr++ = num_zeroes;
+						num_zeroes = 0;
+					}
+				}
+				else
+				{
+					*outptr++ = 0;
+					num_zeroes = 1;
+				}
+				inptr++;
+			}
+			else
+			{
+				if (num_zeroes)
+				{
+					*outptr++ = num_zeroes;
+					num_zeroes = 0;
+				}
+				*outptr++ = *inptr++;
+			}
+		}
+
+		if (num_zeroes)
+		{
+			*outptr++ = num_zeroes;
+		}
+		return (S32)(outptr - dst);
+	}
+
+	// The byte at a time expander from LLMessageSystem, minus the header.
+	// Returns -1 where it raised MX_WROTE_PAST_BUFFER_SIZE.
+	S32 reference_expand(const U8* src, S32 src_size, U8* dst)
+	{
+		S32 count = src_size;
+		const U8* inptr = src;
+		U8* outptr = dst;
+
+		while (count--)
+		{
+			if (outptr > (&dst[BUFFER_SIZE-1]))
+			{
+				return -1;
+			}
+			if (!((*outptr++ = *inptr++)))
+			{
+				while (((count--)) && (!(*inptr)))
+				{
+					*outptr++ = *inptr++;
+					if (outptr > (&dst[BUFFER_SIZE-256]))
+					{
+						return -1;
+					}
+					memset(outptr,0,255);
+					outptr += 255;
+				}
+
+				if (count < 0)
+				{
+					break;
+				}
+				else
+				{
+					if (outptr > (&dst[BUFFER_SIZE-(*inptr)]))
+					{
+						return -1;
+					}
+					memset(outptr,0,(*inptr) - 1);
+					outptr += ((*inptr) - 1);
+					inptr++;
+				}
+			}
+		}
+		return (S32)(outptr - dst);
+	}
+
+	// Something shaped like an ObjectUpdate body: literal spans broken up by
+	// zero runs that are mostly short, sometimes long enough to wrap
+	std::vector<U8> make_body(LLTestRandom& random, S32 size)
+	{
+		std::vector<U8> body;
+		while ((S32)body.size() < size)
+		{
+			S32 literal = random.next(24);
+			for (S32 i = 0; i < literal; ++i)
+			{
+				body.push_back((U8)(1 + random.next(255)));
+			}
+			S32 zeros = random.next(8) ? 1 + random.next(12) : 1 + random.next(600);
+			body.insert(body.end(), zeros, 0);
+		}
+		body.resize(size);
+		return body;
+	}
+}
+
+namespace tut
+{
+	struct zerocode_test
+	{
+	};
+	typedef test_group<zerocode_test> zerocode_group_t;
+	typedef zerocode_group_t::object zerocode_object_t;
+	tut::zerocode_group_t zerocode_instance("LLZeroCode");
+
+	template<> template<>
+	void zerocode_object_t::test<1>()
+	{
+		set_test_name("edge cases");
+
+		U8 coded[2 * BUFFER_SIZE];
+		U8 expanded[BUFFER_SIZE];
+
+		const U8 all_zero[600] = { 0 };
+		for (S32 size = 0; size <= 600; ++size)
+		{
+			S32 coded_size = ll_zero_code(all_zero, size, coded);
+			ensure_equals("zero run coded", coded_size, reference_code(all_zero, size, expanded));
+			ensure_equals("zero run size", ll_zero_code_size(all_zero, size), coded_size);
+			ensure_equals("zero run expanded", ll_zero_code_expand(coded, coded_size, expanded, BUFFER_SIZE), size);
+		}
+
+		// Older coders wrap long runs as 0 0 [count], a trailing 0 stands for itself
+		const U8 wrapped[] = { 7, 0, 0, 3, 7, 0 };
+		ensure_equals("wrapped run", ll_zero_code_expand(wrapped, sizeof(wrapped), expanded, BUFFER_SIZE),
+					  reference_expand(wrapped, sizeof(wrapped), coded));
+		ensure("wrapped run bytes", !memcmp(expanded, coded, 1 + 259 + 1 + 1));
+
+		// A packet claiming more than the buffer holds
+		const U8 bomb[] = { 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 255 };
+		ensure_equals("overflow refused", ll_zero_code_expand(bomb, sizeof(bomb), expanded, BUFFER_SIZE), -1);
+		ensure_equals("reference refused too", reference_expand(bomb, sizeof(bomb), coded), -1);
+	}
+
+	template<> template<>
+	void zerocode_object_t::test<2>()
+	{
+		set_test_name("fuzz against the original loops");
+
+		LLTestRandom random(0x5eed);
+		U8 coded[2 * BUFFER_SIZE];
+		U8 reference[2 * BUFFER_SIZE];
+		U8 expanded[BUFFER_SIZE];
+
+		for (S32 iteration = 0; iteration < 20000; ++iteration)
+		{
+			// Round trips of well formed bodies
+			std::vector<U8> body = make_body(random, 1 + random.next(1400));
+			S32 size = (S32)body.size();
+
+			S32 coded_size = ll_zero_code(&body[0], size, coded);
+			S32 reference_size = reference_code(&body[0], size, reference);
+			ensure_equals("coded size", coded_size, reference_size);
+			ensure("coded bytes", !memcmp(coded, reference, coded_size));
+			ensure_equals("predicted size", ll_zero_code_size(&body[0], size), coded_size);
+
+			ensure_equals("expanded size", ll_zero_code_expand(coded, coded_size, expanded, BUFFER_SIZE), size);
+			ensure("expanded bytes", !memcmp(expanded, &body[0], size));
+
+			// Arbitrary input to the expander, as a broken or hostile sim might send
+			S32 garbage_size = random.next(300);
+			for (S32 i = 0; i < garbage_size; ++i)
+			{
+				coded[i] = random.next(3) ? 0 : (U8)random.next(256);
+			}
+			S32 expected = reference_expand(coded, garbage_size, reference);
+			S32 actual = ll_zero_code_expand(coded, garbage_size, expanded, BUFFER_SIZE);
+			if (expected >= 0)
+			{
+				ensure_equals("garbage expanded size", actual, expected);
+				ensure("garbage expanded bytes", !memcmp(expanded, reference, expected));
+			}
+			else
+			{
+				// The original gives up a little early on runs near the end of the buffer
+				ensure("garbage overflow", actual < 0 || actual > BUFFER_SIZE - 256);
+			}
+		}
+	}
+
+	template<> template<>
+	void zerocode_object_t::test<3>()
+	{
+		set_test_name("benchmark");
+
+		LLTestRandom random(42);
+		std::vector<U8> body = make_body(random, 1200);
+		const S32 size = (S32)body.size();
+		const S32 ITERATIONS = 100000;
+
+		U8 coded[2 * BUFFER_SIZE];
+		U8 expanded[BUFFER_SIZE];
+		S32 coded_size = ll_zero_code(&body[0], size, coded);
+
+		LLTimer timer;
+		S32 total = 0;
+		for (S32 i = 0; i < ITERATIONS; ++i)
+		{
+			total += reference_code(&body[0], size, coded);
+		}
+		F64 reference_code_time = timer.getElapsedTimeF64();
+
+		timer.reset();
+		for (S32 i = 0; i < ITERATIONS; ++i)
+		{
+			total += ll_zero_code(&body[0], size, coded);
+		}
+		F64 code_time = timer.getElapsedTimeF64();
+
+		timer.reset();
+		for (S32 i = 0; i < ITERATIONS; ++i)
+		{
+			total += reference_expand(coded, coded_size, expanded);
+		}
+		F64 reference_expand_time = timer.getElapsedTimeF64();
+
+		timer.reset();
+		for (S32 i = 0; i < ITERATIONS; ++i)
+		{
+			total += ll_zero_code_expand(coded, coded_size, expanded, BUFFER_SIZE);
+		}
+		F64 expand_time = timer.getElapsedTimeF64();
+
+		LL_INFOS() << ITERATIONS << " x " << size << " bytes, " << coded_size << " coded: code "
+				   << reference_code_time * 1000.0 << " -> " << code_time * 1000.0 << " ms, expand "
+				   << reference_expand_time * 1000.0 << " -> " << expand_time * 1000.0 << " ms" << LL_ENDL;
+		ensure_equals("all passes agree", total, 2 * ITERATIONS * (coded_size + size));
+	}
+}
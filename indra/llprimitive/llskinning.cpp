@@ -0,0 +1,141 @@
+/**
+ * @file llskinning.cpp
+ * @brief Software skinning of rigged mesh vertices.
+ *
+ * $LicenseInfo:firstyear=2014&license=viewerlgpl$
+ * Second Life Viewer Source Code
+ * Copyright (C) 2014, Linden Research, Inc.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation;
+ * version 2.1 of the License only.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ * Linden Research, Inc., 945 Battery Street, San Francisco, CA  94111  USA
+ * $/LicenseInfo$
+ */
+
+#include "linden_common.h"
+
+#include "llskinning.h"
+
+#include "llmodel.h"
+
+namespace
+{
+	// Sum of the palette matrices the weight picks, each scaled by its share
+	// of the total weight
+	LL_FORCE_INLINE void blend_matrix(const LLMatrix4a* palette, S32 last, const LLVector4a& weight, LLMatrix4a& out)
+	{
+		// Weights are never negative, so truncating is flooring
+		__m128i index = _mm_cvttps_epi32(weight);
+		LLVector4a w;
+		w = _mm_sub_ps(weight, _mm_cvtepi32_ps(index));
+
+		LLVector4a sum;
+		sum = _mm_add_ps(w, _mm_shuffle_ps(w, w, _MM_SHUFFLE(2, 3, 0, 1)));
+		sum = _mm_add_ps(sum, _mm_shuffle_ps(sum, sum, _MM_SHUFFLE(1, 0, 3, 2)));
+		w.div(sum);
+
+		LL_ALIGN_16(S32 idx[4]);
+		_mm_store_si128((__m128i*) idx, index);
+		const LLMatrix4a& m0 = palette[llclamp(idx[0], 0, last)];
+		const LLMatrix4a& m1 = palette[llclamp(idx[1], 0, last)];
+		const LLMatrix4a& m2 = palette[llclamp(idx[2], 0, last)];
+		const LLMatrix4a& m3 = palette[llclamp(idx[3], 0, last)];
+
+		LLVector4a w0, w1, w2, w3;
+		w0.splat<0>(w);
+		w1.splat<1>(w);
+		w2.splat<2>(w);
+		w3.splat<3>(w);
+
+		for (S32 i = 0; i < 4; ++i)
+		{
+			LLVector4a a, b;
+			a.setMul(m0.mMatrix[i], w0);
+			b.setMul(m1.mMatrix[i], w1);
+			a.add(b);
+			b.setMul(m2.mMatrix[i], w2);
+			a.add(b);
+			b.setMul(m3.mMatrix[i], w3);
+			out.mMatrix[i].setAdd(a, b);
+		}
+	}
+}
+
+//static
+S32 LLSkinning::buildPalette(const LLMeshSkinInfo& skin, const LLMatrix4* const* joint_matrices,
+							 S32 max_joints, LLMatrix4a* palette)
+{
+	S32 count = llmin((S32) skin.mJointNames.size(), (S32) skin.mInvBindMatrix.size(), max_joints);
+
+	LLMatrix4a bind_shape;
+	bind_shape.loadu(skin.mBindShapeMatrix);
+
+	for (S32 i = 0; i < count; ++i)
+	{
+		LLMatrix4 mat = skin.mInvBindMatrix[i];
+		if (joint_matrices[i])
+		{
+			mat *= *joint_matrices[i];
+		}
+
+		LLMatrix4a joint;
+		joint.loadu(mat);
+
+		// The bind shape matrix first, then the joint's
+		LLMatrix4a& entry = palette[i];
+		joint.rotate(bind_shape.mMatrix[0], entry.mMatrix[0]);
+		joint.rotate(bind_shape.mMatrix[1], entry.mMatrix[1]);
+		joint.rotate(bind_shape.mMatrix[2], entry.mMatrix[2]);
+		joint.affineTransform(bind_shape.mMatrix[3], entry.mMatrix[3]);
+	}
+
+	return count;
+}
+
+//static
+void LLSkinning::skinVertices(const LLMatrix4a* palette, S32 palette_size,
+							  const LLVector4a* weights, const LLVector4a* positions, const LLVector4a* normals,
+							  S32 count, LLVector4a* positions_out, LLVector4a* normals_out)
+{
+	if (palette_size <= 0)
+	{
+		return;
+	}
+
+	S32 last = palette_size - 1;
+	LLMatrix4a mat;
+
+	if (normals && normals_out)
+	{
+		for (S32 i = 0; i < count; ++i)
+		{
+			blend_matrix(palette, last, weights[i], mat);
+			mat.affineTransform(positions[i], positions_out[i]);
+
+			LLVector4a n;
+			mat.rotate(normals[i], n);
+			n.normalize3fast();
+			normals_out[i] = n;
+		}
+	}
+	else
+	{
+		for (S32 i = 0; i < count; ++i)
+		{
+			blend_matrix(palette, last, weights[i], mat);
+			mat.affineTransform(positions[i], positions_out[i]);
+		}
+	}
+}
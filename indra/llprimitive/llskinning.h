@@ -0,0 +1,59 @@
+/**
+ * @file llskinning.h
+ * @brief Software skinning of rigged mesh vertices.
+ *
+ * $LicenseInfo:firstyear=2014&license=viewerlgpl$
+ * Second Life Viewer Source Code
+ * Copyright (C) 2014, Linden Research, Inc.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation;
+ * version 2.1 of the License only.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ * Linden Research, Inc., 945 Battery Street, San Francisco, CA  94111  USA
+ * $/LicenseInfo$
+ */
+
+#ifndef LL_LLSKINNING_H
+#define LL_LLSKINNING_H
+
+#include "llmath.h"
+#include "llvector4a.h"
+#include "llmatrix4a.h"
+
+class LLMeshSkinInfo;
+
+// Skins vertices with up to four joints each, for when there is no
+// hardware skinning and for picking and bounding boxes of rigged meshes.
+// The bind shape matrix is folded into the palette, so every vertex is
+// blended and transformed once, all of it in SSE.
+class LLSkinning
+{
+public:
+	// Fills palette with the skinning matrix of each of skin's joints, at
+	// most max_joints of them, and returns how many.  joint_matrices[i] is
+	// the world matrix of the joint named skin.mJointNames[i], NULL for one
+	// the avatar does not have.
+	static S32 buildPalette(const LLMeshSkinInfo& skin, const LLMatrix4* const* joint_matrices,
+							S32 max_joints, LLMatrix4a* palette);
+
+	// weights as in LLVolumeFace::mWeights, the joint index in the integer
+	// part of each component and its weight in the fraction.  Indices past
+	// the palette use its last entry.  normals and normals_out may be NULL,
+	// the outputs may not overlap the inputs.
+	static void skinVertices(const LLMatrix4a* palette, S32 palette_size,
+							 const LLVector4a* weights, const LLVector4a* positions, const LLVector4a* normals,
+							 S32 count, LLVector4a* positions_out, LLVector4a* normals_out);
+};
+
+#endif // LL_LLSKINNING_H
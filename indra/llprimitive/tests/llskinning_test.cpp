@@ -0,0 +1,283 @@
+/**
+ * @file llskinning_test.cpp
+ * @date 2014-10
+ * @brief LLSkinning checked against per vertex matrix blending.
+ *
+ * $LicenseInfo:firstyear=2014&license=viewerlgpl$
+ * Second Life Viewer Source Code
+ * Copyright (C) 2014, Linden Research, Inc.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation;
+ * version 2.1 of the License only.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ * Linden Research, Inc., 945 Battery Street, San Francisco, CA  94111  USA
+ * $/LicenseInfo$
+ */
+
+#include "linden_common.h"
+
+#include "../llskinning.h"
+#include "../llmodel.h"
+#include "llquaternion.h"
+#include "lltimer.h"
+
+#include "../test/lltut.h"
+#include "../test/lltestrandom.h"
+
+#include <vector>
+
+namespace
+{
+	const S32 JOINT_COUNT = 52;
+
+	LLMatrix4 random_matrix(LLTestRandom& random, F32 reach)
+	{
+		LLQuaternion rotation(random.next(-F_PI, F_PI), LLVector3(random.next(-1.f, 1.f), random.next(-1.f, 1.f), 1.f));
+		LLVector4 translation(random.next(-reach, reach), random.next(-reach, reach), random.next(-reach, reach), 1.f);
+		return LLMatrix4(rotation, translation);
+	}
+
+	// A mesh rigged to every joint of an avatar, posed at random
+	struct Rig
+	{
+		Rig(LLTestRandom& random)
+		{
+			mSkin.mBindShapeMatrix = random_matrix(random, 0.5f);
+			for (S32 i = 0; i < JOINT_COUNT; ++i)
+			{
+				mSkin.mJointNames.push_back(llformat("joint%d", i));
+				mSkin.mInvBindMatrix.push_back(random_matrix(random, 1.f));
+				mJointMatrices.push_back(random_matrix(random, 2.f));
+			}
+			for (S32 i = 0; i < JOINT_COUNT; ++i)
+			{
+				// One the avatar lacks
+				mJointPointers.push_back(i == 7 ? NULL : &mJointMatrices[i]);
+			}
+		}
+
+		LLMeshSkinInfo mSkin;
+		std::vector<LLMatrix4> mJointMatrices;
+		std::vector<const LLMatrix4*> mJointPointers;
+	};
+
+	struct Mesh
+	{
+		Mesh(LLTestRandom& random, S32 count)
+		:	mCount(count)
+		{
+			mPositions = (LLVector4a*) ll_aligned_malloc_16(sizeof(LLVector4a) * count * 6);
+			mNormals = mPositions + count;
+			mWeights = mNormals + count;
+			mPositionsOut = mWeights + count;
+			mNormalsOut = mPositionsOut + count;
+			mReference = mNormalsOut + count;
+
+			for (S32 i = 0; i < count; ++i)
+			{
+				mPositions[i].set(random.next(-1.f, 1.f), random.next(-1.f, 1.f), random.next(-1.f, 1.f), 1.f);
+				mNormals[i].set(random.next(-1.f, 1.f), random.next(-1.f, 1.f), random.next(0.1f, 1.f), 0.f);
+				mNormals[i].normalize3fast();
+
+				// Weights add up to just under one as the mesh asset stores
+				// them, the first always there and the rest often zero
+				F32 weight[4];
+				F32 sum = 0.f;
+				for (S32 k = 0; k < 4; ++k)
+				{
+					weight[k] = k && random.next(0.f, 1.f) < 0.4f ? 0.f : random.next(0.1f, 1.f);
+					sum += weight[k];
+				}
+				F32 w[4];
+				for (S32 k = 0; k < 4; ++k)
+				{
+					w[k] = floorf(random.next(0.f, (F32) JOINT_COUNT)) + weight[k] * 0.999f / sum;
+				}
+				mWeights[i].set(w[0], w[1], w[2], w[3]);
+			}
+		}
+
+		~Mesh()
+		{
+			ll_aligned_free_16(mPositions);
+		}
+
+		S32 mCount;
+		LLVector4a* mPositions;
+		LLVector4a* mNormals;
+		LLVector4a* mWeights;
+		LLVector4a* mPositionsOut;
+		LLVector4a* mNormalsOut;
+		LLVector4a* mReference;
+	};
+
+	// How LLRiggedVolume::update() skinned each vertex before LLSkinning,
+	// except that LLVector4::operator*=() left the fourth weight out of the
+	// normalisation
+	void skin_reference(const Rig& rig, const Mesh& mesh, bool normals)
+	{
+		LLMatrix4a mp[JOINT_COUNT];
+		LLMatrix4* mat = (LLMatrix4*) mp;
+		for (U32 j = 0; j < JOINT_COUNT; ++j)
+		{
+			mat[j] = rig.mSkin.mInvBindMatrix[j];
+			if (rig.mJointPointers[j])
+			{
+				mat[j] *= *rig.mJointPointers[j];
+			}
+		}
+
+		LLMatrix4a bind_shape_matrix;
+		bind_shape_matrix.loadu(rig.mSkin.mBindShapeMatrix);
+
+		for (S32 j = 0; j < mesh.mCount; ++j)
+		{
+			LLMatrix4a final_mat;
+			final_mat.clear();
+
+			S32 idx[4];
+			LLVector4 wght;
+			F32 scale = 0.f;
+			for (U32 k = 0; k < 4; k++)
+			{
+				F32 w = mesh.mWeights[j][k];
+				idx[k] = llclamp((S32) floorf(w), 0, JOINT_COUNT - 1);
+				wght[k] = w - floorf(w);
+				scale += wght[k];
+			}
+			for (U32 k = 0; k < 4; k++)
+			{
+				wght[k] /= scale;
+			}
+
+			for (U32 k = 0; k < 4; k++)
+			{
+				LLMatrix4a src;
+				src.setMul(mp[idx[k]], wght[k]);
+				final_mat.add(src);
+			}
+
+			LLVector4a t;
+			LLVector4a dst;
+			bind_shape_matrix.affineTransform(mesh.mPositions[j], t);
+			final_mat.affineTransform(t, dst);
+			mesh.mReference[j] = dst;
+
+			if (normals)
+			{
+				bind_shape_matrix.rotate(mesh.mNormals[j], t);
+				final_mat.rotate(t, dst);
+				dst.normalize3fast();
+				mesh.mNormalsOut[j] = dst;
+			}
+		}
+	}
+
+	F32 max_difference(const LLVector4a* a, const LLVector4a* b, S32 count)
+	{
+		F32 max_diff = 0.f;
+		for (S32 i = 0; i < count; ++i)
+		{
+			LLVector4a diff;
+			diff.setSub(a[i], b[i]);
+			max_diff = llmax(max_diff, diff.getLength3().getF32());
+		}
+		return max_diff;
+	}
+}
+
+namespace tut
+{
+	struct skinning_test
+	{
+	};
+	typedef test_group<skinning_test> skinning_group_t;
+	typedef skinning_group_t::object skinning_object_t;
+	tut::skinning_group_t skinning_instance("LLSkinning");
+
+	template<> template<>
+	void skinning_object_t::test<1>()
+	{
+		set_test_name("matches per vertex matrix blending");
+
+		LLTestRandom random(0x5c1);
+		Rig rig(random);
+		Mesh mesh(random, 5000);
+
+		LLMatrix4a palette[JOINT_COUNT];
+		S32 count = LLSkinning::buildPalette(rig.mSkin, &rig.mJointPointers[0], JOINT_COUNT, palette);
+		ensure_equals("palette size", count, JOINT_COUNT);
+
+		// Normals first, the reference writes its own to mNormalsOut
+		skin_reference(rig, mesh, true);
+		std::vector<LLVector4a> reference_normals(mesh.mNormalsOut, mesh.mNormalsOut + mesh.mCount);
+		LLSkinning::skinVertices(palette, count, mesh.mWeights, mesh.mPositions, mesh.mNormals,
+								 mesh.mCount, mesh.mPositionsOut, mesh.mNormalsOut);
+
+		// Positions reach a few meters, so this is float rounding
+		ensure("positions", max_difference(mesh.mPositionsOut, mesh.mReference, mesh.mCount) < 1e-4f);
+		ensure("normals", max_difference(mesh.mNormalsOut, &reference_normals[0], mesh.mCount) < 1e-3f);
+
+		// And without normals
+		LLVector4a* positions_out = mesh.mNormalsOut;
+		LLSkinning::skinVertices(palette, count, mesh.mWeights, mesh.mPositions, NULL,
+								 mesh.mCount, positions_out, NULL);
+		ensure("positions only", max_difference(positions_out, mesh.mReference, mesh.mCount) < 1e-4f);
+
+		// Indices past a short palette use its last entry
+		LLVector4a weight;
+		weight.set(60.5f, 3.f, 4.f, 5.f);
+		LLVector4a position;
+		position.set(0.25f, 0.5f, 0.75f, 1.f);
+		LLVector4a clamped, expected;
+		LLSkinning::skinVertices(palette, 10, &weight, &position, NULL, 1, &clamped, NULL);
+		palette[9].affineTransform(position, expected);
+		ensure("clamped", max_difference(&clamped, &expected, 1) < 1e-5f);
+	}
+
+	template<> template<>
+	void skinning_object_t::test<2>()
+	{
+		set_test_name("skinning benchmark");
+
+		// A crowd of 60 mesh avatars with 8 faces of 2000 vertices each
+		const S32 FACES = 60 * 8;
+		const S32 VERTICES = 2000;
+
+		LLTestRandom random(0xbe7c);
+		Rig rig(random);
+		Mesh mesh(random, VERTICES);
+
+		LLTimer timer;
+		for (S32 i = 0; i < FACES; ++i)
+		{
+			skin_reference(rig, mesh, true);
+		}
+		F64 reference_time = timer.getElapsedTimeF64();
+
+		timer.reset();
+		for (S32 i = 0; i < FACES; ++i)
+		{
+			LLMatrix4a palette[JOINT_COUNT];
+			S32 count = LLSkinning::buildPalette(rig.mSkin, &rig.mJointPointers[0], JOINT_COUNT, palette);
+			LLSkinning::skinVertices(palette, count, mesh.mWeights, mesh.mPositions, mesh.mNormals,
+									 mesh.mCount, mesh.mPositionsOut, mesh.mNormalsOut);
+		}
+		F64 kernel_time = timer.getElapsedTimeF64();
+
+		LL_INFOS() << FACES << " faces of " << VERTICES << " vertices: per vertex blending "
+				   << reference_time * 1000.0 << " ms, LLSkinning " << kernel_time * 1000.0 << " ms" << LL_ENDL;
+		ensure("same result", max_difference(mesh.mPositionsOut, mesh.mReference, mesh.mCount) < 1e-4f);
+	}
+}
@@ -79,6 +79,14 @@ U32 vbo_block_index(U32 size)
 
 const U32 LL_VBO_POOL_SEED_COUNT = vbo_block_index(LL_VBO_POOL_MAX_SEED_SIZE);
 
+// Frames a released buffer waits before it is handed out again, enough for
+// the GPU to have finished the frames that drew from it
+const U32 LL_VBO_POOL_RECYCLE_FRAMES = 3;
+// Recycled buffers not reused in this many frames are deleted
+const U32 LL_VBO_POOL_IDLE_FRAMES = 300;
+// Most a pool keeps on its free lists from releases
+const U32 LL_VBO_POOL_MAX_FREE_BYTES = 32*1024*1024;
+
 
 //============================================================================
 
@@ -91,6 +99,11 @@ LLVBOPool LLVertexBuffer::sDynamicIBOPool(GL_DYNAMIC_DRAW_ARB, GL_ELEMENT_ARRAY_
 
 U32 LLVBOPool::sBytesPooled = 0;
 U32 LLVBOPool::sIndexBytesPooled = 0;
+U32 LLVBOPool::sFrame = 0;
+U32 LLVBOPool::sAllocatedFromPool = 0;
+U32 LLVBOPool::sAllocatedNew = 0;
+U32 LLVBOPool::sRecycled = 0;
+U32 LLVBOPool::sTrimmed = 0;
 
 std::list<U32> LLVertexBuffer::sAvailableVAOName;
 U32 LLVertexBuffer::sCurVAOName = 1;
@@ -145,12 +158,51 @@ void LLVBOPool::deleteBuffer(U32 name)
 
 
 LLVBOPool::LLVBOPool(U32 vboUsage, U32 vboType)
-: mUsage(vboUsage), mType(vboType)
+: mUsage(vboUsage), mType(vboType), mFreeBytes(0)
 {
 	mMissCount.resize(LL_VBO_POOL_SEED_COUNT);
 	std::fill(mMissCount.begin(), mMissCount.end(), 0);
 }
 
+void LLVBOPool::addFreeBytes(U32 size)
+{
+	mFreeBytes += size;
+	if (mType == GL_ARRAY_BUFFER_ARB)
+	{
+		sBytesPooled += size;
+	}
+	else
+	{
+		sIndexBytesPooled += size;
+	}
+}
+
+void LLVBOPool::removeFreeBytes(U32 size)
+{
+	mFreeBytes -= size;
+	if (mType == GL_ARRAY_BUFFER_ARB)
+	{
+		sBytesPooled -= size;
+	}
+	else
+	{
+		sIndexBytesPooled -= size;
+	}
+}
+
+U32 LLVBOPool::getFreeSizeCount() const
+{
+	U32 count = 0;
+	for (U32 i = 0; i < mFreeList.size(); ++i)
+	{
+		if (!mFreeList[i].empty())
+		{
+			++count;
+		}
+	}
+	return count;
+}
+
 volatile U8* LLVBOPool::allocate(U32& name, U32 size, bool for_seed)
 {
 	llassert(vbo_block_size(size) == size);
@@ -164,16 +216,35 @@ volatile U8* LLVBOPool::allocate(U32& name, U32 size, bool for_seed)
 		mFreeList.resize(i+1);
 	}
 
-	if (mFreeList[i].empty() || for_seed)
+	//recycled buffers wait behind seeded ones that are ready now, so take
+	//the first one that is ready rather than the front
+	record_list_t::iterator ready = mFreeList[i].end();
+	if (!for_seed)
+	{
+		for (record_list_t::iterator iter = mFreeList[i].begin(); iter != mFreeList[i].end(); ++iter)
+		{
+			if (iter->mReadyFrame <= sFrame)
+			{
+				ready = iter;
+				break;
+			}
+		}
+	}
+
+	if (ready == mFreeList[i].end())
 	{
 		//make a new buffer
 		name = genBuffer();
 		
 		glBindBufferARB(mType, name);
 
-		if (!for_seed && i < LL_VBO_POOL_SEED_COUNT)
-		{ //record this miss
-			mMissCount[i]++;	
+		if (!for_seed)
+		{
+			sAllocatedNew++;
+			if (i < LL_VBO_POOL_SEED_COUNT)
+			{ //record this miss
+				mMissCount[i]++;	
+			}
 		}
 
 		if (mType == GL_ARRAY_BUFFER_ARB)
@@ -207,42 +278,50 @@ volatile U8* LLVBOPool::allocate(U32& name, U32 size, bool for_seed)
 			Record rec;
 			rec.mGLName = name;
 			rec.mClientData = ret;
+			rec.mReadyFrame = sFrame;
 	
-			if (mType == GL_ARRAY_BUFFER_ARB)
-			{
-				sBytesPooled += size;
-			}
-			else
-			{
-				sIndexBytesPooled += size;
-			}
+			addFreeBytes(size);
 			mFreeList[i].push_back(rec);
 		}
 	}
 	else
 	{
-		name = mFreeList[i].front().mGLName;
-		ret = mFreeList[i].front().mClientData;
+		name = ready->mGLName;
+		ret = ready->mClientData;
 
-		if (mType == GL_ARRAY_BUFFER_ARB)
-		{
-			sBytesPooled -= size;
-		}
-		else
-		{
-			sIndexBytesPooled -= size;
-		}
+		removeFreeBytes(size);
+		sAllocatedFromPool++;
 
-		mFreeList[i].pop_front();
+		mFreeList[i].erase(ready);
 	}
 
 	return ret;
 }
 
-void LLVBOPool::release(U32 name, volatile U8* buffer, U32 size)
+void LLVBOPool::release(U32 name, volatile U8* buffer, U32 size, bool recycle)
 {
 	llassert(vbo_block_size(size) == size);
 
+	U32 i = vbo_block_index(size);
+
+	if (recycle && i < LL_VBO_POOL_SEED_COUNT && mFreeBytes + size <= LL_VBO_POOL_MAX_FREE_BYTES)
+	{ //keep it for a buffer of the same size a few frames from now
+		if (mFreeList.size() <= i)
+		{
+			mFreeList.resize(i+1);
+		}
+
+		Record rec;
+		rec.mGLName = name;
+		rec.mClientData = buffer;
+		rec.mReadyFrame = sFrame + LL_VBO_POOL_RECYCLE_FRAMES;
+
+		addFreeBytes(size);
+		mFreeList[i].push_back(rec);
+		sRecycled++;
+		return;
+	}
+
 	deleteBuffer(name);
 	ll_aligned_free_fallback((U8*) buffer);
 
@@ -282,9 +361,41 @@ void LLVBOPool::seedPool()
 
 
 
+void LLVBOPool::trimPool()
+{
+	for (U32 i = 0; i < mFreeList.size(); ++i)
+	{
+		record_list_t& l = mFreeList[i];
+		U32 size = i*LL_VBO_BLOCK_SIZE;
+
+		//oldest first, keep what seedPool() would make again
+		while (l.size() > (i < mMissCount.size() ? mMissCount[i] : 0) &&
+			l.front().mReadyFrame + LL_VBO_POOL_IDLE_FRAMES < sFrame)
+		{
+			Record& r = l.front();
+
+			deleteBuffer(r.mGLName);
+			ll_aligned_free<64>((void*) r.mClientData);
+			l.pop_front();
+
+			removeFreeBytes(size);
+			sTrimmed++;
+
+			if (mType == GL_ARRAY_BUFFER_ARB)
+			{
+				LLVertexBuffer::sAllocatedBytes -= size;
+			}
+			else
+			{
+				LLVertexBuffer::sAllocatedIndexBytes -= size;
+			}
+		}
+	}
+}
+
 void LLVBOPool::cleanup()
 {
-	U32 size = LL_VBO_BLOCK_SIZE;
+	U32 size = 0;
 
 	for (U32 i = 0; i < mFreeList.size(); ++i)
 	{
@@ -303,14 +414,13 @@ void LLVBOPool::cleanup()
 
 			l.pop_front();
 
+			removeFreeBytes(size);
 			if (mType == GL_ARRAY_BUFFER_ARB)
 			{
-				sBytesPooled -= size;
 				LLVertexBuffer::sAllocatedBytes -= size;
 			}
 			else
 			{
-				sIndexBytesPooled -= size;
 				LLVertexBuffer::sAllocatedIndexBytes -= size;
 			}
 		}
@@ -402,6 +512,14 @@ void LLVertexBuffer::releaseVAOName(U32 name)
 //static
 void LLVertexBuffer::seedPools()
 {
+	LLVBOPool::sFrame++;
+
+	sStreamVBOPool.trimPool();
+	sDynamicVBOPool.trimPool();
+	sDynamicCopyVBOPool.trimPool();
+	sStreamIBOPool.trimPool();
+	sDynamicIBOPool.trimPool();
+
 	sStreamVBOPool.seedPool();
 	sDynamicVBOPool.seedPool();
 	sDynamicCopyVBOPool.seedPool();
@@ -1135,13 +1253,22 @@ void LLVertexBuffer::genIndices(U32 size)
 
 void LLVertexBuffer::releaseBuffer()
 {
+	//a buffer still mapped in GL can not be handed out again, and what it
+	//was mapped to is not ours to free
+	bool gl_mapped = mMappable && mMappedData;
+	volatile U8* client_data = gl_mapped ? NULL : mMappedData;
+
 	if (mUsage == GL_STREAM_DRAW_ARB)
 	{
-		sStreamVBOPool.release(mGLBuffer, mMappedData, mSize);
+		sStreamVBOPool.release(mGLBuffer, client_data, mSize, !gl_mapped);
+	}
+	else if (mUsage == GL_DYNAMIC_DRAW_ARB)
+	{
+		sDynamicVBOPool.release(mGLBuffer, client_data, mSize, !gl_mapped);
 	}
 	else
 	{
-		sDynamicVBOPool.release(mGLBuffer, mMappedData, mSize);
+		sDynamicCopyVBOPool.release(mGLBuffer, client_data, mSize, !gl_mapped);
 	}
 	
 	mGLBuffer = 0;
@@ -1152,13 +1279,16 @@ void LLVertexBuffer::releaseBuffer()
 
 void LLVertexBuffer::releaseIndices()
 {
+	bool gl_mapped = mMappable && mMappedIndexData;
+	volatile U8* client_data = gl_mapped ? NULL : mMappedIndexData;
+
 	if (mUsage == GL_STREAM_DRAW_ARB)
 	{
-		sStreamIBOPool.release(mGLIndices, mMappedIndexData, mIndicesSize);
+		sStreamIBOPool.release(mGLIndices, client_data, mIndicesSize, !gl_mapped);
 	}
 	else
 	{
-		sDynamicIBOPool.release(mGLIndices, mMappedIndexData, mIndicesSize);
+		sDynamicIBOPool.release(mGLIndices, client_data, mIndicesSize, !gl_mapped);
 	}
 
 	mGLIndices = 0;
@@ -52,12 +52,28 @@
 
 //============================================================================
 // gl name pools for dynamic and streaming buffers
+//
+// Released buffers of up to the seed size go back on the free list of their
+// size, client copy and all, instead of being deleted, so buffers that are
+// remade every frame (particles, HUD, rigged meshes) cycle through the same
+// memory.  The free lists work as rings: a buffer is handed out again only
+// a few frames after its release, once the GPU is done drawing from it, and
+// ones left idle for long are deleted.
 class LLVBOPool
 {
 public:
 	static U32 sBytesPooled;
 	static U32 sIndexBytesPooled;
 
+	// Counted frames, advanced by LLVertexBuffer::seedPools()
+	static U32 sFrame;
+
+	// Totals over all pools
+	static U32 sAllocatedFromPool;	// allocations served by a free list
+	static U32 sAllocatedNew;		// allocations that made a new GL buffer
+	static U32 sRecycled;			// releases kept on a free list
+	static U32 sTrimmed;			// pooled buffers deleted after idling
+
 	LLVBOPool(U32 vboUsage, U32 vboType);
 		
 	const U32 mUsage;
@@ -67,14 +83,22 @@ public:
 	volatile U8* allocate(U32& name, U32 size, bool for_seed = false);
 	
 	//size MUST be the size provided to allocate that returned the given name
-	void release(U32 name, volatile U8* buffer, U32 size);
+	//buffer is the client copy allocate() returned, NULL if it was mapped
+	void release(U32 name, volatile U8* buffer, U32 size, bool recycle = true);
 	
 	//batch allocate buffers to be provided to the application on demand
 	void seedPool();
 
+	//delete recycled buffers that have not been reused for a while
+	void trimPool();
+
 	//destroy all records in mFreeList
 	void cleanup();
 
+	//fragmentation of the free lists: bytes and number of sizes they hold
+	U32 getFreeBytes() const		{ return mFreeBytes; }
+	U32 getFreeSizeCount() const;
+
 	U32 genBuffer();
 	void deleteBuffer(U32 name);
 
@@ -83,12 +107,18 @@ public:
 	public:
 		U32 mGLName;
 		volatile U8* mClientData;
+		U32 mReadyFrame;	// may be handed out from this frame on
 	};
 
 	typedef std::list<Record> record_list_t;
 	std::vector<record_list_t> mFreeList;
 	std::vector<U32> mMissCount;
 
+private:
+	void addFreeBytes(U32 size);
+	void removeFreeBytes(U32 size);
+
+	U32 mFreeBytes;
 };
 
 
@@ -135,6 +165,8 @@ public:
 	static bool sUseVAO;
 	static bool	sPreferStreamDraw;
 
+	// Once a frame: ages and trims the recycled buffers of the pools, then
+	// seeds them
 	static void seedPools();
 
 	static U32 getVAOName();
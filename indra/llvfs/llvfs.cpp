@@ -43,6 +43,7 @@
     
 #include "llstl.h"
 #include "lltimer.h"
+#include "llvfslogstore.h"
     
 const S32 FILE_BLOCK_MASK = 0x000003FF;	 // 1024-byte blocks
 const S32 VFS_CLEANUP_SIZE = 5242880;  // how much space we free up in a single stroke
@@ -229,10 +230,11 @@ struct LLVFSFileBlock_less
 const S32 LLVFSFileBlock::SERIAL_SIZE = 34;
      
 
-LLVFS::LLVFS(const std::string& index_filename, const std::string& data_filename, const BOOL read_only, const U32 presize, const BOOL remove_after_crash)
+LLVFS::LLVFS(const std::string& index_filename, const std::string& data_filename, const BOOL read_only, const U32 presize, const BOOL remove_after_crash, const BOOL log_structured)
 :	mRemoveAfterCrash(remove_after_crash),
 	mDataFP(NULL),
-	mIndexFP(NULL)
+	mIndexFP(NULL),
+	mLogStore(NULL)
 {
 	mDataMutex = new LLMutex(0);
 
@@ -247,6 +249,12 @@ LLVFS::LLVFS(const std::string& index_filename, const std::string& data_filename
 	mDataFilename = data_filename;
     
 	const char *file_mode = mReadOnly ? "rb" : "r+b";
+
+	if (log_structured)
+	{
+		openLogStore(presize);
+		return;
+	}
     
 	LL_INFOS("VFS") << "Attempting to open VFS index file " << mIndexFilename << LL_ENDL;
 	LL_INFOS("VFS") << "Attempting to open VFS data file " << mDataFilename << LL_ENDL;
@@ -269,23 +277,7 @@ LLVFS::LLVFS(const std::string& index_filename, const std::string& data_filename
 			LLFile::remove(mIndexFilename);
 
 			// <FS:ND> When recreating the cache, also add a marker when we did this (for about/sysinfo)
-			LLFile::remove(mIndexFilename + ".date" );
-			LLFILE *fp = LLFile::fopen( mIndexFilename + ".date", "w" );
-			if( fp )
-			{
-				std::stringstream strm;
-				time_t tmin;
-				time( &tmin );
-				tm *pTm = gmtime( &tmin );
-				strm << std::setw(2) << std::setfill('0') << pTm->tm_year+1900 << "-" << pTm->tm_mon+1 << "-" << pTm->tm_mday << "T" << pTm->tm_hour << ":" << pTm->tm_min << ":" << pTm->tm_sec  << " " << std::endl;
-
-				size_t bytesWritten = fwrite( strm.str().c_str(), strm.str().size(), 1, fp );
-				if( !bytesWritten )
-				{
-					LL_WARNS() << "Eror during write to " << mIndexFilename + ".date" << LL_ENDL;
-				}
-				LLFile::close( fp );
-			}
+			writeCreationDate();
 			// </FS:ND>
 		}
 		else
@@ -584,6 +576,9 @@ LLVFS::~LLVFS()
 	{
 		LL_ERRS("VFS") << "LLVFS destroyed with mutex locked" << LL_ENDL;
 	}
+
+	delete mLogStore;
+	mLogStore = NULL;
 	
 	unlockAndClose(mIndexFP);
 	mIndexFP = NULL;
@@ -621,9 +616,10 @@ LLVFS * LLVFS::createLLVFS(const std::string& index_filename,
 		const std::string& data_filename, 
 		const BOOL read_only, 
 		const U32 presize, 
-		const BOOL remove_after_crash)
+		const BOOL remove_after_crash,
+		const BOOL log_structured)
 {
-	LLVFS * new_vfs = new LLVFS(index_filename, data_filename, read_only, presize, remove_after_crash);
+	LLVFS * new_vfs = new LLVFS(index_filename, data_filename, read_only, presize, remove_after_crash, log_structured);
 
 	if( !new_vfs->isValid() )
 	{	// First name failed, retry with new names
@@ -637,7 +633,7 @@ LLVFS * LLVFS::createLLVFS(const std::string& index_filename,
 			retry_vfs_data_name = data_filename + llformat(".%u", count);
 
 			delete new_vfs;	// Delete bad VFS and try again
-			new_vfs = new LLVFS(retry_vfs_index_name, retry_vfs_data_name, read_only, presize, remove_after_crash);
+			new_vfs = new LLVFS(retry_vfs_index_name, retry_vfs_data_name, read_only, presize, remove_after_crash, log_structured);
 
 			count++;
 		}
@@ -653,6 +649,80 @@ LLVFS * LLVFS::createLLVFS(const std::string& index_filename,
 }
 
 
+void LLVFS::openLogStore(const U32 max_size)
+{
+	LL_INFOS("VFS") << "Attempting to open log-structured VFS " << mDataFilename << LL_ENDL;
+
+	// The segments carry their own index.  The index file is only kept as
+	// the lock against a second viewer and to remember the creation date.
+	BOOL created = LLFile::isfile(mIndexFilename) ? FALSE : TRUE;
+	mIndexFP = openAndLock(mIndexFilename, mReadOnly ? "rb" : "a+b", mReadOnly);
+	if (!mIndexFP)
+	{
+		LL_WARNS("VFS") << "Couldn't open VFS lock file " << mIndexFilename << LL_ENDL;
+		mValid = mReadOnly ? VFSVALID_BAD_CANNOT_OPEN_READONLY : VFSVALID_BAD_CANNOT_CREATE;
+		return;
+	}
+
+	std::string marker = mDataFilename + ".open";
+	if (!mReadOnly && mRemoveAfterCrash && LLFile::isfile(marker))
+	{
+		LL_WARNS("VFS") << "VFS: File left open on last run, removing old VFS segments " << mDataFilename << LL_ENDL;
+		LLVFSLogStore::removeSegments(mDataFilename);
+		created = TRUE;
+	}
+
+	if (created && !mReadOnly)
+	{
+		writeCreationDate();
+	}
+
+	mLogStore = new LLVFSLogStore(mDataFilename, mReadOnly, max_size);
+	mValid = mLogStore->getValidState();
+	if (!isValid())
+	{
+		delete mLogStore;
+		mLogStore = NULL;
+		unlockAndClose(mIndexFP);
+		mIndexFP = NULL;
+		return;
+	}
+
+	if (!mReadOnly && mRemoveAfterCrash)
+	{
+		LLFILE* marker_fp = LLFile::fopen(marker, "w");	/* Flawfinder: ignore */
+		if (marker_fp)
+		{
+			fclose(marker_fp);
+			marker_fp = NULL;
+		}
+	}
+
+	LL_INFOS("VFS") << "Using log-structured VFS " << mDataFilename << LL_ENDL;
+}
+
+// <FS:ND> Remember when this cache was created (for about/sysinfo)
+void LLVFS::writeCreationDate()
+{
+	LLFile::remove(mIndexFilename + ".date" );
+	LLFILE *fp = LLFile::fopen( mIndexFilename + ".date", "w" );
+	if( fp )
+	{
+		std::stringstream strm;
+		time_t tmin;
+		time( &tmin );
+		tm *pTm = gmtime( &tmin );
+		strm << std::setw(2) << std::setfill('0') << pTm->tm_year+1900 << "-" << pTm->tm_mon+1 << "-" << pTm->tm_mday << "T" << pTm->tm_hour << ":" << pTm->tm_min << ":" << pTm->tm_sec  << " " << std::endl;
+
+		size_t bytesWritten = fwrite( strm.str().c_str(), strm.str().size(), 1, fp );
+		if( !bytesWritten )
+		{
+			LL_WARNS() << "Eror during write to " << mIndexFilename + ".date" << LL_ENDL;
+		}
+		LLFile::close( fp );
+	}
+}
+// </FS:ND>
 
 void LLVFS::presizeDataFile(const U32 size)
 {
@@ -690,6 +760,11 @@ BOOL LLVFS::getExists(const LLUUID &file_id, const LLAssetType::EType file_type)
 		LL_ERRS() << "Attempting to use invalid VFS!" << LL_ENDL;
 	}
 
+	if (mLogStore)
+	{
+		return mLogStore->getExists(file_id, file_type);
+	}
+
 	lockData();
 	
 	LLVFSFileSpecifier spec(file_id, file_type);
@@ -717,6 +792,11 @@ S32	 LLVFS::getSize(const LLUUID &file_id, const LLAssetType::EType file_type)
 
 	}
 
+	if (mLogStore)
+	{
+		return mLogStore->getSize(file_id, file_type);
+	}
+
 	lockData();
 	
 	LLVFSFileSpecifier spec(file_id, file_type);
@@ -743,6 +823,11 @@ S32  LLVFS::getMaxSize(const LLUUID &file_id, const LLAssetType::EType file_type
 		LL_ERRS() << "Attempting to use invalid VFS!" << LL_ENDL;
 	}
 
+	if (mLogStore)
+	{
+		return mLogStore->getMaxSize(file_id, file_type);
+	}
+
 	lockData();
 	
 	LLVFSFileSpecifier spec(file_id, file_type);
@@ -762,6 +847,11 @@ S32  LLVFS::getMaxSize(const LLUUID &file_id, const LLAssetType::EType file_type
 
 BOOL LLVFS::checkAvailable(S32 max_size)
 {
+	if (mLogStore)
+	{
+		return mLogStore->checkAvailable(max_size);
+	}
+
 	lockData();
 	
 	blocks_length_map_t::iterator iter = mFreeBlocksByLength.lower_bound(max_size); // first entry >= size
@@ -788,16 +878,6 @@ BOOL LLVFS::setMaxSize(const LLUUID &file_id, const LLAssetType::EType file_type
 		return FALSE;
 	}
 
-	lockData();
-	
-	LLVFSFileSpecifier spec(file_id, file_type);
-	LLVFSFileBlock *block = NULL;
-	fileblock_map::iterator it = mFileBlocks.find(spec);
-	if (it != mFileBlocks.end())
-	{
-		block = (*it).second;
-	}
-    
 	// round all sizes upward to KB increments
 	// SJB: Need to not round for the new texture-pipeline code so we know the correct
 	//      max file size. Need to investigate the potential problems with this...
@@ -809,6 +889,21 @@ BOOL LLVFS::setMaxSize(const LLUUID &file_id, const LLAssetType::EType file_type
 			max_size &= ~FILE_BLOCK_MASK;
 		}
     }
+
+	if (mLogStore)
+	{
+		return mLogStore->setMaxSize(file_id, file_type, max_size);
+	}
+
+	lockData();
+	
+	LLVFSFileSpecifier spec(file_id, file_type);
+	LLVFSFileBlock *block = NULL;
+	fileblock_map::iterator it = mFileBlocks.find(spec);
+	if (it != mFileBlocks.end())
+	{
+		block = (*it).second;
+	}
 	
 	if (block && block->mLength > 0)
 	{    
@@ -981,6 +1076,12 @@ void LLVFS::renameFile(const LLUUID &file_id, const LLAssetType::EType file_type
 		LL_ERRS() << "Attempt to write to read-only VFS" << LL_ENDL;
 	}
 
+	if (mLogStore)
+	{
+		mLogStore->renameFile(file_id, file_type, new_id, new_type);
+		return;
+	}
+
 	lockData();
 	
 	LLVFSFileSpecifier new_spec(new_id, new_type);
@@ -1069,6 +1170,12 @@ void LLVFS::removeFile(const LLUUID &file_id, const LLAssetType::EType file_type
 		LL_ERRS() << "Attempt to write to read-only VFS" << LL_ENDL;
 	}
 
+	if (mLogStore)
+	{
+		mLogStore->removeFile(file_id, file_type);
+		return;
+	}
+
     lockData();
 	
 	LLVFSFileSpecifier spec(file_id, file_type);
@@ -1098,6 +1205,11 @@ S32 LLVFS::getData(const LLUUID &file_id, const LLAssetType::EType file_type, U8
 	llassert(location >= 0);
 	llassert(length >= 0);
 
+	if (mLogStore)
+	{
+		return mLogStore->getData(file_id, file_type, buffer, location, length);
+	}
+
 	BOOL do_read = FALSE;
 	
     lockData();
@@ -1149,6 +1261,11 @@ S32 LLVFS::storeData(const LLUUID &file_id, const LLAssetType::EType file_type,
     
 	llassert(length > 0);
 
+	if (mLogStore)
+	{
+		return mLogStore->storeData(file_id, file_type, buffer, location, length);
+	}
+
     lockData();
     
 	LLVFSFileSpecifier spec(file_id, file_type);
@@ -1224,6 +1341,12 @@ S32 LLVFS::storeData(const LLUUID &file_id, const LLAssetType::EType file_type,
  
 void LLVFS::incLock(const LLUUID &file_id, const LLAssetType::EType file_type, EVFSLock lock)
 {
+	if (mLogStore)
+	{
+		mLogStore->incLock(file_id, file_type, lock);
+		return;
+	}
+
 	lockData();
 
 	LLVFSFileSpecifier spec(file_id, file_type);
@@ -1250,6 +1373,12 @@ void LLVFS::incLock(const LLUUID &file_id, const LLAssetType::EType file_type, E
 
 void LLVFS::decLock(const LLUUID &file_id, const LLAssetType::EType file_type, EVFSLock lock)
 {
+	if (mLogStore)
+	{
+		mLogStore->decLock(file_id, file_type, lock);
+		return;
+	}
+
 	lockData();
 
 	LLVFSFileSpecifier spec(file_id, file_type);
@@ -1274,6 +1403,11 @@ void LLVFS::decLock(const LLUUID &file_id, const LLAssetType::EType file_type, E
 
 BOOL LLVFS::isLocked(const LLUUID &file_id, const LLAssetType::EType file_type, EVFSLock lock)
 {
+	if (mLogStore)
+	{
+		return mLogStore->isLocked(file_id, file_type, lock);
+	}
+
 	lockData();
 	
 	BOOL res = FALSE;
@@ -1670,6 +1804,12 @@ void LLVFS::pokeFiles()
 	{
 		LL_ERRS() << "Attempting to use invalid VFS!" << LL_ENDL;
 	}
+	if (mLogStore)
+	{
+		// Same idea, minus the evil: ask the OS to read ahead the mappings.
+		mLogStore->prefetch();
+		return;
+	}
 	U32 word;
 	
 	// only write data if we actually read 4 bytes
@@ -1700,6 +1840,11 @@ void LLVFS::pokeFiles()
     
 void LLVFS::dumpMap()
 {
+	if (mLogStore)
+	{
+		mLogStore->dumpStatistics();
+		return;
+	}
 	LL_INFOS() << "Files:" << LL_ENDL;
 	for (fileblock_map::iterator it = mFileBlocks.begin(); it != mFileBlocks.end(); ++it)
 	{
@@ -1721,6 +1866,12 @@ void LLVFS::dumpMap()
 // Very slow, do not call routinely. JC
 void LLVFS::audit()
 {
+	if (mLogStore)
+	{
+		// Nothing to cross-check, the segments are the index.
+		return;
+	}
+
 	// Lock the mutex through this whole function.
 	LLMutexLock lock_data(mDataMutex);
 	
@@ -1894,12 +2045,19 @@ void LLVFS::dumpLockCounts()
 	S32 i;
 	for (i = 0; i < VFSLOCK_COUNT; i++)
 	{
-		LL_INFOS() << "LockType: " << i << ": " << mLockCounts[i] << LL_ENDL;
+		S32 count = mLogStore ? mLogStore->getLockCount((EVFSLock)i) : mLockCounts[i];
+		LL_INFOS() << "LockType: " << i << ": " << count << LL_ENDL;
 	}
 }
 
 void LLVFS::dumpStatistics()
 {
+	if (mLogStore)
+	{
+		mLogStore->dumpStatistics();
+		return;
+	}
+
 	lockData();
 	
 	// Investigate file blocks.
@@ -2072,6 +2230,12 @@ std::string get_extension(LLAssetType::EType type)
 
 void LLVFS::listFiles()
 {
+	if (mLogStore)
+	{
+		mLogStore->listFiles();
+		return;
+	}
+
 	lockData();
 	
 	for (fileblock_map::iterator it = mFileBlocks.begin(); it != mFileBlocks.end(); ++it)
@@ -2097,6 +2261,12 @@ void LLVFS::listFiles()
 #include "llapr.h"
 void LLVFS::dumpFiles()
 {
+	if (mLogStore)
+	{
+		LL_WARNS() << "dumpFiles is not supported for log-structured VFS" << LL_ENDL;
+		return;
+	}
+
 	lockData();
 	
 	S32 files_extracted = 0;
@@ -55,6 +55,7 @@ enum EVFSLock
 // internal classes
 class LLVFSBlock;
 class LLVFSFileBlock;
+class LLVFSLogStore;
 class LLVFSFileSpecifier
 {
 public:
@@ -77,17 +78,21 @@ private:
 			const std::string& data_filename, 
 			const BOOL read_only, 
 			const U32 presize, 
-			const BOOL remove_after_crash);
+			const BOOL remove_after_crash,
+			const BOOL log_structured);
 public:
 	~LLVFS();
 
 	// Use this function normally to create LLVFS files
 	// Pass 0 to not presize
+	// If log_structured is set, data_filename is the prefix for the segment
+	// files of an LLVFSLogStore and presize is its size budget.
 	static LLVFS * createLLVFS(const std::string& index_filename, 
 			const std::string& data_filename, 
 			const BOOL read_only, 
 			const U32 presize, 
-			const BOOL remove_after_crash);
+			const BOOL remove_after_crash,
+			const BOOL log_structured = FALSE);
 
 	BOOL isValid() const			{ return (VFSVALID_OK == mValid); }
 	EVFSValid getValidState() const	{ return mValid; }
@@ -138,6 +143,8 @@ protected:
 	void useFreeSpace(LLVFSBlock *free_block, S32 length);
 	void sync(LLVFSFileBlock *block, BOOL remove = FALSE);
 	void presizeDataFile(const U32 size);
+	void openLogStore(const U32 max_size);
+	void writeCreationDate();
 
 	static LLFILE *openAndLock(const std::string& filename, const char* mode, BOOL read_lock);
 	static void unlockAndClose(FILE *fp);
@@ -175,6 +182,10 @@ protected:
 	S32 mLockCounts[VFSLOCK_COUNT];
 	BOOL mRemoveAfterCrash;
 
+	// When set, all file operations go to the log-structured store and the
+	// block allocator above is unused.
+	LLVFSLogStore* mLogStore;
+
 	// <FS:ND> Query when this cache was created, Returns the time and date in UTC, or unknown,
 public:
 	std::string getCreationDataUTC() const;
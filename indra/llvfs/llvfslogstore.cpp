@@ -0,0 +1,1217 @@
+/**
+ * @file llvfslogstore.cpp
+ * @brief Log-structured, memory-mapped backend for LLVFS
+ *
+ * $LicenseInfo:firstyear=2014&license=viewerlgpl$
+ * Second Life Viewer Source Code
+ * Copyright (C) 2014, Linden Research, Inc.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation;
+ * version 2.1 of the License only.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ * Linden Research, Inc., 945 Battery Street, San Francisco, CA  94111  USA
+ * $/LicenseInfo$
+ */
+
+#include "linden_common.h"
+
+#include "llvfslogstore.h"
+
+#include <algorithm>
+#include "lldir.h"
+#include "lldiriterator.h"
+#include "llthread.h"
+#include "lltimer.h"
+
+// On-disk layout.  Segments are a cache that never leaves the machine, so
+// everything is stored in host byte order.
+const U32 SEGMENT_MAGIC = 0x4753564c;		// "LVSG"
+const U32 SEGMENT_VERSION = 1;
+const U32 RECORD_LIVE = 0x4c52564c;		// "LVRL"
+const U32 RECORD_DEAD = 0x4452564c;		// "LVRD"
+const U32 RECORD_ALIGN = 16;
+
+const U32 MIN_SEGMENT_SIZE = 8 * 1024 * 1024;
+const U32 MAX_SEGMENT_SIZE = 64 * 1024 * 1024;
+const U32 DEFAULT_MAX_SIZE = 1024 * 1024 * 1024;
+
+// Start evicting in the background above this fraction of the budget,
+// so that stores rarely have to evict inline.
+const F32 EVICT_HIGH_WATER = 0.9f;
+// Compact sealed segments once at least this fraction of them is dead.
+const F32 COMPACT_DEAD_RATIO = 0.5f;
+const U32 COMPACT_IDLE_MS = 250;
+const S32 EVACUATE_MAX_PASSES = 8;
+
+const S32 BLOCK_LENGTH_INVALID = -1;	// mLength for lock-only placeholders
+
+struct LLVFSLogSegmentHeader
+{
+	U32 mMagic;
+	U32 mVersion;
+	U32 mID;
+	U32 mTail;		// offset of the first unused byte
+	U32 mSealTime;	// 0 while the segment still takes appends
+	U32 mPad[3];
+};
+
+struct LLVFSLogRecord
+{
+	U32 mMagic;
+	U32 mSerial;	// newest copy wins if a crash left duplicates
+	U8  mFileID[UUID_BYTES];
+	S32 mType;
+	S32 mReserved;	// payload bytes following this header, fixes the record span
+	S32 mLength;	// max size of the vfile, at most mReserved
+	S32 mSize;		// bytes of payload written
+	U32 mAccessTime;
+	U32 mPad;
+};
+
+static inline U32 record_span(S32 length)
+{
+	U32 span = sizeof(LLVFSLogRecord) + (U32)length;
+	return (span + RECORD_ALIGN - 1) & ~(RECORD_ALIGN - 1);
+}
+
+static inline LLVFSLogSegmentHeader* segment_header(const LLVFSLogSegment* segment)
+{
+	return (LLVFSLogSegmentHeader*)segment->mFile.getData();
+}
+
+static inline LLVFSLogRecord* record_at(const LLVFSLogSegment* segment, U32 offset)
+{
+	return (LLVFSLogRecord*)(segment->mFile.getData() + offset);
+}
+
+static inline LLVFSFileSpecifier record_spec(const LLVFSLogRecord* record)
+{
+	LLUUID id;
+	memcpy(id.mData, record->mFileID, UUID_BYTES);		/* Flawfinder: ignore */
+	return LLVFSFileSpecifier(id, (LLAssetType::EType)record->mType);
+}
+
+//============================================================================
+
+U32 LLVFSLogSegment::getTail() const
+{
+	return segment_header(this)->mTail;
+}
+
+void LLVFSLogSegment::setTail(U32 tail)
+{
+	segment_header(this)->mTail = tail;
+}
+
+LLVFSLogEntry::LLVFSLogEntry()
+:	mSegment(NULL),
+	mOffset(0),
+	mLength(BLOCK_LENGTH_INVALID),
+	mSize(0),
+	mAccessTime((U32)time(NULL))
+{
+	for (S32 i = 0; i < (S32)VFSLOCK_COUNT; i++)
+	{
+		mLocks[i] = 0;
+	}
+}
+
+//============================================================================
+
+// Reclaims dead space and keeps the store under budget so that writers
+// normally never have to evict inline.
+class LLVFSLogCompactor : public LLThread
+{
+public:
+	LLVFSLogCompactor(LLVFSLogStore* store)
+	:	LLThread("VFS Compactor"),
+		mStore(store)
+	{
+	}
+
+	/*virtual*/ void run()
+	{
+		while (!isQuitting())
+		{
+			checkPause();
+			if (!mStore->compactStep())
+			{
+				ms_sleep(COMPACT_IDLE_MS);
+			}
+		}
+	}
+
+private:
+	LLVFSLogStore* mStore;
+};
+
+//============================================================================
+
+LLVFSLogStore::LLVFSLogStore(const std::string& segment_prefix, const BOOL read_only, const U32 max_size)
+:	mAllocMutex(new LLMutex(NULL)),
+	mActiveSegment(NULL),
+	mNextSegmentID(1),
+	mNextSerial(1),
+	mTotalBytes(0),
+	mEvicting(false),
+	mSegmentPrefix(segment_prefix),
+	mReadOnly(read_only),
+	mMaxBytes(max_size ? max_size : DEFAULT_MAX_SIZE),
+	mValid(VFSVALID_OK),
+	mCompactor(NULL)
+{
+	for (U32 i = 0; i < STRIPE_COUNT; i++)
+	{
+		mStripes[i].mMutex = new LLMutex(NULL);
+	}
+	for (S32 i = 0; i < (S32)VFSLOCK_COUNT; i++)
+	{
+		mLockCounts[i] = 0;
+	}
+
+	// Aim for about 16 segments, so evicting one costs a small slice of the cache.
+	mSegmentSize = llclamp((U32)(mMaxBytes / 16), MIN_SEGMENT_SIZE, MAX_SEGMENT_SIZE);
+
+	if (!loadSegments())
+	{
+		return;
+	}
+
+	if (!mReadOnly)
+	{
+		mCompactor = new LLVFSLogCompactor(this);
+		mCompactor->start();
+	}
+
+	LL_INFOS("VFS") << "Log-structured VFS " << mSegmentPrefix << ": " << mSegments.size()
+					<< " segments, " << (mTotalBytes >> 20) << " MB" << LL_ENDL;
+}
+
+LLVFSLogStore::~LLVFSLogStore()
+{
+	if (mCompactor)
+	{
+		mCompactor->shutdown();
+		delete mCompactor;
+		mCompactor = NULL;
+	}
+
+	for (segment_list_t::iterator it = mSegments.begin(); it != mSegments.end(); ++it)
+	{
+		LLVFSLogSegment* segment = *it;
+		segment->mFile.flush(false);
+		segment->mFile.close();
+		delete segment;
+	}
+	mSegments.clear();
+	mActiveSegment = NULL;
+
+	for (U32 i = 0; i < STRIPE_COUNT; i++)
+	{
+		mStripes[i].mEntries.clear();
+		delete mStripes[i].mMutex;
+		mStripes[i].mMutex = NULL;
+	}
+	delete mAllocMutex;
+}
+
+// static
+void LLVFSLogStore::removeSegments(const std::string& segment_prefix)
+{
+	std::string dir = gDirUtilp->getDirName(segment_prefix);
+	std::string base = gDirUtilp->getBaseFileName(segment_prefix);
+	gDirUtilp->deleteFilesInDir(dir, base + ".seg*");
+}
+
+U32 LLVFSLogStore::getStripeIndex(const LLVFSFileSpecifier& spec) const
+{
+	// Asset ids are random, so a couple of bytes spread well enough.
+	U32 hash = spec.mFileID.mData[0] | (spec.mFileID.mData[7] << 8);
+	return (hash + (U32)spec.mFileType) % STRIPE_COUNT;
+}
+
+LLVFSLogStore::Stripe& LLVFSLogStore::getStripe(const LLVFSFileSpecifier& spec)
+{
+	return mStripes[getStripeIndex(spec)];
+}
+
+//============================================================================
+// Segment management
+//============================================================================
+
+static bool segment_id_less(const LLVFSLogSegment* lhs, const LLVFSLogSegment* rhs)
+{
+	return lhs->mID < rhs->mID;
+}
+
+bool LLVFSLogStore::loadSegments()
+{
+	std::string dir = gDirUtilp->getDirName(mSegmentPrefix);
+	std::string base = gDirUtilp->getBaseFileName(mSegmentPrefix);
+
+	std::string filename;
+	LLDirIterator iter(dir, base + ".seg*");
+	while (iter.next(filename))
+	{
+		U32 id = 0;
+		if (sscanf(filename.substr(base.length()).c_str(), ".seg%x", &id) != 1 || !id)
+		{
+			continue;
+		}
+
+		LLVFSLogSegment* segment = new LLVFSLogSegment(id);
+		segment->mFilename = gDirUtilp->add(dir, filename);
+		LLVFSLogSegmentHeader* header = NULL;
+		if (segment->mFile.open(segment->mFilename, 0, mReadOnly) &&
+			segment->mFile.getSize() >= sizeof(LLVFSLogSegmentHeader))
+		{
+			header = segment_header(segment);
+		}
+
+		if (!header ||
+			header->mMagic != SEGMENT_MAGIC ||
+			header->mVersion != SEGMENT_VERSION ||
+			header->mTail < sizeof(LLVFSLogSegmentHeader) ||
+			header->mTail > segment->mFile.getSize())
+		{
+			LL_WARNS("VFS") << "Discarding bad VFS segment " << segment->mFilename << LL_ENDL;
+			segment->mFile.close();
+			if (!mReadOnly)
+			{
+				LLFile::remove(segment->mFilename);
+			}
+			delete segment;
+			continue;
+		}
+
+		segment->mSealTime = header->mSealTime;
+		mSegments.push_back(segment);
+		mTotalBytes += segment->mFile.getSize();
+		mNextSegmentID = llmax(mNextSegmentID, id + 1);
+	}
+
+	// Replay oldest first so later copies supersede earlier ones.
+	std::sort(mSegments.begin(), mSegments.end(), segment_id_less);
+
+	U32 max_serial = 0;
+	for (segment_list_t::iterator it = mSegments.begin(); it != mSegments.end(); ++it)
+	{
+		scanSegment(*it, max_serial);
+	}
+	mNextSerial = max_serial + 1;
+
+	// Keep appending to the segment that was active when we shut down.
+	if (!mSegments.empty() && !mSegments.back()->mSealTime && !mReadOnly)
+	{
+		mActiveSegment = mSegments.back();
+	}
+	for (segment_list_t::iterator it = mSegments.begin(); it != mSegments.end(); ++it)
+	{
+		LLVFSLogSegment* segment = *it;
+		if (segment != mActiveSegment && !segment->mSealTime)
+		{
+			segment->mSealTime = (U32)time(NULL);
+		}
+	}
+
+	if (mSegments.empty() && mReadOnly)
+	{
+		LL_WARNS("VFS") << "Can't find " << mSegmentPrefix << " segments to open read-only VFS" << LL_ENDL;
+		mValid = VFSVALID_BAD_CANNOT_OPEN_READONLY;
+		return false;
+	}
+	return true;
+}
+
+// Walks the records of one segment and merges them into the index.
+bool LLVFSLogStore::scanSegment(LLVFSLogSegment* segment, U32& max_serial)
+{
+	U32 tail = segment->getTail();
+	U32 offset = sizeof(LLVFSLogSegmentHeader);
+	U32 dead_bytes = 0;
+
+	while (offset + sizeof(LLVFSLogRecord) <= tail)
+	{
+		LLVFSLogRecord* record = record_at(segment, offset);
+		if ((record->mMagic != RECORD_LIVE && record->mMagic != RECORD_DEAD) ||
+			record->mReserved < 0 ||
+			offset + record_span(record->mReserved) > tail)
+		{
+			// Torn append from a crash.  Everything past here is garbage.
+			LL_WARNS("VFS") << "VFS segment " << segment->mID << " truncated at " << offset << LL_ENDL;
+			if (!mReadOnly)
+			{
+				segment->setTail(offset);
+			}
+			break;
+		}
+
+		U32 span = record_span(record->mReserved);
+		if (record->mMagic == RECORD_DEAD)
+		{
+			dead_bytes += span;
+			offset += span;
+			continue;
+		}
+
+		LLVFSFileSpecifier spec = record_spec(record);
+		if (spec.mFileID.isNull() ||
+			spec.mFileType < LLAssetType::AT_NONE ||
+			spec.mFileType >= LLAssetType::AT_COUNT ||
+			record->mLength < 0 ||
+			record->mLength > record->mReserved ||
+			record->mSize < 0 ||
+			record->mSize > record->mLength)
+		{
+			LL_WARNS("VFS") << "VFS corruption: " << spec.mFileID << " (" << spec.mFileType << ") in segment "
+							<< segment->mID << " at " << offset << LL_ENDL;
+			if (!mReadOnly)
+			{
+				record->mMagic = RECORD_DEAD;
+			}
+			dead_bytes += span;
+			offset += span;
+			continue;
+		}
+
+		max_serial = llmax(max_serial, record->mSerial);
+
+		entry_map_t& entries = getStripe(spec).mEntries;
+		entry_map_t::iterator it = entries.find(spec);
+		if (it != entries.end())
+		{
+			LLVFSLogEntry& existing = it->second;
+			if (record_at(existing.mSegment, existing.mOffset)->mSerial > record->mSerial)
+			{
+				// We already have a newer copy
+				killRecord(segment, offset);
+				offset += span;
+				continue;
+			}
+			killRecord(existing.mSegment, existing.mOffset);
+		}
+
+		LLVFSLogEntry& entry = entries[spec];
+		entry.mSegment = segment;
+		entry.mOffset = offset;
+		entry.mLength = record->mLength;
+		entry.mSize = record->mSize;
+		entry.mAccessTime = record->mAccessTime;
+
+		offset += span;
+	}
+
+	segment->mDeadBytes += dead_bytes;
+	return true;
+}
+
+// mAllocMutex must be LOCKED before calling this
+LLVFSLogSegment* LLVFSLogStore::createSegment(U32 min_size)
+{
+	U32 size = llmax(mSegmentSize, (U32)sizeof(LLVFSLogSegmentHeader) + min_size);
+
+	LLVFSLogSegment* segment = new LLVFSLogSegment(mNextSegmentID++);
+	segment->mFilename = mSegmentPrefix + llformat(".seg%08x", segment->mID);
+	if (!segment->mFile.open(segment->mFilename, size, FALSE))
+	{
+		LL_WARNS("VFS") << "Couldn't create VFS segment " << segment->mFilename << LL_ENDL;
+		delete segment;
+		return NULL;
+	}
+
+	LLVFSLogSegmentHeader* header = segment_header(segment);
+	header->mMagic = SEGMENT_MAGIC;
+	header->mVersion = SEGMENT_VERSION;
+	header->mID = segment->mID;
+	header->mTail = sizeof(LLVFSLogSegmentHeader);
+	header->mSealTime = 0;
+
+	mSegments.push_back(segment);
+	mTotalBytes += segment->mFile.getSize();
+	return segment;
+}
+
+// Deletes a segment that no longer holds any live records.
+void LLVFSLogStore::retireSegment(LLVFSLogSegment* segment)
+{
+	{
+		LLMutexLock lock(mAllocMutex);
+		segment_list_t::iterator it = std::find(mSegments.begin(), mSegments.end(), segment);
+		if (it == mSegments.end())
+		{
+			return;
+		}
+		mSegments.erase(it);
+		mTotalBytes -= segment->mFile.getSize();
+		if (segment == mActiveSegment)
+		{
+			mActiveSegment = NULL;
+		}
+	}
+
+	// No entry points here any more, so no new readers can show up.
+	// Wait for the ones still copying out of the mapping.
+	while (segment->mPins.CurrentValue() > 0)
+	{
+		ms_sleep(1);
+	}
+
+	segment->mFile.close();
+	LLFile::remove(segment->mFilename);
+	delete segment;
+}
+
+//============================================================================
+// Records
+//============================================================================
+
+bool LLVFSLogStore::allocateRecord(const LLVFSFileSpecifier& spec, S32 length,
+								   LLVFSLogSegment*& segment, U32& offset)
+{
+	LLMutexLock lock(mAllocMutex);
+
+	U32 span = record_span(length);
+	if (!mActiveSegment ||
+		mActiveSegment->getTail() + span > mActiveSegment->mFile.getSize())
+	{
+		if (mActiveSegment)
+		{
+			mActiveSegment->mSealTime = (U32)time(NULL);
+			segment_header(mActiveSegment)->mSealTime = mActiveSegment->mSealTime;
+			mActiveSegment->mFile.flush();
+		}
+		mActiveSegment = createSegment(span);
+		if (!mActiveSegment)
+		{
+			return false;
+		}
+	}
+
+	segment = mActiveSegment;
+	offset = segment->getTail();
+
+	LLVFSLogRecord* record = record_at(segment, offset);
+	record->mMagic = RECORD_LIVE;
+	record->mSerial = mNextSerial++;
+	memcpy(record->mFileID, spec.mFileID.mData, UUID_BYTES);	/* Flawfinder: ignore */
+	record->mType = spec.mFileType;
+	record->mReserved = length;
+	record->mLength = length;
+	record->mSize = 0;
+	record->mAccessTime = (U32)time(NULL);
+
+	segment->setTail(offset + span);
+
+	// Over budget: the compactor didn't keep up, so evict inline.
+	if (mTotalBytes > mMaxBytes && !mEvicting)
+	{
+		mEvicting = true;
+		size_t attempts = mSegments.size();
+		while (mTotalBytes > mMaxBytes && attempts-- > 0)
+		{
+			evictOldest();
+		}
+		mEvicting = false;
+	}
+
+	return true;
+}
+
+void LLVFSLogStore::killRecord(LLVFSLogSegment* segment, U32 offset)
+{
+	LLVFSLogRecord* record = record_at(segment, offset);
+	if (!mReadOnly && record->mMagic == RECORD_LIVE)
+	{
+		record->mMagic = RECORD_DEAD;
+		segment->mDeadBytes += record_span(record->mReserved);
+	}
+}
+
+// Stripe mutex must be LOCKED before calling this
+void LLVFSLogStore::updateRecordSize(const LLVFSLogEntry& entry)
+{
+	LLVFSLogRecord* record = record_at(entry.mSegment, entry.mOffset);
+	record->mSize = entry.mSize;
+	record->mAccessTime = entry.mAccessTime;
+}
+
+U8* LLVFSLogStore::getRecordData(LLVFSLogSegment* segment, U32 offset) const
+{
+	return segment->mFile.getData() + offset + sizeof(LLVFSLogRecord);
+}
+
+bool LLVFSLogStore::removeEntry(entry_map_t& entries, entry_map_t::iterator it)
+{
+	LLVFSLogEntry& entry = it->second;
+	if (entry.mSegment)
+	{
+		killRecord(entry.mSegment, entry.mOffset);
+		entry.mSegment = NULL;
+		entry.mOffset = 0;
+	}
+	entry.mLength = BLOCK_LENGTH_INVALID;
+	entry.mSize = 0;
+
+	for (S32 i = 0; i < (S32)VFSLOCK_COUNT; i++)
+	{
+		if (entry.mLocks[i])
+		{
+			// Keep a placeholder so the locks survive
+			return false;
+		}
+	}
+	entries.erase(it);
+	return true;
+}
+
+bool LLVFSLogStore::relocateRecord(const LLVFSFileSpecifier& spec, LLVFSLogSegment* segment, U32 offset)
+{
+	Stripe& stripe = getStripe(spec);
+
+	S32 length = 0;
+	{
+		LLMutexLock lock(stripe.mMutex);
+		entry_map_t::iterator it = stripe.mEntries.find(spec);
+		if (it == stripe.mEntries.end() ||
+			it->second.mSegment != segment ||
+			it->second.mOffset != offset)
+		{
+			// Already moved or removed
+			return true;
+		}
+		length = it->second.mLength;
+	}
+
+	// Can't hold the stripe while allocating, so check again afterwards.
+	LLVFSLogSegment* new_segment = NULL;
+	U32 new_offset = 0;
+	bool allocated = allocateRecord(spec, length, new_segment, new_offset);
+
+	LLMutexLock lock(stripe.mMutex);
+	entry_map_t::iterator it = stripe.mEntries.find(spec);
+	if (it == stripe.mEntries.end() ||
+		it->second.mSegment != segment ||
+		it->second.mOffset != offset ||
+		it->second.mLength > length)
+	{
+		if (allocated)
+		{
+			killRecord(new_segment, new_offset);
+		}
+		return true;
+	}
+
+	if (!allocated)
+	{
+		removeEntry(stripe.mEntries, it);
+		return false;
+	}
+
+	// Copy under the stripe lock so no write can slip in between.
+	LLVFSLogEntry& entry = it->second;
+	memcpy(getRecordData(new_segment, new_offset), getRecordData(segment, offset), entry.mSize);	/* Flawfinder: ignore */
+	killRecord(segment, offset);
+	entry.mSegment = new_segment;
+	entry.mOffset = new_offset;
+	entry.mLength = length;
+	updateRecordSize(entry);
+	return true;
+}
+
+void LLVFSLogStore::evacuateSegment(LLVFSLogSegment* segment, bool second_chance)
+{
+	// Segment is sealed, so its tail can't move under us.
+	const U32 tail = segment->getTail();
+	const U32 keep_budget = (U32)(segment->mFile.getSize() / 2);
+	U32 kept = 0;
+	bool live_left = true;
+
+	for (S32 pass = 0; live_left && pass < EVACUATE_MAX_PASSES; pass++)
+	{
+		live_left = false;
+		U32 offset = sizeof(LLVFSLogSegmentHeader);
+		while (offset + sizeof(LLVFSLogRecord) <= tail)
+		{
+			LLVFSLogRecord* record = record_at(segment, offset);
+			U32 span = record_span(record->mReserved);
+			if (record->mMagic != RECORD_LIVE)
+			{
+				offset += span;
+				continue;
+			}
+
+			// A rename can rewrite the header while we look at it, in which
+			// case the lookup misses and the next pass picks it up.
+			LLVFSFileSpecifier spec = record_spec(record);
+			bool keep = true;
+			if (second_chance)
+			{
+				Stripe& stripe = getStripe(spec);
+				LLMutexLock lock(stripe.mMutex);
+				entry_map_t::iterator it = stripe.mEntries.find(spec);
+				if (it != stripe.mEntries.end() &&
+					it->second.mSegment == segment &&
+					it->second.mOffset == offset)
+				{
+					LLVFSLogEntry& entry = it->second;
+					bool locked = entry.mLocks[VFSLOCK_OPEN] || entry.mLocks[VFSLOCK_READ] || entry.mLocks[VFSLOCK_APPEND];
+					bool recent = entry.mAccessTime > segment->mSealTime && kept < keep_budget;
+					keep = locked || recent;
+					if (!keep)
+					{
+						removeEntry(stripe.mEntries, it);
+					}
+				}
+			}
+
+			if (keep)
+			{
+				relocateRecord(spec, segment, offset);
+				kept += span;
+			}
+
+			if (record->mMagic == RECORD_LIVE)
+			{
+				live_left = true;
+			}
+			offset += span;
+		}
+	}
+
+	if (live_left)
+	{
+		LL_WARNS("VFS") << "VFS segment " << segment->mID << " still has live records, not retiring it" << LL_ENDL;
+		LLMutexLock lock(mAllocMutex);
+		segment->mEvacuating = false;
+		return;
+	}
+	retireSegment(segment);
+}
+
+void LLVFSLogStore::evictOldest()
+{
+	LLVFSLogSegment* oldest = NULL;
+	{
+		// Skip a segment the compactor is already working on
+		LLMutexLock lock(mAllocMutex);
+		for (segment_list_t::iterator it = mSegments.begin(); it != mSegments.end(); ++it)
+		{
+			if (*it != mActiveSegment && !(*it)->mEvacuating)
+			{
+				oldest = *it;
+				oldest->mEvacuating = true;
+				break;
+			}
+		}
+	}
+	if (!oldest)
+	{
+		return;
+	}
+
+	LL_DEBUGS("VFS") << "Evicting VFS segment " << oldest->mID << LL_ENDL;
+	evacuateSegment(oldest, true);
+}
+
+bool LLVFSLogStore::compactStep()
+{
+	bool over_budget = false;
+	{
+		LLMutexLock lock(mAllocMutex);
+		over_budget = mTotalBytes > (U64)(mMaxBytes * EVICT_HIGH_WATER) && mSegments.size() > 1;
+	}
+	if (over_budget)
+	{
+		evictOldest();
+		return true;
+	}
+
+	LLVFSLogSegment* candidate = NULL;
+	{
+		LLMutexLock lock(mAllocMutex);
+		F32 worst = COMPACT_DEAD_RATIO;
+		for (segment_list_t::iterator it = mSegments.begin(); it != mSegments.end(); ++it)
+		{
+			LLVFSLogSegment* segment = *it;
+			if (segment == mActiveSegment || segment->mEvacuating)
+			{
+				continue;
+			}
+			F32 dead = (F32)segment->mDeadBytes.CurrentValue() / (F32)segment->mFile.getSize();
+			if (dead >= worst)
+			{
+				worst = dead;
+				candidate = segment;
+			}
+		}
+		if (candidate)
+		{
+			candidate->mEvacuating = true;
+		}
+	}
+
+	if (!candidate)
+	{
+		return false;
+	}
+
+	LL_DEBUGS("VFS") << "Compacting VFS segment " << candidate->mID << LL_ENDL;
+	evacuateSegment(candidate, false);
+	return true;
+}
+
+//============================================================================
+// LLVFS interface
+//============================================================================
+
+BOOL LLVFSLogStore::getExists(const LLUUID &file_id, const LLAssetType::EType file_type)
+{
+	LLVFSFileSpecifier spec(file_id, file_type);
+	Stripe& stripe = getStripe(spec);
+	LLMutexLock lock(stripe.mMutex);
+
+	entry_map_t::iterator it = stripe.mEntries.find(spec);
+	if (it == stripe.mEntries.end())
+	{
+		return FALSE;
+	}
+	it->second.mAccessTime = (U32)time(NULL);
+	return it->second.mLength > 0 ? TRUE : FALSE;
+}
+
+S32 LLVFSLogStore::getSize(const LLUUID &file_id, const LLAssetType::EType file_type)
+{
+	LLVFSFileSpecifier spec(file_id, file_type);
+	Stripe& stripe = getStripe(spec);
+	LLMutexLock lock(stripe.mMutex);
+
+	entry_map_t::iterator it = stripe.mEntries.find(spec);
+	if (it == stripe.mEntries.end())
+	{
+		return 0;
+	}
+	it->second.mAccessTime = (U32)time(NULL);
+	return it->second.mSize;
+}
+
+S32 LLVFSLogStore::getMaxSize(const LLUUID &file_id, const LLAssetType::EType file_type)
+{
+	LLVFSFileSpecifier spec(file_id, file_type);
+	Stripe& stripe = getStripe(spec);
+	LLMutexLock lock(stripe.mMutex);
+
+	entry_map_t::iterator it = stripe.mEntries.find(spec);
+	if (it == stripe.mEntries.end())
+	{
+		return 0;
+	}
+	it->second.mAccessTime = (U32)time(NULL);
+	return it->second.mLength;
+}
+
+BOOL LLVFSLogStore::checkAvailable(S32 max_size)
+{
+	// Eviction can always make room for anything that fits the budget.
+	return (max_size > 0 && (U64)max_size < mMaxBytes) ? TRUE : FALSE;
+}
+
+BOOL LLVFSLogStore::setMaxSize(const LLUUID &file_id, const LLAssetType::EType file_type, S32 max_size)
+{
+	LLVFSFileSpecifier spec(file_id, file_type);
+	Stripe& stripe = getStripe(spec);
+
+	{
+		LLMutexLock lock(stripe.mMutex);
+		entry_map_t::iterator it = stripe.mEntries.find(spec);
+		if (it != stripe.mEntries.end() && it->second.mSegment)
+		{
+			LLVFSLogEntry& entry = it->second;
+			entry.mAccessTime = (U32)time(NULL);
+
+			if (max_size == entry.mLength)
+			{
+				return TRUE;
+			}
+			if (max_size < entry.mLength)
+			{
+				// Shrinking in place.  The record keeps its reserved span, the
+				// rest is reclaimed when the segment gets compacted.
+				if (entry.mSize > max_size)
+				{
+					// JC: Was a warning, but Ian says it's bad.
+					LL_ERRS() << "Truncating virtual file " << file_id << " to " << max_size << " bytes" << LL_ENDL;
+					entry.mSize = max_size;
+				}
+				entry.mLength = max_size;
+				record_at(entry.mSegment, entry.mOffset)->mLength = max_size;
+				updateRecordSize(entry);
+				return TRUE;
+			}
+
+			// Growing.  If we are the last record in the active segment,
+			// just push the tail out.  Only try the allocator lock, since
+			// allocation takes the stripe locks in the other order.
+			LLMutexTrylock alloc_lock(mAllocMutex);
+			if (alloc_lock.isLocked() && entry.mSegment == mActiveSegment)
+			{
+				LLVFSLogRecord* record = record_at(entry.mSegment, entry.mOffset);
+				U32 tail = mActiveSegment->getTail();
+				U32 new_end = entry.mOffset + record_span(max_size);
+				if (entry.mOffset + record_span(record->mReserved) == tail &&
+					new_end <= mActiveSegment->mFile.getSize())
+				{
+					mActiveSegment->setTail(new_end);
+					record->mReserved = max_size;
+					record->mLength = max_size;
+					entry.mLength = max_size;
+					return TRUE;
+				}
+			}
+		}
+	}
+
+	// Need a fresh record.  Allocate without holding the stripe, then
+	// install it, carrying over whatever was already written.
+	LLVFSLogSegment* segment = NULL;
+	U32 offset = 0;
+	if (!allocateRecord(spec, max_size, segment, offset))
+	{
+		LL_WARNS() << "VFS: No space (" << max_size << ") for virtual file " << file_id << LL_ENDL;
+		return FALSE;
+	}
+
+	LLMutexLock lock(stripe.mMutex);
+	LLVFSLogEntry& entry = stripe.mEntries[spec];
+	if (entry.mSegment)
+	{
+		if (entry.mLength >= max_size)
+		{
+			// Someone else grew it while we were allocating
+			killRecord(segment, offset);
+			return TRUE;
+		}
+		memcpy(getRecordData(segment, offset), getRecordData(entry.mSegment, entry.mOffset), entry.mSize);	/* Flawfinder: ignore */
+		killRecord(entry.mSegment, entry.mOffset);
+	}
+	else
+	{
+		entry.mSize = 0;
+	}
+	entry.mSegment = segment;
+	entry.mOffset = offset;
+	entry.mLength = max_size;
+	entry.mAccessTime = (U32)time(NULL);
+	updateRecordSize(entry);
+	return TRUE;
+}
+
+// The locks move with the file, same as the block allocator.
+void LLVFSLogStore::renameFile(const LLUUID &file_id, const LLAssetType::EType file_type,
+							   const LLUUID &new_id, const LLAssetType::EType &new_type)
+{
+	LLVFSFileSpecifier old_spec(file_id, file_type);
+	LLVFSFileSpecifier new_spec(new_id, new_type);
+	Stripe& old_stripe = getStripe(old_spec);
+	Stripe& new_stripe = getStripe(new_spec);
+
+	// Always lock stripes in address order
+	LLMutex* first = old_stripe.mMutex < new_stripe.mMutex ? old_stripe.mMutex : new_stripe.mMutex;
+	LLMutex* second = old_stripe.mMutex < new_stripe.mMutex ? new_stripe.mMutex : old_stripe.mMutex;
+	LLMutexLock lock_first(first);
+	LLMutexLock lock_second(second == first ? NULL : second);
+
+	entry_map_t::iterator it = old_stripe.mEntries.find(old_spec);
+	if (it == old_stripe.mEntries.end())
+	{
+		LL_WARNS() << "VFS: Attempt to rename nonexistent vfile " << file_id << ":" << file_type << LL_ENDL;
+		return;
+	}
+
+	entry_map_t::iterator dest = new_stripe.mEntries.find(new_spec);
+	if (dest != new_stripe.mEntries.end())
+	{
+		for (S32 i = 0; i < (S32)VFSLOCK_COUNT; i++)
+		{
+			if (dest->second.mLocks[i])
+			{
+				LL_ERRS() << "Renaming VFS block to a locked file." << LL_ENDL;
+			}
+		}
+		if (dest->second.mSegment)
+		{
+			killRecord(dest->second.mSegment, dest->second.mOffset);
+		}
+		new_stripe.mEntries.erase(dest);
+	}
+
+	LLVFSLogEntry entry = it->second;
+	old_stripe.mEntries.erase(it);
+	entry.mAccessTime = (U32)time(NULL);
+	if (entry.mSegment)
+	{
+		LLVFSLogRecord* record = record_at(entry.mSegment, entry.mOffset);
+		memcpy(record->mFileID, new_id.mData, UUID_BYTES);		/* Flawfinder: ignore */
+		record->mType = new_type;
+	}
+	new_stripe.mEntries[new_spec] = entry;
+}
+
+void LLVFSLogStore::removeFile(const LLUUID &file_id, const LLAssetType::EType file_type)
+{
+	LLVFSFileSpecifier spec(file_id, file_type);
+	Stripe& stripe = getStripe(spec);
+	LLMutexLock lock(stripe.mMutex);
+
+	entry_map_t::iterator it = stripe.mEntries.find(spec);
+	if (it == stripe.mEntries.end())
+	{
+		LL_WARNS() << "VFS: attempting to remove nonexistent file " << file_id << " type " << file_type << LL_ENDL;
+		return;
+	}
+	removeEntry(stripe.mEntries, it);
+}
+
+S32 LLVFSLogStore::getData(const LLUUID &file_id, const LLAssetType::EType file_type, U8 *buffer, S32 location, S32 length)
+{
+	llassert(location >= 0);
+	llassert(length >= 0);
+
+	LLVFSFileSpecifier spec(file_id, file_type);
+	Stripe& stripe = getStripe(spec);
+
+	LLVFSLogSegment* segment = NULL;
+	const U8* src = NULL;
+	{
+		LLMutexLock lock(stripe.mMutex);
+		entry_map_t::iterator it = stripe.mEntries.find(spec);
+		if (it == stripe.mEntries.end() || !it->second.mSegment)
+		{
+			return 0;
+		}
+
+		LLVFSLogEntry& entry = it->second;
+		entry.mAccessTime = (U32)time(NULL);
+		if (location > entry.mSize)
+		{
+			LL_WARNS() << "VFS: Attempt to read location " << location << " in file " << file_id << " of length " << entry.mSize << LL_ENDL;
+			return 0;
+		}
+		length = llmin(length, entry.mSize - location);
+
+		// Pin the segment so it outlives the copy even if the compactor
+		// moves this record meanwhile.
+		segment = entry.mSegment;
+		segment->mPins++;
+		src = getRecordData(segment, entry.mOffset) + location;
+	}
+
+	memcpy(buffer, src, length);		/* Flawfinder: ignore */
+	segment->mPins--;
+
+	return length;
+}
+
+S32 LLVFSLogStore::storeData(const LLUUID &file_id, const LLAssetType::EType file_type, const U8 *buffer, S32 location, S32 length)
+{
+	llassert(length > 0);
+
+	LLVFSFileSpecifier spec(file_id, file_type);
+	Stripe& stripe = getStripe(spec);
+	LLMutexLock lock(stripe.mMutex);
+
+	entry_map_t::iterator it = stripe.mEntries.find(spec);
+	if (it == stripe.mEntries.end())
+	{
+		return 0;
+	}
+
+	LLVFSLogEntry& entry = it->second;
+	S32 in_loc = location;
+	if (location == -1)
+	{
+		location = entry.mSize;
+	}
+	llassert(location >= 0);
+
+	entry.mAccessTime = (U32)time(NULL);
+
+	if (!entry.mSegment)
+	{
+		// Block was removed, ignore write
+		LL_WARNS() << "VFS: Attempt to write to invalid block"
+				<< " in file " << file_id
+				<< " location: " << in_loc
+				<< " bytes: " << length
+				<< LL_ENDL;
+		return length;
+	}
+	if (location > entry.mLength)
+	{
+		LL_WARNS() << "VFS: Attempt to write to location " << location
+				<< " in file " << file_id
+				<< " type " << S32(file_type)
+				<< " of size " << entry.mSize
+				<< " block length " << entry.mLength
+				<< LL_ENDL;
+		return length;
+	}
+	if (length > entry.mLength - location)
+	{
+		LL_WARNS() << "VFS: Truncating write to virtual file " << file_id << " type " << S32(file_type) << LL_ENDL;
+		length = entry.mLength - location;
+	}
+
+	// Written under the stripe lock so a concurrent relocation can't copy a
+	// half written record.
+	memcpy(getRecordData(entry.mSegment, entry.mOffset) + location, buffer, length);	/* Flawfinder: ignore */
+	if (location + length > entry.mSize)
+	{
+		entry.mSize = location + length;
+	}
+	updateRecordSize(entry);
+
+	return length;
+}
+
+void LLVFSLogStore::incLock(const LLUUID &file_id, const LLAssetType::EType file_type, EVFSLock lock)
+{
+	LLVFSFileSpecifier spec(file_id, file_type);
+	Stripe& stripe = getStripe(spec);
+	LLMutexLock stripe_lock(stripe.mMutex);
+
+	// Creates a placeholder if the file doesn't exist yet
+	stripe.mEntries[spec].mLocks[lock]++;
+	mLockCounts[lock]++;
+}
+
+void LLVFSLogStore::decLock(const LLUUID &file_id, const LLAssetType::EType file_type, EVFSLock lock)
+{
+	LLVFSFileSpecifier spec(file_id, file_type);
+	Stripe& stripe = getStripe(spec);
+	LLMutexLock stripe_lock(stripe.mMutex);
+
+	entry_map_t::iterator it = stripe.mEntries.find(spec);
+	if (it == stripe.mEntries.end())
+	{
+		return;
+	}
+
+	LLVFSLogEntry& entry = it->second;
+	if (entry.mLocks[lock] > 0)
+	{
+		entry.mLocks[lock]--;
+	}
+	else
+	{
+		LL_WARNS() << "VFS: Decrementing zero-value lock " << lock << LL_ENDL;
+	}
+	mLockCounts[lock]--;
+
+	if (!entry.mSegment)
+	{
+		// Drops the placeholder once the last lock is gone
+		removeEntry(stripe.mEntries, it);
+	}
+}
+
+BOOL LLVFSLogStore::isLocked(const LLUUID &file_id, const LLAssetType::EType file_type, EVFSLock lock)
+{
+	LLVFSFileSpecifier spec(file_id, file_type);
+	Stripe& stripe = getStripe(spec);
+	LLMutexLock stripe_lock(stripe.mMutex);
+
+	entry_map_t::iterator it = stripe.mEntries.find(spec);
+	return (it != stripe.mEntries.end() && it->second.mLocks[lock] > 0) ? TRUE : FALSE;
+}
+
+void LLVFSLogStore::prefetch()
+{
+	LLMutexLock lock(mAllocMutex);
+	for (segment_list_t::iterator it = mSegments.begin(); it != mSegments.end(); ++it)
+	{
+		LLVFSLogSegment* segment = *it;
+		segment->mFile.prefetch(0, segment->getTail());
+	}
+}
+
+void LLVFSLogStore::flush()
+{
+	LLMutexLock lock(mAllocMutex);
+	for (segment_list_t::iterator it = mSegments.begin(); it != mSegments.end(); ++it)
+	{
+		(*it)->mFile.flush();
+	}
+}
+
+void LLVFSLogStore::dumpStatistics()
+{
+	S32 file_count = 0;
+	S32 placeholder_count = 0;
+	U64 total_file_size = 0;
+	for (U32 i = 0; i < STRIPE_COUNT; i++)
+	{
+		LLMutexLock lock(mStripes[i].mMutex);
+		for (entry_map_t::iterator it = mStripes[i].mEntries.begin(); it != mStripes[i].mEntries.end(); ++it)
+		{
+			if (it->second.mSegment)
+			{
+				file_count++;
+				total_file_size += it->second.mLength;
+			}
+			else
+			{
+				placeholder_count++;
+			}
+		}
+	}
+
+	LLMutexLock lock(mAllocMutex);
+	U64 total_dead = 0;
+	for (segment_list_t::iterator it = mSegments.begin(); it != mSegments.end(); ++it)
+	{
+		LLVFSLogSegment* segment = *it;
+		total_dead += segment->mDeadBytes.CurrentValue();
+		LL_INFOS() << "Segment: " << segment->mID
+				<< "\tSize: " << segment->mFile.getSize()
+				<< "\tTail: " << segment->getTail()
+				<< "\tDead: " << segment->mDeadBytes.CurrentValue()
+				<< (segment == mActiveSegment ? "\tactive" : "")
+				<< LL_ENDL;
+	}
+
+	LL_INFOS() << "Placeholder blocks: " << placeholder_count << LL_ENDL;
+	LL_INFOS() << "File blocks:    " << file_count << LL_ENDL;
+	LL_INFOS() << "Segments:       " << mSegments.size() << LL_ENDL;
+	LL_INFOS() << "Total file size: " << (total_file_size >> 10) << "K" << LL_ENDL;
+	LL_INFOS() << "Total dead size: " << (total_dead >> 10) << "K" << LL_ENDL;
+	LL_INFOS() << "Total segment size: " << (mTotalBytes >> 10) << "K of " << (mMaxBytes >> 10) << "K" << LL_ENDL;
+}
+
+void LLVFSLogStore::listFiles()
+{
+	for (U32 i = 0; i < STRIPE_COUNT; i++)
+	{
+		LLMutexLock lock(mStripes[i].mMutex);
+		for (entry_map_t::iterator it = mStripes[i].mEntries.begin(); it != mStripes[i].mEntries.end(); ++it)
+		{
+			if (it->second.mSegment && it->second.mSize > 0)
+			{
+				LL_INFOS() << " File: " << it->first.mFileID
+						<< " Type: " << LLAssetType::getDesc(it->first.mFileType)
+						<< " Size: " << it->second.mSize
+						<< LL_ENDL;
+			}
+		}
+	}
+}
@@ -0,0 +1,193 @@
+/**
+ * @file llvfslogstore.h
+ * @brief Log-structured, memory-mapped backend for LLVFS
+ *
+ * $LicenseInfo:firstyear=2014&license=viewerlgpl$
+ * Second Life Viewer Source Code
+ * Copyright (C) 2014, Linden Research, Inc.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation;
+ * version 2.1 of the License only.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ * Linden Research, Inc., 945 Battery Street, San Francisco, CA  94111  USA
+ * $/LicenseInfo$
+ */
+
+#ifndef LL_LLVFSLOGSTORE_H
+#define LL_LLVFSLOGSTORE_H
+
+#include <map>
+#include <vector>
+#include "llvfs.h"
+#include "llmappedfile.h"
+
+class LLVFSLogCompactor;
+
+// One segment file.  Segments are created at full size and only ever
+// appended to, so their mapping never moves while the segment is alive.
+class LLVFSLogSegment
+{
+public:
+	LLVFSLogSegment(U32 id) : mID(id), mPins(0), mDeadBytes(0), mSealTime(0), mEvacuating(false) {}
+
+	U32 getTail() const;
+	void setTail(U32 tail);
+
+public:
+	U32				mID;
+	std::string		mFilename;
+	LLMappedFile	mFile;
+	LLAtomicS32		mPins;		// readers currently copying out of the mapping
+	LLAtomicU32		mDeadBytes;	// bytes in removed or superseded records
+	U32				mSealTime;	// when the segment stopped taking appends, 0 while active
+	bool			mEvacuating;	// claimed for compaction or eviction, guarded by mAllocMutex
+};
+
+// In-memory index entry for one vfile.
+struct LLVFSLogEntry
+{
+	LLVFSLogEntry();
+
+	LLVFSLogSegment* mSegment;	// NULL for lock-only placeholders
+	U32	mOffset;				// of the record header within mSegment
+	S32	mLength;				// max size of the vfile
+	S32	mSize;					// bytes written
+	U32	mAccessTime;
+	S32	mLocks[VFSLOCK_COUNT];
+};
+
+/**
+ * Asset store that appends records to fixed size, memory-mapped segment
+ * files instead of carving a single data file into free blocks.
+ *
+ * - The index is split into stripes, each with its own mutex, so unrelated
+ *   vfiles rarely contend.  Reads copy out of the mapping with no lock held;
+ *   writes copy in under their stripe lock.
+ * - Space is allocated by bumping the tail of the active segment.
+ * - Removed or moved records leave holes that a background thread reclaims
+ *   by copying the live records of mostly-dead segments to the tail.
+ * - When over budget the oldest segment is evicted.  Records that are locked
+ *   or were read since the segment filled up get a second chance at the tail.
+ *
+ * The record headers live in the segments, so the index is rebuilt by
+ * walking them at startup and no separate index file is maintained.
+ */
+class LLVFSLogStore
+{
+public:
+	LLVFSLogStore(const std::string& segment_prefix, const BOOL read_only, const U32 max_size);
+	~LLVFSLogStore();
+
+	// Deletes all segment files of a store that is not open.
+	static void removeSegments(const std::string& segment_prefix);
+
+	EVFSValid getValidState() const	{ return mValid; }
+
+	BOOL getExists(const LLUUID &file_id, const LLAssetType::EType file_type);
+	S32	 getSize(const LLUUID &file_id, const LLAssetType::EType file_type);
+	S32  getMaxSize(const LLUUID &file_id, const LLAssetType::EType file_type);
+	BOOL checkAvailable(S32 max_size);
+	BOOL setMaxSize(const LLUUID &file_id, const LLAssetType::EType file_type, S32 max_size);
+
+	void renameFile(const LLUUID &file_id, const LLAssetType::EType file_type,
+		const LLUUID &new_id, const LLAssetType::EType &new_type);
+	void removeFile(const LLUUID &file_id, const LLAssetType::EType file_type);
+
+	S32 getData(const LLUUID &file_id, const LLAssetType::EType file_type, U8 *buffer, S32 location, S32 length);
+	S32 storeData(const LLUUID &file_id, const LLAssetType::EType file_type, const U8 *buffer, S32 location, S32 length);
+
+	void incLock(const LLUUID &file_id, const LLAssetType::EType file_type, EVFSLock lock);
+	void decLock(const LLUUID &file_id, const LLAssetType::EType file_type, EVFSLock lock);
+	BOOL isLocked(const LLUUID &file_id, const LLAssetType::EType file_type, EVFSLock lock);
+
+	// Asks the OS to read ahead all segments.
+	void prefetch();
+	// Schedule dirty pages for write back.
+	void flush();
+
+	// Called by the compactor thread.  Returns true if it did any work.
+	bool compactStep();
+
+	void dumpStatistics();
+	void listFiles();
+
+	S32 getLockCount(EVFSLock lock) const	{ return mLockCounts[lock].CurrentValue(); }
+
+private:
+	typedef std::map<LLVFSFileSpecifier, LLVFSLogEntry> entry_map_t;
+
+	struct Stripe
+	{
+		Stripe() : mMutex(NULL) {}
+		LLMutex*	mMutex;
+		entry_map_t	mEntries;
+	};
+
+	Stripe& getStripe(const LLVFSFileSpecifier& spec);
+	U32 getStripeIndex(const LLVFSFileSpecifier& spec) const;
+
+	bool loadSegments();
+	bool scanSegment(LLVFSLogSegment* segment, U32& max_serial);
+	LLVFSLogSegment* createSegment(U32 min_size);
+	void retireSegment(LLVFSLogSegment* segment);
+
+	// Reserves a record with room for length bytes of payload and writes its
+	// header.  May evict old segments.  Never call with a stripe mutex held.
+	bool allocateRecord(const LLVFSFileSpecifier& spec, S32 length,
+						LLVFSLogSegment*& segment, U32& offset);
+	void killRecord(LLVFSLogSegment* segment, U32 offset);
+	void updateRecordSize(const LLVFSLogEntry& entry);
+	U8* getRecordData(LLVFSLogSegment* segment, U32 offset) const;
+
+	// Copies the record at segment/offset to the tail if it is still the live
+	// copy of spec.  Returns false if the record was dropped instead.
+	bool relocateRecord(const LLVFSFileSpecifier& spec, LLVFSLogSegment* segment, U32 offset);
+
+	// Empties a claimed segment of live records and deletes it.  If
+	// second_chance is set, locked and recently used records are moved to
+	// the tail and the rest are dropped; otherwise every live record is moved.
+	void evacuateSegment(LLVFSLogSegment* segment, bool second_chance);
+	void evictOldest();
+
+	// Drop the data for an entry, keeping a lock-only placeholder if needed.
+	// Stripe mutex must be held.  Returns true if the entry was erased.
+	bool removeEntry(entry_map_t& entries, entry_map_t::iterator it);
+
+private:
+	static const U32 STRIPE_COUNT = 64;
+	Stripe				mStripes[STRIPE_COUNT];
+
+	// Guards mSegments, mActiveSegment and the tail of the active segment.
+	// Recursive, and always taken before any stripe mutex.
+	LLMutex*			mAllocMutex;
+	typedef std::vector<LLVFSLogSegment*> segment_list_t;
+	segment_list_t		mSegments;		// oldest first
+	LLVFSLogSegment*	mActiveSegment;
+	U32					mNextSegmentID;
+	U32					mNextSerial;
+	U64					mTotalBytes;
+	bool				mEvicting;
+
+	std::string			mSegmentPrefix;
+	BOOL				mReadOnly;
+	U64					mMaxBytes;
+	U32					mSegmentSize;
+	EVFSValid			mValid;
+
+	LLAtomicS32			mLockCounts[VFSLOCK_COUNT];
+
+	LLVFSLogCompactor*	mCompactor;
+};
+
+#endif // LL_LLVFSLOGSTORE_H
@@ -0,0 +1,146 @@
+/**
+ * @file llvfslogstore_test.cpp
+ * @date 2014-09
+ * @brief LLVFSLogStore test cases.
+ *
+ * $LicenseInfo:firstyear=2014&license=viewerlgpl$
+ * Second Life Viewer Source Code
+ * Copyright (C) 2014, Linden Research, Inc.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation;
+ * version 2.1 of the License only.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ * Linden Research, Inc., 945 Battery Street, San Francisco, CA  94111  USA
+ * $/LicenseInfo$
+ */
+
+#include "linden_common.h"
+
+#include "../lldir.h"
+#include "../llvfslogstore.h"
+
+#include "../test/lltut.h"
+
+namespace tut
+{
+	struct LLVFSLogStoreFixture
+	{
+		LLVFSLogStoreFixture()
+		{
+			mPrefix = gDirUtilp->add(LLFile::tmpdir(), llformat("llvfslogstore_test_%u", (U32)time(NULL)));
+			LLVFSLogStore::removeSegments(mPrefix);
+		}
+
+		~LLVFSLogStoreFixture()
+		{
+			LLVFSLogStore::removeSegments(mPrefix);
+		}
+
+		std::vector<U8> pattern(S32 size, U8 seed)
+		{
+			std::vector<U8> data(size);
+			for (S32 i = 0; i < size; i++)
+			{
+				data[i] = (U8)(seed + i * 7);
+			}
+			return data;
+		}
+
+		std::string mPrefix;
+	};
+	typedef test_group<LLVFSLogStoreFixture> LLVFSLogStoreTest_factory;
+	typedef LLVFSLogStoreTest_factory::object LLVFSLogStoreTest_t;
+	LLVFSLogStoreTest_factory tf("LLVFSLogStore");
+
+	template<> template<>
+	void LLVFSLogStoreTest_t::test<1>()
+	{
+		set_test_name("store, grow and read back");
+
+		LLVFSLogStore store(mPrefix, FALSE, 0);
+		ensure_equals("valid", store.getValidState(), VFSVALID_OK);
+
+		LLUUID id;
+		id.generate();
+		ensure("missing", !store.getExists(id, LLAssetType::AT_MESH));
+
+		std::vector<U8> data = pattern(5000, 3);
+		ensure("reserve", store.setMaxSize(id, LLAssetType::AT_MESH, 2000));
+		ensure_equals("first write", store.storeData(id, LLAssetType::AT_MESH, &data[0], 0, 2000), 2000);
+
+		// Growing moves the record, the first 2000 bytes must come along
+		ensure("grow", store.setMaxSize(id, LLAssetType::AT_MESH, 5000));
+		ensure_equals("append", store.storeData(id, LLAssetType::AT_MESH, &data[2000], -1, 3000), 3000);
+		ensure_equals("size", store.getSize(id, LLAssetType::AT_MESH), 5000);
+
+		std::vector<U8> out(5000);
+		ensure_equals("read", store.getData(id, LLAssetType::AT_MESH, &out[0], 0, 5000), 5000);
+		ensure("contents", out == data);
+
+		ensure_equals("partial read", store.getData(id, LLAssetType::AT_MESH, &out[0], 4000, 5000), 1000);
+	}
+
+	template<> template<>
+	void LLVFSLogStoreTest_t::test<2>()
+	{
+		set_test_name("rename, remove and locks");
+
+		LLVFSLogStore store(mPrefix, FALSE, 0);
+
+		LLUUID id, new_id;
+		id.generate();
+		new_id.generate();
+		std::vector<U8> data = pattern(100, 11);
+		store.setMaxSize(id, LLAssetType::AT_ANIMATION, 100);
+		store.storeData(id, LLAssetType::AT_ANIMATION, &data[0], 0, 100);
+
+		store.renameFile(id, LLAssetType::AT_ANIMATION, new_id, LLAssetType::AT_ANIMATION);
+		ensure("old name gone", !store.getExists(id, LLAssetType::AT_ANIMATION));
+		ensure_equals("new name", store.getSize(new_id, LLAssetType::AT_ANIMATION), 100);
+
+		store.incLock(new_id, LLAssetType::AT_ANIMATION, VFSLOCK_READ);
+		store.removeFile(new_id, LLAssetType::AT_ANIMATION);
+		ensure("removed", !store.getExists(new_id, LLAssetType::AT_ANIMATION));
+		ensure("lock survives removal", store.isLocked(new_id, LLAssetType::AT_ANIMATION, VFSLOCK_READ));
+		store.decLock(new_id, LLAssetType::AT_ANIMATION, VFSLOCK_READ);
+		ensure("unlocked", !store.isLocked(new_id, LLAssetType::AT_ANIMATION, VFSLOCK_READ));
+	}
+
+	template<> template<>
+	void LLVFSLogStoreTest_t::test<3>()
+	{
+		set_test_name("index is rebuilt from the segments");
+
+		LLUUID kept, removed;
+		kept.generate();
+		removed.generate();
+		std::vector<U8> data = pattern(3000, 5);
+		{
+			LLVFSLogStore store(mPrefix, FALSE, 0);
+			store.setMaxSize(kept, LLAssetType::AT_TEXTURE, 3000);
+			store.storeData(kept, LLAssetType::AT_TEXTURE, &data[0], 0, 3000);
+			store.setMaxSize(removed, LLAssetType::AT_TEXTURE, 10);
+			store.storeData(removed, LLAssetType::AT_TEXTURE, &data[0], 0, 10);
+			store.removeFile(removed, LLAssetType::AT_TEXTURE);
+		}
+
+		LLVFSLogStore store(mPrefix, FALSE, 0);
+		ensure("removed stays removed", !store.getExists(removed, LLAssetType::AT_TEXTURE));
+		ensure_equals("kept size", store.getSize(kept, LLAssetType::AT_TEXTURE), 3000);
+
+		std::vector<U8> out(3000);
+		store.getData(kept, LLAssetType::AT_TEXTURE, &out[0], 0, 3000);
+		ensure("kept contents", out == data);
+	}
+}
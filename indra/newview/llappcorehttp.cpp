@@ -30,6 +30,7 @@
 
 #include "llappviewer.h"
 #include "llviewercontrol.h"
+#include "lltrace.h"
 
 
 // Here is where we begin to get our connection usage under control.
@@ -40,6 +41,39 @@
 // be open at a time.
 
 const F64 LLAppCoreHttp::MAX_THREAD_WAIT_TIME(10.0);
+
+// LLTrace view of one policy class, names are <prefix>_<stat>
+struct HttpTraceStats
+{
+	HttpTraceStats(const std::string & prefix)
+		: mActive((prefix + "_active").c_str(), "HTTP requests in flight"),
+		  mQueued((prefix + "_queued").c_str(), "HTTP requests waiting for a connection"),
+		  mPipeliningDepth((prefix + "_pipelining").c_str(), "HTTP pipelining depth in effect"),
+		  mConnectionsOpened((prefix + "_connects").c_str(), "HTTP requests that opened a connection"),
+		  mConnectionsReused((prefix + "_reused").c_str(), "HTTP requests sent on an open connection"),
+		  mTLSHandshakes((prefix + "_tlshandshakes").c_str(), "TLS handshakes"),
+		  mBytesReceived((prefix + "_bytesin").c_str(), "HTTP bytes received"),
+		  mBytesSent((prefix + "_bytesout").c_str(), "HTTP bytes sent")
+	{}
+
+	LLTrace::SampleStatHandle<>				mActive;
+	LLTrace::SampleStatHandle<>				mQueued;
+	LLTrace::SampleStatHandle<>				mPipeliningDepth;
+	LLTrace::CountStatHandle<>				mConnectionsOpened;
+	LLTrace::CountStatHandle<>				mConnectionsReused;
+	LLTrace::CountStatHandle<>				mTLSHandshakes;
+	LLTrace::CountStatHandle<F64Bytes>		mBytesReceived;
+	LLTrace::CountStatHandle<F64Bytes>		mBytesSent;
+};
+
+static HttpTraceStats	http_stats_default("httpdefault"),
+						http_stats_texture("httptexture"),
+						http_stats_mesh1("httpmesh1"),
+						http_stats_mesh2("httpmesh2"),
+						http_stats_large_mesh("httplargemesh"),
+						http_stats_uploads("httpuploads"),
+						http_stats_long_poll("httplongpoll");
+
 static const struct
 {
 	LLAppCoreHttp::EAppPolicy	mPolicy;
@@ -47,44 +81,53 @@ static const struct
 	U32							mMin;
 	U32							mMax;
 	U32							mRate;
+	bool						mPipelined;
 	std::string					mKey;
 	const char *				mUsage;
+	HttpTraceStats *			mStats;
 } init_data[] =					//  Default and dynamic values for classes
 {
 	{
-		LLAppCoreHttp::AP_DEFAULT,			8,		8,		8,		0,
+		LLAppCoreHttp::AP_DEFAULT,			8,		8,		8,		0,		false,
 		"",
-		"other"
+		"other",
+		&http_stats_default
 	},
 	{
-		LLAppCoreHttp::AP_TEXTURE,			8,		1,		12,		0,
+		LLAppCoreHttp::AP_TEXTURE,			8,		1,		12,		0,		true,
 		"TextureFetchConcurrency",
-		"texture fetch"
+		"texture fetch",
+		&http_stats_texture
 	},
 	{
-		LLAppCoreHttp::AP_MESH1,			32,		1,		128,	100,
+		LLAppCoreHttp::AP_MESH1,			32,		1,		128,	100,	false,
 		"MeshMaxConcurrentRequests",
-		"mesh fetch"
+		"mesh fetch",
+		&http_stats_mesh1
 	},
 	{
-		LLAppCoreHttp::AP_MESH2,			8,		1,		32,		100,
+		LLAppCoreHttp::AP_MESH2,			8,		1,		32,		100,	true,
 		"Mesh2MaxConcurrentRequests",
-		"mesh2 fetch"
+		"mesh2 fetch",
+		&http_stats_mesh2
 	},
 	{
-		LLAppCoreHttp::AP_LARGE_MESH,		2,		1,		8,		0,
+		LLAppCoreHttp::AP_LARGE_MESH,		2,		1,		8,		0,		true,
 		"",
-		"large mesh fetch"
+		"large mesh fetch",
+		&http_stats_large_mesh
 	},
 	{
-		LLAppCoreHttp::AP_UPLOADS,			2,		1,		8,		0,
+		LLAppCoreHttp::AP_UPLOADS,			2,		1,		8,		0,		false,
 		"",
-		"asset upload"
+		"asset upload",
+		&http_stats_uploads
 	},
 	{
-		LLAppCoreHttp::AP_LONG_POLL,		32,		32,		32,		0,
+		LLAppCoreHttp::AP_LONG_POLL,		32,		32,		32,		0,		false,
 		"",
-		"long poll"
+		"long poll",
+		&http_stats_long_poll
 	}
 };
 
@@ -101,6 +144,7 @@ LLAppCoreHttp::LLAppCoreHttp()
 	{
 		mPolicies[i] = LLCore::HttpRequest::DEFAULT_POLICY_ID;
 		mSettings[i] = 0U;
+		mPipelineDepths[i] = 0L;
 	}
 }
 
@@ -213,6 +257,8 @@ void LLAppCoreHttp::init()
 			}
 		}
 	}
+	mPipeliningSignal = gSavedSettings.getControl("FSHttpPipelining")->getCommitSignal()->connect(boost::bind(&setting_changed));
+	mPipeliningDepthSignal = gSavedSettings.getControl("FSHttpPipeliningDepth")->getCommitSignal()->connect(boost::bind(&setting_changed));
 }
 
 
@@ -265,6 +311,8 @@ void LLAppCoreHttp::cleanup()
 	{
 		mSettingsSignal[i].disconnect();
 	}
+	mPipeliningSignal.disconnect();
+	mPipeliningDepthSignal.disconnect();
 	
 	delete mRequest;
 	mRequest = NULL;
@@ -281,11 +329,41 @@ void LLAppCoreHttp::cleanup()
 void LLAppCoreHttp::refreshSettings(bool initial)
 {
 	LLCore::HttpStatus status;
+
+	// Classes that talk to the simhost's fetch caps pipeline when allowed
+	long pipeline_depth(0L);
+	if (gSavedSettings.getBOOL("FSHttpPipelining"))
+	{
+		pipeline_depth = long(llclamp(gSavedSettings.getU32("FSHttpPipeliningDepth"), 2U, 20U));
+	}
 	
 	for (int i(0); i < LL_ARRAY_SIZE(init_data); ++i)
 	{
 		const EAppPolicy policy(init_data[i].mPolicy);
 
+		const long depth(init_data[i].mPipelined ? pipeline_depth : 0L);
+		if (depth != mPipelineDepths[policy] && mPolicies[policy] != mPolicies[AP_DEFAULT])
+		{
+			LLCore::HttpHandle handle;
+			handle = mRequest->setPolicyOption(LLCore::HttpRequest::PO_PIPELINING_DEPTH,
+											   mPolicies[policy],
+											   depth, NULL);
+			if (LLCORE_HTTP_HANDLE_INVALID == handle)
+			{
+				status = mRequest->getStatus();
+				LL_WARNS("Init") << "Unable to set " << init_data[i].mUsage
+								 << " pipelining.  Reason:  " << status.toString()
+								 << LL_ENDL;
+			}
+			else
+			{
+				LL_INFOS("Init") << "Pipelining " << init_data[i].mUsage
+								 << " requests, depth:  " << depth
+								 << LL_ENDL;
+				mPipelineDepths[policy] = depth;
+			}
+		}
+
 		// Set any desired throttle
 		if (initial && init_data[i].mRate)
 		{
@@ -351,6 +429,41 @@ void LLAppCoreHttp::refreshSettings(bool initial)
 }
 
 
+void LLAppCoreHttp::updateStats()
+{
+	for (int i(0); i < LL_ARRAY_SIZE(init_data); ++i)
+	{
+		const EAppPolicy policy(init_data[i].mPolicy);
+
+		if (AP_DEFAULT != policy && mPolicies[policy] == mPolicies[AP_DEFAULT])
+		{
+			// Shares the default class, counted there
+			continue;
+		}
+
+		LLCore::HttpRequest::PolicyStats stats;
+		if (! LLCore::HttpRequest::getPolicyStats(mPolicies[policy], &stats))
+		{
+			continue;
+		}
+
+		HttpTraceStats & trace(*init_data[i].mStats);
+		LLCore::HttpRequest::PolicyStats & last(mLastStats[policy]);
+
+		sample(trace.mActive, F64(stats.mActive));
+		sample(trace.mQueued, F64(stats.mQueued));
+		sample(trace.mPipeliningDepth, F64(stats.mPipeliningDepth));
+		add(trace.mConnectionsOpened, F64(stats.mConnectionsOpened - last.mConnectionsOpened));
+		add(trace.mConnectionsReused, F64(stats.mConnectionsReused - last.mConnectionsReused));
+		add(trace.mTLSHandshakes, F64(stats.mTLSHandshakes - last.mTLSHandshakes));
+		add(trace.mBytesReceived, F64Bytes(F64(stats.mBytesReceived - last.mBytesReceived)));
+		add(trace.mBytesSent, F64Bytes(F64(stats.mBytesSent - last.mBytesSent)));
+
+		last = stats;
+	}
+}
+
+
 void LLAppCoreHttp::onCompleted(LLCore::HttpHandle, LLCore::HttpResponse *)
 {
 	mStopped = true;
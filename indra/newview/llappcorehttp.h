@@ -70,7 +70,7 @@ public:
 		/// Long poll:       no
 		/// Concurrency:     high
 		/// Request rate:    high
-		/// Pipelined:       soon
+		/// Pipelined:       yes
 		AP_TEXTURE,
 
 		/// Legacy mesh fetching policy class.  Used to
@@ -98,7 +98,7 @@ public:
 		/// Long poll:       no
 		/// Concurrency:     high
 		/// Request rate:    high
-		/// Pipelined:       soon
+		/// Pipelined:       yes
 		AP_MESH2,
 
 		/// Large mesh fetching policy class.  Used to
@@ -116,7 +116,7 @@ public:
 		/// Long poll:       no
 		/// Concurrency:     low
 		/// Request rate:    low
-		/// Pipelined:       soon
+		/// Pipelined:       yes
 		AP_LARGE_MESH,
 
 		/// Asset upload policy class.  Used to store
@@ -185,6 +185,10 @@ public:
 
 	// Apply initial or new settings from the environment.
 	void refreshSettings(bool initial);
+
+	// Feed the per-class connection and pipelining counters
+	// of the library into LLTrace.  Once per frame.
+	void updateStats();
 	
 private:
 	static const F64			MAX_THREAD_WAIT_TIME;
@@ -196,7 +200,11 @@ private:
 	bool						mStopped;
 	policy_t					mPolicies[AP_COUNT];			// Policy class id for each connection set
 	U32							mSettings[AP_COUNT];
+	long						mPipelineDepths[AP_COUNT];		// Depth last set, 0 when off
+	LLCore::HttpRequest::PolicyStats mLastStats[AP_COUNT];		// Totals at the last updateStats()
 	boost::signals2::connection mSettingsSignal[AP_COUNT];		// Signals to global settings that affect us
+	boost::signals2::connection mPipeliningSignal;
+	boost::signals2::connection mPipeliningDepthSignal;
 };
 
 
@@ -126,6 +126,7 @@
 #include "llurlentry.h"
 #include "llvfile.h"
 #include "llvfsthread.h"
+#include "llvfslogstore.h"
 #include "llvolumemgr.h"
 #include "llxfermanager.h"
 #include "llphysicsextensions.h"
@@ -160,6 +161,7 @@
 #include "lltexturecache.h"
 #include "lltexturefetch.h"
 #include "llimageworker.h"
+#include "llthreadpool.h"
 #include "llevents.h"
 
 // The files below handle dependencies from cleanup.
@@ -480,6 +482,8 @@ void init_default_trans_args()
 // File scope definitons
 const char *VFS_DATA_FILE_BASE = "data.db2.x.";
 const char *VFS_INDEX_FILE_BASE = "index.db2.x.";
+const char *VFS_LOG_DATA_FILE_BASE = "asset_store";
+const char *VFS_LOG_INDEX_FILE = "asset_store.idx";
 
 std::string gWindowTitle;
 
@@ -738,6 +742,7 @@ LLAppViewer* LLAppViewer::sInstance = NULL;
 LLTextureCache* LLAppViewer::sTextureCache = NULL; 
 LLImageDecodeThread* LLAppViewer::sImageDecodeThread = NULL; 
 LLTextureFetch* LLAppViewer::sTextureFetch = NULL; 
+LLThreadPool* LLAppViewer::sThreadPool = NULL;
 
 std::string getRuntime()
 {
@@ -2407,6 +2412,9 @@ bool LLAppViewer::cleanup()
     sTextureFetch = NULL;
 	delete sImageDecodeThread;
     sImageDecodeThread = NULL;
+	LLImageJ2C::setThreadPool(NULL);
+	delete sThreadPool;
+	sThreadPool = NULL;
 	delete mFastTimerLogThread;
 	mFastTimerLogThread = NULL;
 	
@@ -2531,8 +2539,20 @@ bool LLAppViewer::initThreads()
 	LLVFSThread::initClass(enable_threads && false);
 	LLLFSThread::initClass(enable_threads && false);
 
-	// Image decoding
-	LLAppViewer::sImageDecodeThread = new LLImageDecodeThread(enable_threads && true);
+	// Shared worker threads.  The texture cache and the LFS/VFS threads keep
+	// their own thread, their requests share state and the local APR pool.
+	S32 pool_size = gSavedSettings.getS32("FSThreadPoolSize");
+	if (pool_size <= 0)
+	{
+		pool_size = LLThreadPool::getDefaultThreadCount();
+	}
+	LLAppViewer::sThreadPool = new LLThreadPool("General", pool_size);
+
+	// Image decoding.  Besides decoding several images at once, large images
+	// have part of their decode split across the pool.
+	LLImageJ2C::setThreadPool(sThreadPool);
+	S32 decode_threads = llmax(gSavedSettings.getS32("FSImageDecodeThreads"), 0);
+	LLAppViewer::sImageDecodeThread = new LLImageDecodeThread(enable_threads && true, sThreadPool, decode_threads);
 	LLAppViewer::sTextureCache = new LLTextureCache(enable_threads && true);
 	LLAppViewer::sTextureFetch = new LLTextureFetch(LLAppViewer::getTextureCache(),
 													sImageDecodeThread,
@@ -4977,7 +4997,7 @@ U32 LLAppViewer::getObjectCacheVersion()
 {
 	// Viewer object cache version, change if object update
 	// format changes. JC
-	const U32 INDRA_OBJECT_CACHE_VERSION = 14;
+	const U32 INDRA_OBJECT_CACHE_VERSION = 15;
 
 	return INDRA_OBJECT_CACHE_VERSION;
 }
@@ -5230,8 +5250,24 @@ bool LLAppViewer::initCache()
 	// Startup the VFS...
 	gSavedSettings.setU32("VFSSalt", new_salt);
 
+	std::string log_vfs_data_file = gDirUtilp->getExpandedFilename(LL_PATH_CACHE, VFS_LOG_DATA_FILE_BASE);
+	std::string log_vfs_index_file = gDirUtilp->getExpandedFilename(LL_PATH_CACHE, VFS_LOG_INDEX_FILE);
+
 	// Don't remove VFS after viewer crashes.  If user has corrupt data, they can reinstall. JC
-	gVFS = LLVFS::createLLVFS(new_vfs_index_file, new_vfs_data_file, false, vfs_size_u32, false);
+	if (gSavedSettings.getBOOL("FSLogStructuredVFS"))
+	{
+		// The segment files have fixed names and the store evicts on its own
+		// when the size changes, so the salted files above are not used.
+		LLFile::remove(new_vfs_data_file);
+		LLFile::remove(new_vfs_index_file);
+		gVFS = LLVFS::createLLVFS(log_vfs_index_file, log_vfs_data_file, false, vfs_size_u32, false, true);
+	}
+	else
+	{
+		LLVFSLogStore::removeSegments(log_vfs_data_file);
+		LLFile::remove(log_vfs_index_file);
+		gVFS = LLVFS::createLLVFS(new_vfs_index_file, new_vfs_data_file, false, vfs_size_u32, false);
+	}
 	if (!gVFS)
 	{
 		return false;
@@ -5273,6 +5309,7 @@ void LLAppViewer::purgeCache()
 	LL_INFOS("AppCache") << "Purging Cache and Texture Cache..." << LL_ENDL;
 	LLAppViewer::getTextureCache()->purgeCache(LL_PATH_CACHE);
 	LLVOCache::getInstance()->removeCache(LL_PATH_CACHE);
+	LLMeshDecodeCache::purgeCache(LL_PATH_CACHE);
 	gDirUtilp->deleteFilesInDir(gDirUtilp->getExpandedFilename(LL_PATH_CACHE, ""), "*.*");
 }
 
@@ -5554,6 +5591,13 @@ void LLAppViewer::idle()
 	// here.
 	request_initial_instant_messages();
 
+	// Hand the region caches read on the cache thread to their regions,
+	// the first region handshake happens during startup.
+	if (LLVOCache::instanceExists())
+	{
+		LLVOCache::getInstance()->update();
+	}
+
 	///////////////////////////////////
 	//
 	// Special case idle if still starting up
@@ -38,6 +38,7 @@ class LLFrameTimer;
 class LLPumpIO;
 class LLTextureCache;
 class LLImageDecodeThread;
+class LLThreadPool;
 class LLTextureFetch;
 class LLWatchdogTimeout;
 class LLUpdaterService;
@@ -103,6 +104,7 @@ public:
 	static LLTextureCache* getTextureCache() { return sTextureCache; }
 	static LLImageDecodeThread* getImageDecodeThread() { return sImageDecodeThread; }
 	static LLTextureFetch* getTextureFetch() { return sTextureFetch; }
+	static LLThreadPool* getThreadPool() { return sThreadPool; }
 
 	static U32 getTextureCacheVersion() ;
 	static U32 getObjectCacheVersion() ;
@@ -280,6 +282,7 @@ private:
 	static LLTextureCache* sTextureCache; 
 	static LLImageDecodeThread* sImageDecodeThread; 
 	static LLTextureFetch* sTextureFetch;
+	static LLThreadPool* sThreadPool;
 
 	S32 mNumSessions;
 
@@ -32,6 +32,7 @@
 #include "llvoavatar.h"
 #include "m3math.h"
 #include "llmatrix4a.h"
+#include "llskinning.h"
 
 #include "llagent.h" //for gAgent.needsRenderAvatar()
 #include "lldrawable.h"
@@ -1713,74 +1714,18 @@ void LLDrawPoolAvatar::updateRiggedFaceVertexBuffer(LLVOAvatar* avatar, LLFace*
 		
 		//build matrix palette
 		LLMatrix4a mp[JOINT_COUNT];
-		LLMatrix4* mat = (LLMatrix4*) mp;
+		const LLMatrix4* joint_matrices[JOINT_COUNT];
 
 		U32 count = llmin((U32) skin->mJointNames.size(), (U32) JOINT_COUNT);
 		for (U32 j = 0; j < count; ++j)
 		{
 			LLJoint* joint = avatar->getJoint(skin->mJointNames[j]);
-			if (joint)
-			{
-				mat[j] = skin->mInvBindMatrix[j];
-				mat[j] *= joint->getWorldMatrix();
-			}
+			joint_matrices[j] = joint ? &joint->getWorldMatrix() : NULL;
 		}
 
-		LLMatrix4a bind_shape_matrix;
-		bind_shape_matrix.loadu(skin->mBindShapeMatrix);
-
-		for (U32 j = 0; j < buffer->getNumVerts(); ++j)
-		{
-			LLMatrix4a final_mat;
-			final_mat.clear();
-
-			S32 idx[4];
-
-			LLVector4 wght;
-
-			F32 scale = 0.f;
-			for (U32 k = 0; k < 4; k++)
-			{
-				F32 w = weight[j][k];
-
-				// <FS:ND> proper bounds checking, the maximum changed from 64 to 52(JOINT_COUNT).
-				// idx[k] = llclamp((S32) floorf(w), 0, 63);
-				idx[k] = llclamp((S32) floorf(w), 0, JOINT_COUNT-1);
-				// </FS:ND>
-
-				wght[k] = w - floorf(w);
-				scale += wght[k];
-			}
-
-			wght *= 1.f/scale;
-
-			for (U32 k = 0; k < 4; k++)
-			{
-				F32 w = wght[k];
-
-				LLMatrix4a src;
-				src.setMul(mp[idx[k]], w);
-
-				final_mat.add(src);
-			}
-
-			
-			LLVector4a& v = vol_face.mPositions[j];
-			LLVector4a t;
-			LLVector4a dst;
-			bind_shape_matrix.affineTransform(v, t);
-			final_mat.affineTransform(t, dst);
-			pos[j] = dst;
-
-			if (norm)
-			{
-				LLVector4a& n = vol_face.mNormals[j];
-				bind_shape_matrix.rotate(n, t);
-				final_mat.rotate(t, dst);
-				dst.normalize3fast();
-				norm[j] = dst;
-			}
-		}
+		S32 palette_size = LLSkinning::buildPalette(*skin, joint_matrices, count, mp);
+		LLSkinning::skinVertices(mp, palette_size, weight, vol_face.mPositions, norm ? vol_face.mNormals : NULL,
+								 buffer->getNumVerts(), pos, norm);
 	}
 }
 
@@ -159,6 +159,7 @@ void LLFace::init(LLDrawable* drawablep, LLViewerObject* objp)
 
 	mTextureMatrix = NULL;
 	mDrawInfo = NULL;
+	mGeometryStaging = NULL;
 
 	mFaceColor = LLColor4(1,0,0,1);
 
@@ -1151,6 +1152,93 @@ void push_for_transform(LLVertexBuffer* buff, U32 source_count, U32 dest_count)
 	}
 }
 
+// Room for the stores getGeometryVolume() makes a vector past the last vertex
+static const U32 STAGING_SLACK = 16;
+
+static U32 staging_array_size(U32 bytes)
+{
+	return ((bytes + 0xF) & ~0xF) + STAGING_SLACK;
+}
+
+LLFaceGeometryStaging::LLFaceGeometryStaging()
+:	mData(NULL),
+	mWrittenMask(0)
+{
+	memset(mOffsets, 0, sizeof(mOffsets));
+}
+
+//static
+U32 LLFaceGeometryStaging::calcSize(const LLFace* face)
+{
+	const LLVertexBuffer* buffer = face->getVertexBuffer();
+	U32 size = staging_array_size(face->getIndicesCount() * sizeof(U16));
+	for (S32 type = 0; type < LLVertexBuffer::TYPE_MAX; ++type)
+	{
+		if (buffer->hasDataType(type))
+		{
+			size += staging_array_size(LLVertexBuffer::sTypeSize[type] * face->getGeomCount());
+		}
+	}
+	return size;
+}
+
+void LLFaceGeometryStaging::setup(const LLFace* face, U8* data)
+{
+	const LLVertexBuffer* buffer = face->getVertexBuffer();
+	mData = data;
+	mWrittenMask = 0;
+
+	U32 offset = 0;
+	for (S32 type = 0; type < LLVertexBuffer::TYPE_MAX; ++type)
+	{
+		mOffsets[type] = offset;
+		if (buffer->hasDataType(type))
+		{
+			offset += staging_array_size(LLVertexBuffer::sTypeSize[type] * face->getGeomCount());
+		}
+	}
+	mOffsets[LLVertexBuffer::TYPE_MAX] = offset;
+	mOffsets[LLVertexBuffer::TYPE_INDEX] = offset;
+}
+
+void LLFaceGeometryStaging::upload(LLFace* face)
+{
+	LLVertexBuffer* buffer = face->getVertexBuffer();
+	for (S32 type = 0; type < LLVertexBuffer::TYPE_MAX; ++type)
+	{
+		if (mWrittenMask & (1 << type))
+		{
+			volatile U8* dst = buffer->mapVertexBuffer(type, face->getGeomIndex(), face->getGeomCount(), false);
+			if (dst)
+			{
+				memcpy((U8*) dst, mData + mOffsets[type], LLVertexBuffer::sTypeSize[type] * face->getGeomCount());
+			}
+		}
+	}
+
+	if (mWrittenMask & (1 << LLVertexBuffer::TYPE_INDEX))
+	{
+		volatile U8* dst = buffer->mapIndexBuffer(face->getIndicesStart(), face->getIndicesCount(), false);
+		if (dst)
+		{
+			memcpy((U8*) dst, mData + mOffsets[LLVertexBuffer::TYPE_INDEX], face->getIndicesCount() * sizeof(U16));
+		}
+	}
+
+	mWrittenMask = 0;
+}
+
+template <class T>
+bool LLFace::getStagedStrider(LLStrider<T>& strider, S32 type)
+{
+	if (!mGeometryStaging)
+	{
+		return false;
+	}
+	mGeometryStaging->getStrider(strider, type);
+	return true;
+}
+
 static LLTrace::BlockTimerStatHandle FTM_FACE_GET_GEOM("Face Geom");
 static LLTrace::BlockTimerStatHandle FTM_FACE_GEOM_POSITION("Position");
 static LLTrace::BlockTimerStatHandle FTM_FACE_GEOM_NORMAL("Normal");
@@ -1337,7 +1425,10 @@ BOOL LLFace::getGeometryVolume(const LLVolume& volume,
 	if (full_rebuild)
 	{
 		LL_RECORD_BLOCK_TIME(FTM_FACE_GEOM_INDEX);
-		mVertexBuffer->getIndexStrider(indicesp, mIndicesIndex, mIndicesCount, map_range);
+		if (!getStagedStrider(indicesp, LLVertexBuffer::TYPE_INDEX))
+		{
+			mVertexBuffer->getIndexStrider(indicesp, mIndicesIndex, mIndicesCount, map_range);
+		}
 
 		volatile __m128i* dst = (__m128i*) indicesp.get();
 		__m128i* src = (__m128i*) vf.mIndices;
@@ -1408,6 +1499,7 @@ BOOL LLFace::getGeometryVolume(const LLVolume& volume,
 
 #ifdef GL_TRANSFORM_FEEDBACK_BUFFER
 	if (use_transform_feedback &&
+		!mGeometryStaging &&
 		mVertexBuffer->getUsage() == GL_DYNAMIC_COPY_ARB &&
 		gTransformPositionProgram.mProgramObject && //transform shaders are loaded
 		mVertexBuffer->useVBOs() && //target buffer is in VRAM
@@ -1679,7 +1771,10 @@ BOOL LLFace::getGeometryVolume(const LLVolume& volume,
 
 			if (!do_bump)
 			{ //not bump mapped, might be able to do a cheap update
-				mVertexBuffer->getTexCoord0Strider(tex_coords0, mGeomIndex, mGeomCount);
+				if (!getStagedStrider(tex_coords0, LLVertexBuffer::TYPE_TEXCOORD0))
+				{
+					mVertexBuffer->getTexCoord0Strider(tex_coords0, mGeomIndex, mGeomCount);
+				}
 
 				if (texgen != LLTextureEntry::TEX_GEN_PLANAR)
 				{
@@ -1815,12 +1910,18 @@ BOOL LLFace::getGeometryVolume(const LLVolume& volume,
 					switch (ch)
 					{
 						case 0: 
-							mVertexBuffer->getTexCoord0Strider(dst, mGeomIndex, mGeomCount, map_range); 
+							if (!getStagedStrider(dst, LLVertexBuffer::TYPE_TEXCOORD0))
+							{
+								mVertexBuffer->getTexCoord0Strider(dst, mGeomIndex, mGeomCount, map_range);
+							}
 							break;
 						case 1:
 							if (mVertexBuffer->hasDataType(LLVertexBuffer::TYPE_TEXCOORD1))
 							{
-								mVertexBuffer->getTexCoord1Strider(dst, mGeomIndex, mGeomCount, map_range);
+								if (!getStagedStrider(dst, LLVertexBuffer::TYPE_TEXCOORD1))
+								{
+									mVertexBuffer->getTexCoord1Strider(dst, mGeomIndex, mGeomCount, map_range);
+								}
 								if (mat && !tex_anim)
 								{
 									r  = mat->getNormalRotation();
@@ -1840,7 +1941,10 @@ BOOL LLFace::getGeometryVolume(const LLVolume& volume,
 						case 2:
 							if (mVertexBuffer->hasDataType(LLVertexBuffer::TYPE_TEXCOORD2))
 							{
-								mVertexBuffer->getTexCoord2Strider(dst, mGeomIndex, mGeomCount, map_range);
+								if (!getStagedStrider(dst, LLVertexBuffer::TYPE_TEXCOORD2))
+								{
+									mVertexBuffer->getTexCoord2Strider(dst, mGeomIndex, mGeomCount, map_range);
+								}
 								if (mat && !tex_anim)
 								{
 									r  = mat->getSpecularRotation();
@@ -1906,7 +2010,10 @@ BOOL LLFace::getGeometryVolume(const LLVolume& volume,
 
 				if (!mat && do_bump)
 				{
-					mVertexBuffer->getTexCoord1Strider(tex_coords1, mGeomIndex, mGeomCount, map_range);
+					if (!getStagedStrider(tex_coords1, LLVertexBuffer::TYPE_TEXCOORD1))
+					{
+						mVertexBuffer->getTexCoord1Strider(tex_coords1, mGeomIndex, mGeomCount, map_range);
+					}
 		
 					for (S32 i = 0; i < num_vertices; i++)
 					{
@@ -1960,7 +2067,10 @@ BOOL LLFace::getGeometryVolume(const LLVolume& volume,
 			//LL_RECORD_TIME_BLOCK(FTM_FACE_GEOM_POSITION);
 			llassert(num_vertices > 0);
 		
-			mVertexBuffer->getVertexStrider(vert, mGeomIndex, mGeomCount, map_range);
+			if (!getStagedStrider(vert, LLVertexBuffer::TYPE_VERTEX))
+			{
+				mVertexBuffer->getVertexStrider(vert, mGeomIndex, mGeomCount, map_range);
+			}
 			
 			LLMatrix4a mat_vert;
 			mat_vert.loadu(mat_vert_in);
@@ -2053,7 +2163,10 @@ BOOL LLFace::getGeometryVolume(const LLVolume& volume,
 		if (rebuild_normal)
 		{
 			//LL_RECORD_TIME_BLOCK(FTM_FACE_GEOM_NORMAL);
-			mVertexBuffer->getNormalStrider(norm, mGeomIndex, mGeomCount, map_range);
+			if (!getStagedStrider(norm, LLVertexBuffer::TYPE_NORMAL))
+			{
+				mVertexBuffer->getNormalStrider(norm, mGeomIndex, mGeomCount, map_range);
+			}
 			F32* normals = (F32*) norm.get();
 			LLVector4a* src = vf.mNormals;
 			LLVector4a* end = src+num_vertices;
@@ -2075,7 +2188,10 @@ BOOL LLFace::getGeometryVolume(const LLVolume& volume,
 		if (rebuild_tangent)
 		{
 			LL_RECORD_BLOCK_TIME(FTM_FACE_GEOM_TANGENT);
-			mVertexBuffer->getTangentStrider(tangent, mGeomIndex, mGeomCount, map_range);
+			if (!getStagedStrider(tangent, LLVertexBuffer::TYPE_TANGENT))
+			{
+				mVertexBuffer->getTangentStrider(tangent, mGeomIndex, mGeomCount, map_range);
+			}
 			F32* tangents = (F32*) tangent.get();
 			
 			mVObjp->getVolume()->genTangents(f);
@@ -2108,7 +2224,10 @@ BOOL LLFace::getGeometryVolume(const LLVolume& volume,
 		if (rebuild_weights && vf.mWeights)
 		{
 			LL_RECORD_BLOCK_TIME(FTM_FACE_GEOM_WEIGHTS);
-			mVertexBuffer->getWeight4Strider(wght, mGeomIndex, mGeomCount, map_range);
+			if (!getStagedStrider(wght, LLVertexBuffer::TYPE_WEIGHT4))
+			{
+				mVertexBuffer->getWeight4Strider(wght, mGeomIndex, mGeomCount, map_range);
+			}
 			F32* weights = (F32*) wght.get();
 			LLVector4a::memcpyNonAliased16(weights, (F32*) vf.mWeights, num_vertices*4*sizeof(F32));
 			if (map_range)
@@ -2120,7 +2239,10 @@ BOOL LLFace::getGeometryVolume(const LLVolume& volume,
 		if (rebuild_color && mVertexBuffer->hasDataType(LLVertexBuffer::TYPE_COLOR) )
 		{
 			LL_RECORD_BLOCK_TIME(FTM_FACE_GEOM_COLOR);
-			mVertexBuffer->getColorStrider(colors, mGeomIndex, mGeomCount, map_range);
+			if (!getStagedStrider(colors, LLVertexBuffer::TYPE_COLOR))
+			{
+				mVertexBuffer->getColorStrider(colors, mGeomIndex, mGeomCount, map_range);
+			}
 
 			LLVector4a src;
 
@@ -2153,7 +2275,10 @@ BOOL LLFace::getGeometryVolume(const LLVolume& volume,
 		{
 			LL_RECORD_BLOCK_TIME(FTM_FACE_GEOM_EMISSIVE);
 			LLStrider<LLColor4U> emissive;
-			mVertexBuffer->getEmissiveStrider(emissive, mGeomIndex, mGeomCount, map_range);
+			if (!getStagedStrider(emissive, LLVertexBuffer::TYPE_EMISSIVE))
+			{
+				mVertexBuffer->getEmissiveStrider(emissive, mGeomIndex, mGeomCount, map_range);
+			}
 
 			U8 glow = (U8) llclamp((S32) (getTextureEntry()->getGlow()*255), 0, 255);
 
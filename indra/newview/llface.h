@@ -40,6 +40,7 @@
 #include "llviewertexture.h"
 #include "lldrawable.h"
 
+class LLFace;
 class LLFacePool;
 class LLVolume;
 class LLViewerTexture;
@@ -53,6 +54,38 @@ class LLDrawInfo;
 const F32 MIN_ALPHA_SIZE = 1024.f;
 const F32 MIN_TEX_ANIM_SIZE = 512.f;
 
+// Plain memory LLFace::getGeometryVolume() can write a face's vertices and
+// indices to instead of its vertex buffer, so it can run off the main
+// thread.  One array per data type of the buffer and one for indices, each
+// sized for the face's range of it.  upload() copies what was written into
+// the buffer.
+class LLFaceGeometryStaging
+{
+public:
+	LLFaceGeometryStaging();
+
+	// Bytes setup() takes for the face's current vertex buffer and counts
+	static U32 calcSize(const LLFace* face);
+	// data must be 16 byte aligned
+	void setup(const LLFace* face, U8* data);
+
+	// type may be LLVertexBuffer::TYPE_INDEX
+	template <class T> void getStrider(LLStrider<T>& strider, S32 type)
+	{
+		strider = (T*) (mData + mOffsets[type]);
+		strider.setStride(type == LLVertexBuffer::TYPE_INDEX ? 0 : LLVertexBuffer::sTypeSize[type]);
+		mWrittenMask |= 1 << type;
+	}
+
+	// Main thread only, maps the face's range of its vertex buffer
+	void upload(LLFace* face);
+
+private:
+	U8*		mData;
+	U32		mOffsets[LLVertexBuffer::TYPE_INDEX + 1];
+	U32		mWrittenMask;
+};
+
 class LLFace : public LLTrace::MemTrackableNonVirtual<LLFace, 16>
 {
 public:
@@ -167,6 +200,9 @@ public:
 						const LLMatrix4& mat_vert, const LLMatrix3& mat_normal,
 						const U16 &index_offset,
 						bool force_rebuild = false);
+	// While set, getGeometryVolume() writes to staging instead of the
+	// vertex buffer and touches nothing but this face
+	void setGeometryStaging(LLFaceGeometryStaging* staging) { mGeometryStaging = staging; }
 
 	// For avatar
 	U16			 getGeometryAvatar(
@@ -236,6 +272,7 @@ public: //aligned members
 private:	
 	F32         adjustPartialOverlapPixelArea(F32 cos_angle_to_view_dir, F32 radius );
 	BOOL        calcPixelArea(F32& cos_angle_to_view_dir, F32& radius) ;
+	template <class T> bool getStagedStrider(LLStrider<T>& strider, S32 type);
 public:
 	static F32 calcImportanceToCamera(F32 to_view_dir, F32 dist);
 	static F32 adjustPixelArea(F32 importance, F32 pixel_area) ;
@@ -257,6 +294,7 @@ public:
 
 private:
 	LLPointer<LLVertexBuffer> mVertexBuffer;
+	LLFaceGeometryStaging* mGeometryStaging;
 		
 	U32			mState;
 	LLFacePool*	mDrawPoolp;
@@ -67,9 +67,19 @@
 #include "aoengine.h"
 #include "fslslbridge.h"
 
+#include "llsdarena.h"
+#include "llsdserialize.h"
+#include "llthreadpool.h"
+#ifdef LL_STANDALONE
+#include <zlib.h>
+#else
+#include "zlib/zlib.h"
+#endif
+
 // Increment this if the inventory contents change in a non-backwards-compatible way.
 // For viewer 2, the addition of link items makes a pre-viewer-2 cache incorrect.
-const S32 LLInventoryModel::sCurrentInvCacheVersion = 2;
+// Version 3 is the binary cache, see saveToFile().
+const S32 LLInventoryModel::sCurrentInvCacheVersion = 3;
 BOOL LLInventoryModel::sFirstTimeInViewer2 = TRUE;
 
 ///----------------------------------------------------------------------------
@@ -77,7 +87,15 @@ BOOL LLInventoryModel::sFirstTimeInViewer2 = TRUE;
 ///----------------------------------------------------------------------------
 
 //BOOL decompress_file(const char* src_filename, const char* dst_filename);
-const char CACHE_FORMAT_STRING[] = "%s.inv"; 
+const char CACHE_FORMAT_STRING[] = "%s.inv.gz"; 
+
+// The cache file starts with this, then come sections of binary LLSD, each
+// after its size as four bytes, most significant first: a header map, an
+// array of all categories, arrays of up to CACHE_ITEMS_PER_SECTION items and
+// a size of zero to end it.
+const char CACHE_MAGIC[] = "<? LLSD/InvCache ?>\n";
+const S32 CACHE_ITEMS_PER_SECTION = 1000;
+const U32 CACHE_MAX_SECTION_SIZE = 64 * 1024 * 1024;
 
 struct InventoryIDPtrLess
 {
@@ -87,6 +105,270 @@ struct InventoryIDPtrLess
 	}
 };
 
+typedef std::set<LLPointer<LLViewerInventoryCategory>, InventoryIDPtrLess> cat_set_t;
+
+static bool write_cache_section(gzFile file, const LLSD& sd)
+{
+	std::ostringstream str;
+	LLSDSerialize::toBinary(sd, str);
+	const std::string& data = str.str();
+	U32 size = (U32)data.size();
+	U8 size_bytes[4] = { (U8)(size >> 24), (U8)(size >> 16), (U8)(size >> 8), (U8)size };
+	return gzwrite(file, size_bytes, 4) == 4
+		&& gzwrite(file, data.data(), size) == (S32)size;
+}
+
+// Size of the next section read into buffer, 0 at the end, -1 on errors.
+static S32 read_cache_section(gzFile file, std::vector<U8>& buffer)
+{
+	U8 size_bytes[4];
+	if (gzread(file, size_bytes, 4) != 4)
+	{
+		return -1;
+	}
+	U32 size = (size_bytes[0] << 24) | (size_bytes[1] << 16) | (size_bytes[2] << 8) | size_bytes[3];
+	if (size > CACHE_MAX_SECTION_SIZE)
+	{
+		return -1;
+	}
+	if (size > 0)
+	{
+		buffer.resize(size);
+		if (gzread(file, &buffer[0], size) != (S32)size)
+		{
+			return -1;
+		}
+	}
+	return (S32)size;
+}
+
+// Reads an inventory cache on a pool thread. The categories are handed over
+// in one go as soon as they are read, the items follow section by section.
+class LLInventoryCacheReader : public LLThreadPool::Task, public LLThreadSafeRefCount
+{
+public:
+	enum EState
+	{
+		READING_CATEGORIES,
+		READING_ITEMS,
+		DONE,
+		MISSING,	// no cache, or not readable
+		OBSOLETE	// old version or damaged
+	};
+
+	LLInventoryCacheReader(const std::string& filename, S32 version)
+	:	mFilename(filename),
+		mVersion(version),
+		mCondition(NULL),
+		mState(READING_CATEGORIES)
+	{
+	}
+
+	// Holds a reference while queued, the pool does not delete tasks.
+	void start(LLThreadPool* pool)
+	{
+		ref();
+		if (pool)
+		{
+			pool->submit(this, LLThreadPool::BAND_HIGH);
+		}
+		else
+		{
+			run();
+		}
+	}
+
+	/*virtual*/ void run()
+	{
+		setState(read());
+		unref();
+	}
+
+	// Waits for the categories, false if there are none to be had.
+	bool takeCategories(LLInventoryModel::cat_array_t& categories)
+	{
+		LLMutexLock lock(&mCondition);
+		while (mState == READING_CATEGORIES)
+		{
+			mCondition.wait();
+		}
+		categories.swap(mCategories);
+		return mState == READING_ITEMS || mState == DONE;
+	}
+
+	// Takes the oldest section of items read so far, false once every
+	// section is taken.
+	bool takeItems(LLInventoryModel::item_array_t& items)
+	{
+		LLMutexLock lock(&mCondition);
+		if (!mItems.empty())
+		{
+			items.swap(mItems.front());
+			mItems.pop_front();
+			return true;
+		}
+		return mState == READING_ITEMS;
+	}
+
+	EState getState()
+	{
+		LLMutexLock lock(&mCondition);
+		return mState;
+	}
+
+private:
+	void setState(EState state)
+	{
+		LLMutexLock lock(&mCondition);
+		mState = state;
+		mCondition.broadcast();
+	}
+
+	EState read();
+	bool parseSection(const std::vector<U8>& buffer, S32 size, LLSD& sd);
+
+	std::string mFilename;
+	S32 mVersion;
+	LLCondition mCondition;
+	EState mState;
+	LLInventoryModel::cat_array_t mCategories;
+	std::deque<LLInventoryModel::item_array_t> mItems;
+};
+
+bool LLInventoryCacheReader::parseSection(const std::vector<U8>& buffer, S32 size, LLSD& sd)
+{
+	// Most of the values go away as soon as the section is read
+	LLSDArena arena;
+	LLSDArena::Scope scope(arena);
+	return LLSDSerialize::fromBinary(sd, &buffer[0], size) > 0;
+}
+
+LLInventoryCacheReader::EState LLInventoryCacheReader::read()
+{
+	gzFile file = gzopen(mFilename.c_str(), "rb");
+	if (!file)
+	{
+		LL_INFOS() << "unable to load inventory from: " << mFilename << LL_ENDL;
+		return MISSING;
+	}
+	LL_INFOS() << "Reading inventory cache " << mFilename << LL_ENDL;
+
+	const S32 magic_size = sizeof(CACHE_MAGIC) - 1;
+	char magic[sizeof(CACHE_MAGIC)];
+	std::vector<U8> buffer;
+	LLSD header;
+	S32 size = 0;
+	if (gzread(file, magic, magic_size) != magic_size
+		|| memcmp(magic, CACHE_MAGIC, magic_size) != 0
+		|| (size = read_cache_section(file, buffer)) <= 0
+		|| !parseSection(buffer, size, header)
+		|| header["inv_cache_version"].asInteger() != mVersion)
+	{
+		// Obsolete until proven current
+		gzclose(file);
+		return OBSOLETE;
+	}
+
+	LLSD categories;
+	if ((size = read_cache_section(file, buffer)) <= 0
+		|| !parseSection(buffer, size, categories))
+	{
+		gzclose(file);
+		return OBSOLETE;
+	}
+	{
+		LLInventoryModel::cat_array_t cats;
+		cats.reserve(categories.size());
+		for (LLSD::array_const_iterator it = categories.beginArray(), end = categories.endArray();
+			 it != end; ++it)
+		{
+			LLPointer<LLViewerInventoryCategory> inv_cat = new LLViewerInventoryCategory(LLUUID::null);
+			if (inv_cat->importLLSD(*it))
+			{
+				cats.push_back(inv_cat);
+			}
+			else
+			{
+				LL_WARNS() << "Ignoring invalid inventory category: " << inv_cat->getName() << LL_ENDL;
+			}
+		}
+		categories.clear();
+
+		LLMutexLock lock(&mCondition);
+		mCategories.swap(cats);
+		mState = READING_ITEMS;
+		mCondition.broadcast();
+	}
+
+	while ((size = read_cache_section(file, buffer)) > 0)
+	{
+		LLSD items;
+		if (!parseSection(buffer, size, items))
+		{
+			size = -1;
+			break;
+		}
+		LLInventoryModel::item_array_t section;
+		section.reserve(items.size());
+		for (LLSD::array_const_iterator it = items.beginArray(), end = items.endArray();
+			 it != end; ++it)
+		{
+			LLPointer<LLViewerInventoryItem> inv_item = new LLViewerInventoryItem;
+			if (!inv_item->importLLSD(*it))
+			{
+				LL_WARNS() << "Ignoring invalid inventory item: " << inv_item->getName() << LL_ENDL;
+			}
+			else if (inv_item->getUUID().isNull())
+			{
+				// *FIX: Need a better solution, this prevents the
+				// application from freezing, but breaks inventory
+				// caching.
+				LL_WARNS() << "Ignoring inventory with null item id: "
+						<< inv_item->getName() << LL_ENDL;
+			}
+			else
+			{
+				section.push_back(inv_item);
+			}
+		}
+
+		LLMutexLock lock(&mCondition);
+		mItems.push_back(LLInventoryModel::item_array_t());
+		mItems.back().swap(section);
+	}
+	gzclose(file);
+
+	if (size < 0)
+	{
+		LL_WARNS() << "Inventory cache " << mFilename << " is damaged" << LL_ENDL;
+		return OBSOLETE;
+	}
+	return DONE;
+}
+
+// A cache being read, and what is needed to merge it with the skeleton sent
+// at login once all items are in.
+class LLInventoryModel::CacheLoad
+{
+public:
+	LLPointer<LLInventoryCacheReader> mReader;
+	std::string mFilename;
+	cat_set_t mCategories;		// from the skeleton
+	update_map_t mChildCounts;
+	item_array_t mPossibleBrokenLinks;
+	cat_set_t mInvalidCategories; // Used to mark categories that weren't successfully loaded.
+	S32 mCachedCategoryCount;
+	S32 mCachedItemCount;
+	S32 mGoodLinkCount;
+
+	CacheLoad()
+	:	mCachedCategoryCount(0),
+		mCachedItemCount(0),
+		mGoodLinkCount(0)
+	{
+	}
+};
+
 class LLCanCache : public LLInventoryCollectFunctor 
 {
 public:
@@ -173,6 +455,9 @@ LLInventoryModel::~LLInventoryModel()
 
 void LLInventoryModel::cleanupInventory()
 {
+	// Readers still running finish on their own
+	std::for_each(mCacheLoads.begin(), mCacheLoads.end(), DeletePointer());
+	mCacheLoads.clear();
 	empty();
 	// Deleting one observer might erase others from the list, so always pop off the front
 	while (!mObservers.empty())
@@ -1676,17 +1961,9 @@ void LLInventoryModel::cache(
 	agent_id.toString(agent_id_str);
 	std::string path(gDirUtilp->getExpandedFilename(LL_PATH_CACHE, agent_id_str));
 	inventory_filename = llformat(CACHE_FORMAT_STRING, path.c_str());
-	saveToFile(inventory_filename, categories, items);
-	std::string gzip_filename(inventory_filename);
-	gzip_filename.append(".gz");
-	if(gzip_file(inventory_filename, gzip_filename))
-	{
-		LL_DEBUGS() << "Successfully compressed " << inventory_filename << LL_ENDL;
-		LLFile::remove(inventory_filename);
-	}
-	else
+	if(saveToFile(inventory_filename, categories, items))
 	{
-		LL_WARNS() << "Unable to compress " << inventory_filename << LL_ENDL;
+		LL_DEBUGS() << "Successfully saved " << inventory_filename << LL_ENDL;
 	}
 }
 
@@ -1935,7 +2212,6 @@ bool LLInventoryModel::loadSkeleton(
 {
 	LL_DEBUGS() << "importing inventory skeleton for " << owner_id << LL_ENDL;
 
-	typedef std::set<LLPointer<LLViewerInventoryCategory>, InventoryIDPtrLess> cat_set_t;
 	cat_set_t temp_cats;
 	bool rv = true;
 
@@ -1975,56 +2251,35 @@ bool LLInventoryModel::loadSkeleton(
 		}
 	}
 
-	S32 cached_category_count = 0;
-	S32 cached_item_count = 0;
 	if(!temp_cats.empty())
 	{
-		update_map_t child_counts;
-		cat_array_t categories;
-		item_array_t items;
-		item_array_t possible_broken_links;
-		cat_set_t invalid_categories; // Used to mark categories that weren't successfully loaded.
+		CacheLoad* load = new CacheLoad;
+		load->mCategories.swap(temp_cats);
 		std::string owner_id_str;
 		owner_id.toString(owner_id_str);
 		std::string path(gDirUtilp->getExpandedFilename(LL_PATH_CACHE, owner_id_str));
-		std::string inventory_filename;
-		inventory_filename = llformat(CACHE_FORMAT_STRING, path.c_str());
+		load->mFilename = llformat(CACHE_FORMAT_STRING, path.c_str());
 		const S32 NO_VERSION = LLViewerInventoryCategory::VERSION_UNKNOWN;
-		std::string gzip_filename(inventory_filename);
-		gzip_filename.append(".gz");
-		LLFILE* fp = LLFile::fopen(gzip_filename, "rb");
-		bool remove_inventory_file = false;
-		if(fp)
-		{
-			fclose(fp);
-			fp = NULL;
-			if(gunzip_file(gzip_filename, inventory_filename))
-			{
-				// we only want to remove the inventory file if it was
-				// gzipped before we loaded, and we successfully
-				// gunziped it.
-				remove_inventory_file = true;
-			}
-			else
-			{
-				LL_INFOS() << "Unable to gunzip " << gzip_filename << LL_ENDL;
-			}
-		}
-		bool is_cache_obsolete = false;
-		if(loadFromFile(inventory_filename, categories, items, is_cache_obsolete))
+
+		// The categories come first in the cache, so only they are waited
+		// for here; the items are added by loadCachedItems() as they are read.
+		load->mReader = new LLInventoryCacheReader(load->mFilename, sCurrentInvCacheVersion);
+		load->mReader->start(LLAppViewer::getThreadPool());
+		cat_array_t categories;
+		if(load->mReader->takeCategories(categories))
 		{
 			// We were able to find a cache of files. So, use what we
 			// found to generate a set of categories we should add. We
 			// will go through each category loaded and if the version
 			// does not match, invalidate the version.
 			S32 count = categories.size();
-			cat_set_t::iterator not_cached = temp_cats.end();
+			cat_set_t::iterator not_cached = load->mCategories.end();
 			std::set<LLUUID> cached_ids;
 			for(S32 i = 0; i < count; ++i)
 			{
 				LLViewerInventoryCategory* cat = categories[i];
-				cat_set_t::iterator cit = temp_cats.find(cat);
-				if (cit == temp_cats.end())
+				cat_set_t::iterator cit = load->mCategories.find(cat);
+				if (cit == load->mCategories.end())
 				{
 					continue; // cache corruption?? not sure why this happens -SJB
 				}
@@ -2051,8 +2306,8 @@ bool LLInventoryModel::loadSkeleton(
 
 			// go ahead and add the cats returned during the download
 			std::set<LLUUID>::const_iterator not_cached_id = cached_ids.end();
-			cached_category_count = cached_ids.size();
-			for(cat_set_t::iterator it = temp_cats.begin(); it != temp_cats.end(); ++it)
+			load->mCachedCategoryCount = cached_ids.size();
+			for(cat_set_t::iterator it = load->mCategories.begin(); it != load->mCategories.end(); ++it)
 			{
 				if(cached_ids.find((*it)->getUUID()) == not_cached_id)
 				{
@@ -2063,146 +2318,192 @@ bool LLInventoryModel::loadSkeleton(
 					llvic->setVersion(NO_VERSION);
 				}
 				addCategory(*it);
-				++child_counts[(*it)->getParentUUID()];
+				++load->mChildCounts[(*it)->getParentUUID()];
 			}
-
-			// Add all the items loaded which are parented to a
-			// category with a correctly cached parent
-			S32 bad_link_count = 0;
-			S32 good_link_count = 0;
-			S32 recovered_link_count = 0;
-			cat_map_t::iterator unparented = mCategoryMap.end();
-			for(item_array_t::const_iterator item_iter = items.begin();
-				item_iter != items.end();
-				++item_iter)
-			{
-				LLViewerInventoryItem *item = (*item_iter).get();
-				const cat_map_t::iterator cit = mCategoryMap.find(item->getParentUUID());
-				
-				if(cit != unparented)
-				{
-					const LLViewerInventoryCategory* cat = cit->second.get();
-					if(cat->getVersion() != NO_VERSION)
-					{
-						// This can happen if the linked object's baseobj is removed from the cache but the linked object is still in the cache.
-						if (item->getIsBrokenLink())
-						{
-							//bad_link_count++;
-							LL_DEBUGS() << "Attempted to add cached link item without baseobj present ( name: "
-									 << item->getName() << " itemID: " << item->getUUID()
-									 << " assetID: " << item->getAssetUUID()
-									 << " ).  Ignoring and invalidating " << cat->getName() << " . " << LL_ENDL;
-							possible_broken_links.push_back(item);
-							continue;
-						}
-						else if (item->getIsLinkType())
-						{
-							good_link_count++;
-						}
-						addItem(item);
-						cached_item_count += 1;
-						++child_counts[cat->getUUID()];
-					}
-				}
-			}
-			if (possible_broken_links.size() > 0)
-			{
-				for(item_array_t::const_iterator item_iter = possible_broken_links.begin();
-				    item_iter != possible_broken_links.end();
-				    ++item_iter)
-				{
-					LLViewerInventoryItem *item = (*item_iter).get();
-					const cat_map_t::iterator cit = mCategoryMap.find(item->getParentUUID());
-					const LLViewerInventoryCategory* cat = cit->second.get();
-					if (item->getIsBrokenLink())
-					{
-						bad_link_count++;
-						invalid_categories.insert(cit->second);
-						//LL_INFOS() << "link still broken: " << item->getName() << " in folder " << cat->getName() << LL_ENDL;
-					}
-					else
-					{
-						// was marked as broken because of loading order, its actually fine to load
-						addItem(item);
-						cached_item_count += 1;
-						++child_counts[cat->getUUID()];
-						recovered_link_count++;
-					}
-				}
-
- 				LL_INFOS() << "Attempted to add " << bad_link_count
- 						<< " cached link items without baseobj present. "
-					    << good_link_count << " link items were successfully added. "
-					    << recovered_link_count << " links added in recovery. "
- 						<< "The corresponding categories were invalidated." << LL_ENDL;
-			}
-
 		}
 		else
 		{
 			// go ahead and add everything after stripping the version
 			// information.
-			for(cat_set_t::iterator it = temp_cats.begin(); it != temp_cats.end(); ++it)
+			for(cat_set_t::iterator it = load->mCategories.begin(); it != load->mCategories.end(); ++it)
 			{
 				LLViewerInventoryCategory *llvic = (*it);
 				llvic->setVersion(NO_VERSION);
 				addCategory(*it);
 			}
 		}
+		categories.clear(); // will unref and delete entries
+		mCacheLoads.push_back(load);
+	}
+
+	return rv;
+}
 
-		// Invalidate all categories that failed fetching descendents for whatever
-		// reason (e.g. one of the descendents was a broken link).
-		for (cat_set_t::iterator invalid_cat_it = invalid_categories.begin();
-			 invalid_cat_it != invalid_categories.end();
-			 invalid_cat_it++)
+bool LLInventoryModel::loadCachedItems(F32 max_time)
+{
+	LLTimer timer;
+	while(!mCacheLoads.empty() && timer.getElapsedTimeF32() < max_time)
+	{
+		bool waiting = true;
+		for(std::vector<CacheLoad*>::iterator it = mCacheLoads.begin(); it != mCacheLoads.end(); )
 		{
-			LLViewerInventoryCategory* cat = (*invalid_cat_it).get();
-			cat->setVersion(NO_VERSION);
-			LL_DEBUGS("Inventory") << "Invalidating category name: " << cat->getName() << " UUID: " << cat->getUUID() << " due to invalid descendents cache" << LL_ENDL;
+			CacheLoad* load = *it;
+			item_array_t items;
+			if(load->mReader->takeItems(items))
+			{
+				if(!items.empty())
+				{
+					addCachedItems(*load, items);
+					waiting = false;
+				}
+				++it;
+			}
+			else
+			{
+				finishCacheLoad(*load);
+				delete load;
+				it = mCacheLoads.erase(it);
+				waiting = false;
+			}
+		}
+		if(waiting)
+		{
+			// Nothing read yet, let the caller get on with other things
+			break;
 		}
-		LL_INFOS("Inventory") << "Invalidated " << invalid_categories.size() << " categories due to invalid descendents cache" << LL_ENDL;
+	}
+	return mCacheLoads.empty();
+}
 
-		// At this point, we need to set the known descendents for each
-		// category which successfully cached so that we do not
-		// needlessly fetch descendents for categories which we have.
-		update_map_t::const_iterator no_child_counts = child_counts.end();
-		for(cat_set_t::iterator it = temp_cats.begin(); it != temp_cats.end(); ++it)
+void LLInventoryModel::addCachedItems(CacheLoad& load, const item_array_t& items)
+{
+	// Add all the items loaded which are parented to a
+	// category with a correctly cached parent
+	const S32 NO_VERSION = LLViewerInventoryCategory::VERSION_UNKNOWN;
+	cat_map_t::iterator unparented = mCategoryMap.end();
+	for(item_array_t::const_iterator item_iter = items.begin();
+		item_iter != items.end();
+		++item_iter)
+	{
+		LLViewerInventoryItem *item = (*item_iter).get();
+		const cat_map_t::iterator cit = mCategoryMap.find(item->getParentUUID());
+		
+		if(cit != unparented)
 		{
-			LLViewerInventoryCategory* cat = (*it).get();
+			const LLViewerInventoryCategory* cat = cit->second.get();
 			if(cat->getVersion() != NO_VERSION)
 			{
-				update_map_t::const_iterator the_count = child_counts.find(cat->getUUID());
-				if(the_count != no_child_counts)
+				// This can happen if the linked object's baseobj is removed from the cache but the linked object is still in the cache.
+				if (item->getIsBrokenLink())
 				{
-					const S32 num_descendents = (*the_count).second.mValue;
-					cat->setDescendentCount(num_descendents);
+					LL_DEBUGS() << "Attempted to add cached link item without baseobj present ( name: "
+							 << item->getName() << " itemID: " << item->getUUID()
+							 << " assetID: " << item->getAssetUUID()
+							 << " ).  Ignoring and invalidating " << cat->getName() << " . " << LL_ENDL;
+					load.mPossibleBrokenLinks.push_back(item);
+					continue;
 				}
-				else
+				else if (item->getIsLinkType())
 				{
-					cat->setDescendentCount(0);
+					load.mGoodLinkCount++;
 				}
+				addItem(item);
+				load.mCachedItemCount += 1;
+				++load.mChildCounts[cat->getUUID()];
 			}
 		}
+	}
+}
 
-		if(remove_inventory_file)
+void LLInventoryModel::finishCacheLoad(CacheLoad& load)
+{
+	const S32 NO_VERSION = LLViewerInventoryCategory::VERSION_UNKNOWN;
+	bool is_cache_obsolete = (load.mReader->getState() == LLInventoryCacheReader::OBSOLETE);
+	if (load.mPossibleBrokenLinks.size() > 0)
+	{
+		S32 bad_link_count = 0;
+		S32 recovered_link_count = 0;
+		for(item_array_t::const_iterator item_iter = load.mPossibleBrokenLinks.begin();
+		    item_iter != load.mPossibleBrokenLinks.end();
+		    ++item_iter)
 		{
-			// clean up the gunzipped file.
-			LLFile::remove(inventory_filename);
+			LLViewerInventoryItem *item = (*item_iter).get();
+			const cat_map_t::iterator cit = mCategoryMap.find(item->getParentUUID());
+			const LLViewerInventoryCategory* cat = cit->second.get();
+			if (item->getIsBrokenLink())
+			{
+				bad_link_count++;
+				load.mInvalidCategories.insert(cit->second);
+				//LL_INFOS() << "link still broken: " << item->getName() << " in folder " << cat->getName() << LL_ENDL;
+			}
+			else
+			{
+				// was marked as broken because of loading order, its actually fine to load
+				addItem(item);
+				load.mCachedItemCount += 1;
+				++load.mChildCounts[cat->getUUID()];
+				recovered_link_count++;
+			}
 		}
-		if(is_cache_obsolete)
+
+ 		LL_INFOS() << "Attempted to add " << bad_link_count
+ 				<< " cached link items without baseobj present. "
+			    << load.mGoodLinkCount << " link items were successfully added. "
+			    << recovered_link_count << " links added in recovery. "
+ 				<< "The corresponding categories were invalidated." << LL_ENDL;
+	}
+
+	if(is_cache_obsolete)
+	{
+		// A cache damaged past its categories may be missing items of
+		// folders that look complete, so fetch them all again.
+		load.mInvalidCategories.insert(load.mCategories.begin(), load.mCategories.end());
+	}
+
+	// Invalidate all categories that failed fetching descendents for whatever
+	// reason (e.g. one of the descendents was a broken link).
+	for (cat_set_t::iterator invalid_cat_it = load.mInvalidCategories.begin();
+		 invalid_cat_it != load.mInvalidCategories.end();
+		 invalid_cat_it++)
+	{
+		LLViewerInventoryCategory* cat = (*invalid_cat_it).get();
+		cat->setVersion(NO_VERSION);
+		LL_DEBUGS("Inventory") << "Invalidating category name: " << cat->getName() << " UUID: " << cat->getUUID() << " due to invalid descendents cache" << LL_ENDL;
+	}
+	LL_INFOS("Inventory") << "Invalidated " << load.mInvalidCategories.size() << " categories due to invalid descendents cache" << LL_ENDL;
+
+	// At this point, we need to set the known descendents for each
+	// category which successfully cached so that we do not
+	// needlessly fetch descendents for categories which we have.
+	update_map_t::const_iterator no_child_counts = load.mChildCounts.end();
+	for(cat_set_t::iterator it = load.mCategories.begin(); it != load.mCategories.end(); ++it)
+	{
+		LLViewerInventoryCategory* cat = (*it).get();
+		if(cat->getVersion() != NO_VERSION)
 		{
-			// If out of date, remove the gzipped file too.
-			LL_WARNS() << "Inv cache out of date, removing" << LL_ENDL;
-			LLFile::remove(gzip_filename);
+			update_map_t::const_iterator the_count = load.mChildCounts.find(cat->getUUID());
+			if(the_count != no_child_counts)
+			{
+				const S32 num_descendents = (*the_count).second.mValue;
+				cat->setDescendentCount(num_descendents);
+			}
+			else
+			{
+				cat->setDescendentCount(0);
+			}
 		}
-		categories.clear(); // will unref and delete entries
 	}
 
-	LL_INFOS() << "Successfully loaded " << cached_category_count
-			<< " categories and " << cached_item_count << " items from cache."
-			<< LL_ENDL;
+	if(is_cache_obsolete)
+	{
+		// If out of date, remove the gzipped file too.
+		LL_WARNS() << "Inv cache out of date, removing" << LL_ENDL;
+		LLFile::remove(load.mFilename);
+	}
 
-	return rv;
+	LL_INFOS() << "Successfully loaded " << load.mCachedCategoryCount
+			<< " categories and " << load.mCachedItemCount << " items from cache."
+			<< LL_ENDL;
 }
 
 // This is a brute force method to rebuild the entire parent-child
@@ -2476,105 +2777,6 @@ bool LLUUIDAndName::operator>(const LLUUIDAndName& rhs) const
 	return (mID > rhs.mID);
 }
 
-// static
-bool LLInventoryModel::loadFromFile(const std::string& filename,
-									LLInventoryModel::cat_array_t& categories,
-									LLInventoryModel::item_array_t& items,
-									bool &is_cache_obsolete)
-{
-	if(filename.empty())
-	{
-		LL_ERRS() << "Filename is Null!" << LL_ENDL;
-		return false;
-	}
-	LL_INFOS() << "LLInventoryModel::loadFromFile(" << filename << ")" << LL_ENDL;
-	LLFILE* file = LLFile::fopen(filename, "rb");		/*Flawfinder: ignore*/
-	if(!file)
-	{
-		LL_INFOS() << "unable to load inventory from: " << filename << LL_ENDL;
-		return false;
-	}
-	// *NOTE: This buffer size is hard coded into scanf() below.
-	char buffer[MAX_STRING];		/*Flawfinder: ignore*/
-	char keyword[MAX_STRING];		/*Flawfinder: ignore*/
-	char value[MAX_STRING];			/*Flawfinder: ignore*/
-	is_cache_obsolete = true;  		// Obsolete until proven current
-	while(!feof(file) && fgets(buffer, MAX_STRING, file)) 
-	{
-		sscanf(buffer, " %126s %126s", keyword, value);	/* Flawfinder: ignore */
-		if(0 == strcmp("inv_cache_version", keyword))
-		{
-			S32 version;
-			int succ = sscanf(value,"%d",&version);
-			if ((1 == succ) && (version == sCurrentInvCacheVersion))
-			{
-				// Cache is up to date
-				is_cache_obsolete = false;
-				continue;
-			}
-			else
-			{
-				// Cache is out of date
-				break;
-			}
-		}
-		else if(0 == strcmp("inv_category", keyword))
-		{
-			if (is_cache_obsolete)
-				break;
-			
-			LLPointer<LLViewerInventoryCategory> inv_cat = new LLViewerInventoryCategory(LLUUID::null);
-			if(inv_cat->importFileLocal(file))
-			{
-				categories.push_back(inv_cat);
-			}
-			else
-			{
-				LL_WARNS() << "loadInventoryFromFile().  Ignoring invalid inventory category: " << inv_cat->getName() << LL_ENDL;
-				//delete inv_cat; // automatic when inv_cat is reassigned or destroyed
-			}
-		}
-		else if(0 == strcmp("inv_item", keyword))
-		{
-			if (is_cache_obsolete)
-				break;
-
-			LLPointer<LLViewerInventoryItem> inv_item = new LLViewerInventoryItem;
-			if( inv_item->importFileLocal(file) )
-			{
-				// *FIX: Need a better solution, this prevents the
-				// application from freezing, but breaks inventory
-				// caching.
-				if(inv_item->getUUID().isNull())
-				{
-					//delete inv_item; // automatic when inv_cat is reassigned or destroyed
-					LL_WARNS() << "Ignoring inventory with null item id: "
-							<< inv_item->getName() << LL_ENDL;
-						
-				}
-				else
-				{
-					items.push_back(inv_item);
-				}
-			}
-			else
-			{
-				LL_WARNS() << "loadInventoryFromFile().  Ignoring invalid inventory item: " << inv_item->getName() << LL_ENDL;
-				//delete inv_item; // automatic when inv_cat is reassigned or destroyed
-			}
-		}
-		else
-		{
-			LL_WARNS() << "Unknown token in inventory file '" << keyword << "'"
-					<< LL_ENDL;
-		}
-	}
-	fclose(file);
-	if (is_cache_obsolete)
-		return false;
-	return true;
-}
-
 // static
 bool LLInventoryModel::saveToFile(const std::string& filename,
 								  const cat_array_t& categories,
@@ -2586,14 +2788,22 @@ bool LLInventoryModel::saveToFile(const std::string& filename,
 		return false;
 	}
 	LL_INFOS() << "LLInventoryModel::saveToFile(" << filename << ")" << LL_ENDL;
-	LLFILE* file = LLFile::fopen(filename, "wb");		/*Flawfinder: ignore*/
+	std::string tmp_filename = filename + ".t";
+	gzFile file = gzopen(tmp_filename.c_str(), "wb");		/*Flawfinder: ignore*/
 	if(!file)
 	{
 		LL_WARNS() << "unable to save inventory to: " << filename << LL_ENDL;
 		return false;
 	}
 
-	fprintf(file, "\tinv_cache_version\t%d\n",sCurrentInvCacheVersion);
+	LLSD header;
+	header["inv_cache_version"] = sCurrentInvCacheVersion;
+	bool success = gzwrite(file, CACHE_MAGIC, sizeof(CACHE_MAGIC) - 1) == (S32)sizeof(CACHE_MAGIC) - 1
+		&& write_cache_section(file, header);
+
+	// All categories first, so that the skeleton can be set up before the
+	// items are read.
+	LLSD section = LLSD::emptyArray();
 	S32 count = categories.size();
 	S32 i;
 	for(i = 0; i < count; ++i)
@@ -2601,18 +2811,40 @@ bool LLInventoryModel::saveToFile(const std::string& filename,
 		LLViewerInventoryCategory* cat = categories[i];
 		if(cat->getVersion() != LLViewerInventoryCategory::VERSION_UNKNOWN)
 		{
-			cat->exportFileLocal(file);
+			section.append(cat->exportLLSD());
 		}
 	}
+	success = success && write_cache_section(file, section);
 
 	count = items.size();
-	for(i = 0; i < count; ++i)
+	for(i = 0; success && i < count; i += CACHE_ITEMS_PER_SECTION)
 	{
-		items[i]->exportFile(file);
+		section = LLSD::emptyArray();
+		S32 end = llmin(i + CACHE_ITEMS_PER_SECTION, count);
+		for(S32 j = i; j < end; ++j)
+		{
+			section.append(items[j]->exportLLSD());
+		}
+		success = write_cache_section(file, section);
 	}
 
-	fclose(file);
-	return true;
+	const U8 end_of_cache[4] = { 0, 0, 0, 0 };
+	success = success && gzwrite(file, end_of_cache, 4) == 4;
+	if(gzclose(file) != Z_OK)
+	{
+		success = false;
+	}
+	if(!success)
+	{
+		LL_WARNS() << "unable to save inventory to: " << filename << LL_ENDL;
+		LLFile::remove(tmp_filename);
+		return false;
+	}
+#if LL_WINDOWS
+	// Rename in windows needs the filename to not exist.
+	LLFile::remove(filename);
+#endif
+	return LLFile::rename(tmp_filename, filename) == 0;
 }
 
 // message handling functionality
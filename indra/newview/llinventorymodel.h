@@ -146,6 +146,10 @@ public:
 	// Methods to load up inventory skeleton & meat. These are used
 	// during authentication. Returns true if everything parsed.
 	bool loadSkeleton(const LLSD& options, const LLUUID& owner_id);
+	// The categories of the cache are in once loadSkeleton() returns, the
+	// items are read on another thread and added by this for up to max_time
+	// seconds at a time. Returns true once all are in.
+	bool loadCachedItems(F32 max_time);
 	void buildParentChildMap(); // brute force method to rebuild the entire parent-child relations
 	// Call on logout to save a terse representation.
 	void cache(const LLUUID& parent_folder_id, const LLUUID& agent_id);
@@ -172,6 +176,10 @@ private:
 	parent_cat_map_t mParentChildCategoryTree;
 	parent_item_map_t mParentChildItemTree;
 
+	// Caches still being read, see loadCachedItems()
+	class CacheLoad;
+	std::vector<CacheLoad*> mCacheLoads;
+
 	//--------------------------------------------------------------------
 	// Login
 	//--------------------------------------------------------------------
@@ -535,13 +543,11 @@ public:
 	// File I/O
 	//--------------------------------------------------------------------
 protected:
-	static bool loadFromFile(const std::string& filename,
-							 cat_array_t& categories,
-							 item_array_t& items,
-							 bool& is_cache_obsolete); 
 	static bool saveToFile(const std::string& filename,
 						   const cat_array_t& categories,
 						   const item_array_t& items); 
+	void addCachedItems(CacheLoad& load, const item_array_t& items);
+	void finishCacheLoad(CacheLoad& load);
 
 	//--------------------------------------------------------------------
 	// Message handling functionality
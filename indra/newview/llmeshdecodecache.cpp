@@ -0,0 +1,299 @@
+/**
+ * @file llmeshdecodecache.cpp
+ * @brief On disk cache of decoded, vertex cache optimized mesh LODs.
+ *
+ * $LicenseInfo:firstyear=2014&license=viewerlgpl$
+ * Second Life Viewer Source Code
+ * Copyright (C) 2014, Linden Research, Inc.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation;
+ * version 2.1 of the License only.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ * Linden Research, Inc., 945 Battery Street, San Francisco, CA  94111  USA
+ * $/LicenseInfo$
+ */
+
+#include "llviewerprecompiledheaders.h"
+
+#include "llmeshdecodecache.h"
+
+#include <ctime>
+
+#include "lldiriterator.h"
+#include "llfile.h"
+#include "llmappedfile.h"
+#include "llvolume.h"
+
+static const std::string MESH_DECODE_CACHE_DIRNAME("meshcache");
+static const std::string MESH_DECODE_CACHE_EXT(".dmesh");
+
+static const U32 MESH_DECODE_CACHE_MAGIC = 0x48534d44;	// "DMSH"
+// Bump when the layout of LLVolume::packDecodedFaces() changes
+static const U32 MESH_DECODE_CACHE_VERSION = 1;
+
+// Trim to this fraction of the limit, so a full cache does not purge on every store
+static const F64 MESH_DECODE_CACHE_PURGE_RATIO = 0.9;
+
+namespace
+{
+	struct FileHeader
+	{
+		U32 mMagic;
+		U32 mVersion;
+		U8 mMeshID[UUID_BYTES];
+		S32 mLOD;
+		U32 mSculptType;
+		U32 mDataSize;
+		U32 mReserved[3];
+	};
+}
+
+LLMeshDecodeCache::LLMeshDecodeCache()
+:	mMutex(NULL),
+	mMaxSize(0),
+	mTotalSize(0),
+	mTempCount(0)
+{
+}
+
+LLMeshDecodeCache::~LLMeshDecodeCache()
+{
+}
+
+void LLMeshDecodeCache::initCache(ELLPath location, U64 max_size)
+{
+	LLMutexLock lock(&mMutex);
+
+	mEntries.clear();
+	mTotalSize = 0;
+	mMaxSize = max_size;
+	if (!mMaxSize)
+	{
+		LL_INFOS("MeshDecodeCache") << "Decoded mesh cache disabled" << LL_ENDL;
+		return;
+	}
+
+	mCacheDir = gDirUtilp->getExpandedFilename(location, MESH_DECODE_CACHE_DIRNAME);
+	LLFile::mkdir(mCacheDir);
+
+	// Left over by a crash in the middle of a store
+	gDirUtilp->deleteFilesInDir(mCacheDir, "*.tmp");
+
+	LLDirIterator iter(mCacheDir, "*" + MESH_DECODE_CACHE_EXT);
+	std::string filename;
+	while (iter.next(filename))
+	{
+		llstat stat_data;
+		if (LLFile::stat(mCacheDir + gDirUtilp->getDirDelimiter() + filename, &stat_data) == 0)
+		{
+			Entry& entry = mEntries[filename];
+			entry.mSize = (U32)stat_data.st_size;
+			entry.mTime = stat_data.st_mtime;
+			mTotalSize += entry.mSize;
+		}
+	}
+
+	LL_INFOS("MeshDecodeCache") << "Decoded mesh cache: " << mEntries.size() << " entries, "
+		<< (mTotalSize >> 20) << " of " << (mMaxSize >> 20) << " MB" << LL_ENDL;
+
+	if (mTotalSize > mMaxSize)
+	{
+		purgeEntries((U64)(mMaxSize * MESH_DECODE_CACHE_PURGE_RATIO));
+	}
+}
+
+//static
+void LLMeshDecodeCache::purgeCache(ELLPath location)
+{
+	std::string cache_dir = gDirUtilp->getExpandedFilename(location, MESH_DECODE_CACHE_DIRNAME);
+	LL_INFOS("MeshDecodeCache") << "Removing cache at " << cache_dir << LL_ENDL;
+	gDirUtilp->deleteFilesInDir(cache_dir, "*");
+	LLFile::rmdir(cache_dir);
+}
+
+std::string LLMeshDecodeCache::getFilename(const LLVolumeParams& mesh_params, S32 lod) const
+{
+	// The mirror and invert bits of the sculpt type change the decoded faces
+	return llformat("%s_%d_%02x", mesh_params.getSculptID().asString().c_str(), lod,
+					(U32)mesh_params.getSculptType()) + MESH_DECODE_CACHE_EXT;
+}
+
+bool LLMeshDecodeCache::contains(const LLVolumeParams& mesh_params, S32 lod)
+{
+	if (!isEnabled())
+	{
+		return false;
+	}
+
+	LLMutexLock lock(&mMutex);
+	return mEntries.find(getFilename(mesh_params, lod)) != mEntries.end();
+}
+
+bool LLMeshDecodeCache::load(const LLVolumeParams& mesh_params, S32 lod, LLVolume* volume)
+{
+	if (!isEnabled())
+	{
+		return false;
+	}
+
+	std::string filename = getFilename(mesh_params, lod);
+	{
+		LLMutexLock lock(&mMutex);
+		if (mEntries.find(filename) == mEntries.end())
+		{
+			return false;
+		}
+	}
+
+	std::string path = mCacheDir + gDirUtilp->getDirDelimiter() + filename;
+	bool success = false;
+	{
+		LLMappedFile file;
+		if (file.open(path, 0, true) && file.getSize() >= sizeof(FileHeader))
+		{
+			FileHeader header;
+			memcpy(&header, file.getData(), sizeof(FileHeader));
+			if (header.mMagic == MESH_DECODE_CACHE_MAGIC
+				&& header.mVersion == MESH_DECODE_CACHE_VERSION
+				&& !memcmp(header.mMeshID, mesh_params.getSculptID().mData, UUID_BYTES)
+				&& header.mLOD == lod
+				&& header.mSculptType == (U32)mesh_params.getSculptType()
+				&& header.mDataSize == file.getSize() - sizeof(FileHeader))
+			{
+				success = volume->unpackDecodedFaces(file.getData() + sizeof(FileHeader), (S32)header.mDataSize);
+			}
+		}
+	}
+
+	LLMutexLock lock(&mMutex);
+	if (success)
+	{
+		entry_map_t::iterator iter = mEntries.find(filename);
+		if (iter != mEntries.end())
+		{
+			iter->second.mTime = time(NULL);
+		}
+	}
+	else
+	{
+		LL_WARNS("MeshDecodeCache") << "Dropping unreadable entry " << filename << LL_ENDL;
+		LLFile::remove(path);
+		removeEntry(filename);
+	}
+	return success;
+}
+
+void LLMeshDecodeCache::store(const LLVolumeParams& mesh_params, S32 lod, const LLVolume* volume)
+{
+	if (!isEnabled())
+	{
+		return;
+	}
+
+	std::vector<U8> data;
+	volume->packDecodedFaces(data);
+	if (data.empty())
+	{
+		return;
+	}
+
+	FileHeader header;
+	memset(&header, 0, sizeof(FileHeader));
+	header.mMagic = MESH_DECODE_CACHE_MAGIC;
+	header.mVersion = MESH_DECODE_CACHE_VERSION;
+	memcpy(header.mMeshID, mesh_params.getSculptID().mData, UUID_BYTES);
+	header.mLOD = lod;
+	header.mSculptType = (U32)mesh_params.getSculptType();
+	header.mDataSize = (U32)data.size();
+
+	std::string filename = getFilename(mesh_params, lod);
+	std::string path = mCacheDir + gDirUtilp->getDirDelimiter() + filename;
+
+	// Several decode tasks may store the same mesh at once, each writes its
+	// own temporary and the last rename wins.
+	U32 temp_count;
+	{
+		LLMutexLock lock(&mMutex);
+		temp_count = mTempCount++;
+	}
+	std::string temp_path = llformat("%s.%u.tmp", path.c_str(), temp_count);
+
+	bool success = false;
+	LLFILE* fp = LLFile::fopen(temp_path, "wb");
+	if (fp)
+	{
+		success = fwrite(&header, sizeof(FileHeader), 1, fp) == 1
+			&& fwrite(&data[0], data.size(), 1, fp) == 1;
+		success = LLFile::close(fp) == 0 && success;
+	}
+	if (success)
+	{
+		// rename() does not replace an existing file everywhere
+		LLFile::remove(path);
+		success = LLFile::rename(temp_path, path) == 0;
+	}
+	if (!success)
+	{
+		LL_WARNS("MeshDecodeCache") << "Failed to write " << path << LL_ENDL;
+		LLFile::remove(temp_path);
+		return;
+	}
+
+	LLMutexLock lock(&mMutex);
+	addEntry(filename, (U32)(sizeof(FileHeader) + data.size()), time(NULL));
+	if (mTotalSize > mMaxSize)
+	{
+		purgeEntries((U64)(mMaxSize * MESH_DECODE_CACHE_PURGE_RATIO));
+	}
+}
+
+void LLMeshDecodeCache::addEntry(const std::string& filename, U32 size, time_t time)
+{
+	removeEntry(filename);
+	Entry& entry = mEntries[filename];
+	entry.mSize = size;
+	entry.mTime = time;
+	mTotalSize += size;
+}
+
+void LLMeshDecodeCache::removeEntry(const std::string& filename)
+{
+	entry_map_t::iterator iter = mEntries.find(filename);
+	if (iter != mEntries.end())
+	{
+		mTotalSize -= iter->second.mSize;
+		mEntries.erase(iter);
+	}
+}
+
+void LLMeshDecodeCache::purgeEntries(U64 target_size)
+{
+	typedef std::multimap<time_t, std::string> time_map_t;
+	time_map_t by_time;
+	for (entry_map_t::iterator iter = mEntries.begin(); iter != mEntries.end(); ++iter)
+	{
+		by_time.insert(std::make_pair(iter->second.mTime, iter->first));
+	}
+
+	U32 purged = 0;
+	for (time_map_t::iterator iter = by_time.begin(); iter != by_time.end() && mTotalSize > target_size; ++iter)
+	{
+		LLFile::remove(mCacheDir + gDirUtilp->getDirDelimiter() + iter->second);
+		removeEntry(iter->second);
+		++purged;
+	}
+
+	LL_INFOS("MeshDecodeCache") << "Purged " << purged << " entries, "
+		<< (mTotalSize >> 20) << " MB left" << LL_ENDL;
+}
@@ -0,0 +1,88 @@
+/**
+ * @file llmeshdecodecache.h
+ * @brief On disk cache of decoded, vertex cache optimized mesh LODs.
+ *
+ * $LicenseInfo:firstyear=2014&license=viewerlgpl$
+ * Second Life Viewer Source Code
+ * Copyright (C) 2014, Linden Research, Inc.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation;
+ * version 2.1 of the License only.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ * Linden Research, Inc., 945 Battery Street, San Francisco, CA  94111  USA
+ * $/LicenseInfo$
+ */
+
+#ifndef LL_LLMESHDECODECACHE_H
+#define LL_LLMESHDECODECACHE_H
+
+#include <map>
+
+#include "lldir.h"
+#include "llmutex.h"
+
+class LLVolume;
+class LLVolumeParams;
+
+// The VFS keeps mesh LODs as the sim sends them: zlib compressed LLSD.
+// Inflating them and reordering their indices for the vertex cache is
+// most of the cost of showing a mesh, so the result is kept here, one
+// file per mesh, LOD and sculpt flags, in the layout of
+// LLVolume::packDecodedFaces().  Loading one is a map and a copy per array.
+//
+// Mesh assets never change, so entries only go when the cache is full,
+// least recently used first.
+//
+// Threads:  initCache() on main, the rest on any thread
+class LLMeshDecodeCache
+{
+public:
+	LLMeshDecodeCache();
+	~LLMeshDecodeCache();
+
+	// Indexes the cache directory, a max_size of 0 disables the cache
+	void initCache(ELLPath location, U64 max_size);
+	static void purgeCache(ELLPath location);
+
+	bool isEnabled() const { return mMaxSize > 0; }
+
+	bool contains(const LLVolumeParams& mesh_params, S32 lod);
+	// Fills the faces of volume, false if there is no usable entry
+	bool load(const LLVolumeParams& mesh_params, S32 lod, LLVolume* volume);
+	void store(const LLVolumeParams& mesh_params, S32 lod, const LLVolume* volume);
+
+private:
+	std::string getFilename(const LLVolumeParams& mesh_params, S32 lod) const;
+	void addEntry(const std::string& filename, U32 size, time_t time);
+	void removeEntry(const std::string& filename);
+	// Mutex:  must be holding mMutex when called
+	void purgeEntries(U64 target_size);
+
+private:
+	struct Entry
+	{
+		U32 mSize;
+		time_t mTime;	// last used
+	};
+	typedef std::map<std::string, Entry> entry_map_t;
+
+	LLMutex		mMutex;
+	std::string	mCacheDir;
+	U64			mMaxSize;
+	U64			mTotalSize;
+	U32			mTempCount;
+	entry_map_t	mEntries;	// by file name
+};
+
+#endif // LL_LLMESHDECODECACHE_H
@@ -46,9 +46,11 @@
 #include "llmath.h"
 #include "llnotificationsutil.h"
 #include "llsd.h"
+#include "llsdarena.h"
 #include "llsdutil_math.h"
 #include "llsdserialize.h"
 #include "llthread.h"
+#include "llthreadpool.h"
 #include "llvfile.h"
 #include "llviewercontrol.h"
 #include "llviewerinventory.h"
@@ -104,6 +106,7 @@
 //   repo     Overseeing worker thread associated with the LLMeshRepoThread class
 //   decom    Worker thread for mesh decomposition requests
 //   core     HTTP worker thread:  does the work but doesn't intrude here
+//   pool     LLAppViewer's thread pool:  decodes LOD and skin info data
 //   uploadN  0-N temporary mesh upload threads (0-1 in practice)
 //
 // Sequence of Operations
@@ -142,9 +145,16 @@
 //                             ...
 //                             onCompleted() invoked for GET
 //                               data copied
-//                               lodReceived() invoked
-//                                 unpack data into LLVolume
-//                                 append LoadedMesh to mLoadedQ
+//                               decodeMeshLOD() invoked
+//                                 DecodeTask submitted to the pool
+//                             ...
+//                                                 pool thread
+//                                                 unpack data into LLVolume
+//                                                 decodeDone() invoked
+//                             ...
+//                             processDecoded() invoked
+//                               write data to VFS
+//                               append LoadedMesh to mLoadedQ
 //                             ...
 //         notifyLoadedMeshes() invoked again
 //           scan mLoadedQ
@@ -251,6 +261,7 @@
 //     mUnavailableQ            mMutex        rw.repo.none [0], ro.main.none [5], rw.main.mMutex
 //     mLoadedQ                 mMutex        rw.repo.mMutex, ro.main.none [5], rw.main.mMutex
 //     mPendingLOD              mMutex        rw.repo.mMutex, rw.any.mMutex
+//     mDecodedQ                mMutex        rw.pool.mMutex, rw.repo.mMutex
 //     mGetMeshCapability       mMutex        rw.main.mMutex, ro.repo.mMutex (was:  [0])
 //     mGetMesh2Capability      mMutex        rw.main.mMutex, ro.repo.mMutex (was:  [0])
 //     mGetMeshVersion          mMutex        rw.main.mMutex, ro.repo.mMutex
@@ -536,7 +547,10 @@ protected:
 	
 public:
 	virtual void onCompleted(LLCore::HttpHandle handle, LLCore::HttpResponse * response);
-	virtual void processData(LLCore::BufferArray * body, U8 * data, S32 data_size) = 0;
+	// If body is set, data points into it and must be kept alive with a
+	// reference to body.  Otherwise data came from new[] and processData
+	// may take ownership of it and set it to NULL.
+	virtual void processData(LLCore::BufferArray * body, U8 *& data, S32 data_size) = 0;
 	virtual void processFailure(LLCore::HttpStatus status) = 0;
 	
 public:
@@ -565,7 +579,7 @@ protected:
 	void operator=(const LLMeshHeaderHandler &);				// Not defined
 	
 public:
-	virtual void processData(LLCore::BufferArray * body, U8 * data, S32 data_size);
+	virtual void processData(LLCore::BufferArray * body, U8 *& data, S32 data_size);
 	virtual void processFailure(LLCore::HttpStatus status);
 };
 
@@ -592,7 +606,7 @@ protected:
 	void operator=(const LLMeshLODHandler &);					// Not defined
 
 public:
-	virtual void processData(LLCore::BufferArray * body, U8 * data, S32 data_size);
+	virtual void processData(LLCore::BufferArray * body, U8 *& data, S32 data_size);
 	virtual void processFailure(LLCore::HttpStatus status);
 
 public:
@@ -621,7 +635,7 @@ protected:
 	void operator=(const LLMeshSkinInfoHandler &);				// Not defined
 
 public:
-	virtual void processData(LLCore::BufferArray * body, U8 * data, S32 data_size);
+	virtual void processData(LLCore::BufferArray * body, U8 *& data, S32 data_size);
 	virtual void processFailure(LLCore::HttpStatus status);
 
 public:
@@ -650,7 +664,7 @@ protected:
 	void operator=(const LLMeshDecompositionHandler &);					// Not defined
 
 public:
-	virtual void processData(LLCore::BufferArray * body, U8 * data, S32 data_size);
+	virtual void processData(LLCore::BufferArray * body, U8 *& data, S32 data_size);
 	virtual void processFailure(LLCore::HttpStatus status);
 
 public:
@@ -679,7 +693,7 @@ protected:
 	void operator=(const LLMeshPhysicsShapeHandler &);				// Not defined
 
 public:
-	virtual void processData(LLCore::BufferArray * body, U8 * data, S32 data_size);
+	virtual void processData(LLCore::BufferArray * body, U8 *& data, S32 data_size);
 	virtual void processFailure(LLCore::HttpStatus status);
 
 public:
@@ -689,6 +703,102 @@ public:
 };
 
 
+// Decode of one fetched LOD or skin info block on the thread pool.
+// The repo thread finishes it in processDecoded().
+//
+// Thread:  repo, then pool
+class LLMeshRepoThread::DecodeTask : public LLThreadPool::Task
+{
+public:
+	enum EType
+	{
+		DECODE_LOD,
+		DECODE_SKIN_INFO
+	};
+
+	DecodeTask(LLMeshRepoThread* thread, EType type, const LLVolumeParams& mesh_params, S32 lod,
+			   U8* data, S32 data_size, S32 offset, S32 size, bool from_cache, LLCore::BufferArray* body)
+		: mThread(thread),
+		  mType(type),
+		  mSequence(0),
+		  mMeshParams(mesh_params),
+		  mLOD(lod),
+		  mData(data),
+		  mDataSize(data_size),
+		  mBody(body),
+		  mOffset(offset),
+		  mSize(size),
+		  mFromCache(from_cache),
+		  mSuccess(false)
+	{
+		if (mBody)
+		{
+			mBody->addRef();
+		}
+	}
+
+	~DecodeTask()
+	{
+		if (mBody)
+		{
+			// mData is borrowed from the response body
+			mBody->release();
+		}
+		else
+		{
+			delete [] mData;
+		}
+	}
+
+	void decode()
+	{
+		if (DECODE_LOD == mType)
+		{
+			LLPointer<LLVolume> volume = new LLVolume(mMeshParams, LLVolumeLODGroup::getVolumeScaleFromDetail(mLOD));
+			// No data means fetchMeshLOD() found it in the decode cache
+			if (!mData)
+			{
+				mSuccess = gMeshRepo.mDecodeCache.load(mMeshParams, mLOD, volume) && volume->getNumFaces() > 0;
+			}
+			else if (volume->unpackVolumeFaces(mData, mDataSize) && volume->getNumFaces() > 0)
+			{
+				gMeshRepo.mDecodeCache.store(mMeshParams, mLOD, volume);
+				mSuccess = true;
+			}
+			if (mSuccess)
+			{
+				mVolume = volume;
+			}
+		}
+		else
+		{
+			// Goes straight to mSkinInfoQ, the order skin info arrives in doesn't matter
+			mSuccess = mThread->skinInfoReceived(mMeshParams.getSculptID(), mData, mDataSize);
+		}
+	}
+
+	/*virtual*/ void run()
+	{
+		decode();
+		mThread->decodeDone(this);
+	}
+
+	LLMeshRepoThread* mThread;
+	EType mType;
+	U32 mSequence;
+	LLVolumeParams mMeshParams;
+	S32 mLOD;
+	U8* mData;
+	S32 mDataSize;
+	LLCore::BufferArray* mBody;
+	S32 mOffset;
+	S32 mSize;
+	bool mFromCache;
+	bool mSuccess;
+	LLPointer<LLVolume> mVolume;
+};
+
+
 void log_upload_error(LLCore::HttpStatus status, const LLSD& content,
 					  const char * const stage, const std::string & model_name)
 {
@@ -752,8 +862,12 @@ LLMeshRepoThread::LLMeshRepoThread()
   mHttpLegacyPolicyClass(LLCore::HttpRequest::DEFAULT_POLICY_ID),
   mHttpLargePolicyClass(LLCore::HttpRequest::DEFAULT_POLICY_ID),
   mHttpPriority(0),
-  mGetMeshVersion(2)
+  mGetMeshVersion(2),
+  mDecodeSequence(0),
+  mNextDecodeSequence(0),
+  mDecodePool(LLAppViewer::getThreadPool())
 	{
+	mDecodesInFlight = 0;
 	mMutex = new LLMutex(NULL);
 	mHeaderMutex = new LLMutex(NULL);
 	mSignal = new LLCondition(NULL);
@@ -774,6 +888,8 @@ LLMeshRepoThread::LLMeshRepoThread()
 			
 LLMeshRepoThread::~LLMeshRepoThread()
 		{
+	waitForDecodes();
+
 	LL_INFOS(LOG_MESH) << "Small GETs issued:  " << LLMeshRepository::sHTTPRequestCount
 					   << ", Large GETs issued:  " << LLMeshRepository::sHTTPLargeRequestCount
 					   << ", Max Lock Holdoffs:  " << LLMeshRepository::sMaxLockHoldoffs
@@ -846,6 +962,7 @@ void LLMeshRepoThread::run()
 			// Dispatch all HttpHandler notifications
 			mHttpRequest->update(0L);
 			}
+		processDecoded();
 		sRequestWaterLevel = mHttpRequestSet.size();			// Stats data update
 
 		// NOTE: order of queue processing intentionally favors LOD requests over header requests
@@ -1221,42 +1338,16 @@ bool LLMeshRepoThread::fetchMeshSkinInfo(const LLUUID& mesh_id)
 				}
 
 				if (!zero)
-				{ //attempt to parse
-					if (skinInfoReceived(mesh_id, buffer, size))
-					{						
-						delete[] buffer;
-						return true;
-					}
+				{ //attempt to parse, falls back to the sim if that fails
+					decodeMeshSkinInfo(mesh_id, buffer, size, offset, size, true);
+					return true;
 				}
 
 				delete[] buffer;
 			}
 
 			//reading from VFS failed for whatever reason, fetch from sim
-			int cap_version(2);
-			std::string http_url;
-			constructUrl(mesh_id, &http_url, &cap_version);
-
-			if (!http_url.empty())
-			{				
-				LLMeshSkinInfoHandler * handler = new LLMeshSkinInfoHandler(mesh_id, offset, size);
-				LLCore::HttpHandle handle = getByteRange(http_url, cap_version, offset, size, handler);
-				if (LLCORE_HTTP_HANDLE_INVALID == handle)
-				{
-					LL_WARNS(LOG_MESH) << "HTTP GET request failed for skin info on mesh " << mID
-									   << ".  Reason:  " << mHttpStatus.toString()
-									   << " (" << mHttpStatus.toTerseString() << ")"
-									   << LL_ENDL;
-					delete handler;
-					ret = false;
-
-				}
-				else
-				{
-					handler->mHttpHandle = handle;
-					mHttpRequestSet.insert(handler);
-				}
-			}
+			ret = requestMeshSkinInfo(mesh_id, offset, size);
 		}
 	}
 	else
@@ -1268,6 +1359,34 @@ bool LLMeshRepoThread::fetchMeshSkinInfo(const LLUUID& mesh_id)
 	return ret;
 }
 
+bool LLMeshRepoThread::requestMeshSkinInfo(const LLUUID& mesh_id, S32 offset, S32 size)
+{
+	int cap_version(2);
+	std::string http_url;
+	constructUrl(mesh_id, &http_url, &cap_version);
+
+	if (http_url.empty())
+	{
+		return true;
+	}
+
+	LLMeshSkinInfoHandler * handler = new LLMeshSkinInfoHandler(mesh_id, offset, size);
+	LLCore::HttpHandle handle = getByteRange(http_url, cap_version, offset, size, handler);
+	if (LLCORE_HTTP_HANDLE_INVALID == handle)
+	{
+		LL_WARNS(LOG_MESH) << "HTTP GET request failed for skin info on mesh " << mID
+						   << ".  Reason:  " << mHttpStatus.toString()
+						   << " (" << mHttpStatus.toTerseString() << ")"
+						   << LL_ENDL;
+		delete handler;
+		return false;
+	}
+
+	handler->mHttpHandle = handle;
+	mHttpRequestSet.insert(handler);
+	return true;
+}
+
 bool LLMeshRepoThread::fetchMeshDecomposition(const LLUUID& mesh_id)
 {
 	if (!mHeaderMutex)
@@ -1573,65 +1692,22 @@ bool LLMeshRepoThread::fetchMeshLOD(const LLVolumeParams& mesh_params, S32 lod)
 				
 		if (version <= MAX_MESH_VERSION && offset >= 0 && size > 0)
 		{
-
-			//check VFS for mesh asset
-			LLVFile file(gVFS, mesh_id, LLAssetType::AT_MESH);
-			if (file.getSize() >= offset+size)
+			//already decoded once, skip the VFS read and the inflate
+			if (gMeshRepo.mDecodeCache.contains(mesh_params, lod))
 			{
-				LLMeshRepository::sCacheBytesRead += size;
 				++LLMeshRepository::sCacheReads;
-				file.seek(offset);
-				U8* buffer = new U8[size];
-				file.read(buffer, size);
-
-				//make sure buffer isn't all 0's by checking the first 1KB (reserved block but not written)
-				bool zero = true;
-				for (S32 i = 0; i < llmin(size, 1024) && zero; ++i)
-				{
-					zero = buffer[i] > 0 ? false : true;
-				}
-
-				if (!zero)
-				{ //attempt to parse
-					if (lodReceived(mesh_params, lod, buffer, size))
-					{
-						delete[] buffer;
-						return true;
-					}
-				}
-
-				delete[] buffer;
+				decodeMeshLOD(mesh_params, lod, NULL, 0, offset, size, true);
+				return true;
 			}
 
-			//reading from VFS failed for whatever reason, fetch from sim
-			int cap_version(2);
-			std::string http_url;
-			constructUrl(mesh_id, &http_url, &cap_version);
-
-			if (!http_url.empty())
-			{				
-				LLMeshLODHandler * handler = new LLMeshLODHandler(mesh_params, lod, offset, size);
-				LLCore::HttpHandle handle = getByteRange(http_url, cap_version, offset, size, handler);
-				if (LLCORE_HTTP_HANDLE_INVALID == handle)
-				{
-					LL_WARNS(LOG_MESH) << "HTTP GET request failed for LOD on mesh " << mID
-									   << ".  Reason:  " << mHttpStatus.toString()
-									   << " (" << mHttpStatus.toTerseString() << ")"
-									   << LL_ENDL;
-					delete handler;
-					retval = false;
-				}
-				else
-				{
-					handler->mHttpHandle = handle;
-					mHttpRequestSet.insert(handler);
-					// *NOTE:  Allowing a re-request, not marking as unavailable.  Is that correct?
-				}
-			}
-			else
+			//check VFS for mesh asset
+			if (readMeshLODFromVFS(mesh_params, lod, offset, size))
 			{
-				mUnavailableQ.push(LODRequest(mesh_params, lod));
+				return true;
 			}
+
+			//reading from VFS failed for whatever reason, fetch from sim
+			retval = requestMeshLOD(mesh_params, lod, offset, size);
 		}
 		else
 		{
@@ -1646,6 +1722,69 @@ bool LLMeshRepoThread::fetchMeshLOD(const LLVolumeParams& mesh_params, S32 lod)
 	return retval;
 }
 
+bool LLMeshRepoThread::readMeshLODFromVFS(const LLVolumeParams& mesh_params, S32 lod, S32 offset, S32 size)
+{
+	LLVFile file(gVFS, mesh_params.getSculptID(), LLAssetType::AT_MESH);
+	if (file.getSize() < offset+size)
+	{
+		return false;
+	}
+
+	LLMeshRepository::sCacheBytesRead += size;
+	++LLMeshRepository::sCacheReads;
+	file.seek(offset);
+	U8* buffer = new U8[size];
+	file.read(buffer, size);
+
+	//make sure buffer isn't all 0's by checking the first 1KB (reserved block but not written)
+	bool zero = true;
+	for (S32 i = 0; i < llmin(size, 1024) && zero; ++i)
+	{
+		zero = buffer[i] > 0 ? false : true;
+	}
+
+	if (zero)
+	{
+		delete[] buffer;
+		return false;
+	}
+
+	//attempt to parse, falls back to the sim if that fails
+	decodeMeshLOD(mesh_params, lod, buffer, size, offset, size, true);
+	return true;
+}
+
+bool LLMeshRepoThread::requestMeshLOD(const LLVolumeParams& mesh_params, S32 lod, S32 offset, S32 size)
+{
+	int cap_version(2);
+	std::string http_url;
+	constructUrl(mesh_params.getSculptID(), &http_url, &cap_version);
+
+	if (http_url.empty())
+	{
+		LLMutexLock lock(mMutex);
+		mUnavailableQ.push(LODRequest(mesh_params, lod));
+		return true;
+	}
+
+	LLMeshLODHandler * handler = new LLMeshLODHandler(mesh_params, lod, offset, size);
+	LLCore::HttpHandle handle = getByteRange(http_url, cap_version, offset, size, handler);
+	if (LLCORE_HTTP_HANDLE_INVALID == handle)
+	{
+		LL_WARNS(LOG_MESH) << "HTTP GET request failed for LOD on mesh " << mID
+						   << ".  Reason:  " << mHttpStatus.toString()
+						   << " (" << mHttpStatus.toTerseString() << ")"
+						   << LL_ENDL;
+		delete handler;
+		return false;
+	}
+
+	handler->mHttpHandle = handle;
+	mHttpRequestSet.insert(handler);
+	// *NOTE:  Allowing a re-request, not marking as unavailable.  Is that correct?
+	return true;
+}
+
 bool LLMeshRepoThread::headerReceived(const LLVolumeParams& mesh_params, U8* data, S32 data_size)
 {
 	const LLUUID mesh_id = mesh_params.getSculptID();
@@ -1654,27 +1793,26 @@ bool LLMeshRepoThread::headerReceived(const LLVolumeParams& mesh_params, U8* dat
 	U32 header_size = 0;
 	if (data_size > 0)
 	{
-		std::string res_str((char*) data, data_size);
-
-		std::string deprecated_header("<? LLSD/Binary ?>");
+		static const char deprecated_header[] = "<? LLSD/Binary ?>";
+		const S32 deprecated_header_size = sizeof(deprecated_header) - 1;
 
-		if (res_str.substr(0, deprecated_header.size()) == deprecated_header)
+		if (data_size > deprecated_header_size && !memcmp(data, deprecated_header, deprecated_header_size))
 		{
-			res_str = res_str.substr(deprecated_header.size()+1, data_size);
-			header_size = deprecated_header.size()+1;
+			header_size = deprecated_header_size + 1;
 		}
-		data_size = res_str.size();
 
-		std::istringstream stream(res_str);
+		// Parse straight out of the fetch buffer, the LOD data that follows
+		// the header is left alone.
+		LLSDBinaryReader reader(data + header_size, data_size - header_size);
 
-		if (!LLSDSerialize::fromBinary(header, stream, data_size))
+		if (reader.readValue(header) <= 0)
 		{
 			LL_WARNS(LOG_MESH) << "Mesh header parse error.  Not a valid mesh asset!  ID:  " << mesh_id
 							   << LL_ENDL;
 			return false;
 		}
 
-		header_size += stream.tellg();
+		header_size += reader.getOffset();
 	}
 	else
 	{
@@ -1711,39 +1849,157 @@ bool LLMeshRepoThread::headerReceived(const LLVolumeParams& mesh_params, U8* dat
 	return true;
 }
 
-bool LLMeshRepoThread::lodReceived(const LLVolumeParams& mesh_params, S32 lod, U8* data, S32 data_size)
+void LLMeshRepoThread::decodeMeshLOD(const LLVolumeParams& mesh_params, S32 lod, U8* data, S32 data_size,
+									 S32 offset, S32 size, bool from_cache, LLCore::BufferArray* body)
+{
+	submitDecode(new DecodeTask(this, DecodeTask::DECODE_LOD, mesh_params, lod, data, data_size, offset, size, from_cache, body));
+}
+
+void LLMeshRepoThread::decodeMeshSkinInfo(const LLUUID& mesh_id, U8* data, S32 data_size,
+										  S32 offset, S32 size, bool from_cache, LLCore::BufferArray* body)
+{
+	LLVolumeParams mesh_params;
+	mesh_params.setSculptID(mesh_id, LL_SCULPT_TYPE_MESH);
+	submitDecode(new DecodeTask(this, DecodeTask::DECODE_SKIN_INFO, mesh_params, 0, data, data_size, offset, size, from_cache, body));
+}
+
+void LLMeshRepoThread::submitDecode(DecodeTask* task)
 {
-	LLPointer<LLVolume> volume = new LLVolume(mesh_params, LLVolumeLODGroup::getVolumeScaleFromDetail(lod));
-	std::string mesh_string((char*) data, data_size);
-	std::istringstream stream(mesh_string);
+	if (!mDecodePool)
+	{
+		task->decode();
+		finishDecode(task);
+		return;
+	}
+
+	task->mSequence = mDecodeSequence++;
+
+	++mDecodesInFlight;
+	// Skin info holds up drawing rigged meshes more than a missing LOD does
+	mDecodePool->submit(task, DecodeTask::DECODE_SKIN_INFO == task->mType ? LLThreadPool::BAND_HIGH : LLThreadPool::BAND_NORMAL);
+}
+
+void LLMeshRepoThread::decodeDone(DecodeTask* task)
+{
+	{
+		LLMutexLock lock(mMutex);
+		mDecodedQ[task->mSequence] = task;
+	}
+	mSignal->signal();
+	--mDecodesInFlight;		// last, the repo thread may be waiting on it to go away
+}
+
+void LLMeshRepoThread::processDecoded()
+{
+	std::vector<DecodeTask*> decoded;
+	{
+		LLMutexLock lock(mMutex);
+		// Stop at the first one still decoding, later ones wait for it
+		decode_task_map::iterator iter = mDecodedQ.find(mNextDecodeSequence);
+		while (iter != mDecodedQ.end())
+		{
+			decoded.push_back(iter->second);
+			mDecodedQ.erase(iter);
+			iter = mDecodedQ.find(++mNextDecodeSequence);
+		}
+	}
 
-	if (volume->unpackVolumeFaces(stream, data_size))
+	for (U32 i = 0; i < decoded.size(); ++i)
 	{
-		if (volume->getNumFaces() > 0)
+		finishDecode(decoded[i]);
+	}
+}
+
+void LLMeshRepoThread::finishDecode(DecodeTask* task)
+{
+	const LLUUID mesh_id = task->mMeshParams.getSculptID();
+	bool is_lod = (DecodeTask::DECODE_LOD == task->mType);
+
+	if (task->mSuccess)
+	{
+		if (is_lod)
+		{
+			LLMutexLock lock(mMutex);
+			mLoadedQ.push(LoadedMesh(task->mVolume, task->mMeshParams, task->mLOD));
+		}
+
+		if (!task->mFromCache)
 		{
-			LoadedMesh mesh(volume, mesh_params, lod);
+			//good fetch from sim, write to VFS for caching
+			LLVFile file(gVFS, mesh_id, LLAssetType::AT_MESH, LLVFile::WRITE);
+
+			S32 offset = task->mOffset;
+			S32 size = llmin(task->mSize, task->mDataSize);
+
+			if (file.getSize() >= offset+size)
 			{
-				LLMutexLock lock(mMutex);
-				mLoadedQ.push(mesh);
+				file.seek(offset);
+				file.write(task->mData, size);
+				LLMeshRepository::sCacheBytesWritten += size;
+				++LLMeshRepository::sCacheWrites;
 			}
-			return true;
 		}
 	}
+	else if (is_lod && task->mFromCache && !task->mData
+			 && readMeshLODFromVFS(task->mMeshParams, task->mLOD, task->mOffset, task->mSize))
+	{
+		//the decoded copy is bad, the VFS copy is decoding again
+	}
+	else if (task->mFromCache)
+	{
+		//the cached copy is bad, fetch from sim
+		bool requested = is_lod ? requestMeshLOD(task->mMeshParams, task->mLOD, task->mOffset, task->mSize)
+								: requestMeshSkinInfo(mesh_id, task->mOffset, task->mSize);
+		if (!requested && is_lod)
+		{
+			LLMutexLock lock(mMutex);
+			mUnavailableQ.push(LODRequest(task->mMeshParams, task->mLOD));
+		}
+	}
+	else if (is_lod)
+	{
+		LL_WARNS(LOG_MESH) << "Error during mesh LOD processing.  ID:  " << mesh_id
+						   << ", Unknown reason.  Not retrying."
+						   << LL_ENDL;
+		LLMutexLock lock(mMutex);
+		mUnavailableQ.push(LODRequest(task->mMeshParams, task->mLOD));
+	}
+	else
+	{
+		LL_WARNS(LOG_MESH) << "Error during mesh skin info processing.  ID:  " << mesh_id
+						   << ", Unknown reason.  Not retrying."
+						   << LL_ENDL;
+		// *TODO:  Mark mesh unavailable on error
+	}
 
-	return false;
+	delete task;
+}
+
+void LLMeshRepoThread::waitForDecodes()
+{
+	while (mDecodesInFlight > 0)
+	{
+		ms_sleep(1);
+	}
+
+	// Too late to deliver them
+	for (decode_task_map::iterator iter = mDecodedQ.begin(); iter != mDecodedQ.end(); ++iter)
+	{
+		delete iter->second;
+	}
+	mDecodedQ.clear();
 }
 
 bool LLMeshRepoThread::skinInfoReceived(const LLUUID& mesh_id, U8* data, S32 data_size)
 {
+	// Only lives until it has been copied into LLMeshSkinInfo
+	LLSDArena arena;
+	LLSDArena::Scope scope(arena);
 	LLSD skin;
 
 	if (data_size > 0)
 	{
-		std::string res_str((char*) data, data_size);
-
-		std::istringstream stream(res_str);
-
-		if (!unzip_llsd(skin, stream, data_size))
+		if (!unzip_llsd(skin, data, data_size))
 		{
 			LL_WARNS(LOG_MESH) << "Mesh skin info parse error.  Not a valid mesh asset!  ID:  " << mesh_id
 							   << LL_ENDL;
@@ -1767,15 +2023,13 @@ bool LLMeshRepoThread::skinInfoReceived(const LLUUID& mesh_id, U8* data, S32 dat
 
 bool LLMeshRepoThread::decompositionReceived(const LLUUID& mesh_id, U8* data, S32 data_size)
 {
+	LLSDArena arena;
+	LLSDArena::Scope scope(arena);
 	LLSD decomp;
 
 	if (data_size > 0)
 	{ 
-		std::string res_str((char*) data, data_size);
-
-		std::istringstream stream(res_str);
-
-		if (!unzip_llsd(decomp, stream, data_size))
+		if (!unzip_llsd(decomp, data, data_size))
 		{
 			LL_WARNS(LOG_MESH) << "Mesh decomposition parse error.  Not a valid mesh asset!  ID:  " << mesh_id
 							   << LL_ENDL;
@@ -1812,10 +2066,8 @@ bool LLMeshRepoThread::physicsShapeReceived(const LLUUID& mesh_id, U8* data, S32
 		volume_params.setType(LL_PCODE_PROFILE_SQUARE, LL_PCODE_PATH_LINE);
 		volume_params.setSculptID(mesh_id, LL_SCULPT_TYPE_MESH);
 		LLPointer<LLVolume> volume = new LLVolume(volume_params,0);
-		std::string mesh_string((char*) data, data_size);
-		std::istringstream stream(mesh_string);
 
-		if (volume->unpackVolumeFaces(stream, data_size))
+		if (volume->unpackVolumeFaces(data, data_size))
 		{
 			//load volume faces into decomposition buffer
 			S32 vertex_count = 0;
@@ -2686,21 +2938,31 @@ void LLMeshHandlerBase::onCompleted(LLCore::HttpHandle handle, LLCore::HttpRespo
 		LLCore::BufferArray * body(response->getBody());
 		S32 data_size(body ? body->size() : 0);
 		U8 * data(NULL);
+		LLCore::BufferArray * data_body(NULL);
 
-	if (data_size > 0)
-	{
-			// *TODO: Try to get rid of data copying and add interfaces
-			// that support BufferArray directly.  Introduce a two-phase
-			// handler, optional first that takes a body, fallback second
-			// that requires a temporary allocation and data copy.
-		data = new U8[data_size];
-			body->read(0, (char *) data, data_size);
+		if (data_size > 0)
+		{
+			// Bodies normally arrive in one block sized from Content-Length
+			// and are parsed in place.  Copy only the odd fragmented one.
+			data = (U8 *) body->getContiguous(0, data_size);
+			if (data)
+			{
+				data_body = body;
+			}
+			else
+			{
+				data = new U8[data_size];
+				body->read(0, (char *) data, data_size);
+			}
 			LLMeshRepository::sBytesReceived += data_size;
 		}
 
-		processData(body, data, data_size);
+		processData(data_body, data, data_size);
 
-		delete [] data;
+		if (! data_body)
+		{
+			delete [] data;
+		}
 	}
 
 	// Release handler
@@ -2740,7 +3002,7 @@ void LLMeshHeaderHandler::processFailure(LLCore::HttpStatus status)
 	}
 	}
 
-void LLMeshHeaderHandler::processData(LLCore::BufferArray * body, U8 * data, S32 data_size)
+void LLMeshHeaderHandler::processData(LLCore::BufferArray * body, U8 *& data, S32 data_size)
 {
 	LLUUID mesh_id = mMeshParams.getSculptID();
 	bool success = (! MESH_HEADER_PROCESS_FAILED) && gMeshRepo.mThread->headerReceived(mMeshParams, data, data_size);
@@ -2842,24 +3104,14 @@ void LLMeshLODHandler::processFailure(LLCore::HttpStatus status)
 	gMeshRepo.mThread->mUnavailableQ.push(LLMeshRepoThread::LODRequest(mMeshParams, mLOD));
 }
 
-void LLMeshLODHandler::processData(LLCore::BufferArray * body, U8 * data, S32 data_size)
-	{
-	if ((! MESH_LOD_PROCESS_FAILED) && gMeshRepo.mThread->lodReceived(mMeshParams, mLOD, data, data_size))
+void LLMeshLODHandler::processData(LLCore::BufferArray * body, U8 *& data, S32 data_size)
+{
+	if ((! MESH_LOD_PROCESS_FAILED) && data)
 	{
-		//good fetch from sim, write to VFS for caching
-		LLVFile file(gVFS, mMeshParams.getSculptID(), LLAssetType::AT_MESH, LLVFile::WRITE);
-
-		S32 offset = mOffset;
-		S32 size = mRequestedBytes;
-
-		if (file.getSize() >= offset+size)
-		{
-			file.seek(offset);
-			file.write(data, size);
-			LLMeshRepository::sCacheBytesWritten += size;
-			++LLMeshRepository::sCacheWrites;
-		}
-		}
+		// Decoded on the pool, written to VFS once that succeeds
+		gMeshRepo.mThread->decodeMeshLOD(mMeshParams, mLOD, data, data_size, mOffset, mRequestedBytes, false, body);
+		data = NULL;
+	}
 	else
 	{
 		LL_WARNS(LOG_MESH) << "Error during mesh LOD processing.  ID:  " << mMeshParams.getSculptID()
@@ -2886,23 +3138,13 @@ void LLMeshSkinInfoHandler::processFailure(LLCore::HttpStatus status)
 	// request unfulfilled rather than retry forever.
 		}
 
-void LLMeshSkinInfoHandler::processData(LLCore::BufferArray * body, U8 * data, S32 data_size)
-	{
-	if ((! MESH_SKIN_INFO_PROCESS_FAILED) && gMeshRepo.mThread->skinInfoReceived(mMeshID, data, data_size))
+void LLMeshSkinInfoHandler::processData(LLCore::BufferArray * body, U8 *& data, S32 data_size)
+{
+	if ((! MESH_SKIN_INFO_PROCESS_FAILED) && data)
 	{
-		//good fetch from sim, write to VFS for caching
-		LLVFile file(gVFS, mMeshID, LLAssetType::AT_MESH, LLVFile::WRITE);
-
-		S32 offset = mOffset;
-		S32 size = mRequestedBytes;
-
-		if (file.getSize() >= offset+size)
-		{
-			LLMeshRepository::sCacheBytesWritten += size;
-			++LLMeshRepository::sCacheWrites;
-			file.seek(offset);
-			file.write(data, size);
-		}
+		// Decoded on the pool, written to VFS once that succeeds
+		gMeshRepo.mThread->decodeMeshSkinInfo(mMeshID, data, data_size, mOffset, mRequestedBytes, false, body);
+		data = NULL;
 	}
 	else
 	{
@@ -2928,7 +3170,7 @@ void LLMeshDecompositionHandler::processFailure(LLCore::HttpStatus status)
 	// request unfulfilled rather than retry forever.
 	}
 
-void LLMeshDecompositionHandler::processData(LLCore::BufferArray * body, U8 * data, S32 data_size)
+void LLMeshDecompositionHandler::processData(LLCore::BufferArray * body, U8 *& data, S32 data_size)
 {
 	if ((! MESH_DECOMP_PROCESS_FAILED) && gMeshRepo.mThread->decompositionReceived(mMeshID, data, data_size))
 	{
@@ -2969,7 +3211,7 @@ void LLMeshPhysicsShapeHandler::processFailure(LLCore::HttpStatus status)
 	// *TODO:  Mark mesh unavailable on error
 	}
 
-void LLMeshPhysicsShapeHandler::processData(LLCore::BufferArray * body, U8 * data, S32 data_size)
+void LLMeshPhysicsShapeHandler::processData(LLCore::BufferArray * body, U8 *& data, S32 data_size)
 			{
 	if ((! MESH_PHYS_SHAPE_PROCESS_FAILED) && gMeshRepo.mThread->physicsShapeReceived(mMeshID, data, data_size))
 				{
@@ -3020,6 +3262,8 @@ void LLMeshRepository::init()
 	}
 
 	metrics_teleport_started_signal = LLViewerMessage::getInstance()->setTeleportStartedCallback(teleport_started);
+
+	mDecodeCache.initCache(LL_PATH_CACHE, (U64)gSavedSettings.getU32("FSMeshDecodeCacheSize") * 1024 * 1024);
 	
 	mThread = new LLMeshRepoThread();
 	mThread->start();
@@ -45,12 +45,14 @@
 
 #include "llconvexdecomposition.h"
 #include "lluploadfloaterobservers.h"
+#include "llmeshdecodecache.h"
 
 class LLVOVolume;
 class LLMutex;
 class LLCondition;
 class LLVFS;
 class LLMeshRepository;
+class LLThreadPool;
 
 class LLMeshUploadData
 {
@@ -321,6 +323,18 @@ public:
 	typedef std::map<LLVolumeParams, std::vector<S32> > pending_lod_map;
 	pending_lod_map mPendingLOD;
 
+	// LOD and skin info data is decoded on the thread pool.  Decoded
+	// requests come back to the repo thread keyed by the order they
+	// were issued in and are held until all earlier ones are back, so
+	// LODs reach mLoadedQ in request priority order.
+	class DecodeTask;
+	typedef std::map<U32, DecodeTask*> decode_task_map;
+	decode_task_map						mDecodedQ;
+	U32									mDecodeSequence;	// repo thread only
+	U32									mNextDecodeSequence;	// repo thread only, next to deliver
+	LLAtomicS32							mDecodesInFlight;
+	LLThreadPool*						mDecodePool;		// NULL decodes on the repo thread
+
 	// llcorehttp library interface objects.
 	LLCore::HttpStatus					mHttpStatus;
 	LLCore::HttpRequest *				mHttpRequest;
@@ -350,12 +364,26 @@ public:
 	bool fetchMeshHeader(const LLVolumeParams& mesh_params);
 	bool fetchMeshLOD(const LLVolumeParams& mesh_params, S32 lod);
 	bool headerReceived(const LLVolumeParams& mesh_params, U8* data, S32 data_size);
-	bool lodReceived(const LLVolumeParams& mesh_params, S32 lod, U8* data, S32 data_size);
 	bool skinInfoReceived(const LLUUID& mesh_id, U8* data, S32 data_size);
 	bool decompositionReceived(const LLUUID& mesh_id, U8* data, S32 data_size);
 	bool physicsShapeReceived(const LLUUID& mesh_id, U8* data, S32 data_size);
 	LLSD& getMeshHeader(const LLUUID& mesh_id);
 
+	// Hand fetched data over for decoding, takes ownership of data which
+	// must come from new[], or if body is given, data points into body
+	// and a reference to body is held instead.  from_cache data is fetched
+	// from the sim if it turns out to be bad, data from the sim is written
+	// to the VFS once it has decoded.
+	//
+	// Threads:  Repo thread only
+	void decodeMeshLOD(const LLVolumeParams& mesh_params, S32 lod, U8* data, S32 data_size,
+					   S32 offset, S32 size, bool from_cache, LLCore::BufferArray* body = NULL);
+	void decodeMeshSkinInfo(const LLUUID& mesh_id, U8* data, S32 data_size,
+							S32 offset, S32 size, bool from_cache, LLCore::BufferArray* body = NULL);
+
+	// Threads:  any
+	void decodeDone(DecodeTask* task);
+
 	void notifyLoadedMeshes();
 	S32 getActualMeshLOD(const LLVolumeParams& mesh_params, S32 lod);
 	
@@ -375,6 +403,14 @@ public:
 	//  (should hold onto mesh_id and try again later if header info does not exist)
 	bool fetchMeshPhysicsShape(const LLUUID& mesh_id);
 
+	// Hand a LOD block in the VFS to the decoder, false if it isn't there.
+	bool readMeshLODFromVFS(const LLVolumeParams& mesh_params, S32 lod, S32 offset, S32 size);
+
+	// Issue the GET for a LOD or skin info block that isn't in the VFS,
+	// false if the request could not be made.
+	bool requestMeshLOD(const LLVolumeParams& mesh_params, S32 lod, S32 offset, S32 size);
+	bool requestMeshSkinInfo(const LLUUID& mesh_id, S32 offset, S32 size);
+
 	static void incActiveLODRequests();
 	static void decActiveLODRequests();
 	static void incActiveHeaderRequests();
@@ -392,6 +428,14 @@ public:
 	void constructUrl(LLUUID mesh_id, std::string * url, int * version);
 
 private:
+	void submitDecode(DecodeTask* task);
+	// Finish the decoded requests in issue order.
+	//
+	// Threads:  Repo thread only
+	void processDecoded();
+	void finishDecode(DecodeTask* task);
+	void waitForDecodes();
+
 	// Issue a GET request to a URL with 'Range' header using
 	// the correct policy class and other attributes.  If an invalid
 	// handle is returned, the request failed and caller must retry
@@ -611,6 +655,9 @@ public:
 	std::vector<LLMeshUploadThread*> mUploadWaitList;
 
 	LLPhysicsDecomp* mDecompThread;
+
+	// Decoded LODs, shared by the repo thread and its decode tasks
+	LLMeshDecodeCache mDecodeCache;
 	
 	class inventory_data
 	{
@@ -0,0 +1,295 @@
+/**
+ * @file llobjectupdatequeue.cpp
+ * @brief Decodes cacheable object updates on the thread pool and files them
+ * with the region caches on a time budget.
+ *
+ * $LicenseInfo:firstyear=2014&license=viewerlgpl$
+ * Second Life Viewer Source Code
+ * Copyright (C) 2014, Linden Research, Inc.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation;
+ * version 2.1 of the License only.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ * Linden Research, Inc., 945 Battery Street, San Francisco, CA  94111  USA
+ * $/LicenseInfo$
+ */
+
+#include "llviewerprecompiledheaders.h"
+
+#include "llobjectupdatequeue.h"
+
+#include "lldatapacker.h"
+#include "message.h"
+#include "llthreadpool.h"
+#include "llviewerobject.h"
+#include "llviewerregion.h"
+#include "llworld.h"
+
+static LLTrace::BlockTimerStatHandle FTM_APPLY_OBJECT_UPDATES("Apply Object Updates");
+
+// The cacheable blocks of one message
+class LLObjectUpdateQueue::Batch : public LLThreadSafeRefCount
+{
+public:
+	enum EState
+	{
+		QUEUED,
+		DECODING,
+		DECODED
+	};
+
+	struct Block
+	{
+		S32 mOffset;
+		S32 mSize;
+		U32 mLocalID;	// read when queued for isPending(), 0 if unreadable
+		bool mValid;
+		LLDecodedObjectUpdate mUpdate;
+	};
+
+	Batch(U64 region_handle)
+	:	mRegionHandle(region_handle),
+		mState(QUEUED)
+	{
+	}
+
+	void decode()
+	{
+		for (std::vector<Block>::iterator it = mBlocks.begin(); it != mBlocks.end(); ++it)
+		{
+			it->mValid = LLViewerObject::decodeCacheableUpdate(&mData[it->mOffset], it->mSize, it->mUpdate);
+		}
+	}
+
+	U64 mRegionHandle;
+	std::vector<U8> mData;
+	std::vector<Block> mBlocks;
+	EState mState;
+};
+
+class LLObjectUpdateQueue::DecodeTask : public LLThreadPool::Task
+{
+public:
+	DecodeTask(LLObjectUpdateQueue* queue, Batch* batch)
+	:	mQueue(queue),
+		mBatch(batch)
+	{
+	}
+
+	/*virtual*/ void run()
+	{
+		// The main thread may have got there first
+		if (mQueue->claim(mBatch))
+		{
+			mBatch->decode();
+			mQueue->decoded(mBatch);
+		}
+		delete this;
+	}
+
+private:
+	LLObjectUpdateQueue* mQueue;
+	LLPointer<Batch> mBatch;
+};
+
+LLObjectUpdateQueue::LLObjectUpdateQueue()
+:	mCondition(NULL)
+{
+}
+
+LLObjectUpdateQueue::~LLObjectUpdateQueue()
+{
+	// Tasks still on the pool keep their batch
+	mBatches.clear();
+	delete mCondition;
+	mCondition = NULL;
+}
+
+void LLObjectUpdateQueue::beginMessage(U64 region_handle)
+{
+	llassert(mCurrentBatch.isNull());
+	mCurrentBatch = new Batch(region_handle);
+}
+
+void LLObjectUpdateQueue::addBlock(LLMessageSystem* mesgsys, S32 block_num, U32 flags)
+{
+	Batch::Block block;
+	block.mOffset = (S32)mCurrentBatch->mData.size();
+	block.mSize = mesgsys->getSizeFast(_PREHASH_ObjectData, block_num, _PREHASH_Data);
+	block.mLocalID = 0;
+	block.mValid = false;
+	block.mUpdate.mFlags = flags;
+	if (block.mSize <= 0)
+	{
+		return;
+	}
+
+	mCurrentBatch->mData.resize(block.mOffset + block.mSize);
+	U8* data = &mCurrentBatch->mData[block.mOffset];
+	mesgsys->getBinaryDataFast(_PREHASH_ObjectData, _PREHASH_Data, data, block.mSize, block_num);
+	if (LLViewerObject::peekCacheableLocalID(data, block.mSize, block.mLocalID))
+	{
+		mPendingLocalIDs.insert(block.mLocalID);
+	}
+	else
+	{
+		block.mLocalID = 0;
+	}
+	mCurrentBatch->mBlocks.push_back(block);
+}
+
+void LLObjectUpdateQueue::endMessage(LLThreadPool* pool)
+{
+	LLPointer<Batch> batch = mCurrentBatch;
+	mCurrentBatch = NULL;
+	if (batch.isNull() || batch->mBlocks.empty())
+	{
+		return;
+	}
+
+	mBatches.push_back(batch);
+	if (pool)
+	{
+		if (!mCondition)
+		{
+			mCondition = new LLCondition(NULL);
+		}
+		pool->submit(new DecodeTask(this, batch), LLThreadPool::BAND_URGENT);
+	}
+}
+
+bool LLObjectUpdateQueue::claim(Batch* batch)
+{
+	if (!mCondition)
+	{
+		// Never went to the pool
+		batch->mState = Batch::DECODING;
+		return true;
+	}
+	LLMutexLock lock(mCondition);
+	if (batch->mState != Batch::QUEUED)
+	{
+		return false;
+	}
+	batch->mState = Batch::DECODING;
+	return true;
+}
+
+void LLObjectUpdateQueue::decoded(Batch* batch)
+{
+	if (!mCondition)
+	{
+		batch->mState = Batch::DECODED;
+		return;
+	}
+	LLMutexLock lock(mCondition);
+	batch->mState = Batch::DECODED;
+	mCondition->broadcast();
+}
+
+void LLObjectUpdateQueue::apply(F32 max_time)
+{
+	if (mBatches.empty())
+	{
+		return;
+	}
+	LL_RECORD_BLOCK_TIME(FTM_APPLY_OBJECT_UPDATES);
+
+	LLTimer timer;
+	while (!mBatches.empty())
+	{
+		Batch* batch = mBatches.front();
+		if (claim(batch))
+		{
+			batch->decode();
+			decoded(batch);
+		}
+		else
+		{
+			LLMutexLock lock(mCondition);
+			if (batch->mState != Batch::DECODED)
+			{
+				// Still on a worker, pick it up next frame
+				break;
+			}
+		}
+
+		applyBatch(batch);
+		mBatches.pop_front();
+		if (timer.getElapsedTimeF32() >= max_time)
+		{
+			break;
+		}
+	}
+}
+
+void LLObjectUpdateQueue::flush()
+{
+	if (mCurrentBatch.notNull() && !mCurrentBatch->mBlocks.empty())
+	{
+		// Close the message so far and carry on with a fresh batch
+		U64 region_handle = mCurrentBatch->mRegionHandle;
+		endMessage(NULL);
+		beginMessage(region_handle);
+	}
+
+	while (!mBatches.empty())
+	{
+		Batch* batch = mBatches.front();
+		if (claim(batch))
+		{
+			batch->decode();
+			decoded(batch);
+		}
+		else
+		{
+			LLMutexLock lock(mCondition);
+			while (batch->mState != Batch::DECODED)
+			{
+				mCondition->wait();
+			}
+		}
+
+		applyBatch(batch);
+		mBatches.pop_front();
+	}
+}
+
+void LLObjectUpdateQueue::applyBatch(Batch* batch)
+{
+	// The region may have gone away meanwhile
+	LLViewerRegion* regionp = LLWorld::getInstance()->getRegionFromHandle(batch->mRegionHandle);
+	for (std::vector<Batch::Block>::iterator it = batch->mBlocks.begin(); it != batch->mBlocks.end(); ++it)
+	{
+		if (it->mLocalID)
+		{
+			std::multiset<U32>::iterator pending = mPendingLocalIDs.find(it->mLocalID);
+			if (pending != mPendingLocalIDs.end())
+			{
+				mPendingLocalIDs.erase(pending);
+			}
+		}
+		if (!regionp)
+		{
+			continue;
+		}
+		if (!it->mValid)
+		{
+			LL_WARNS() << "Ignoring truncated object update of " << it->mSize << " bytes" << LL_ENDL;
+			continue;
+		}
+		LLDataPackerBinaryBuffer dp(&batch->mData[it->mOffset], it->mSize);
+		regionp->cacheFullUpdate(dp, it->mUpdate);
+	}
+}
@@ -0,0 +1,88 @@
+/**
+ * @file llobjectupdatequeue.h
+ * @brief Decodes cacheable object updates on the thread pool and files them
+ * with the region caches on a time budget.
+ *
+ * $LicenseInfo:firstyear=2014&license=viewerlgpl$
+ * Second Life Viewer Source Code
+ * Copyright (C) 2014, Linden Research, Inc.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation;
+ * version 2.1 of the License only.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ * Linden Research, Inc., 945 Battery Street, San Francisco, CA  94111  USA
+ * $/LicenseInfo$
+ */
+
+#ifndef LL_LLOBJECTUPDATEQUEUE_H
+#define LL_LLOBJECTUPDATEQUEUE_H
+
+#include <deque>
+#include <set>
+
+#include "llpointer.h"
+
+class LLCondition;
+class LLMessageSystem;
+class LLThreadPool;
+
+// Arriving in a busy region brings thousands of ObjectUpdateCompressed
+// blocks within a few frames. The cacheable ones are copied out of the
+// message here, decoded on the thread pool and handed to their region's
+// object cache in arrival order, a frame's budget at a time. The region
+// creates the objects from its cache as usual.
+//
+// Anything else about an object that still has a block queued must not
+// overtake it, so the handlers of other object messages check isPending()
+// and flush() first.
+class LLObjectUpdateQueue
+{
+public:
+	LLObjectUpdateQueue();
+	~LLObjectUpdateQueue();
+
+	// Collects the cacheable blocks of the message being processed
+	void beginMessage(U64 region_handle);
+	void addBlock(LLMessageSystem* mesgsys, S32 block_num, U32 flags);
+	void endMessage(LLThreadPool* pool);
+
+	// Files decoded blocks for up to max_time seconds, blocks nobody has
+	// started decoding yet are decoded here rather than waited for.
+	void apply(F32 max_time);
+	// Files every queued block, waiting for the pool if need be. Blocks
+	// collected so far from the current message go first.
+	void flush();
+
+	// True if a block for this local ID is queued. Local IDs are only
+	// unique within a region, so this may flush for nothing now and then.
+	bool isPending(U32 local_id) const { return mPendingLocalIDs.find(local_id) != mPendingLocalIDs.end(); }
+	S32 getPendingCount() const { return (S32)mPendingLocalIDs.size(); }
+
+private:
+	class Batch;
+	class DecodeTask;
+	friend class DecodeTask;
+
+	// Returns true if the caller gets to decode the batch
+	bool claim(Batch* batch);
+	void decoded(Batch* batch);
+	void applyBatch(Batch* batch);
+
+	std::deque<LLPointer<Batch> > mBatches;
+	LLPointer<Batch> mCurrentBatch;
+	std::multiset<U32> mPendingLocalIDs;
+	LLCondition* mCondition;	// guards the state of the batches
+};
+
+#endif // LL_LLOBJECTUPDATEQUEUE_H
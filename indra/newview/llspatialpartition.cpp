@@ -537,6 +537,7 @@ void LLSpatialGroup::shift(const LLVector4a &offset)
 	mObjectBounds[0].add(offset);
 	mObjectExtents[0].add(offset);
 	mObjectExtents[1].add(offset);
+	shiftChildBounds(offset);
 
 	if (!getSpatialPartition()->mRenderByGroup && 
 		getSpatialPartition()->mPartitionType != LLViewerRegion::PARTITION_TREE &&
@@ -1075,6 +1076,12 @@ public:
 		
 		return false;
 	}
+
+	virtual bool isOccluded(LLViewerOctreeGroup* base_group)
+	{
+		LLSpatialGroup* group = (LLSpatialGroup*)base_group;
+		return LLPipeline::sUseOcclusion && group->isOcclusionState(LLSpatialGroup::OCCLUDED);
+	}
 	
 	virtual S32 frustumCheck(const LLViewerOctreeGroup* group)
 	{
@@ -1086,6 +1093,22 @@ public:
 		return res;
 	}
 
+	virtual bool frustumCheckChildren(const OctreeNode* branch, S32* results)
+	{
+		if (!AABBInFrustumNoFarClipChildBounds((LLViewerOctreeGroup*) branch->getListener(0), results))
+		{
+			return false;
+		}
+		for (U32 i = 0; i < branch->getChildCount(); i++)
+		{
+			if (results[i] != 0)
+			{
+				results[i] = llmin(results[i], AABBSphereIntersectGroupExtents((LLViewerOctreeGroup*) branch->getChild(i)->getListener(0)));
+			}
+		}
+		return true;
+	}
+
 	virtual S32 frustumCheckObjects(const LLViewerOctreeGroup* group)
 	{
 		S32 res = AABBInFrustumNoFarClipObjectBounds(group);
@@ -1119,6 +1142,11 @@ public:
 		return AABBInFrustumNoFarClipGroupBounds(group);
 	}
 
+	virtual bool frustumCheckChildren(const OctreeNode* branch, S32* results)
+	{
+		return AABBInFrustumNoFarClipChildBounds((LLViewerOctreeGroup*) branch->getListener(0), results);
+	}
+
 	virtual S32 frustumCheckObjects(const LLViewerOctreeGroup* group)
 	{
 		S32 res = AABBInFrustumNoFarClipObjectBounds(group);
@@ -1137,6 +1165,11 @@ public:
 		return AABBInFrustumGroupBounds(group);
 	}
 
+	virtual bool frustumCheckChildren(const OctreeNode* branch, S32* results)
+	{
+		return AABBInFrustumChildBounds((LLViewerOctreeGroup*) branch->getListener(0), results);
+	}
+
 	virtual S32 frustumCheckObjects(const LLViewerOctreeGroup* group)
 	{
 		return AABBInFrustumObjectBounds(group);
@@ -1259,6 +1292,7 @@ public:
 		: LLOctreeCull(camera), mResults(results) { }
 
 	virtual bool earlyFail(LLViewerOctreeGroup* group) { return false; }
+	virtual bool isOccluded(LLViewerOctreeGroup* group) { return false; }
 	virtual void preprocess(LLViewerOctreeGroup* group) { }
 
 	virtual void processGroup(LLViewerOctreeGroup* base_group)
@@ -1490,6 +1524,19 @@ S32 LLSpatialPartition::cull(LLCamera &camera, std::vector<LLDrawable *>* result
 	}
 	
 S32 LLSpatialPartition::cull(LLCamera &camera, bool do_occlusion)
+{
+	LLViewerOctreeCull* culler = beginCull(camera, do_occlusion);
+	{
+		LL_RECORD_BLOCK_TIME(FTM_FRUSTUM_CULL);
+		culler->traverse(mOctree);
+	}
+	delete culler;
+	
+	return 0;
+}
+
+//virtual
+LLViewerOctreeCull* LLSpatialPartition::beginCull(LLCamera& camera, bool do_occlusion)
 {
 #if LL_OCTREE_PARANOIA_CHECK
 	((LLSpatialGroup*)mOctree->getListener(0))->checkStates();
@@ -1506,24 +1553,13 @@ S32 LLSpatialPartition::cull(LLCamera &camera, bool do_occlusion)
 
 	if (LLPipeline::sShadowRender)
 	{
-		LL_RECORD_BLOCK_TIME(FTM_FRUSTUM_CULL);
-		LLOctreeCullShadow culler(&camera);
-		culler.traverse(mOctree);
+		return new LLOctreeCullShadow(&camera);
 	}
 	else if (mInfiniteFarClip || !LLPipeline::sUseFarClip)
 	{
-		LL_RECORD_BLOCK_TIME(FTM_FRUSTUM_CULL);		
-		LLOctreeCullNoFarClip culler(&camera);
-		culler.traverse(mOctree);
-	}
-	else
-	{
-		LL_RECORD_BLOCK_TIME(FTM_FRUSTUM_CULL);		
-		LLOctreeCull culler(&camera);
-		culler.traverse(mOctree);
+		return new LLOctreeCullNoFarClip(&camera);
 	}
-	
-	return 0;
+	return new LLOctreeCull(&camera);
 }
 
 void pushVerts(LLDrawInfo* params, U32 mask)
@@ -410,6 +410,7 @@ public:
 	BOOL visibleObjectsInFrustum(LLCamera& camera);
 	/*virtual*/ S32 cull(LLCamera &camera, bool do_occlusion=false); // Cull on arbitrary frustum
 	S32 cull(LLCamera &camera, std::vector<LLDrawable *>* results, BOOL for_select); // Cull on arbitrary frustum
+	/*virtual*/ LLViewerOctreeCull* beginCull(LLCamera& camera, bool do_occlusion);
 	
 	BOOL isVisible(const LLVector3& v);
 	bool isHUDPartition() ;
@@ -2178,6 +2178,13 @@ LLWorld::getInstance()->addRegion(gFirstSimHandle, gFirstSim, first_sim_size_x,
  		}
 		display_startup();
 
+		// The items of the inventory caches are still being read, add them
+		// as they come in and keep the progress screen alive meanwhile.
+		while (!gInventory.loadCachedItems(0.05f))
+		{
+			display_startup();
+		}
+
 		LLSD inv_basic = response["inventory-basic"];
  		if(inv_basic.isDefined())
  		{
@@ -40,9 +40,11 @@
 
 // Cache organization:
 // cache/texture.entries
-//  Unordered array of Entry structs
+//  Unordered array of Entry structs, memory mapped at its full size
 // cache/texture.cache
 //  First TEXTURE_CACHE_ENTRY_SIZE bytes of each texture in texture.entries in same order
+// cache/FastCache.cache
+//  Low resolution copy of each texture in texture.entries in same order, memory mapped where the address space allows
 // cache/textures/[0-F]/UUID.texture
 //  Actual texture body files
 
@@ -52,6 +54,65 @@ const F32 TEXTURE_CACHE_PURGE_AMOUNT = .20f; // % amount to reduce the cache by
 const F32 TEXTURE_CACHE_LRU_SIZE = .10f; // % amount for LRU list (low overhead to regenerate)
 const S32 TEXTURE_FAST_CACHE_ENTRY_OVERHEAD = sizeof(S32) * 4; //w, h, c, level
 const S32 TEXTURE_FAST_CACHE_ENTRY_SIZE = 16 * 16 * 4 + TEXTURE_FAST_CACHE_ENTRY_OVERHEAD;
+const size_t TEXTURE_FAST_CACHE_MAX_MAPPED_SIZE_32BIT = 256 * 1024 * 1024; // leave the rest of a 32 bit address space to textures
+
+// The fast cache file, mapped for the whole session.  Images read from it
+// point straight into the mapping and pin their entry, so that writes leave
+// those pixels alone while they are in use.  Reference counted so that the
+// mapping outlives the cache if images still use it at shutdown.
+class LLTextureFastCacheSlab : public LLThreadSafeRefCount
+{
+public:
+	LLTextureFastCacheSlab() : mMutex(NULL) {}
+
+	U8* getEntry(S32 idx) const
+	{
+		size_t offset = (size_t)idx * TEXTURE_FAST_CACHE_ENTRY_SIZE;
+		if (idx < 0 || offset + TEXTURE_FAST_CACHE_ENTRY_SIZE > mFile.getSize())
+		{
+			return NULL;
+		}
+		return mFile.getData() + offset;
+	}
+
+	// mMutex must be locked for the following functions
+	void pin(S32 idx)				{ mPins[idx]++; }
+	void unpin(S32 idx)
+	{
+		pin_map_t::iterator iter = mPins.find(idx);
+		if (iter != mPins.end() && --iter->second <= 0)
+		{
+			mPins.erase(iter);
+		}
+	}
+	bool isPinned(S32 idx) const	{ return mPins.find(idx) != mPins.end(); }
+
+	LLMappedFile mFile;
+	LLMutex mMutex;
+
+private:
+	typedef std::map<S32, S32> pin_map_t;
+	pin_map_t mPins; // entry -> number of images pointing into it
+};
+
+// Keeps an image read from the mapped fast cache pinned to its entry.
+class LLTextureFastCacheLease : public LLImageDataOwner
+{
+public:
+	// The entry must already be pinned.
+	LLTextureFastCacheLease(LLTextureFastCacheSlab* slab, S32 idx) : mSlab(slab), mIndex(idx) {}
+
+protected:
+	~LLTextureFastCacheLease()
+	{
+		LLMutexLock lock(&mSlab->mMutex);
+		mSlab->unpin(mIndex);
+	}
+
+private:
+	LLPointer<LLTextureFastCacheSlab> mSlab;
+	S32 mIndex;
+};
 
 class LLTextureCacheWorker : public LLWorkerClass
 {
@@ -761,8 +822,8 @@ LLTextureCache::LLTextureCache(bool threaded)
 	  mHeaderMutex(NULL),
 	  mListMutex(NULL),
 	  mFastCacheMutex(NULL),
-	  mHeaderAPRFile(NULL),
 	  mReadOnly(TRUE), //do not allow to change the texture cache until setReadOnly() is called.
+	  mLRUTime(0),
 	  mTexturesSizeTotal(0),
 	  mDoPurge(FALSE),
 	  mFastCachep(NULL),
@@ -775,6 +836,7 @@ LLTextureCache::~LLTextureCache()
 {
 	clearDeleteList() ;
 	writeUpdatedEntries() ;
+	closeHeaderEntriesFile();
 	delete mFastCachep;
 	delete mFastCachePoolp;
 	FREE_MEM(LLImageBase::getPrivatePool(), mFastCachePadBuffer);
@@ -854,10 +916,7 @@ std::string LLTextureCache::getTextureFileName(const LLUUID& id)
 //debug
 BOOL LLTextureCache::isInCache(const LLUUID& id) 
 {
-	LLMutexLock lock(&mHeaderMutex);
-	id_map_t::const_iterator iter = mHeaderIDMap.find(id);
-	
-	return (iter != mHeaderIDMap.end()) ;
+	return mHeaderIDMap.find(id) >= 0;
 }
 
 //debug
@@ -930,7 +989,7 @@ void LLTextureCache::purgeCache(ELLPath location, bool remove_dir)
 	if (!mReadOnly)
 	{
 		setDirNames(location);
-		llassert_always(mHeaderAPRFile == NULL);
+		llassert_always(!mHeaderEntriesFile.isOpen());
 
 		//remove the legacy cache if exists
 		std::string texture_dir = mTexturesDirName ;
@@ -1006,6 +1065,7 @@ S64 LLTextureCache::initCache(ELLPath location, S64 max_size, BOOL texture_cache
 			LLFile::mkdir(dirname);
 		}
 	}
+	mHeaderIDMap.reserve(sCacheMaxEntries);
 	readHeaderCache();
 	purgeTextures(true); // calc mTexturesSize and make some room in the texture cache if we need it
 
@@ -1018,37 +1078,66 @@ S64 LLTextureCache::initCache(ELLPath location, S64 max_size, BOOL texture_cache
 //----------------------------------------------------------------------------
 // mHeaderMutex must be locked for the following functions!
 
-LLAPRFile* LLTextureCache::openHeaderEntriesFile(bool readonly, S32 offset)
+bool LLTextureCache::openHeaderEntriesFile()
 {
-	llassert_always(mHeaderAPRFile == NULL);
-	apr_int32_t flags = readonly ? APR_READ|APR_BINARY : APR_READ|APR_WRITE|APR_BINARY;
-	mHeaderAPRFile = new LLAPRFile(mHeaderEntriesFileName, flags, getLocalAPRFilePool());
-	if(offset > 0)
+	if (mHeaderEntriesFile.isOpen())
+	{
+		return true;
+	}
+	if (mReadOnly && !LLAPRFile::isExist(mHeaderEntriesFileName, getLocalAPRFilePool()))
 	{
-		mHeaderAPRFile->seek(APR_SET, offset);
+		return false;
 	}
-	return mHeaderAPRFile;
+
+	// Map room for every entry we may ever use up front, so the mapping does
+	// not move while lock-free readers are looking at it.
+	size_t size = mReadOnly ? 0 : sizeof(EntriesInfo) + (size_t)sCacheMaxEntries * sizeof(Entry);
+	if (!mHeaderEntriesFile.open(mHeaderEntriesFileName, size, mReadOnly))
+	{
+		LL_WARNS("TextureCache") << "Unable to map " << mHeaderEntriesFileName << LL_ENDL;
+		return false;
+	}
+	if (mHeaderEntriesFile.getSize() < sizeof(EntriesInfo))
+	{
+		mHeaderEntriesFile.close();
+		return false;
+	}
+	return true;
 }
 
 void LLTextureCache::closeHeaderEntriesFile()
 {
-	if(!mHeaderAPRFile)
+	if (!mHeaderEntriesFile.isOpen())
 	{
 		return ;
 	}
 
-	delete mHeaderAPRFile;
-	mHeaderAPRFile = NULL;
+	if (!mReadOnly)
+	{
+		mHeaderEntriesFile.flush(false);
+	}
+	mHeaderEntriesFile.close();
+}
+
+LLTextureCache::Entry* LLTextureCache::getMappedEntries() const
+{
+	U8* data = mHeaderEntriesFile.getData();
+	return data ? (Entry*)(data + sizeof(EntriesInfo)) : NULL;
+}
+
+U32 LLTextureCache::getMappedEntryCount() const
+{
+	size_t size = mHeaderEntriesFile.getSize();
+	return size > sizeof(EntriesInfo) ? (U32)((size - sizeof(EntriesInfo)) / sizeof(Entry)) : 0;
 }
 
 void LLTextureCache::readEntriesHeader()
 {
 	// mHeaderEntriesInfo initializes to default values so safe not to read it
-	llassert_always(mHeaderAPRFile == NULL);
-	if (LLAPRFile::isExist(mHeaderEntriesFileName, getLocalAPRFilePool()))
+	bool created = !mHeaderEntriesFile.isOpen() && !LLAPRFile::isExist(mHeaderEntriesFileName, getLocalAPRFilePool());
+	if (openHeaderEntriesFile() && !created)
 	{
-		LLAPRFile::readEx(mHeaderEntriesFileName, (U8*)&mHeaderEntriesInfo, 0, sizeof(EntriesInfo),
-						  getLocalAPRFilePool());
+		memcpy(&mHeaderEntriesInfo, mHeaderEntriesFile.getData(), sizeof(EntriesInfo));
 	}
 	else //create an empty entries header.
 	{
@@ -1060,24 +1149,24 @@ void LLTextureCache::readEntriesHeader()
 
 void LLTextureCache::writeEntriesHeader()
 {
-	llassert_always(mHeaderAPRFile == NULL);
 	if (!mReadOnly)
 	{
-		LLAPRFile::writeEx(mHeaderEntriesFileName, (U8*)&mHeaderEntriesInfo, 0, sizeof(EntriesInfo),
-						   getLocalAPRFilePool());
+		if (mHeaderEntriesFile.isOpen())
+		{
+			memcpy(mHeaderEntriesFile.getData(), &mHeaderEntriesInfo, sizeof(EntriesInfo));
+		}
+		else
+		{
+			LLAPRFile::writeEx(mHeaderEntriesFileName, (U8*)&mHeaderEntriesInfo, 0, sizeof(EntriesInfo),
+							   getLocalAPRFilePool());
+		}
 	}
 }
 
 //mHeaderMutex is locked before calling this.
 S32 LLTextureCache::openAndReadEntry(const LLUUID& id, Entry& entry, bool create)
 {
-	S32 idx = -1;
-	
-	id_map_t::iterator iter1 = mHeaderIDMap.find(id);
-	if (iter1 != mHeaderIDMap.end())
-	{
-		idx = iter1->second;
-	}
+	S32 idx = mHeaderIDMap.find(id);
 
 	if (idx < 0)
 	{
@@ -1097,6 +1186,8 @@ S32 LLTextureCache::openAndReadEntry(const LLUUID& id, Entry& entry, bool create
 			else
 			{
 				// Look for a still valid entry in the LRU
+				Entry* entries = getMappedEntries();
+				U32 num_entries = getMappedEntryCount();
 				for (std::set<LLUUID>::iterator iter2 = mLRU.begin(); iter2 != mLRU.end();)
 				{
 					std::set<LLUUID>::iterator curiter2 = iter2++;
@@ -1104,10 +1195,16 @@ S32 LLTextureCache::openAndReadEntry(const LLUUID& id, Entry& entry, bool create
 					// Erase entry from LRU regardless
 					mLRU.erase(curiter2);
 					// Look up entry and use it if it is valid
-					id_map_t::iterator iter3 = mHeaderIDMap.find(oldid);
-					if (iter3 != mHeaderIDMap.end() && iter3->second >= 0)
+					S32 oldidx = mHeaderIDMap.find(oldid);
+					if (oldidx >= 0)
 					{
-						idx = iter3->second;
+						// Reads do not take the header mutex and so can not take
+						// their texture off the LRU, they stamp the entry instead.
+						if (entries && (U32)oldidx < num_entries && entries[oldidx].mTime > mLRUTime)
+						{
+							continue;
+						}
+						idx = oldidx;
 						removeCachedTexture(oldid) ;//remove the existing cached texture to release the entry index.
 						break;
 					}
@@ -1129,23 +1226,14 @@ S32 LLTextureCache::openAndReadEntry(const LLUUID& id, Entry& entry, bool create
 		// Remove this entry from the LRU if it exists
 		mLRU.erase(id);
 		// Read the entry
-		idx_entry_map_t::iterator iter = mUpdatedEntryMap.find(idx) ;
-		if(iter != mUpdatedEntryMap.end())
-		{
-			entry = iter->second ;
-		}
-		else
-		{
-			readEntryFromHeaderImmediately(idx, entry) ;
-		}
-		if(entry.mImageSize <= entry.mBodySize)//it happens on 64-bit systems, do not know why
+		readEntryFromHeaderImmediately(idx, entry) ;
+		if(idx >= 0 && entry.mImageSize <= entry.mBodySize)//it happens on 64-bit systems, do not know why
 		{
 			LL_WARNS() << "corrupted entry: " << id << " entry image size: " << entry.mImageSize << " entry body size: " << entry.mBodySize << LL_ENDL ;
 
 			//erase this entry and the cached texture from the cache.
 			std::string tex_filename = getTextureFileName(id);
 			removeEntry(idx, entry, tex_filename) ;
-			mUpdatedEntryMap.erase(idx) ;
 			idx = -1 ;
 		}
 	}
@@ -1155,73 +1243,66 @@ S32 LLTextureCache::openAndReadEntry(const LLUUID& id, Entry& entry, bool create
 //mHeaderMutex is locked before calling this.
 void LLTextureCache::writeEntryToHeaderImmediately(S32& idx, Entry& entry, bool write_header)
 {	
-	LLAPRFile* aprfile ;
-	S32 bytes_written ;
-	S32 offset = sizeof(EntriesInfo) + idx * sizeof(Entry);
-	if(write_header)
-	{
-		aprfile = openHeaderEntriesFile(false, 0);		
-		bytes_written = aprfile->write((U8*)&mHeaderEntriesInfo, sizeof(EntriesInfo)) ;
-		if(bytes_written != sizeof(EntriesInfo))
-		{
-			clearCorruptedCache() ; //clear the cache.
-			idx = -1 ;//mark the idx invalid.
-			return ;
-		}
-
-		mHeaderAPRFile->seek(APR_SET, offset);
-	}
-	else
+	if (mReadOnly)
 	{
-		aprfile = openHeaderEntriesFile(false, offset);
+		return;
 	}
-	bytes_written = aprfile->write((void*)&entry, (S32)sizeof(Entry));
-	if(bytes_written != sizeof(Entry))
+
+	Entry* entries = getMappedEntries();
+	if (!entries || idx < 0 || (U32)idx >= getMappedEntryCount())
 	{
 		clearCorruptedCache() ; //clear the cache.
 		idx = -1 ;//mark the idx invalid.
-
 		return ;
 	}
 
-	closeHeaderEntriesFile();
-	mUpdatedEntryMap.erase(idx) ;
+	if(write_header)
+	{
+		writeEntriesHeader();
+	}
+	mHeaderIDMap.writeEntry(entry, &entries[idx]);
 }
 
 //mHeaderMutex is locked before calling this.
 void LLTextureCache::readEntryFromHeaderImmediately(S32& idx, Entry& entry)
 {
-	S32 offset = sizeof(EntriesInfo) + idx * sizeof(Entry);
-	LLAPRFile* aprfile = openHeaderEntriesFile(true, offset);
-	S32 bytes_read = aprfile->read((void*)&entry, (S32)sizeof(Entry));
-	closeHeaderEntriesFile();
-
-	if(bytes_read != sizeof(Entry))
+	const Entry* entries = getMappedEntries();
+	if (!entries || idx < 0 || (U32)idx >= getMappedEntryCount())
 	{
 		clearCorruptedCache() ; //clear the cache.
 		idx = -1 ;//mark the idx invalid.
+		return ;
 	}
+	entry = entries[idx];
 }
 
-//mHeaderMutex is locked before calling this.
-//update an existing entry time stamp, delay writing.
+//update an existing entry time stamp, written straight to the mapped file.
+//called without mHeaderMutex from getHeaderCacheEntry(), so the entry may have
+//been reused for another texture in the meantime; stamping that one is harmless.
 void LLTextureCache::updateEntryTimeStamp(S32 idx, Entry& entry)
 {
 	static const U32 MAX_ENTRIES_WITHOUT_TIME_STAMP = (U32)(LLTextureCache::sCacheMaxEntries * 0.75f) ;
 
-	if(mHeaderEntriesInfo.mEntries < MAX_ENTRIES_WITHOUT_TIME_STAMP)
+	if (idx < 0 || mReadOnly)
 	{
-		return ; //there are enough empty entry index space, no need to stamp time.
+		return ;
 	}
 
-	if (idx >= 0)
+	Entry* entries = getMappedEntries();
+	if (!entries || (U32)idx >= getMappedEntryCount())
 	{
-		if (!mReadOnly)
-		{
-			entry.mTime = time(NULL);			
-			mUpdatedEntryMap[idx] = entry ;
-		}
+		return ;
+	}
+
+	// While there is enough empty entry index space there is no need to stamp
+	// time, except for entries that may still be on the LRU.
+	if (mHeaderEntriesInfo.mEntries < MAX_ENTRIES_WITHOUT_TIME_STAMP && entries[idx].mTime > mLRUTime)
+	{
+		return ;
 	}
+
+	entry.mTime = time(NULL);
+	entries[idx].mTime = entry.mTime;
 }
 
 //update an existing entry, write to header file immediately.
@@ -1242,7 +1323,6 @@ bool LLTextureCache::updateEntry(S32& idx, Entry& entry, S32 new_image_size, S32
 		bool update_header = false ;
 		if(entry.mImageSize < 0) //is a brand-new entry
 		{
-			mHeaderIDMap[entry.mID] = idx;
 			mTexturesSizeMap[entry.mID] = new_body_size ;
 			mTexturesSizeTotal += new_body_size ;
 			
@@ -1261,6 +1341,12 @@ bool LLTextureCache::updateEntry(S32& idx, Entry& entry, S32 new_image_size, S32
 		entry.mBodySize = new_body_size ;
 		
 		writeEntryToHeaderImmediately(idx, entry, update_header) ;
+
+		if (update_header && idx >= 0)
+		{
+			// Only publish the id once its entry is in place, lookups do not lock.
+			mHeaderIDMap.insert(entry.mID, idx);
+		}
 	
 		if (mTexturesSizeTotal > sCacheMaxTexturesSize)
 		{
@@ -1287,37 +1373,23 @@ U32 LLTextureCache::openAndReadEntries(std::vector<Entry>& entries)
 	mFreeList.clear();
 	mTexturesSizeTotal = 0;
 
-	LLAPRFile* aprfile = NULL; 
-	if(mUpdatedEntryMap.empty())
+	if (num_entries > getMappedEntryCount())
 	{
-		aprfile = openHeaderEntriesFile(true, (S32)sizeof(EntriesInfo));
-	}
-	else //update the header file first.
-	{
-		aprfile = openHeaderEntriesFile(false, 0);
-		updatedHeaderEntriesFile() ;
-		if(!aprfile)
-		{
-			return 0;
-		}
-		aprfile->seek(APR_SET, (S32)sizeof(EntriesInfo));
+		LL_WARNS() << "Corrupted header entries, " << num_entries << " entries but room for " << getMappedEntryCount() << LL_ENDL;
+		purgeAllTextures(false);
+		return 0;
 	}
+
+	const Entry* mapped_entries = getMappedEntries();
+	entries.reserve(num_entries);
 	for (U32 idx=0; idx<num_entries; idx++)
 	{
-		Entry entry;
-		S32 bytes_read = aprfile->read((void*)(&entry), (S32)sizeof(Entry));
-		if (bytes_read < sizeof(Entry))
-		{
-			LL_WARNS() << "Corrupted header entries, failed at " << idx << " / " << num_entries << LL_ENDL;
-			closeHeaderEntriesFile();
-			purgeAllTextures(false);
-			return 0;
-		}
+		const Entry& entry = mapped_entries[idx];
 		entries.push_back(entry);
 // 		LL_INFOS() << "ENTRY: " << entry.mTime << " TEX: " << entry.mID << " IDX: " << idx << " Size: " << entry.mImageSize << LL_ENDL;
 		if(entry.mImageSize > entry.mBodySize)
 		{
-			mHeaderIDMap[entry.mID] = idx;
+			mHeaderIDMap.insert(entry.mID, idx);
 			mTexturesSizeMap[entry.mID] = entry.mBodySize;
 			mTexturesSizeTotal += entry.mBodySize;
 		}
@@ -1326,78 +1398,40 @@ U32 LLTextureCache::openAndReadEntries(std::vector<Entry>& entries)
 			mFreeList.insert(idx);
 		}
 	}
-	closeHeaderEntriesFile();
 	return num_entries;
 }
 
 void LLTextureCache::writeEntriesAndClose(const std::vector<Entry>& entries)
 {
-	S32 num_entries = entries.size();
+	U32 num_entries = entries.size();
 	llassert_always(num_entries == mHeaderEntriesInfo.mEntries);
 	
 	if (!mReadOnly)
 	{
-		LLAPRFile* aprfile = openHeaderEntriesFile(false, (S32)sizeof(EntriesInfo));
-		for (S32 idx=0; idx<num_entries; idx++)
+		Entry* mapped_entries = getMappedEntries();
+		if (num_entries && (!mapped_entries || num_entries > getMappedEntryCount()))
+		{
+			clearCorruptedCache() ; //clear the cache.
+			return ;
+		}
+		for (U32 idx=0; idx<num_entries; idx++)
 		{
-			S32 bytes_written = aprfile->write((void*)(&entries[idx]), (S32)sizeof(Entry));
-			if(bytes_written != sizeof(Entry))
+			// Most entries are unchanged, leave their pages clean.
+			if (memcmp(&mapped_entries[idx], &entries[idx], sizeof(Entry)))
 			{
-				clearCorruptedCache() ; //clear the cache.
-				return ;
+				mHeaderIDMap.writeEntry(entries[idx], &mapped_entries[idx]);
 			}
 		}
-		closeHeaderEntriesFile();
+		mHeaderEntriesFile.flush();
 	}
 }
 
+// Schedules the mapped entries file for write back.  Needs no lock.
 void LLTextureCache::writeUpdatedEntries()
 {
-	lockHeaders() ;
-	if (!mReadOnly && !mUpdatedEntryMap.empty())
+	if (!mReadOnly && mHeaderEntriesFile.isOpen())
 	{
-		openHeaderEntriesFile(false, 0);
-		updatedHeaderEntriesFile() ;
-		closeHeaderEntriesFile();
-	}
-	unlockHeaders() ;
-}
-
-//mHeaderMutex is locked and mHeaderAPRFile is created before calling this.
-void LLTextureCache::updatedHeaderEntriesFile()
-{
-	if (!mReadOnly && !mUpdatedEntryMap.empty() && mHeaderAPRFile)
-	{
-		//entriesInfo
-		mHeaderAPRFile->seek(APR_SET, 0);
-		S32 bytes_written = mHeaderAPRFile->write((U8*)&mHeaderEntriesInfo, sizeof(EntriesInfo)) ;
-		if(bytes_written != sizeof(EntriesInfo))
-		{
-			clearCorruptedCache() ; //clear the cache.
-			return ;
-		}
-		
-		//write each updated entry
-		S32 entry_size = (S32)sizeof(Entry) ;
-		S32 prev_idx = -1 ;
-		S32 delta_idx ;
-		for (idx_entry_map_t::iterator iter = mUpdatedEntryMap.begin(); iter != mUpdatedEntryMap.end(); ++iter)
-		{
-			delta_idx = iter->first - prev_idx - 1;
-			prev_idx = iter->first ;
-			if(delta_idx)
-			{
-				mHeaderAPRFile->seek(APR_CUR, delta_idx * entry_size);
-			}
-			
-			bytes_written = mHeaderAPRFile->write((void*)(&iter->second), entry_size);
-			if(bytes_written != entry_size)
-			{
-				clearCorruptedCache() ; //clear the cache.
-				return ;
-			}
-		}
-		mUpdatedEntryMap.clear() ;
+		mHeaderEntriesFile.flush();
 	}
 }
 //----------------------------------------------------------------------------
@@ -1469,6 +1503,7 @@ void LLTextureCache::readHeaderCache()
 			else
 			{
 				S32 lru_entries = (S32)((F32)sCacheMaxEntries * TEXTURE_CACHE_LRU_SIZE);
+				mLRUTime = time(NULL);
 				for (std::set<lru_data_t>::iterator iter = lru.begin(); iter != lru.end(); ++iter)
 				{
 					mLRU.insert(entries[iter->second].mID);
@@ -1499,6 +1534,8 @@ void LLTextureCache::readHeaderCache()
 				llassert_always(new_entries.size() <= sCacheMaxEntries);
 				mHeaderEntriesInfo.mEntries = new_entries.size();
 				writeEntriesHeader();
+				// Entries move around, so nothing may be found until the index is rebuilt.
+				mHeaderIDMap.clear();
 				writeEntriesAndClose(new_entries);
 				mHeaderMutex.unlock(); // unlock the mutex before calling again
 				readHeaderCache(); // repeat with new entries file
@@ -1520,7 +1557,6 @@ void LLTextureCache::clearCorruptedCache()
 {
 	LL_WARNS() << "the texture cache is corrupted, need to be cleared." << LL_ENDL ;
 
-	closeHeaderEntriesFile();//close possible file handler
 	purgeAllTextures(false) ; //clear the cache.
 	
 	if (!mReadOnly) //regenerate the directory tree if not exists.
@@ -1542,6 +1578,13 @@ void LLTextureCache::purgeAllTextures(bool purge_directories)
 {
 	if (!mReadOnly)
 	{
+		if (purge_directories)
+		{
+			// The entries file goes with the directory, and a mapped file can
+			// not be deleted everywhere.
+			closeHeaderEntriesFile();
+		}
+
 		const char* subdirs = "0123456789abcdef";
 		std::string delem = gDirUtilp->getDirDelimiter();
 		std::string mask = "*";
@@ -1572,7 +1615,6 @@ void LLTextureCache::purgeAllTextures(bool purge_directories)
 	mTexturesSizeTotal = 0;
 	mFreeList.clear();
 	mTexturesSizeTotal = 0;
-	mUpdatedEntryMap.clear();
 
 	// Info with 0 entries
 	mHeaderEntriesInfo.mVersion = sHeaderCacheVersion;
@@ -1615,10 +1657,9 @@ void LLTextureCache::purgeTextures(bool validate)
 	{
 		if (iter1->second > 0)
 		{
-			id_map_t::iterator iter2 = mHeaderIDMap.find(iter1->first);
-			if (iter2 != mHeaderIDMap.end())
+			S32 idx = mHeaderIDMap.find(iter1->first);
+			if (idx >= 0)
 			{
-				S32 idx = iter2->second;
 				time_idx_set.insert(std::make_pair(entries[idx].mTime, idx));
 // 				LL_INFOS() << "TIME: " << entries[idx].mTime << " TEX: " << entries[idx].mID << " IDX: " << idx << " Size: " << entries[idx].mImageSize << LL_ENDL;
 			}
@@ -1725,10 +1766,15 @@ LLTextureCacheWorker* LLTextureCache::getWriter(handle_t handle)
 // Called from work thread
 
 // Reads imagesize from the header, updates timestamp
+// Lock free unless the entry turns out to need repairing.
 S32 LLTextureCache::getHeaderCacheEntry(const LLUUID& id, Entry& entry)
 {
-	LLMutexLock lock(&mHeaderMutex);	
-	S32 idx = openAndReadEntry(id, entry, false);
+	S32 idx = mHeaderIDMap.findEntry(id, getMappedEntries(), getMappedEntryCount(), entry);
+	if (idx >= 0 && (entry.mID != id || entry.mImageSize <= entry.mBodySize))
+	{
+		LLMutexLock lock(&mHeaderMutex);
+		idx = openAndReadEntry(id, entry, false);
+	}
 	if (idx >= 0)
 	{		
 		updateEntryTimeStamp(idx, entry); // updates time
@@ -1863,18 +1909,37 @@ LLTextureCache::handle_t LLTextureCache::writeToCache(const LLUUID& id, U32 prio
 //called in the main thread
 LLPointer<LLImageRaw> LLTextureCache::readFromFastCache(const LLUUID& id, S32& discardlevel)
 {
-	U32 offset;
+	S32 idx = mHeaderIDMap.find(id);
+	if(idx < 0)
 	{
-		LLMutexLock lock(&mHeaderMutex);
-		id_map_t::const_iterator iter = mHeaderIDMap.find(id);
-		if(iter == mHeaderIDMap.end())
+		return NULL; //not in the cache
+	}
+
+	if (mFastCacheSlab.notNull())
+	{
+		// Hand out the pixels in place, no copy and no file I/O.
+		LLMutexLock lock(&mFastCacheSlab->mMutex);
+		const U8* entry = mFastCacheSlab->getEntry(idx);
+		if (!entry)
 		{
-			return NULL; //not in the cache
+			return NULL;
 		}
 
-		offset = iter->second;
+		S32 head[4];
+		memcpy(head, entry, TEXTURE_FAST_CACHE_ENTRY_OVERHEAD);
+		if (head[0] <= 0 || head[1] <= 0 || head[2] <= 0 ||
+			(S64)head[0] * head[1] * head[2] > TEXTURE_FAST_CACHE_ENTRY_SIZE - TEXTURE_FAST_CACHE_ENTRY_OVERHEAD)
+		{
+			return NULL; //invalid
+		}
+		discardlevel = head[3];
+
+		mFastCacheSlab->pin(idx);
+		return new LLImageRaw(entry + TEXTURE_FAST_CACHE_ENTRY_OVERHEAD, head[0], head[1], head[2],
+							  new LLTextureFastCacheLease(mFastCacheSlab, idx));
 	}
-	offset *= TEXTURE_FAST_CACHE_ENTRY_SIZE;
+
+	U32 offset = (U32)idx * TEXTURE_FAST_CACHE_ENTRY_SIZE;
 
 	U8* data;
 	S32 head[4];
@@ -1963,6 +2028,28 @@ bool LLTextureCache::writeToFastCache(S32 id, LLPointer<LLImageRaw> raw, S32 dis
 		copy_size = llmin(copy_size, TEXTURE_FAST_CACHE_ENTRY_SIZE - TEXTURE_FAST_CACHE_ENTRY_OVERHEAD);
 		memcpy(mFastCachePadBuffer + TEXTURE_FAST_CACHE_ENTRY_OVERHEAD, raw->getData(), copy_size);
 	}
+
+	if (mFastCacheSlab.notNull())
+	{
+		LLMutexLock lock(&mFastCacheSlab->mMutex);
+		U8* entry = mFastCacheSlab->getEntry(id);
+		if (entry && !mFastCacheSlab->mFile.isReadOnly())
+		{
+			if (mFastCacheSlab->isPinned(id))
+			{
+				// An image read from the entry before it was reused still
+				// points at the old pixels.  Leave them be and mark the
+				// entry invalid, the texture is fetched normally next time.
+				memset(entry, 0, TEXTURE_FAST_CACHE_ENTRY_OVERHEAD);
+			}
+			else
+			{
+				memcpy(entry, mFastCachePadBuffer, TEXTURE_FAST_CACHE_ENTRY_SIZE);
+			}
+		}
+		return true;
+	}
+
 	S32 offset = id * TEXTURE_FAST_CACHE_ENTRY_SIZE;
 
 	{
@@ -1985,6 +2072,11 @@ bool LLTextureCache::writeToFastCache(S32 id, LLPointer<LLImageRaw> raw, S32 dis
 
 void LLTextureCache::openFastCache(bool first_time)
 {
+	if (mFastCacheSlab.notNull())
+	{
+		return; //mapped for the whole session.
+	}
+
 	if(!mFastCachep)
 	{
 		if(first_time)
@@ -1993,6 +2085,10 @@ void LLTextureCache::openFastCache(bool first_time)
 			{
 				mFastCachePadBuffer = (U8*)ALLOCATE_MEM(LLImageBase::getPrivatePool(), TEXTURE_FAST_CACHE_ENTRY_SIZE);
 			}
+			if (mapFastCache())
+			{
+				return;
+			}
 			mFastCachePoolp = new LLVolatileAPRPool();
 			if (LLAPRFile::isExist(mFastCacheFileName, mFastCachePoolp))
 			{
@@ -2013,6 +2109,29 @@ void LLTextureCache::openFastCache(bool first_time)
 	return;
 }
 	
+//called from openFastCache() in the main thread, before any worker runs.
+//maps the whole fast cache and asks the OS to read in the part in use, so
+//the first textures of a session come up without waiting on the disk.
+bool LLTextureCache::mapFastCache()
+{
+	size_t size = (size_t)sCacheMaxEntries * TEXTURE_FAST_CACHE_ENTRY_SIZE;
+	if (sizeof(void*) < 8 && size > TEXTURE_FAST_CACHE_MAX_MAPPED_SIZE_32BIT)
+	{
+		return false;
+	}
+
+	LLPointer<LLTextureFastCacheSlab> slab = new LLTextureFastCacheSlab();
+	if (!slab->mFile.open(mFastCacheFileName, mReadOnly ? 0 : size, mReadOnly))
+	{
+		LL_WARNS("TextureCache") << "Unable to map " << mFastCacheFileName << ", using file I/O" << LL_ENDL;
+		return false;
+	}
+	slab->mFile.prefetch(0, (size_t)mHeaderEntriesInfo.mEntries * TEXTURE_FAST_CACHE_ENTRY_SIZE);
+
+	mFastCacheSlab = slab;
+	return true;
+}
+
 void LLTextureCache::closeFastCache(bool forced)
 {	
 	static const F32 timeout = 10.f ; //seconds
@@ -2100,9 +2219,10 @@ void LLTextureCache::removeEntry(S32 idx, Entry& entry, std::string& filename)
 		}
 		mTexturesSizeTotal -= entry.mBodySize;
 
+		// Unpublish the id before its entry can be handed to another texture.
+		mHeaderIDMap.erase(entry.mID);
 		entry.mImageSize = -1;
 		entry.mBodySize = 0;
-		mHeaderIDMap.erase(entry.mID);
 		mTexturesSizeMap.erase(entry.mID);		
 		mFreeList.insert(idx);	
 	}
@@ -28,14 +28,17 @@
 #define LL_LLTEXTURECACHE_H
 
 #include "lldir.h"
+#include "llmappedfile.h"
 #include "llstl.h"
 #include "llstring.h"
 #include "lluuid.h"
+#include "lluuidindexmap.h"
 
 #include "llworkerthread.h"
 
 class LLImageFormatted;
 class LLTextureCacheWorker;
+class LLTextureFastCacheSlab;
 class LLImageRaw;
 
 class LLTextureCache : public LLWorkerThread
@@ -153,8 +156,10 @@ private:
 	void clearCorruptedCache();
 	void purgeAllTextures(bool purge_directories);
 	void purgeTextures(bool validate);
-	LLAPRFile* openHeaderEntriesFile(bool readonly, S32 offset);
+	bool openHeaderEntriesFile();
 	void closeHeaderEntriesFile();
+	Entry* getMappedEntries() const;
+	U32 getMappedEntryCount() const;
 	void readEntriesHeader();
 	void writeEntriesHeader();
 	S32 openAndReadEntry(const LLUUID& id, Entry& entry, bool create);
@@ -169,11 +174,11 @@ private:
 	S32 getHeaderCacheEntry(const LLUUID& id, Entry& entry);
 	S32 setHeaderCacheEntry(const LLUUID& id, Entry& entry, S32 imagesize, S32 datasize);
 	void writeUpdatedEntries() ;
-	void updatedHeaderEntriesFile() ;
 	void lockHeaders() { mHeaderMutex.lock(); }
 	void unlockHeaders() { mHeaderMutex.unlock(); }
 	
 	void openFastCache(bool first_time = false);
+	bool mapFastCache();
 	void closeFastCache(bool forced = false);
 	bool writeToFastCache(S32 id, LLPointer<LLImageRaw> raw, S32 discardlevel);	
 
@@ -183,7 +188,7 @@ private:
 	LLMutex mHeaderMutex;
 	LLMutex mListMutex;
 	LLMutex mFastCacheMutex;
-	LLAPRFile* mHeaderAPRFile;
+	LLMappedFile mHeaderEntriesFile;
 	LLVolatileAPRPool* mFastCachePoolp;
 	
 	typedef std::map<handle_t, LLTextureCacheWorker*> handle_map_t;
@@ -207,10 +212,11 @@ private:
 	EntriesInfo mHeaderEntriesInfo;
 	std::set<S32> mFreeList; // deleted entries
 	std::set<LLUUID> mLRU;
-	typedef std::map<LLUUID, S32> id_map_t;
-	id_map_t mHeaderIDMap;
+	U32 mLRUTime; // when mLRU was last rebuilt
+	LLUUIDIndexMap mHeaderIDMap;
 
 	LLAPRFile*   mFastCachep;
+	LLPointer<LLTextureFastCacheSlab> mFastCacheSlab; // replaces mFastCachep when the fast cache is mapped
 	LLFrameTimer mFastCacheTimer;
 	U8*          mFastCachePadBuffer;
 
@@ -221,9 +227,6 @@ private:
 	S64 mTexturesSizeTotal;
 	LLAtomic32<BOOL> mDoPurge;
 
-	typedef std::map<S32, Entry> idx_entry_map_t;
-	idx_entry_map_t mUpdatedEntryMap;
-
 	// Statics
 	static F32 sHeaderCacheVersion;
 	static U32 sCacheMaxEntries;
@@ -1671,12 +1671,25 @@ bool LLTextureFetchWorker::doWork(S32 param)
 				mFileSize = total_size + 1 ; //flag the file is not fully loaded.
 			}
 			
-			U8 * buffer = (U8 *) ALLOCATE_MEM(LLImageBase::getPrivatePool(), total_size);
-			if (cur_size > 0)
+			U8 * buffer(NULL);
+			if (! cur_size && ! src_offset && ! LLImageBase::getPrivatePool())
 			{
-				memcpy(buffer, mFormattedImage->getData(), cur_size);
+				// A body received into one block sized from its Content-Length
+				// is aligned heap memory just like ALLOCATE_MEM() without a pool
+				// hands out, so the image can take it over instead of copying.
+				size_t detached_size(0);
+				buffer = (U8 *) mHttpBufferArray->detach(&detached_size);
+				llassert_always(! buffer || detached_size == append_size);
+			}
+			if (! buffer)
+			{
+				buffer = (U8 *) ALLOCATE_MEM(LLImageBase::getPrivatePool(), total_size);
+				if (cur_size > 0)
+				{
+					memcpy(buffer, mFormattedImage->getData(), cur_size);
+				}
+				mHttpBufferArray->read(src_offset, (char *) buffer + cur_size, append_size);
 			}
-			mHttpBufferArray->read(src_offset, (char *) buffer + cur_size, append_size);
 
 			// NOTE: setData releases current data and owns new data (buffer)
 			mFormattedImage->setData(buffer, total_size);
@@ -2162,9 +2175,8 @@ S32 LLTextureFetchWorker::callbackHttpGet(LLCore::HttpResponse * response,
 		if (data_size > 0)
 		{
 			LLViewerStatsRecorder::instance().textureFetch(data_size);
-			// *TODO: set the formatted image data here directly to avoid the copy
 
-			// Hold on to body for later copy
+			// Hold on to body, its storage is taken over or copied later
 			llassert_always(NULL == mHttpBufferArray);
 			body->addRef();
 			mHttpBufferArray = body;
@@ -513,6 +513,13 @@ bool LLViewerInventoryItem::importFileLocal(LLFILE* fp)
 	return rv;
 }
 
+bool LLViewerInventoryItem::importLLSD(const LLSD& sd)
+{
+	bool rv = fromLLSD(sd);
+	mIsComplete = false;
+	return rv;
+}
+
 bool LLViewerInventoryItem::exportFileLocal(LLFILE* fp) const
 {
 	std::string uuid_str;
@@ -818,6 +825,37 @@ bool LLViewerInventoryCategory::exportFileLocal(LLFILE* fp) const
 	return true;
 }
 
+LLSD LLViewerInventoryCategory::exportLLSD() const
+{
+	LLSD sd;
+	sd["cat_id"] = mUUID;
+	sd["parent_id"] = mParentUUID;
+	sd["type"] = (S32)mType;
+	sd["pref_type"] = (S32)mPreferredType;
+	sd["name"] = mName;
+	sd["owner_id"] = mOwnerID;
+	sd["version"] = mVersion;
+	return sd;
+}
+
+bool LLViewerInventoryCategory::importLLSD(const LLSD& sd)
+{
+	if (!sd.has("cat_id"))
+	{
+		return false;
+	}
+	mUUID = sd["cat_id"].asUUID();
+	mParentUUID = sd["parent_id"].asUUID();
+	mType = (LLAssetType::EType)sd["type"].asInteger();
+	mPreferredType = (LLFolderType::EType)sd["pref_type"].asInteger();
+	mName = sd["name"].asString();
+	LLStringUtil::replaceNonstandardASCII(mName, ' ');
+	LLStringUtil::replaceChar(mName, '|', ' ');
+	mOwnerID = sd["owner_id"].asUUID();
+	mVersion = sd["version"].asInteger();
+	return true;
+}
+
 void LLViewerInventoryCategory::determineFolderType()
 {
 	/* Do NOT uncomment this code.  This is for future 2.1 support of ensembles.
@@ -133,6 +133,8 @@ public:
 	// other than cacheing.
 	bool exportFileLocal(LLFILE* fp) const;
 	bool importFileLocal(LLFILE* fp);
+	LLSD exportLLSD() const { return asLLSD(); }
+	bool importLLSD(const LLSD& sd);
 
 	// new methods
 	BOOL isFinished() const { return mIsComplete; }
@@ -223,6 +225,8 @@ public:
 	// other than caching.
 	bool exportFileLocal(LLFILE* fp) const;
 	bool importFileLocal(LLFILE* fp);
+	LLSD exportLLSD() const;
+	bool importLLSD(const LLSD& sd);
 	void determineFolderType();
 	void changeType(LLFolderType::EType new_folder_type);
 
@@ -5679,6 +5679,7 @@ void process_kill_object(LLMessageSystem *mesgsys, void **user_data)
 	{
 		U32	local_id;
 		mesgsys->getU32Fast(_PREHASH_ObjectData, _PREHASH_ID, local_id, i);
+		gObjectList.flushObjectUpdates(local_id);
 
 		LLViewerObjectList::getUUIDFromLocal(id, local_id, ip, port); 
 		if (id == LLUUID::null)
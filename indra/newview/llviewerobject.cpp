@@ -128,6 +128,15 @@ F64Seconds	LLViewerObject::sPhaseOutUpdateInterpolationTime(2.0);	// For motion
 
 std::map<std::string, U32> LLViewerObject::sObjectDataMap;
 
+// Offsets from sObjectDataMap for decodeCacheableUpdate()
+static U32 sLocalIDOffset = 0;
+static U32 sCRCOffset = 0;
+static U32 sScaleOffset = 0;
+static U32 sPosOffset = 0;
+static U32 sRotOffset = 0;
+static U32 sSpecialCodeOffset = 0;
+static U32 sParentIDOffset = 0;
+
 // The maximum size of an object extra parameters binary (packed) block
 #define MAX_OBJECT_PARAMS_SIZE 1024
 
@@ -583,6 +592,14 @@ void LLViewerObject::initObjectDataMap()
 	//-------
 	//The rest items are not included here
 	//-------
+
+	sLocalIDOffset = sObjectDataMap["LocalID"];
+	sCRCOffset = sObjectDataMap["CRC"];
+	sScaleOffset = sObjectDataMap["Scale"];
+	sPosOffset = sObjectDataMap["Pos"];
+	sRotOffset = sObjectDataMap["Rot"];
+	sSpecialCodeOffset = sObjectDataMap["SpecialCode"];
+	sParentIDOffset = sObjectDataMap["ParentID"];
 }
 
 //static 
@@ -1057,6 +1074,54 @@ U32 LLViewerObject::extractSpatialExtents(LLDataPackerBinaryBuffer *dp, LLVector
 	return parent_id;
 }
 
+//static
+bool LLViewerObject::decodeCacheableUpdate(const U8* data, S32 size, LLDecodedObjectUpdate& update)
+{
+	// Every field up to the owner is always there
+	if (sSpecialCodeOffset == 0 || size < (S32)(sSpecialCodeOffset + sizeof(U32) + sizeof(LLUUID)))
+	{
+		return false;
+	}
+
+	// Same byte order as LLDataPackerBinaryBuffer
+	htonmemcpy(&update.mLocalID, data + sLocalIDOffset, MVT_U32, 4);
+	htonmemcpy(&update.mCRC, data + sCRCOffset, MVT_U32, 4);
+	htonmemcpy(update.mScale.mV, data + sScaleOffset, MVT_LLVector3, 12);
+	htonmemcpy(update.mPos.mV, data + sPosOffset, MVT_LLVector3, 12);
+	LLVector3 vec;
+	htonmemcpy(vec.mV, data + sRotOffset, MVT_LLVector3, 12);
+	update.mRot.unpackFromVector3(vec);
+
+	U32 special_code;
+	htonmemcpy(&special_code, data + sSpecialCodeOffset, MVT_U32, 4);
+	update.mParentID = 0;
+	if (special_code & 0x20)
+	{
+		S32 offset = sParentIDOffset;
+		if (!(special_code & 0x80))
+		{
+			offset -= sizeof(LLVector3);
+		}
+		if (size < offset + (S32)sizeof(U32))
+		{
+			return false;
+		}
+		htonmemcpy(&update.mParentID, data + offset, MVT_U32, 4);
+	}
+	return true;
+}
+
+//static
+bool LLViewerObject::peekCacheableLocalID(const U8* data, S32 size, U32& local_id)
+{
+	if (sLocalIDOffset == 0 || size < (S32)(sLocalIDOffset + sizeof(U32)))
+	{
+		return false;
+	}
+	htonmemcpy(&local_id, data + sLocalIDOffset, MVT_U32, 4);
+	return true;
+}
+
 U32 LLViewerObject::processUpdateMessage(LLMessageSystem *mesgsys,
 					 void **user_data,
 					 U32 block_num,
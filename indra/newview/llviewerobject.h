@@ -76,6 +76,19 @@ typedef enum e_object_update_type
 	OUT_UNKNOWN,
 } EObjectUpdateType;
 
+// What a region needs of a cacheable ObjectUpdateCompressed block to file it
+// in its object cache, see LLViewerObject::decodeCacheableUpdate().
+struct LLDecodedObjectUpdate
+{
+	U32				mLocalID;
+	U32				mCRC;
+	U32				mFlags;		// UpdateFlags of the block, not in its data
+	U32				mParentID;
+	LLVector3		mPos;
+	LLVector3		mScale;
+	LLQuaternion	mRot;
+};
+
 
 // callback typedef for inventory
 typedef void (*inventory_callback)(LLViewerObject*,
@@ -579,6 +592,12 @@ public:
 	static void unpackU32(LLDataPackerBinaryBuffer* dp, U32& value, std::string name);
 	static void unpackU8(LLDataPackerBinaryBuffer* dp, U8& value, std::string name);
 	static U32 unpackParentID(LLDataPackerBinaryBuffer* dp, U32& parent_id);
+	// Same fields as cacheFullUpdate() and extractSpatialExtents() read, but
+	// without touching sObjectDataMap so that it is safe on any thread.
+	// False if the data is too short to hold them.
+	static bool decodeCacheableUpdate(const U8* data, S32 size, LLDecodedObjectUpdate& update);
+	// Just the local ID of the same, false if the data is too short for it.
+	static bool peekCacheableLocalID(const U8* data, S32 size, U32& local_id);
 
 public:
 	//counter-translation
@@ -482,6 +482,12 @@ void LLViewerObjectList::processObjectUpdate(LLMessageSystem *mesgsys,
 	LLDataPackerBinaryBuffer compressed_dp(compressed_dpbuffer, 2048);
 	LLViewerStatsRecorder& recorder = LLViewerStatsRecorder::instance();
 
+	bool queue_updates = compressed && update_type != OUT_TERSE_IMPROVED;
+	if (queue_updates)
+	{
+		mUpdateQueue.beginMessage(region_handle);
+	}
+
 	for (i = 0; i < num_objects; i++)
 	{
 		// timer is unused?
@@ -495,26 +501,27 @@ void LLViewerObjectList::processObjectUpdate(LLMessageSystem *mesgsys,
 			S32							uncompressed_length = 2048;
 			compressed_dp.reset();
 
+			U32 flags = 0;
+			if (update_type != OUT_TERSE_IMPROVED) // OUT_FULL_COMPRESSED only?
+			{
+				mesgsys->getU32Fast(_PREHASH_ObjectData, _PREHASH_UpdateFlags, flags, i);
+				if (!(flags & FLAGS_TEMPORARY_ON_REZ))
+				{
+					//send to object cache, decoded on the thread pool
+					mUpdateQueue.addBlock(mesgsys, i, flags);
+					continue;
+				}
+			}
+
 			uncompressed_length = mesgsys->getSizeFast(_PREHASH_ObjectData, i, _PREHASH_Data);
 			mesgsys->getBinaryDataFast(_PREHASH_ObjectData, _PREHASH_Data, compressed_dpbuffer, 0, i);
 			compressed_dp.assignBuffer(compressed_dpbuffer, uncompressed_length);
 
 			if (update_type != OUT_TERSE_IMPROVED) // OUT_FULL_COMPRESSED only?
 			{
-				U32 flags = 0;
-				mesgsys->getU32Fast(_PREHASH_ObjectData, _PREHASH_UpdateFlags, flags, i);
-			
-				if(flags & FLAGS_TEMPORARY_ON_REZ)
-				{
 				compressed_dp.unpackUUID(fullid, "ID");
 				compressed_dp.unpackU32(local_id, "LocalID");
 				compressed_dp.unpackU8(pcode, "PCode");
-			}
-				else //send to object cache
-				{
-					regionp->cacheFullUpdate(compressed_dp, flags);
-					continue;
-				}
 			}
 			else //OUT_TERSE_IMPROVED
 			{
@@ -555,6 +562,9 @@ void LLViewerObjectList::processObjectUpdate(LLMessageSystem *mesgsys,
 			msg_size += sizeof(U32);
 			// LL_INFOS() << "Full Update, obj " << local_id << ", global ID" << fullid << "from " << mesgsys->getSender() << LL_ENDL;
 		}
+		// A queued full update for this object goes in first
+		flushObjectUpdates(local_id);
+
 		objectp = findObject(fullid);
 
 		if(update_cache)
@@ -695,6 +705,11 @@ void LLViewerObjectList::processObjectUpdate(LLMessageSystem *mesgsys,
 		objectp->setLastUpdateType(update_type);
 	}
 
+	if (queue_updates)
+	{
+		mUpdateQueue.endMessage(LLAppViewer::getThreadPool());
+	}
+
 	recorder.log(0.2f);
 
 	LLVOAvatar::cullAvatarsByPixelArea();
@@ -740,6 +755,7 @@ void LLViewerObjectList::processCachedObjectUpdate(LLMessageSystem *mesgsys,
 		
 		// Lookup data packer and add this id to cache miss lists if necessary.
 		U8 cache_miss_type = LLViewerRegion::CACHE_MISS_TYPE_NONE;
+		flushObjectUpdates(id);
 		if(!regionp->probeCache(id, crc, flags, cache_miss_type))
 		{
 			// Cache Miss.
@@ -1041,6 +1057,10 @@ void LLViewerObjectList::update(LLAgent &agent)
 	static LLCachedControl<bool> animateTextures(gSavedSettings, "AnimateTextures");
 	static LLCachedControl<bool> freezeTime(gSavedSettings, "FreezeTime");
 	// </FS:Ansariel> Speed up debug settings
+	static LLCachedControl<F32> objectUpdateTimeBudget(gSavedSettings, "FSObjectUpdateTimeBudget");
+
+	// File the object updates decoded since last frame with the region caches
+	mUpdateQueue.apply(llmax((F32)objectUpdateTimeBudget, 0.1f) * 0.001f);
 
 	// Update globals
 	// </FS:Ansariel> Speed up debug settings
@@ -35,6 +35,7 @@
 #include "lltrace.h"
 
 // project includes
+#include "llobjectupdatequeue.h"
 #include "llviewerobject.h"
 
 class LLCamera;
@@ -90,6 +91,10 @@ public:
 	void processObjectUpdate(LLMessageSystem *mesgsys, void **user_data, EObjectUpdateType update_type, bool compressed=false);
 	void processCompressedObjectUpdate(LLMessageSystem *mesgsys, void **user_data, EObjectUpdateType update_type);
 	void processCachedObjectUpdate(LLMessageSystem *mesgsys, void **user_data, EObjectUpdateType update_type);
+	// Files the queued compressed updates right away, so a message about the
+	// object doesn't overtake its full update.
+	void flushObjectUpdates() { mUpdateQueue.flush(); }
+	void flushObjectUpdates(U32 local_id) { if (mUpdateQueue.isPending(local_id)) mUpdateQueue.flush(); }
 	void updateApparentAngles(LLAgent &agent);
 	void update(LLAgent &agent);
 
@@ -237,6 +242,8 @@ protected:
 
 	std::set<LLViewerObject *> mSelectPickList;
 
+	LLObjectUpdateQueue mUpdateQueue;
+
 	friend class LLViewerObject;
 
 // <FS:ND> Remember objects we did derender. We might get object updates for them that create new instances. In those cases we kill them again.
@@ -461,7 +461,8 @@ LLViewerOctreeGroup::LLViewerOctreeGroup(OctreeNode* node)
 :	LLTrace::MemTrackable<LLViewerOctreeGroup, 16>("LLViewerOctreeGroup"),
 	mOctreeNode(node),
 	mAnyVisible(0),
-	mState(CLEAN)
+	mState(CLEAN),
+	mChildBoundsCount(0)
 {
 	LLVector4a tmp;
 	tmp.splat(0.f);
@@ -474,6 +475,31 @@ LLViewerOctreeGroup::LLViewerOctreeGroup(OctreeNode* node)
 	mOctreeNode->addListener(this);
 }
 
+// Children are rebound by now
+void LLViewerOctreeGroup::updateChildBounds()
+{
+	U32 count = mOctreeNode->getChildCount();
+	if (count > 2 * LLBoxes4::COUNT)
+	{
+		return;
+	}
+
+	// Pad the last block with the first child, the tests run on all four
+	U32 padded = (count + LLBoxes4::COUNT - 1) & ~(LLBoxes4::COUNT - 1);
+	for (U32 i = 0; i < padded; i++)
+	{
+		const LLViewerOctreeGroup* group = (LLViewerOctreeGroup*) mOctreeNode->getChild(i < count ? i : 0)->getListener(0);
+		mChildBounds[i / LLBoxes4::COUNT].set(i % LLBoxes4::COUNT, group->mBounds[0], group->mBounds[1]);
+	}
+	mChildBoundsCount = count;
+}
+
+void LLViewerOctreeGroup::shiftChildBounds(const LLVector4a& offset)
+{
+	mChildBounds[0].shift(offset);
+	mChildBounds[1].shift(offset);
+}
+
 bool LLViewerOctreeGroup::hasElement(LLViewerOctreeEntryData* data) 
 { 
 	if(!data->getEntry())
@@ -549,6 +575,8 @@ void LLViewerOctreeGroup::rebound()
 	{	
 		return;
 	}
+
+	mChildBoundsCount = 0;
 	
 	if (mOctreeNode->getChildCount() == 1 && mOctreeNode->getElementCount() == 0)
 	{
@@ -593,6 +621,8 @@ void LLViewerOctreeGroup::rebound()
 			newMin.setMin(newMin, min);
 		}
 
+		updateChildBounds();
+
 		boundObjects(FALSE, newMin, newMax);
 		
 		mBounds[0].setAdd(newMin, newMax);
@@ -1359,7 +1389,12 @@ void LLViewerOctreeCull::traverse(const OctreeNode* n)
 	{
 		return;
 	}
-		
+
+	traverseGroup(n, group);
+}
+
+void LLViewerOctreeCull::traverseGroup(const OctreeNode* n, LLViewerOctreeGroup* group)
+{
 	if (mRes == 2 || 
 		(mRes && group->hasState(LLViewerOctreeGroup::SKIP_FRUSTUM_CHECK)))
 	{	//fully in, just add everything
@@ -1377,6 +1412,91 @@ void LLViewerOctreeCull::traverse(const OctreeNode* n)
 		mRes = 0;
 	}
 }
+
+void LLViewerOctreeCull::record(const OctreeNode* root)
+{
+	mRecord.clear();
+	recordNode(root, 0, -1);
+	mRes = 0;
+}
+
+// Same decisions as traverse() without earlyFail(), which replay() applies.
+// Below an occluded group there is nothing to record, replay() culls the
+// subtree itself should earlyFail() find it visible after all.
+// A group inherits its parent's result where traverse() skips the check:
+// fully inside, or an only child sharing its parent's bounds.  Children of
+// a partly inside group are checked together where the culler can batch
+// them, checked_res is then the child's result, otherwise -1.
+void LLViewerOctreeCull::recordNode(const OctreeNode* n, S32 parent_res, S32 checked_res)
+{
+	LLViewerOctreeGroup* group = (LLViewerOctreeGroup*) n->getListener(0);
+
+	S32 index = (S32)mRecord.size();
+	mRecord.push_back(RecordEntry());
+	mRecord[index].mGroup = group;
+	mRecord[index].mParentRes = parent_res;
+	mRecord[index].mProcess = false;
+	mRecord[index].mOccluded = n->getParent() && isOccluded(group);
+
+	S32 res = parent_res;
+	if (!(parent_res == 2 || 
+		(parent_res && group->hasState(LLViewerOctreeGroup::SKIP_FRUSTUM_CHECK))))
+	{
+		res = checked_res >= 0 ? checked_res : frustumCheck(group);
+	}
+	mRecord[index].mRes = res;
+
+	if (res && !mRecord[index].mOccluded)
+	{
+		mRes = res;
+		mRecord[index].mProcess = checkObjects(n, group);
+
+		S32 child_res[2 * LLBoxes4::COUNT];
+		bool batched = res != 2 && frustumCheckChildren(n, child_res);
+		for (U32 i = 0; i < n->getChildCount(); i++)
+		{
+			recordNode(n->getChild(i), res, batched ? child_res[i] : -1);
+		}
+	}
+
+	mRecord[index].mSubtreeEnd = (S32)mRecord.size();
+}
+
+void LLViewerOctreeCull::replay()
+{
+	S32 count = (S32)mRecord.size();
+	for (S32 i = 0; i < count; )
+	{
+		const RecordEntry& entry = mRecord[i];
+		if (earlyFail(entry.mGroup))
+		{
+			i = entry.mSubtreeEnd;
+			continue;
+		}
+
+		if (entry.mOccluded)
+		{ //no longer occluded, cull it as traverse() would
+			mRes = entry.mParentRes;
+			traverseGroup(entry.mGroup->getOctreeNode(), entry.mGroup);
+			++i;
+			continue;
+		}
+
+		if (entry.mRes)
+		{
+			mRes = entry.mRes;
+			preprocess(entry.mGroup);
+			if (entry.mProcess)
+			{
+				processGroup(entry.mGroup);
+			}
+		}
+		++i;
+	}
+
+	mRes = 0;
+	mRecord.clear();
+}
 	
 //------------------------------------------
 //agent space group culling
@@ -1396,6 +1516,54 @@ S32 LLViewerOctreeCull::AABBInFrustumGroupBounds(const LLViewerOctreeGroup* grou
 }
 //------------------------------------------
 
+//------------------------------------------
+//batched child group culling
+static bool has_child_bounds(const LLViewerOctreeGroup* group, const OctreeNode* node)
+{
+	return !group->isDirty() && group->getChildBoundsCount() > 0 &&
+		group->getChildBoundsCount() == node->getChildCount();
+}
+
+bool LLViewerOctreeCull::AABBInFrustumNoFarClipChildBounds(const LLViewerOctreeGroup* group, S32* results)
+{
+	if (!has_child_bounds(group, group->mOctreeNode))
+	{
+		return false;
+	}
+	for (U32 i = 0; i < group->getChildBoundsCount(); i += LLBoxes4::COUNT)
+	{
+		mCamera->AABBInFrustumNoFarClip4(group->mChildBounds[i / LLBoxes4::COUNT], results + i);
+	}
+	return true;
+}
+
+bool LLViewerOctreeCull::AABBInFrustumChildBounds(const LLViewerOctreeGroup* group, S32* results)
+{
+	if (!has_child_bounds(group, group->mOctreeNode))
+	{
+		return false;
+	}
+	for (U32 i = 0; i < group->getChildBoundsCount(); i += LLBoxes4::COUNT)
+	{
+		mCamera->AABBInFrustum4(group->mChildBounds[i / LLBoxes4::COUNT], results + i);
+	}
+	return true;
+}
+
+bool LLViewerOctreeCull::AABBInRegionFrustumNoFarClipChildBounds(const LLViewerOctreeGroup* group, S32* results)
+{
+	if (!has_child_bounds(group, group->mOctreeNode))
+	{
+		return false;
+	}
+	for (U32 i = 0; i < group->getChildBoundsCount(); i += LLBoxes4::COUNT)
+	{
+		mCamera->AABBInRegionFrustumNoFarClip4(group->mChildBounds[i / LLBoxes4::COUNT], results + i);
+	}
+	return true;
+}
+//------------------------------------------
+
 //------------------------------------------
 //agent space object set culling
 S32 LLViewerOctreeCull::AABBInFrustumNoFarClipObjectBounds(const LLViewerOctreeGroup* group)
@@ -44,6 +44,7 @@ class LLViewerOctreeEntryData;
 class LLViewerOctreeGroup;
 class LLViewerOctreeEntry;
 class LLViewerOctreePartition;
+class LLViewerOctreeCull;
 
 typedef LLOctreeListener<LLViewerOctreeEntry>	OctreeListener;
 typedef LLTreeNode<LLViewerOctreeEntry>			TreeNode;
@@ -243,6 +244,12 @@ public:
 	const LLVector4a* getObjectBounds() const  {return mObjectBounds;}
 	const LLVector4a* getObjectExtents() const {return mObjectExtents;}
 
+	// Bounds of the children four to a block, in child order, for the
+	// batched frustum tests.  Kept by rebound(), so only good while the
+	// group is not dirty.  Empty for leaves and lone children.
+	const LLBoxes4* getChildBounds() const     {return mChildBounds;}
+	U32 getChildBoundsCount() const            {return mChildBoundsCount;}
+
 	//octree wrappers to make code more readable
 	element_list& getData() { return mOctreeNode->getData(); }
 	element_iter getDataBegin() { return mOctreeNode->getDataBegin(); }
@@ -252,7 +259,9 @@ public:
 	
 protected:
 	void checkStates();
+	void shiftChildBounds(const LLVector4a& offset);
 private:
+	void updateChildBounds();
 	virtual bool boundObjects(BOOL empty, LLVector4a& minOut, LLVector4a& maxOut);			
 
 protected:
@@ -263,6 +272,8 @@ protected:
 	LL_ALIGN_16(LLVector4a mObjectBounds[2]);  // bounding box (center, size) of objects in this node
 	LL_ALIGN_16(LLVector4a mExtents[2]);       // extents (min, max) of this node and all its children
 	LL_ALIGN_16(LLVector4a mObjectExtents[2]); // extents (min, max) of objects in this node	
+	LL_ALIGN_16(LLBoxes4 mChildBounds[2]);     // bounds (center, size) of up to 8 children
+	U32         mChildBoundsCount;
 
 	S32         mAnyVisible; //latest visible to any camera
 	S32         mVisible[LLViewerCamera::NUM_CAMERAS];	
@@ -349,6 +360,13 @@ public:
 
 	// Cull on arbitrary frustum
 	virtual S32 cull(LLCamera &camera, bool do_occlusion) = 0;
+
+	// cull() in steps, so the frustum checks of many partitions can run on
+	// the thread pool.  beginCull() returns the culler to record() there
+	// and replay() back on the main thread, or NULL if there is nothing to
+	// cull this frame.  The caller deletes it, then calls endCull().
+	virtual LLViewerOctreeCull* beginCull(LLCamera& camera, bool do_occlusion) { return NULL; }
+	virtual void endCull() {}
 	BOOL isOcclusionEnabled();
 
 public:	
@@ -366,11 +384,25 @@ class LLViewerOctreeCull : public OctreeTraveler
 public:
 	LLViewerOctreeCull(LLCamera* camera)
 		: mCamera(camera), mRes(0) { }
+	virtual ~LLViewerOctreeCull() { }
 	
 	virtual void traverse(const OctreeNode* n);
 
+	// traverse() in two passes.  record() does the frustum checks of the
+	// whole tree, reading nothing but the camera and the group bounds, so
+	// it is safe on any thread as long as the tree is left alone.  replay()
+	// then makes the calls traverse() would have, in the same order, for
+	// occlusion and the cull result on the main thread.  Subtrees of groups
+	// that are occluded when recorded are not checked.
+	void record(const OctreeNode* root);
+	void replay();
+
 protected:
 	virtual bool earlyFail(LLViewerOctreeGroup* group);	
+	// What earlyFail() would say for a group other than the root, going by
+	// its occlusion state as it stands.  record() uses it and must not
+	// change that state; replay() still asks earlyFail().
+	virtual bool isOccluded(LLViewerOctreeGroup* group) { return false; }
 	
 	//agent space group cull
 	S32 AABBInFrustumNoFarClipGroupBounds(const LLViewerOctreeGroup* group);	
@@ -392,18 +424,44 @@ protected:
 	S32 AABBInRegionFrustumObjectBounds(const LLViewerOctreeGroup* group);
 	S32 AABBRegionSphereIntersectObjectExtents(const LLViewerOctreeGroup* group, const LLVector3& shift);	
 	
+	//batched child group cull, false if the group has no child bounds to batch
+	bool AABBInFrustumNoFarClipChildBounds(const LLViewerOctreeGroup* group, S32* results);
+	bool AABBInFrustumChildBounds(const LLViewerOctreeGroup* group, S32* results);
+	bool AABBInRegionFrustumNoFarClipChildBounds(const LLViewerOctreeGroup* group, S32* results);
+
 	virtual S32 frustumCheck(const LLViewerOctreeGroup* group) = 0;
 	virtual S32 frustumCheckObjects(const LLViewerOctreeGroup* group) = 0;
+	// frustumCheck() of every child of branch at once, into results[0..7].
+	// Returns false to have record() check them one by one instead.
+	virtual bool frustumCheckChildren(const OctreeNode* branch, S32* results) { return false; }
 
 	bool checkProjectionArea(const LLVector4a& center, const LLVector4a& size, const LLVector3& shift, F32 pixel_threshold, F32 near_radius);
 	virtual bool checkObjects(const OctreeNode* branch, const LLViewerOctreeGroup* group);
 	virtual void preprocess(LLViewerOctreeGroup* group);
 	virtual void processGroup(LLViewerOctreeGroup* group);
 	virtual void visit(const OctreeNode* branch);
+
+private:
+	void recordNode(const OctreeNode* n, S32 parent_res, S32 checked_res);
+	// traverse() once earlyFail() has passed
+	void traverseGroup(const OctreeNode* n, LLViewerOctreeGroup* group);
 	
 protected:
 	LLCamera *mCamera;
 	S32 mRes;
+
+private:
+	// Groups in the order traverse() reaches them
+	struct RecordEntry
+	{
+		LLViewerOctreeGroup* mGroup;
+		S32 mSubtreeEnd;	// index past the last entry below this one
+		S32 mRes;			// 0 if outside the frustum
+		S32 mParentRes;
+		bool mProcess;		// checkObjects() passed
+		bool mOccluded;		// isOccluded(), nothing below was recorded
+	};
+	std::vector<RecordEntry> mRecord;
 };
 
 //scan the octree, output the info of each node for debug use.
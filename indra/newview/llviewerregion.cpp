@@ -384,6 +384,7 @@ LLViewerRegion::LLViewerRegion(const U64 &handle,
 	mProductName("unknown"),
 	mHttpUrl(""),
 	mCacheLoaded(FALSE),
+	mCacheLoading(FALSE),
 	mCacheDirty(FALSE),
 	mReleaseNotesRequested(FALSE),
 	mCapabilitiesReceived(false),
@@ -556,26 +557,50 @@ void LLViewerRegion::loadObjectCache()
 	// Presume success.  If it fails, we don't want to try again.
 	mCacheLoaded = TRUE;
 
-	if(LLVOCache::instanceExists())
+	// The cache file is read on the cache thread, objectCacheLoaded() takes it from there.
+	mCacheLoading = TRUE;
+	if(!LLVOCache::instanceExists() || !LLVOCache::getInstance()->readFromCache(mHandle, mImpl->mCacheID))
 	{
-		LLVOCache::getInstance()->readFromCache(mHandle, mImpl->mCacheID, mImpl->mCacheMap) ;
-		if (mImpl->mCacheMap.empty())
-		{
-			mCacheDirty = TRUE;
-		}
+		mCacheLoading = FALSE;
+		mCacheDirty = TRUE;
 	}
 }
 
-
-void LLViewerRegion::saveObjectCache()
+void LLViewerRegion::objectCacheLoaded(LLVOCacheEntry::vocache_entry_map_t& cache_entry_map)
 {
-	if (!mCacheLoaded)
+	if (!mCacheLoading)
 	{
 		return;
 	}
+	mCacheLoading = FALSE;
 
 	if (mImpl->mCacheMap.empty())
 	{
+		mImpl->mCacheMap.swap(cache_entry_map);
+	}
+	else
+	{
+		mImpl->mCacheMap.insert(cache_entry_map.begin(), cache_entry_map.end());
+	}
+	if (mImpl->mCacheMap.empty())
+	{
+		mCacheDirty = TRUE;
+	}
+
+	sendHandshakeReply();
+}
+
+
+void LLViewerRegion::saveObjectCache()
+{
+	if (!mCacheLoaded || mCacheLoading || mImpl->mCacheMap.empty())
+	{
+		// Nothing to write back, the cache can drop what it read ahead for us.
+		if (LLVOCache::instanceExists())
+		{
+			LLVOCache::getInstance()->releaseRegion(mHandle);
+		}
+		mCacheLoading = FALSE;
 		return;
 	}
 
@@ -2176,7 +2201,7 @@ void LLViewerRegion::findOrphans(U32 parent_id)
 	}
 }
 
-void LLViewerRegion::decodeBoundingInfo(LLVOCacheEntry* entry)
+void LLViewerRegion::decodeBoundingInfo(LLVOCacheEntry* entry, const LLDecodedObjectUpdate* update)
 {
 	if(!sVOCacheCullingEnabled)
 	{
@@ -2213,7 +2238,14 @@ void LLViewerRegion::decodeBoundingInfo(LLVOCacheEntry* entry)
 
 		//set parent id
 		U32	parent_id = 0;
-		LLViewerObject::unpackParentID(entry->getDP(), parent_id);
+		if(update)
+		{
+			parent_id = update->mParentID;
+		}
+		else
+		{
+			LLViewerObject::unpackParentID(entry->getDP(), parent_id);
+		}
 		if(parent_id != entry->getParentID())
 		{				
 			entry->setParentID(parent_id);
@@ -2233,7 +2265,18 @@ void LLViewerRegion::decodeBoundingInfo(LLVOCacheEntry* entry)
 	LLQuaternion rot;
 
 	//decode spatial info and parent info
-	U32 parent_id = LLViewerObject::extractSpatialExtents(entry->getDP(), pos, scale, rot);
+	U32 parent_id;
+	if(update)
+	{
+		parent_id = update->mParentID;
+		pos = update->mPos;
+		scale = update->mScale;
+		rot = update->mRot;
+	}
+	else
+	{
+		parent_id = LLViewerObject::extractSpatialExtents(entry->getDP(), pos, scale, rot);
+	}
 	
 	U32 old_parent_id = entry->getParentID();
 	bool same_old_parent = false;
@@ -2344,21 +2387,36 @@ void LLViewerRegion::decodeBoundingInfo(LLVOCacheEntry* entry)
 
 LLViewerRegion::eCacheUpdateResult LLViewerRegion::cacheFullUpdate(LLDataPackerBinaryBuffer &dp, U32 flags)
 {
-	eCacheUpdateResult result;
-	U32 crc;
-	U32 local_id;
+	LLDecodedObjectUpdate update;
+	if (!LLViewerObject::decodeCacheableUpdate(dp.getBuffer(), dp.getBufferSize(), update))
+	{
+		LL_WARNS() << "Ignoring truncated object update of " << dp.getBufferSize() << " bytes" << LL_ENDL;
+		return CACHE_UPDATE_DUPE;
+	}
+	update.mFlags = flags;
 
-	LLViewerObject::unpackU32(&dp, local_id, "LocalID");
-	LLViewerObject::unpackU32(&dp, crc, "CRC");
+	return cacheFullUpdate(dp, update);
+}
 
-	LLVOCacheEntry* entry = getCacheEntry(local_id, false);
+LLViewerRegion::eCacheUpdateResult LLViewerRegion::cacheFullUpdate(LLViewerObject* objectp, LLDataPackerBinaryBuffer &dp, U32 flags)
+{
+	eCacheUpdateResult result = cacheFullUpdate(dp, flags);
+
+	return result;
+}
+
+LLViewerRegion::eCacheUpdateResult LLViewerRegion::cacheFullUpdate(LLDataPackerBinaryBuffer &dp, const LLDecodedObjectUpdate& update)
+{
+	eCacheUpdateResult result;
+
+	LLVOCacheEntry* entry = getCacheEntry(update.mLocalID, false);
 
 	if (entry)
 	{
 		entry->setValid();
 
 		// we've seen this object before
-		if (entry->getCRC() == crc)
+		if (entry->getCRC() == update.mCRC)
 		{
 			// Record a hit
 			entry->recordDupe();
@@ -2367,9 +2425,9 @@ LLViewerRegion::eCacheUpdateResult LLViewerRegion::cacheFullUpdate(LLDataPackerB
 		else //CRC changed
 		{
 			// Update the cache entry
-			entry->updateEntry(crc, dp);
+			entry->updateEntry(update.mCRC, dp);
 
-			decodeBoundingInfo(entry);
+			decodeBoundingInfo(entry, &update);
 
 			result = CACHE_UPDATE_CHANGED;
 		}		
@@ -2379,21 +2437,14 @@ LLViewerRegion::eCacheUpdateResult LLViewerRegion::cacheFullUpdate(LLDataPackerB
 		// we haven't seen this object before
 		// Create new entry and add to map
 		result = CACHE_UPDATE_ADDED;
-		entry = new LLVOCacheEntry(local_id, crc, dp);
+		entry = new LLVOCacheEntry(update.mLocalID, update.mCRC, dp);
 		record(LLStatViewer::OBJECT_CACHE_HIT_RATE, LLUnits::Ratio::fromValue(0));
 		
-		mImpl->mCacheMap[local_id] = entry;
+		mImpl->mCacheMap[update.mLocalID] = entry;
 		
-		decodeBoundingInfo(entry);
+		decodeBoundingInfo(entry, &update);
 	}
-	entry->setUpdateFlags(flags);
-
-	return result;
-	}
-
-LLViewerRegion::eCacheUpdateResult LLViewerRegion::cacheFullUpdate(LLViewerObject* objectp, LLDataPackerBinaryBuffer &dp, U32 flags)
-{
-	eCacheUpdateResult result = cacheFullUpdate(dp, flags);
+	entry->setUpdateFlags(update.mFlags);
 
 	return result;
 }
@@ -2763,9 +2814,18 @@ void LLViewerRegion::unpackRegionHandshake()
 	loadObjectCache();
 
 	// After loading cache, signal that simulator can start
-	// sending data.
+	// sending data. If the cache is still being read, the reply
+	// goes out once it is loaded.
+	if (!mCacheLoading)
+	{
+		sendHandshakeReply();
+	}
+}
+
+void LLViewerRegion::sendHandshakeReply()
+{
 	// TODO: Send all upstream viewer->sim handshake info here.
-	LLHost host = msg->getSender();
+	LLMessageSystem* msg = gMessageSystem;
 	msg->newMessage("RegionHandshakeReply");
 	msg->nextBlock("AgentData");
 	msg->addUUID("AgentID", gAgent.getID());
@@ -2782,7 +2842,7 @@ void LLViewerRegion::unpackRegionHandshake()
 		flags |= 0x00000002; //set the bit 1 to be 1 to tell sim the cache file is empty, no need to send cache probes.
 	}
 	msg->addU32("Flags", flags );
-	msg->sendReliable(host);
+	msg->sendReliable(mImpl->mHost);
 
 	mRegionTimer.reset(); //reset region timer.
 }
@@ -65,6 +65,7 @@ class LLEventPump;
 class LLCapabilityListener;
 class LLDataPacker;
 class LLDataPackerBinaryBuffer;
+struct LLDecodedObjectUpdate;
 class LLHost;
 class LLBBox;
 class LLSpatialGroup;
@@ -109,6 +110,8 @@ public:
 	// Call this after you have the region name and handle.
 	void loadObjectCache();
 	void saveObjectCache();
+	// The cache read by loadObjectCache() arrived.
+	void objectCacheLoaded(std::map<U32, LLPointer<LLVOCacheEntry> >& cache_entry_map);
 
 	void sendMessage(); // Send the current message to this region's simulator
 	void sendReliableMessage(); // Send the current message to this region's simulator
@@ -355,6 +358,8 @@ public:
 	// handle a full update message
 	eCacheUpdateResult cacheFullUpdate(LLDataPackerBinaryBuffer &dp, U32 flags);
 	eCacheUpdateResult cacheFullUpdate(LLViewerObject* objectp, LLDataPackerBinaryBuffer &dp, U32 flags);	
+	// same, with the fields already decoded by LLViewerObject::decodeCacheableUpdate()
+	eCacheUpdateResult cacheFullUpdate(LLDataPackerBinaryBuffer &dp, const LLDecodedObjectUpdate& update);
 	LLVOCacheEntry* getCacheEntryForOctree(U32 local_id);
 	LLVOCacheEntry* getCacheEntry(U32 local_id, bool valid = true);
 	bool probeCache(U32 local_id, U32 crc, U32 flags, U8 &cache_miss_type);
@@ -367,6 +372,7 @@ public:
 	void dumpCache();
 
 	void unpackRegionHandshake();
+	void sendHandshakeReply();
 
 	void calculateCenterGlobal();
 	void calculateCameraDistance();
@@ -415,7 +421,7 @@ private:
 	void updateVisibleEntries(F32 max_time); //update visible entries
 
 	void addCacheMiss(U32 id, LLViewerRegion::eCacheMissType miss_type);
-	void decodeBoundingInfo(LLVOCacheEntry* entry);
+	void decodeBoundingInfo(LLVOCacheEntry* entry, const LLDecodedObjectUpdate* update = NULL);
 	bool isNonCacheableObjectCreated(U32 local_id);	
 
 public:
@@ -533,6 +539,7 @@ private:
 	// Regions can have order 10,000 objects, so assume
 	// a structure of size 2^14 = 16,000
 	BOOL									mCacheLoaded;
+	BOOL									mCacheLoading;	// waiting for the cache thread
 	BOOL                                    mCacheDirty;
 	BOOL	mAlive;					// can become false if circuit disconnects
 	BOOL	mCapabilitiesReceived;
@@ -379,6 +379,7 @@ void update_statistics()
 	sample(LLStatViewer::PENDING_VFS_OPERATIONS, LLVFile::getVFSThread()->getPending());
 	add(LLStatViewer::ASSET_UDP_DATA_RECEIVED, F64Bits(gTransferManager.getTransferBitsIn(LLTCT_ASSET)));
 	gTransferManager.resetTransferBitsIn(LLTCT_ASSET);
+	LLAppViewer::instance()->getAppCoreHttp().updateStats();
 
 	if (LLAppViewer::getTextureFetch()->getNumRequests() == 0)
 	{
@@ -582,6 +582,16 @@ public:
 			addText(xpos, ypos, llformat("%d Vertex Buffers", LLVertexBuffer::sGLCount));
 			ypos += y_inc;
 
+			{
+				U32 allocations = LLVBOPool::sAllocatedFromPool + LLVBOPool::sAllocatedNew;
+				U32 free_sizes = LLVertexBuffer::sStreamVBOPool.getFreeSizeCount() + LLVertexBuffer::sDynamicVBOPool.getFreeSizeCount()
+					+ LLVertexBuffer::sDynamicCopyVBOPool.getFreeSizeCount() + LLVertexBuffer::sStreamIBOPool.getFreeSizeCount()
+					+ LLVertexBuffer::sDynamicIBOPool.getFreeSizeCount();
+				addText(xpos, ypos, llformat("%d%% Buffers From Pool (%d Recycled, %d Trimmed, Pooled in %d Sizes)",
+					allocations ? LLVBOPool::sAllocatedFromPool*100/allocations : 0, LLVBOPool::sRecycled, LLVBOPool::sTrimmed, free_sizes));
+				ypos += y_inc;
+			}
+
 			addText(xpos, ypos, llformat("%d Mapped Buffers", LLVertexBuffer::sMappedCount));
 			ypos += y_inc;
 
@@ -32,8 +32,10 @@
 #include "llviewerobjectlist.h"
 #include "lldrawable.h"
 #include "llviewerregion.h"
+#include "llworld.h"
 #include "pipeline.h"
 #include "llagentcamera.h"
+#include "llmappedfile.h"
 #include "llmemory.h"
 
 //static variables
@@ -54,6 +56,120 @@ BOOL check_write(LLAPRFile* apr_file, void* src, S32 n_bytes)
 	return apr_file->write(src, n_bytes) == n_bytes ;
 }
 
+//---------------------------------------------------------------------------
+// LLVOCacheFile
+//---------------------------------------------------------------------------
+
+// The object cache of one region, mapped into memory. The file is a header
+// followed by a log of object records. A record supersedes any earlier one
+// for the same local ID, and a record without data removes the object.
+// Writing a region back appends the records of the objects that changed,
+// the file is only rewritten once it is mostly superseded records.
+//
+// Files are opened, written and closed on the cache thread. The main thread
+// only creates entries from a file and loads their data, under the lock.
+class LLVOCacheFile : public LLThreadSafeRefCount
+{
+public:
+	struct FileHeader
+	{
+		U32 mMagic;
+		U32 mVersion;
+		U8  mRegionID[UUID_BYTES];
+		U32 mDataEnd;	//end of the last complete record
+	};
+
+	struct RecordHeader
+	{
+		U32 mLocalID;
+		U32 mCRC;
+		S32 mHitCount;
+		S32 mDupeCount;
+		S32 mCRCChangeCount;
+		S32 mSize;		//followed by this much data, padded to 4 bytes
+	};
+
+	//what a write keeps of an entry, see LLVOCache::writeToCache()
+	struct EntryRecord
+	{
+		RecordHeader mHeader;	//mSize is 0 if the data is not in the write
+		U32  mDataOffset;		//into the data of the write
+		U32  mFileOffset;		//its record in the file being written, 0 if none
+		bool mDirty;
+	};
+	typedef std::vector<EntryRecord> entry_record_list_t;
+
+	typedef std::map<U32, U32> record_map_t; //local id -> offset of its current record
+
+	LLVOCacheFile();
+
+	//open an existing cache file
+	bool open(const std::string& filename, bool read_only);
+	//start a new, empty cache file for the region id
+	bool create(const std::string& filename, const LLUUID& id);
+	void close();
+	bool isOpen() const;
+
+	const LLUUID& getRegionID() const {return mRegionID;}
+
+	//main thread
+	void createEntries(LLVOCacheEntry::vocache_entry_map_t& cache_entry_map);
+	bool readRecordHeader(U32 offset, RecordHeader& header) const;
+	U8*  readRecordData(U32 offset, U32 local_id, S32& size) const;
+
+	//cache thread, entries sorted by local id
+	bool appendEntries(const entry_record_list_t& entries, const std::vector<U8>& data);
+	bool copyEntries(LLVOCacheFile* source, const entry_record_list_t& entries, const std::vector<U8>& data);
+	bool needsCompaction() const;
+
+protected:
+	~LLVOCacheFile();
+
+private:
+	static U32 getRecordSize(S32 data_size) {return sizeof(RecordHeader) + ((data_size + 3) & ~3);}
+	const RecordHeader* getRecord(U32 offset) const;
+	U32  findRecord(U32 local_id) const; //0 if there is none
+	void setRecord(U32 local_id, U32 offset);
+	bool reserve(U32 size);
+	bool appendRecord(const RecordHeader& header, const U8* data);
+	bool appendRemoval(U32 local_id);
+	bool appendEntry(const EntryRecord& entry, const std::vector<U8>& data, LLVOCacheFile* source);
+	bool commit(); //make the appended records part of the file
+
+private:
+	mutable LLMutex mMutex;
+	LLMappedFile mFile;
+	LLUUID       mRegionID;
+	U32          mDataEnd;
+	U32          mLiveBytes; //bytes in current records
+	record_map_t mRecords;
+};
+
+//---------------------------------------------------------------------------
+// LLVOCacheThread
+//---------------------------------------------------------------------------
+
+// Reads, writes and removes region cache files in request order, so a read
+// always sees the writes queued before it.
+class LLVOCacheThread : public LLQueuedThread
+{
+public:
+	LLVOCacheThread() : LLQueuedThread("VOCache") {}
+
+	handle_t read(const std::string& filename, bool read_only);
+	handle_t write(const std::string& filename, const LLUUID& id, LLVOCacheFile* file,
+				   LLVOCacheFile::entry_record_list_t& entries, std::vector<U8>& data);
+	void remove(const std::string& filename, LLVOCacheFile* file);
+
+	//take the outcome of a finished request, false if it is still running
+	bool finishRead(handle_t handle, LLPointer<LLVOCacheFile>& file);
+	bool finishWrite(handle_t handle, bool& success);
+
+private:
+	class ReadRequest;
+	class WriteRequest;
+	class RemoveRequest;
+};
 
 //---------------------------------------------------------------------------
 // LLVOCacheEntry
@@ -72,7 +188,9 @@ LLVOCacheEntry::LLVOCacheEntry(U32 local_id, U32 crc, LLDataPackerBinaryBuffer &
 	mSceneContrib(0.f),
 	mValid(TRUE),
 	mParentID(0),
-	mBSphereRadius(-1.0f)
+	mBSphereRadius(-1.0f),
+	mRecordOffset(0),
+	mDirty(true)
 {
 	mBuffer = new U8[dp.getBufferSize()];
 	mDP.assignBuffer(mBuffer, dp.getBufferSize());
@@ -93,12 +211,14 @@ LLVOCacheEntry::LLVOCacheEntry()
 	mSceneContrib(0.f),
 	mValid(TRUE),
 	mParentID(0),
-	mBSphereRadius(-1.0f)
+	mBSphereRadius(-1.0f),
+	mRecordOffset(0),
+	mDirty(false)
 {
 	mDP.assignBuffer(mBuffer, 0);
 }
 
-LLVOCacheEntry::LLVOCacheEntry(LLAPRFile* apr_file)
+LLVOCacheEntry::LLVOCacheEntry(LLVOCacheFile* file, U32 offset)
 :	LLTrace::MemTrackable<LLVOCacheEntry, 16>("LLVOCacheEntry"),
 	LLViewerOctreeEntryData(LLViewerOctreeEntry::LLVOCACHEENTRY), 
 	mBuffer(NULL),
@@ -107,71 +227,23 @@ LLVOCacheEntry::LLVOCacheEntry(LLAPRFile* apr_file)
 	mSceneContrib(0.f),
 	mValid(FALSE),
 	mParentID(0),
-	mBSphereRadius(-1.0f)
+	mBSphereRadius(-1.0f),
+	mFile(file),
+	mRecordOffset(offset),
+	mDirty(false)
 {
-	S32 size = -1;
-	BOOL success;
-
 	mDP.assignBuffer(mBuffer, 0);
-	
-	success = check_read(apr_file, &mLocalID, sizeof(U32));
-	if(success)
-	{
-		success = check_read(apr_file, &mCRC, sizeof(U32));
-	}
-	if(success)
-	{
-		success = check_read(apr_file, &mHitCount, sizeof(S32));
-	}
-	if(success)
-	{
-		success = check_read(apr_file, &mDupeCount, sizeof(S32));
-	}
-	if(success)
-	{
-		success = check_read(apr_file, &mCRCChangeCount, sizeof(S32));
-	}
-	if(success)
-	{
-		success = check_read(apr_file, &size, sizeof(S32));
-
-		// Corruption in the cache entries
-		if ((size > 10000) || (size < 1))
-		{
-			// We've got a bogus size, skip reading it.
-			// We won't bother seeking, because the rest of this file
-			// is likely bogus, and will be tossed anyway.
-			LL_WARNS() << "Bogus cache entry, size " << size << ", aborting!" << LL_ENDL;
-			success = FALSE;
-		}
-	}
-	if(success && size > 0)
-	{
-		mBuffer = new U8[size];
-		success = check_read(apr_file, mBuffer, size);
 
-		if(success)
-		{
-			mDP.assignBuffer(mBuffer, size);
-		}
-		else
-		{
-			delete[] mBuffer ;
-			mBuffer = NULL ;
-		}
-	}
-
-	if(!success)
+	LLVOCacheFile::RecordHeader record;
+	if (!file->readRecordHeader(offset, record))
 	{
-		mLocalID = 0;
-		mCRC = 0;
-		mHitCount = 0;
-		mDupeCount = 0;
-		mCRCChangeCount = 0;
-		mBuffer = NULL;
-		mEntry = NULL;
-		mState = INACTIVE;
+		memset(&record, 0, sizeof(record));
 	}
+	mLocalID = record.mLocalID;
+	mCRC = record.mCRC;
+	mHitCount = record.mHitCount;
+	mDupeCount = record.mDupeCount;
+	mCRCChangeCount = record.mCRCChangeCount;
 }
 
 LLVOCacheEntry::~LLVOCacheEntry()
@@ -188,6 +260,8 @@ void LLVOCacheEntry::updateEntry(U32 crc, LLDataPackerBinaryBuffer &dp)
 	}
 
 	mDP.freeBuffer();
+	mFile = NULL;
+	mDirty = true;
 
 	llassert_always(dp.getBufferSize() > 0);
 	mBuffer = new U8[dp.getBufferSize()];
@@ -318,8 +392,24 @@ LLVOCacheEntry* LLVOCacheEntry::getChild()
 	return child;
 }
 
+void LLVOCacheEntry::loadData()
+{
+	//the file may have been closed since, the data is gone then
+	S32 size = 0;
+	mBuffer = mFile->readRecordData(mRecordOffset, mLocalID, size);
+	if (mBuffer)
+	{
+		mDP.assignBuffer(mBuffer, size);
+	}
+}
+
 LLDataPackerBinaryBuffer *LLVOCacheEntry::getDP()
 {
+	if (mDP.getBufferSize() == 0 && mFile.notNull())
+	{
+		loadData();
+	}
+
 	if (mDP.getBufferSize() == 0)
 	{
 		//LL_INFOS() << "Not getting cache entry, invalid!" << LL_ENDL;
@@ -345,40 +435,6 @@ void LLVOCacheEntry::dump() const
 		<< LL_ENDL;
 }
 
-BOOL LLVOCacheEntry::writeToFile(LLAPRFile* apr_file) const
-{
-	BOOL success;
-	success = check_write(apr_file, (void*)&mLocalID, sizeof(U32));
-	if(success)
-	{
-		success = check_write(apr_file, (void*)&mCRC, sizeof(U32));
-	}
-	if(success)
-	{
-		success = check_write(apr_file, (void*)&mHitCount, sizeof(S32));
-	}
-	if(success)
-	{
-		success = check_write(apr_file, (void*)&mDupeCount, sizeof(S32));
-	}
-	if(success)
-	{
-		success = check_write(apr_file, (void*)&mCRCChangeCount, sizeof(S32));
-	}
-	if(success)
-	{
-		S32 size = mDP.getBufferSize();
-		success = check_write(apr_file, (void*)&size, sizeof(S32));
-	
-		if(success)
-		{
-			success = check_write(apr_file, (void*)mBuffer, size);
-		}
-	}
-
-	return success ;
-}
-
 //static 
 void LLVOCacheEntry::updateDebugSettings()
 {
@@ -715,6 +771,13 @@ public:
 		return false;
 	}
 
+	virtual bool isOccluded(LLViewerOctreeGroup* base_group)
+	{
+		LLOcclusionCullingGroup* group = (LLOcclusionCullingGroup*)base_group;
+		return mUseObjectCacheOcclusion && !group->needsUpdate() &&
+			group->isOcclusionState(LLOcclusionCullingGroup::OCCLUDED);
+	}
+
 	virtual S32 frustumCheck(const LLViewerOctreeGroup* group)
 	{
 #if 0
@@ -730,6 +793,22 @@ public:
 		return res;
 	}
 
+	virtual bool frustumCheckChildren(const OctreeNode* branch, S32* results)
+	{
+		if (!AABBInRegionFrustumNoFarClipChildBounds((LLViewerOctreeGroup*) branch->getListener(0), results))
+		{
+			return false;
+		}
+		for (U32 i = 0; i < branch->getChildCount(); i++)
+		{
+			if (results[i] != 0)
+			{
+				results[i] = llmin(results[i], AABBRegionSphereIntersectGroupExtents((LLViewerOctreeGroup*) branch->getChild(i)->getListener(0), mLocalShift));
+			}
+		}
+		return true;
+	}
+
 	virtual S32 frustumCheckObjects(const LLViewerOctreeGroup* group)
 	{
 #if 0
@@ -897,28 +976,42 @@ void LLVOCachePartition::selectBackObjects(LLCamera &camera, F32 pixel_threshold
 }
 
 S32 LLVOCachePartition::cull(LLCamera &camera, bool do_occlusion)
+{
+	LLViewerOctreeCull* culler = beginCull(camera, do_occlusion);
+	if (!culler)
+	{
+		return 0;
+	}
+	culler->traverse(mOctree);
+	delete culler;
+	endCull();
+	return 1;
+}
+
+//virtual
+LLViewerOctreeCull* LLVOCachePartition::beginCull(LLCamera& camera, bool do_occlusion)
 {
 	static LLCachedControl<bool> use_object_cache_occlusion(gSavedSettings,"UseObjectCacheOcclusion");
 	
 	if(!LLViewerRegion::sVOCacheCullingEnabled)
 	{
-		return 0;
+		return NULL;
 	}
 	if(mRegionp->isPaused())
 	{
-		return 0;
+		return NULL;
 	}
 
 	((LLViewerOctreeGroup*)mOctree->getListener(0))->rebound();
 
 	if(LLViewerCamera::sCurCameraID != LLViewerCamera::CAMERA_WORLD)
 	{
-		return 0; //no need for those cameras.
+		return NULL; //no need for those cameras.
 	}
 
 	if(mCulledTime[LLViewerCamera::sCurCameraID] == LLViewerOctreeEntryData::getCurrentFrame())
 	{
-		return 0; //already culled
+		return NULL; //already culled
 	}
 	mCulledTime[LLViewerCamera::sCurCameraID] = LLViewerOctreeEntryData::getCurrentFrame();
 
@@ -939,7 +1032,7 @@ S32 LLVOCachePartition::cull(LLCamera &camera, bool do_occlusion)
 			//process back objects selection
 			selectBackObjects(camera, LLVOCacheEntry::getSquaredPixelThreshold(mFrontCull), 
 				do_occlusion && use_object_cache_occlusion);
-			return 0; //nothing changed, reduce frequency of culling
+			return NULL; //nothing changed, reduce frequency of culling
 		}
 	}
 	else
@@ -952,15 +1045,17 @@ S32 LLVOCachePartition::cull(LLCamera &camera, bool do_occlusion)
 	camera.calcRegionFrustumPlanes(region_agent, gAgentCamera.mDrawDistance);
 
 	mFrontCull = TRUE;
-	LLVOCacheOctreeCull culler(&camera, mRegionp, region_agent, do_occlusion && use_object_cache_occlusion, 
+	return new LLVOCacheOctreeCull(&camera, mRegionp, region_agent, do_occlusion && use_object_cache_occlusion, 
 		LLVOCacheEntry::getSquaredPixelThreshold(mFrontCull), this);
-	culler.traverse(mOctree);	
+}
 
+//virtual
+void LLVOCachePartition::endCull()
+{
 	if(!sNeedsOcclusionCheck)
 	{
 		sNeedsOcclusionCheck = !mOccludedGroups.empty();
 	}
-	return 1;
 }
 
 void LLVOCachePartition::setCullHistory(BOOL has_new_object)
@@ -1038,6 +1133,491 @@ void LLVOCachePartition::removeOccluder(LLVOCacheGroup* group)
 // Format string used to construct filename for the object cache
 static const char OBJECT_CACHE_FILENAME[] = "objects_%d_%d.slc";
 
+const U32 CACHE_FILE_MAGIC = 0x434f564c; //"LVOC"
+const U32 CACHE_FILE_VERSION = 1;
+const U32 CACHE_FILE_GROW_SIZE = 64 * 1024; //the mapping grows by this much at least
+const S32 MAX_CACHE_RECORD_SIZE = 10000;
+const U32 MIN_CACHE_COMPACT_SIZE = 256 * 1024;
+
+LLVOCacheFile::LLVOCacheFile()
+:	mMutex(NULL),
+	mDataEnd(0),
+	mLiveBytes(0)
+{
+}
+
+LLVOCacheFile::~LLVOCacheFile()
+{
+	close();
+}
+
+bool LLVOCacheFile::open(const std::string& filename, bool read_only)
+{
+	LLMutexLock lock(&mMutex);
+	close();
+
+	if (!mFile.open(filename, 0, read_only))
+	{
+		return false;
+	}
+
+	const FileHeader* header = (const FileHeader*)mFile.getData();
+	if (mFile.getSize() < sizeof(FileHeader) ||
+		header->mMagic != CACHE_FILE_MAGIC ||
+		header->mVersion != CACHE_FILE_VERSION ||
+		header->mDataEnd < sizeof(FileHeader) ||
+		header->mDataEnd > mFile.getSize())
+	{
+		LL_WARNS() << "Unrecognized object cache file " << filename << ", discarding" << LL_ENDL;
+		close();
+		return false;
+	}
+	memcpy(mRegionID.mData, header->mRegionID, UUID_BYTES);
+
+	//index the records, later ones supersede earlier ones
+	U32 data_end = header->mDataEnd;
+	mDataEnd = sizeof(FileHeader);
+	while (mDataEnd + sizeof(RecordHeader) <= data_end)
+	{
+		const RecordHeader* record = getRecord(mDataEnd);
+		if (!record->mLocalID ||
+			record->mSize < 0 || record->mSize > MAX_CACHE_RECORD_SIZE ||
+			mDataEnd + getRecordSize(record->mSize) > data_end)
+		{
+			// Keep what was read so far, the rest will be overwritten
+			LL_WARNS() << "Bogus cache record at " << mDataEnd << " in " << filename << ", ignoring the rest" << LL_ENDL;
+			break;
+		}
+
+		setRecord(record->mLocalID, record->mSize > 0 ? mDataEnd : 0);
+		mDataEnd += getRecordSize(record->mSize);
+	}
+
+	return true;
+}
+
+bool LLVOCacheFile::create(const std::string& filename, const LLUUID& id)
+{
+	LLMutexLock lock(&mMutex);
+	close();
+
+	if (!mFile.open(filename, CACHE_FILE_GROW_SIZE, false))
+	{
+		close();
+		return false;
+	}
+
+	FileHeader* header = (FileHeader*)mFile.getData();
+	header->mMagic = CACHE_FILE_MAGIC;
+	header->mVersion = CACHE_FILE_VERSION;
+	memcpy(header->mRegionID, id.mData, UUID_BYTES);
+	header->mDataEnd = sizeof(FileHeader);
+
+	mRegionID = id;
+	mDataEnd = sizeof(FileHeader);
+	return true;
+}
+
+void LLVOCacheFile::close()
+{
+	LLMutexLock lock(&mMutex);
+	if (mFile.isOpen() && !mFile.isReadOnly() && mDataEnd && mDataEnd != mFile.getSize())
+	{
+		//drop the room reserved for appending
+		mFile.resize(mDataEnd);
+	}
+	mFile.close();
+	mRecords.clear();
+	mDataEnd = 0;
+	mLiveBytes = 0;
+}
+
+bool LLVOCacheFile::isOpen() const
+{
+	LLMutexLock lock(&mMutex);
+	return mFile.isOpen();
+}
+
+void LLVOCacheFile::createEntries(LLVOCacheEntry::vocache_entry_map_t& cache_entry_map)
+{
+	LLMutexLock lock(&mMutex);
+	for (record_map_t::const_iterator iter = mRecords.begin(); iter != mRecords.end(); ++iter)
+	{
+		cache_entry_map[iter->first] = new LLVOCacheEntry(this, iter->second);
+	}
+}
+
+bool LLVOCacheFile::readRecordHeader(U32 offset, RecordHeader& header) const
+{
+	LLMutexLock lock(&mMutex);
+	const RecordHeader* record = getRecord(offset);
+	if (!record)
+	{
+		return false;
+	}
+	header = *record;
+	return true;
+}
+
+U8* LLVOCacheFile::readRecordData(U32 offset, U32 local_id, S32& size) const
+{
+	LLMutexLock lock(&mMutex);
+	const RecordHeader* record = getRecord(offset);
+	if (!record || record->mLocalID != local_id || record->mSize <= 0)
+	{
+		return NULL;
+	}
+
+	size = record->mSize;
+	U8* data = new U8[size];
+	memcpy(data, record + 1, size);
+	return data;
+}
+
+const LLVOCacheFile::RecordHeader* LLVOCacheFile::getRecord(U32 offset) const
+{
+	if (!offset || !mFile.isOpen() || offset + sizeof(RecordHeader) > mFile.getSize())
+	{
+		return NULL;
+	}
+	return (const RecordHeader*)(mFile.getData() + offset);
+}
+
+U32 LLVOCacheFile::findRecord(U32 local_id) const
+{
+	record_map_t::const_iterator iter = mRecords.find(local_id);
+	return iter != mRecords.end() ? iter->second : 0;
+}
+
+void LLVOCacheFile::setRecord(U32 local_id, U32 offset)
+{
+	record_map_t::iterator iter = mRecords.find(local_id);
+	if (iter != mRecords.end())
+	{
+		mLiveBytes -= getRecordSize(getRecord(iter->second)->mSize);
+		if (!offset)
+		{
+			mRecords.erase(iter);
+		}
+	}
+	if (offset)
+	{
+		mRecords[local_id] = offset;
+		mLiveBytes += getRecordSize(getRecord(offset)->mSize);
+	}
+}
+
+bool LLVOCacheFile::reserve(U32 size)
+{
+	if (mDataEnd + size <= mFile.getSize())
+	{
+		return true;
+	}
+	return mFile.resize(mDataEnd + llmax(size, CACHE_FILE_GROW_SIZE));
+}
+
+bool LLVOCacheFile::appendRecord(const RecordHeader& header, const U8* data)
+{
+	if (!reserve(getRecordSize(header.mSize)))
+	{
+		return false;
+	}
+
+	RecordHeader* record = (RecordHeader*)(mFile.getData() + mDataEnd);
+	*record = header;
+	memcpy(record + 1, data, header.mSize);
+
+	setRecord(header.mLocalID, mDataEnd);
+	mDataEnd += getRecordSize(header.mSize);
+	return true;
+}
+
+bool LLVOCacheFile::appendRemoval(U32 local_id)
+{
+	if (!reserve(sizeof(RecordHeader)))
+	{
+		return false;
+	}
+
+	RecordHeader* record = (RecordHeader*)(mFile.getData() + mDataEnd);
+	memset(record, 0, sizeof(RecordHeader));
+	record->mLocalID = local_id;
+
+	setRecord(local_id, 0);
+	mDataEnd += sizeof(RecordHeader);
+	return true;
+}
+
+bool LLVOCacheFile::appendEntry(const EntryRecord& entry, const std::vector<U8>& data, LLVOCacheFile* source)
+{
+	if (entry.mHeader.mSize > 0)
+	{
+		return appendRecord(entry.mHeader, &data[entry.mDataOffset]);
+	}
+
+	//the data is still in the source file
+	const RecordHeader* record = source ? source->getRecord(entry.mFileOffset) : NULL;
+	if (!record || record->mLocalID != entry.mHeader.mLocalID || record->mSize <= 0)
+	{
+		return true; //lost, nothing to write
+	}
+
+	RecordHeader header = entry.mHeader;
+	header.mSize = record->mSize;
+	//appending may move the mapping the record is in
+	std::vector<U8> buffer((const U8*)(record + 1), (const U8*)(record + 1) + record->mSize);
+	return appendRecord(header, &buffer[0]);
+}
+
+bool LLVOCacheFile::appendEntries(const entry_record_list_t& entries, const std::vector<U8>& data)
+{
+	LLMutexLock lock(&mMutex);
+
+	bool success = mFile.isOpen() && !mFile.isReadOnly();
+	for (entry_record_list_t::const_iterator iter = entries.begin(); success && iter != entries.end(); ++iter)
+	{
+		U32 offset = findRecord(iter->mHeader.mLocalID);
+		if (offset && !iter->mDirty)
+		{
+			//counts don't dirty an entry, update them in place
+			RecordHeader* record = (RecordHeader*)(mFile.getData() + offset);
+			record->mHitCount = iter->mHeader.mHitCount;
+			record->mDupeCount = iter->mHeader.mDupeCount;
+			record->mCRCChangeCount = iter->mHeader.mCRCChangeCount;
+		}
+		else
+		{
+			success = appendEntry(*iter, data, this);
+		}
+	}
+
+	//objects dropped from the region since the file was read
+	std::vector<U32> removed;
+	entry_record_list_t::const_iterator entry_iter = entries.begin();
+	for (record_map_t::const_iterator iter = mRecords.begin(); iter != mRecords.end(); ++iter)
+	{
+		while (entry_iter != entries.end() && entry_iter->mHeader.mLocalID < iter->first)
+		{
+			++entry_iter;
+		}
+		if (entry_iter == entries.end() || entry_iter->mHeader.mLocalID != iter->first)
+		{
+			removed.push_back(iter->first);
+		}
+	}
+	for (std::vector<U32>::iterator iter = removed.begin(); success && iter != removed.end(); ++iter)
+	{
+		success = appendRemoval(*iter);
+	}
+
+	return success && commit();
+}
+
+bool LLVOCacheFile::copyEntries(LLVOCacheFile* source, const entry_record_list_t& entries, const std::vector<U8>& data)
+{
+	LLMutexLock lock(&mMutex);
+	if (source)
+	{
+		source->mMutex.lock();
+	}
+
+	bool success = mFile.isOpen();
+	for (entry_record_list_t::const_iterator iter = entries.begin(); success && iter != entries.end(); ++iter)
+	{
+		success = appendEntry(*iter, data, source);
+	}
+
+	if (source)
+	{
+		source->mMutex.unlock();
+	}
+	return success && commit();
+}
+
+bool LLVOCacheFile::commit()
+{
+	((FileHeader*)mFile.getData())->mDataEnd = mDataEnd;
+	return mFile.flush();
+}
+
+bool LLVOCacheFile::needsCompaction() const
+{
+	LLMutexLock lock(&mMutex);
+	U32 data_size = mDataEnd - sizeof(FileHeader);
+	return data_size > MIN_CACHE_COMPACT_SIZE && data_size > 2 * mLiveBytes;
+}
+
+//---------------------------------------------------------------------------
+// LLVOCacheThread
+//---------------------------------------------------------------------------
+
+class LLVOCacheThread::ReadRequest : public LLQueuedThread::QueuedRequest
+{
+public:
+	ReadRequest(handle_t handle, const std::string& filename, bool read_only)
+	:	QueuedRequest(handle, PRIORITY_NORMAL),
+		mFilename(filename),
+		mReadOnly(read_only)
+	{
+	}
+
+	/*virtual*/ bool processRequest()
+	{
+		//opening the file indexes it, which reads in every record header
+		LLPointer<LLVOCacheFile> file = new LLVOCacheFile();
+		if (LLFile::isfile(mFilename) && file->open(mFilename, mReadOnly))
+		{
+			mFile = file;
+		}
+		return true;
+	}
+
+	std::string mFilename;
+	bool mReadOnly;
+	LLPointer<LLVOCacheFile> mFile;
+};
+
+class LLVOCacheThread::WriteRequest : public LLQueuedThread::QueuedRequest
+{
+public:
+	WriteRequest(handle_t handle, const std::string& filename, const LLUUID& id, LLVOCacheFile* file)
+	:	QueuedRequest(handle, PRIORITY_NORMAL),
+		mFilename(filename),
+		mID(id),
+		mFile(file),
+		mSuccess(false)
+	{
+	}
+
+	/*virtual*/ bool processRequest()
+	{
+		if (mFile.isNull() && LLFile::isfile(mFilename))
+		{
+			//the region didn't read its file, append to it anyway
+			mFile = new LLVOCacheFile();
+			mFile->open(mFilename, false);
+		}
+
+		if (mFile.notNull() && mFile->isOpen() && mFile->getRegionID() == mID && !mFile->needsCompaction())
+		{
+			mSuccess = mFile->appendEntries(mEntries, mData);
+		}
+		else
+		{
+			//write the region out next to the old file, which may hold some of the data
+			bool has_old_file = mFile.notNull() && mFile->isOpen();
+			std::string new_filename = has_old_file ? mFilename + ".tmp" : mFilename;
+
+			LLPointer<LLVOCacheFile> new_file = new LLVOCacheFile();
+			mSuccess = new_file->create(new_filename, mID) && new_file->copyEntries(mFile, mEntries, mData);
+			new_file->close();
+
+			if (has_old_file)
+			{
+				mFile->close();
+				if (mSuccess)
+				{
+					LLFile::remove(mFilename);
+					mSuccess = LLFile::rename(new_filename, mFilename) == 0;
+				}
+				else
+				{
+					LLFile::remove(new_filename);
+				}
+			}
+		}
+
+		//anything left of the region in memory doesn't need the file any more
+		if (mFile.notNull())
+		{
+			mFile->close();
+		}
+		return true;
+	}
+
+	std::string mFilename;
+	LLUUID mID;
+	LLPointer<LLVOCacheFile> mFile;
+	LLVOCacheFile::entry_record_list_t mEntries;
+	std::vector<U8> mData;
+	bool mSuccess;
+};
+
+class LLVOCacheThread::RemoveRequest : public LLQueuedThread::QueuedRequest
+{
+public:
+	RemoveRequest(handle_t handle, const std::string& filename, LLVOCacheFile* file)
+	:	QueuedRequest(handle, PRIORITY_NORMAL, FLAG_AUTO_COMPLETE),
+		mFilename(filename),
+		mFile(file)
+	{
+	}
+
+	/*virtual*/ bool processRequest()
+	{
+		if (mFile.notNull())
+		{
+			mFile->close();
+		}
+		LLFile::remove(mFilename);
+		return true;
+	}
+
+	std::string mFilename;
+	LLPointer<LLVOCacheFile> mFile;
+};
+
+LLQueuedThread::handle_t LLVOCacheThread::read(const std::string& filename, bool read_only)
+{
+	handle_t handle = generateHandle();
+	addRequest(new ReadRequest(handle, filename, read_only));
+	return handle;
+}
+
+LLQueuedThread::handle_t LLVOCacheThread::write(const std::string& filename, const LLUUID& id, LLVOCacheFile* file,
+												LLVOCacheFile::entry_record_list_t& entries, std::vector<U8>& data)
+{
+	handle_t handle = generateHandle();
+	WriteRequest* req = new WriteRequest(handle, filename, id, file);
+	req->mEntries.swap(entries);
+	req->mData.swap(data);
+	addRequest(req);
+	return handle;
+}
+
+void LLVOCacheThread::remove(const std::string& filename, LLVOCacheFile* file)
+{
+	addRequest(new RemoveRequest(generateHandle(), filename, file));
+}
+
+bool LLVOCacheThread::finishRead(handle_t handle, LLPointer<LLVOCacheFile>& file)
+{
+	status_t status = getRequestStatus(handle);
+	if (status == STATUS_QUEUED || status == STATUS_INPROGRESS)
+	{
+		return false;
+	}
+
+	ReadRequest* req = (ReadRequest*)getRequest(handle);
+	file = req ? req->mFile.get() : NULL;
+	completeRequest(handle);
+	return true;
+}
+
+bool LLVOCacheThread::finishWrite(handle_t handle, bool& success)
+{
+	status_t status = getRequestStatus(handle);
+	if (status == STATUS_QUEUED || status == STATUS_INPROGRESS)
+	{
+		return false;
+	}
+
+	WriteRequest* req = (WriteRequest*)getRequest(handle);
+	success = req && req->mSuccess && status == STATUS_COMPLETE;
+	completeRequest(handle);
+	return true;
+}
+
 const U32 MAX_NUM_OBJECT_ENTRIES = 128 ;
 const U32 MIN_ENTRIES_TO_PURGE = 16 ;
 const U32 INVALID_TIME = 0 ;
@@ -1049,7 +1629,8 @@ LLVOCache::LLVOCache():
 	mInitialized(false),
 	mReadOnly(true),
 	mNumEntries(0),
-	mCacheSize(1)
+	mCacheSize(1),
+	mThread(NULL)
 {
 	mEnabled = gSavedSettings.getBOOL("ObjectCacheEnabled");
 	mLocalAPRFilePoolp = new LLVolatileAPRPool() ;
@@ -1057,6 +1638,15 @@ LLVOCache::LLVOCache():
 
 LLVOCache::~LLVOCache()
 {
+	if(mThread)
+	{
+		//let the writes of the regions that just went away finish
+		waitOnPending();
+		mThread->shutdown();
+		delete mThread;
+		mThread = NULL;
+	}
+
 	if(mEnabled)
 	{
 		writeCacheHeader();
@@ -1093,6 +1683,10 @@ void LLVOCache::initCache(ELLPath location, U32 size, U32 cache_version)
 	}
 	mCacheSize = llclamp(size, MIN_ENTRIES_TO_PURGE, MAX_NUM_OBJECT_ENTRIES);
 	mMetaInfo.mVersion = cache_version;
+	if(!mThread)
+	{
+		mThread = new LLVOCacheThread();
+	}
 	readCacheHeader();	
 
 	if(mMetaInfo.mVersion != cache_version) 
@@ -1128,10 +1722,10 @@ void LLVOCache::removeCache(ELLPath location, bool started)
 	std::string mask = "*";
 	std::string cache_dir = gDirUtilp->getExpandedFilename(location, object_cache_dirname);
 	LL_INFOS() << "Removing cache at " << cache_dir << LL_ENDL;
+	clearCacheInMemory(); //unmaps the region files
 	gDirUtilp->deleteFilesInDir(cache_dir, mask); //delete all files
 	LLFile::rmdir(cache_dir);
 
-	clearCacheInMemory();
 	mInitialized = false;
 }
 
@@ -1151,9 +1745,9 @@ void LLVOCache::removeCache()
 
 	std::string mask = "*";
 	LL_INFOS() << "Removing object cache at " << mObjectCacheDirName << LL_ENDL;
+	clearCacheInMemory() ; //unmaps the region files
 	gDirUtilp->deleteFilesInDir(mObjectCacheDirName, mask); 
 
-	clearCacheInMemory() ;
 	writeCacheHeader();
 }
 
@@ -1194,6 +1788,14 @@ void LLVOCache::removeEntry(U64 handle)
 
 void LLVOCache::clearCacheInMemory()
 {
+	waitOnPending();
+
+	for(region_file_map_t::iterator iter = mRegionFiles.begin(); iter != mRegionFiles.end(); ++iter)
+	{
+		iter->second->close();
+	}
+	mRegionFiles.clear();
+
 	if(!mHeaderEntryQueue.empty()) 
 	{
 		for(header_entry_queue_t::iterator iter = mHeaderEntryQueue.begin(); iter != mHeaderEntryQueue.end(); ++iter)
@@ -1228,7 +1830,27 @@ void LLVOCache::removeFromCache(HeaderEntryInfo* entry)
 
 	std::string filename;
 	getObjectCacheFilename(entry->mHandle, filename);
-	LLAPRFile::remove(filename, mLocalAPRFilePoolp);
+
+	//the file is closed on the cache thread before it goes
+	LLPointer<LLVOCacheFile> file;
+	region_file_map_t::iterator iter = mRegionFiles.find(entry->mHandle);
+	if(iter != mRegionFiles.end())
+	{
+		file = iter->second;
+		mRegionFiles.erase(iter);
+	}
+	if(mThread)
+	{
+		mThread->remove(filename, file);
+	}
+	else
+	{
+		if(file.notNull())
+		{
+			file->close();
+		}
+		LLFile::remove(filename);
+	}
 	entry->mTime = INVALID_TIME ;
 	updateEntry(entry) ; //update the head file.
 }
@@ -1376,12 +1998,12 @@ BOOL LLVOCache::updateEntry(const HeaderEntryInfo* entry)
 	return check_write(&apr_file, (void*)entry, sizeof(HeaderEntryInfo)) ;
 }
 
-void LLVOCache::readFromCache(U64 handle, const LLUUID& id, LLVOCacheEntry::vocache_entry_map_t& cache_entry_map) 
+bool LLVOCache::readFromCache(U64 handle, const LLUUID& id) 
 {
 	if(!mEnabled)
 	{
 		LL_WARNS() << "Not reading cache for handle " << handle << "): Cache is currently disabled." << LL_ENDL;
-		return ;
+		return false;
 	}
 	llassert_always(mInitialized);
 
@@ -1389,58 +2011,186 @@ void LLVOCache::readFromCache(U64 handle, const LLUUID& id, LLVOCacheEntry::voca
 	if(iter == mHandleEntryMap.end()) //no cache
 	{
 		LL_WARNS() << "No handle map entry for " << handle << LL_ENDL;
-		return ;
+		return false;
 	}
 
-	bool success = true ;
+	pending_read_map_t::iterator pending_iter = mPendingReads.find(handle);
+	if(pending_iter != mPendingReads.end())
+	{
+		//prefetched, the region gets it as soon as it is read
+		pending_iter->second.mID = id;
+		pending_iter->second.mState = PendingRead::WANTED;
+		return true;
+	}
+
+	PendingRead& read = mPendingReads[handle];
+	read.mID = id;
+	read.mState = PendingRead::WANTED;
+	if(mRegionFiles.find(handle) != mRegionFiles.end())
+	{
+		read.mRequest = 0; //already read, delivered by the next update()
+	}
+	else
 	{
 		std::string filename;
 		getObjectCacheFilename(handle, filename);
-		LLAPRFile apr_file(filename, APR_READ|APR_BINARY, mLocalAPRFilePoolp);
-	
-		LLUUID cache_id ;
-		success = check_read(&apr_file, cache_id.mData, UUID_BYTES) ;
-	
-		if(success)
-		{		
-			if(cache_id != id)
+		read.mRequest = mThread->read(filename, mReadOnly);
+	}
+
+	return true;
+}
+
+void LLVOCache::prefetch(U64 handle)
+{
+	if(!mEnabled || !mInitialized || !mThread)
+	{
+		return;
+	}
+
+	if(mHandleEntryMap.find(handle) == mHandleEntryMap.end() ||
+	   mPendingReads.find(handle) != mPendingReads.end() ||
+	   mRegionFiles.find(handle) != mRegionFiles.end())
+	{
+		return; //nothing to read, or read already
+	}
+
+	std::string filename;
+	getObjectCacheFilename(handle, filename);
+
+	PendingRead& read = mPendingReads[handle];
+	read.mRequest = mThread->read(filename, mReadOnly);
+	read.mState = PendingRead::PREFETCH;
+}
+
+void LLVOCache::releaseRegion(U64 handle)
+{
+	pending_read_map_t::iterator iter = mPendingReads.find(handle);
+	if(iter != mPendingReads.end())
+	{
+		if(iter->second.mRequest)
+		{
+			iter->second.mState = PendingRead::RELEASED;
+		}
+		else
+		{
+			mPendingReads.erase(iter);
+		}
+	}
+	mRegionFiles.erase(handle);
+}
+
+void LLVOCache::update()
+{
+	if(!mThread)
+	{
+		return;
+	}
+	mThread->update(1.f);
+
+	for(pending_read_map_t::iterator iter = mPendingReads.begin(); iter != mPendingReads.end(); )
+	{
+		pending_read_map_t::iterator cur_iter = iter++;
+
+		LLPointer<LLVOCacheFile> file;
+		if(cur_iter->second.mRequest)
+		{
+			if(!mThread->finishRead(cur_iter->second.mRequest, file))
 			{
-				LL_INFOS() << "Cache ID doesn't match for this region, discarding"<< LL_ENDL;
-				success = false ;
+				continue; //still reading
 			}
+		}
+		else
+		{
+			region_file_map_t::iterator file_iter = mRegionFiles.find(cur_iter->first);
+			if(file_iter != mRegionFiles.end())
+			{
+				file = file_iter->second;
+			}
+		}
+
+		U64 handle = cur_iter->first;
+		PendingRead read = cur_iter->second;
+		mPendingReads.erase(cur_iter);
 
-			if(success)
+		switch(read.mState)
+		{
+		case PendingRead::WANTED:
+			deliver(handle, read.mID, file);
+			break;
+		case PendingRead::PREFETCH:
+			if(file.notNull())
 			{
-				S32 num_entries;
-				success = check_read(&apr_file, &num_entries, sizeof(S32)) ;
-	
-				if(success)
-				{
-					for (S32 i = 0; i < num_entries && apr_file.eof() != APR_EOF; i++)
-					{
-						LLPointer<LLVOCacheEntry> entry = new LLVOCacheEntry(&apr_file);
-						if (!entry->getLocalID())
-						{
-							LL_WARNS() << "Aborting cache file load for " << filename << ", cache file corruption!" << LL_ENDL;
-							success = false ;
-							break ;
-						}
-						cache_entry_map[entry->getLocalID()] = entry;
-					}
-				}
+				mRegionFiles[handle] = file;
 			}
-		}		
+			break;
+		default: //released, the file goes away
+			break;
+		}
 	}
-	
-	if(!success)
+
+	for(pending_write_list_t::iterator iter = mPendingWrites.begin(); iter != mPendingWrites.end(); )
 	{
-		if(cache_entry_map.empty())
+		bool success = false;
+		if(!mThread->finishWrite(iter->first, success))
 		{
-			removeEntry(iter->second) ;
+			++iter;
+			continue;
+		}
+
+		U64 handle = iter->second;
+		iter = mPendingWrites.erase(iter);
+		if(!success)
+		{
+			LL_WARNS() << "Failed to write object cache for handle " << handle << LL_ENDL;
+			removeEntry(handle);
 		}
 	}
+}
 
-	return ;
+void LLVOCache::deliver(U64 handle, const LLUUID& id, LLVOCacheFile* file)
+{
+	LLViewerRegion* regionp = LLWorld::instanceExists() ? LLWorld::getInstance()->getRegionFromHandle(handle) : NULL;
+	if(!regionp)
+	{
+		return;
+	}
+
+	//only the record headers are read, entries load their data when first used
+	LLVOCacheEntry::vocache_entry_map_t cache_entry_map;
+	if(!file)
+	{
+		removeEntry(handle);
+	}
+	else if(file->getRegionID() != id)
+	{
+		LL_INFOS() << "Cache ID doesn't match for this region, discarding"<< LL_ENDL;
+		mRegionFiles[handle] = file; //closed before it is removed
+		removeEntry(handle);
+	}
+	else
+	{
+		file->createEntries(cache_entry_map);
+		mRegionFiles[handle] = file;
+	}
+
+	regionp->objectCacheLoaded(cache_entry_map);
+}
+
+void LLVOCache::waitOnPending()
+{
+	if(!mThread)
+	{
+		return;
+	}
+
+	while(mThread->getPending() > 0 || !mPendingReads.empty() || !mPendingWrites.empty())
+	{
+		update();
+		if(mThread->getPending() > 0 || !mPendingReads.empty() || !mPendingWrites.empty())
+		{
+			ms_sleep(1);
+		}
+	}
 }
 	
 void LLVOCache::purgeEntries(U32 size)
@@ -1466,6 +2216,15 @@ void LLVOCache::writeToCache(U64 handle, const LLUUID& id, const LLVOCacheEntry:
 	}
 	llassert_always(mInitialized);
 
+	//the region is done with its file after this
+	LLPointer<LLVOCacheFile> file;
+	region_file_map_t::iterator file_iter = mRegionFiles.find(handle);
+	if(file_iter != mRegionFiles.end())
+	{
+		file = file_iter->second;
+		mRegionFiles.erase(file_iter);
+	}
+
 	if(mReadOnly)
 	{
 		LL_WARNS() << "Not writing cache for handle " << handle << "): Cache is currently in read-only mode." << LL_ENDL;
@@ -1513,39 +2272,52 @@ void LLVOCache::writeToCache(U64 handle, const LLUUID& id, const LLVOCacheEntry:
 		return ; //nothing changed, no need to update.
 	}
 
-	//write to cache file
-	bool success = true ;
+	//only what is not in the file already goes to the cache thread
+	LLVOCacheFile::entry_record_list_t entries;
+	std::vector<U8> data;
+	entries.reserve(cache_entry_map.size());
+	for (LLVOCacheEntry::vocache_entry_map_t::const_iterator iter = cache_entry_map.begin(); iter != cache_entry_map.end(); ++iter)
 	{
-		std::string filename;
-		getObjectCacheFilename(handle, filename);
-		LLAPRFile apr_file(filename, APR_CREATE|APR_WRITE|APR_BINARY, mLocalAPRFilePoolp);
-	
-		success = check_write(&apr_file, (void*)id.mData, UUID_BYTES) ;
+		LLVOCacheEntry* cache_entry = iter->second.get();
+		if(removal_enabled && !cache_entry->isValid())
+		{
+			continue;
+		}
 
-	
-		if(success)
+		LLVOCacheFile::EntryRecord record;
+		record.mHeader.mLocalID = cache_entry->getLocalID();
+		record.mHeader.mCRC = cache_entry->getCRC();
+		record.mHeader.mHitCount = cache_entry->getHitCount();
+		record.mHeader.mDupeCount = cache_entry->getDupeCount();
+		record.mHeader.mCRCChangeCount = cache_entry->getCRCChangeCount();
+		record.mHeader.mSize = 0;
+		record.mDataOffset = 0;
+		record.mFileOffset = 0;
+		record.mDirty = cache_entry->isDirty();
+
+		if(!record.mDirty && file.notNull() && cache_entry->getFile() == file.get())
 		{
-			S32 num_entries = cache_entry_map.size() ;
-			success = check_write(&apr_file, &num_entries, sizeof(S32));
-	
-			for (LLVOCacheEntry::vocache_entry_map_t::const_iterator iter = cache_entry_map.begin(); success && iter != cache_entry_map.end(); ++iter)
+			record.mFileOffset = cache_entry->getRecordOffset();
+		}
+		else
+		{
+			LLDataPackerBinaryBuffer* dp = cache_entry->getDP();
+			if(!dp || dp->getBufferSize() <= 0)
 			{
-				if(!removal_enabled || iter->second->isValid())
-				{
-					success = iter->second->writeToFile(&apr_file) ;
-					if(!success)
-					{
-						break;
-					}
-				}
+				continue; //its data is gone
 			}
+			record.mHeader.mSize = dp->getBufferSize();
+			record.mDataOffset = data.size();
+			data.insert(data.end(), dp->getBuffer(), dp->getBuffer() + dp->getBufferSize());
 		}
-	}
 
-	if(!success)
-	{
-		removeEntry(entry) ;
+		entries.push_back(record);
+		cache_entry->clearDirty();
 	}
 
+	std::string filename;
+	getObjectCacheFilename(handle, filename);
+	mPendingWrites.push_back(std::make_pair(mThread->write(filename, id, file, entries, data), handle));
+
 	return ;
 }
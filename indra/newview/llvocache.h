@@ -32,10 +32,13 @@
 #include "lldir.h"
 #include "llvieweroctree.h"
 #include "llapr.h"
+#include "llqueuedthread.h"
 
 //---------------------------------------------------------------------------
 // Cache entries
 class LLCamera;
+class LLVOCacheFile;
+class LLVOCacheThread;
 
 class LLVOCacheEntry 
 :	public LLViewerOctreeEntryData,
@@ -83,7 +86,7 @@ protected:
 	~LLVOCacheEntry();
 public:
 	LLVOCacheEntry(U32 local_id, U32 crc, LLDataPackerBinaryBuffer &dp);
-	LLVOCacheEntry(LLAPRFile* apr_file);
+	LLVOCacheEntry(LLVOCacheFile* file, U32 offset); //the data stays in the file until getDP() needs it
 	LLVOCacheEntry();	
 
 	void updateEntry(U32 crc, LLDataPackerBinaryBuffer &dp);
@@ -99,6 +102,7 @@ public:
 	U32 getLocalID() const			{ return mLocalID; }
 	U32 getCRC() const				{ return mCRC; }
 	S32 getHitCount() const			{ return mHitCount; }
+	S32 getDupeCount() const		{ return mDupeCount; }
 	S32 getCRCChangeCount() const	{ return mCRCChangeCount; }
 	
 	void calcSceneContribution(const LLVector4a& camera_origin, bool needs_update, U32 last_update, F32 dist_threshold);
@@ -106,7 +110,6 @@ public:
 	F32 getSceneContribution() const             { return mSceneContrib;}
 
 	void dump() const;
-	BOOL writeToFile(LLAPRFile* apr_file) const;
 	LLDataPackerBinaryBuffer *getDP();
 	void recordHit();
 	void recordDupe() { mDupeCount++; }
@@ -133,11 +136,20 @@ public:
 	void setUpdateFlags(U32 flags) {mUpdateFlags = flags;}
 	U32  getUpdateFlags() const    {return mUpdateFlags;}
 
+	//dirty if the data changed since it was last written to the cache file
+	bool isDirty() const {return mDirty;}
+	void clearDirty()    {mDirty = false;}
+
+	//the file the entry was read from and its record there
+	LLVOCacheFile* getFile() const   {return mFile.get();}
+	U32  getRecordOffset() const     {return mRecordOffset;}
+
 	static void updateDebugSettings();
 	static F32  getSquaredPixelThreshold(bool is_front);
 
 private:
 	void updateParentBoundingInfo(const LLVOCacheEntry* child);	
+	void loadData();
 
 public:
 	typedef std::map<U32, LLPointer<LLVOCacheEntry> >	   vocache_entry_map_t;
@@ -155,6 +167,9 @@ protected:
 	S32							mCRCChangeCount;
 	LLDataPackerBinaryBuffer	mDP;
 	U8							*mBuffer;
+	LLPointer<LLVOCacheFile>	mFile; //holds the data until it is first needed
+	U32							mRecordOffset;
+	bool						mDirty;
 
 	F32                         mSceneContrib; //projected scene contributuion of this object.
 	U32                         mState; //high 16 bits reserved for special use.
@@ -193,6 +208,8 @@ public:
 	bool addEntry(LLViewerOctreeEntry* entry);
 	void removeEntry(LLViewerOctreeEntry* entry);
 	/*virtual*/ S32 cull(LLCamera &camera, bool do_occlusion);
+	/*virtual*/ LLViewerOctreeCull* beginCull(LLCamera& camera, bool do_occlusion);
+	/*virtual*/ void endCull();
 	void addOccluders(LLViewerOctreeGroup* gp);
 	void resetOccluders();
 	void processOccluders(LLCamera* camera);
@@ -219,7 +236,8 @@ private:
 };
 
 //
-//Note: LLVOCache is not thread-safe
+//Note: LLVOCache is not thread-safe, it is used from the main thread only.
+//Region files are read and written on its cache thread.
 //
 class LLVOCache : public LLSingleton<LLVOCache>
 {
@@ -253,6 +271,23 @@ private:
 	};
 	typedef std::set<HeaderEntryInfo*, header_entry_less> header_entry_queue_t;
 	typedef std::map<U64, HeaderEntryInfo*> handle_entry_map_t;
+	typedef std::map<U64, LLPointer<LLVOCacheFile> > region_file_map_t;
+
+	struct PendingRead
+	{
+		enum EState
+		{
+			PREFETCH,	//nobody asked for it yet
+			WANTED,		//the region waits for it
+			RELEASED	//the region went away first
+		};
+
+		LLQueuedThread::handle_t mRequest;
+		LLUUID mID;
+		EState mState;
+	};
+	typedef std::map<U64, PendingRead> pending_read_map_t;
+	typedef std::vector<std::pair<LLQueuedThread::handle_t, U64> > pending_write_list_t;
 private:
     friend class LLSingleton<LLVOCache>;
 	LLVOCache() ;
@@ -263,12 +298,21 @@ public:
 	void initCache(ELLPath location, U32 size, U32 cache_version) ;
 	void removeCache(ELLPath location, bool started = false) ;
 
-	void readFromCache(U64 handle, const LLUUID& id, LLVOCacheEntry::vocache_entry_map_t& cache_entry_map) ;
+	//start loading the region cache, LLViewerRegion::objectCacheLoaded() gets the entries.
+	//false if there is nothing to load.
+	bool readFromCache(U64 handle, const LLUUID& id) ;
+	//read the region file ahead of the region asking for it
+	void prefetch(U64 handle) ;
+	//the region won't ask for or write back its cache
+	void releaseRegion(U64 handle) ;
 	void writeToCache(U64 handle, const LLUUID& id, const LLVOCacheEntry::vocache_entry_map_t& cache_entry_map, BOOL dirty_cache, bool removal_enabled);
 	void removeEntry(U64 handle) ;
 
 	void setReadOnly(bool read_only) {mReadOnly = read_only;} 
 
+	//deliver the loaded region caches, once per frame
+	void update();
+
 private:
 	void setDirNames(ELLPath location);	
 	// determine the cache filename for the region from the region handle	
@@ -281,6 +325,8 @@ private:
 	void removeEntry(HeaderEntryInfo* entry) ;
 	void purgeEntries(U32 size);
 	BOOL updateEntry(const HeaderEntryInfo* entry);
+	void deliver(U64 handle, const LLUUID& id, LLVOCacheFile* file);
+	void waitOnPending();
 	
 private:
 	bool                 mEnabled;
@@ -294,6 +340,10 @@ private:
 	LLVolatileAPRPool*   mLocalAPRFilePoolp ; 	
 	header_entry_queue_t mHeaderEntryQueue;
 	handle_entry_map_t   mHandleEntryMap;	
+	region_file_map_t    mRegionFiles; //files of the regions read and not yet written back
+	LLVOCacheThread*     mThread;
+	pending_read_map_t   mPendingReads;
+	pending_write_list_t mPendingWrites;
 };
 
 #endif
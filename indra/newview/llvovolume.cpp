@@ -67,10 +67,13 @@
 #include "pipeline.h"
 #include "llsdutil.h"
 #include "llmatrix4a.h"
+#include "llskinning.h"
 #include "llmediaentry.h"
 #include "llmediadataclient.h"
 #include "llmeshrepository.h"
 #include "llagent.h"
+#include "llappviewer.h"
+#include "llthreadpool.h"
 #include "llviewermediafocus.h"
 #include "lldatapacker.h"
 #include "llviewershadermgr.h"
@@ -4009,6 +4012,85 @@ void LLVOVolume::updateRiggedVolume(bool force_update)
 static LLTrace::BlockTimerStatHandle FTM_SKIN_RIGGED("Skin");
 static LLTrace::BlockTimerStatHandle FTM_RIGGED_OCTREE("Octree");
 
+// Below this many vertices in a volume skinning it is quicker than handing
+// its faces to the thread pool
+static const S32 MIN_PARALLEL_SKIN_VERTICES = 8192;
+
+class LLRiggedVolumeSkinner : public LLThreadPool::RangeTask
+{
+public:
+	LLRiggedVolumeSkinner(LLRiggedVolume* rigged, const LLVolume* volume, const LLMatrix4a* palette, S32 palette_size)
+	:	mRigged(rigged),
+		mVolume(volume),
+		mPalette(palette),
+		mPaletteSize(palette_size)
+	{
+	}
+
+	S32 getVertexCount() const
+	{
+		S32 count = 0;
+		for (S32 i = 0; i < mVolume->getNumVolumeFaces(); ++i)
+		{
+			count += mVolume->getVolumeFace(i).mNumVertices;
+		}
+		return count;
+	}
+
+	/*virtual*/ void run(S32 begin, S32 end)
+	{
+		for (S32 i = begin; i < end; ++i)
+		{
+			mRigged->skinFace(i, mVolume, mPalette, mPaletteSize);
+		}
+	}
+
+private:
+	LLRiggedVolume* mRigged;
+	const LLVolume* mVolume;
+	const LLMatrix4a* mPalette;
+	S32 mPaletteSize;
+};
+
+void LLRiggedVolume::skinFace(S32 f, const LLVolume* src_volume, const LLMatrix4a* palette, S32 palette_size)
+{
+	const LLVolumeFace& vol_face = src_volume->getVolumeFace(f);
+	LLVolumeFace& dst_face = mVolumeFaces[f];
+
+	LLVector4a* weight = vol_face.mWeights;
+	LLVector4a* pos = dst_face.mPositions;
+
+	if (!weight || !pos || !dst_face.mExtents || !dst_face.mNumVertices)
+	{
+		return;
+	}
+
+	if (palette_size <= 0)
+	{
+		// skinVertices() writes nothing, keep the extents of the last skinning
+		return;
+	}
+
+	LLSkinning::skinVertices(palette, palette_size, weight, vol_face.mPositions, NULL,
+							 dst_face.mNumVertices, pos, NULL);
+
+	//update bounding box
+	LLVector4a& min = dst_face.mExtents[0];
+	LLVector4a& max = dst_face.mExtents[1];
+
+	min = pos[0];
+	max = pos[0];
+
+	for (U32 j = 1; j < dst_face.mNumVertices; ++j)
+	{
+		min.setMin(min, pos[j]);
+		max.setMax(max, pos[j]);
+	}
+
+	dst_face.mCenter->setAdd(dst_face.mExtents[0], dst_face.mExtents[1]);
+	dst_face.mCenter->mul(0.5f);
+}
+
 void LLRiggedVolume::update(const LLMeshSkinInfo* skin, LLVOAvatar* avatar, const LLVolume* volume)
 {
 	bool copy = false;
@@ -4041,16 +4123,28 @@ void LLRiggedVolume::update(const LLMeshSkinInfo* skin, LLVOAvatar* avatar, cons
 	// </FS:Ansariel>
 
 	LLMatrix4a mp[kMaxJoints];
-	LLMatrix4* mat = (LLMatrix4*) mp;
+	const LLMatrix4* joint_matrices[kMaxJoints];
 	
 	U32 maxJoints = llmin(skin->mJointNames.size(), kMaxJoints);
 	for (U32 j = 0; j < maxJoints; ++j)
 	{
 		LLJoint* joint = avatar->getJoint(skin->mJointNames[j]);
-		if (joint)
+		joint_matrices[j] = joint ? &joint->getWorldMatrix() : NULL;
+	}
+
+	S32 palette_size = LLSkinning::buildPalette(*skin, joint_matrices, maxJoints, mp);
+
+	{
+		LL_RECORD_BLOCK_TIME(FTM_SKIN_RIGGED);
+		LLRiggedVolumeSkinner skinner(this, volume, mp, palette_size);
+		LLThreadPool* pool = LLAppViewer::getThreadPool();
+		if (pool && volume->getNumVolumeFaces() > 1 && skinner.getVertexCount() >= MIN_PARALLEL_SKIN_VERTICES)
 		{
-			mat[j] = skin->mInvBindMatrix[j];
-			mat[j] *= joint->getWorldMatrix();
+			pool->parallelFor(volume->getNumVolumeFaces(), 1, skinner);
+		}
+		else
+		{
+			skinner.run(0, volume->getNumVolumeFaces());
 		}
 	}
 
@@ -4064,75 +4158,6 @@ void LLRiggedVolume::update(const LLMeshSkinInfo* skin, LLVOAvatar* avatar, cons
 
 		if ( weight )
 		{
-			LLMatrix4a bind_shape_matrix;
-			bind_shape_matrix.loadu(skin->mBindShapeMatrix);
-
-			LLVector4a* pos = dst_face.mPositions;
-
-			if( pos && weight && dst_face.mExtents )
-			{
-				LL_RECORD_BLOCK_TIME(FTM_SKIN_RIGGED);
-
-				for (U32 j = 0; j < dst_face.mNumVertices; ++j)
-				{
-					LLMatrix4a final_mat;
-					final_mat.clear();
-
-					S32 idx[4];
-
-					LLVector4 wght;
-
-					F32 scale = 0.f;
-					for (U32 k = 0; k < 4; k++)
-					{
-						F32 w = weight[j][k];
-
-						idx[k] = (S32) floorf(w);
-						wght[k] = w - floorf(w);
-						scale += wght[k];
-					}
-
-					wght *= 1.f/scale;
-
-					for (U32 k = 0; k < 4; k++)
-					{
-						F32 w = wght[k];
-
-						LLMatrix4a src;
-						// Insure ref'd bone is in our clamped array of mats
-						llassert(idx[k] < kMaxJoints);
-						// clamp k to kMaxJoints to avoid reading garbage off stack in release
-						src.setMul(mp[idx[(k < kMaxJoints) ? k : 0]], w);
-						final_mat.add(src);
-					}
-
-				
-					LLVector4a& v = vol_face.mPositions[j];
-					LLVector4a t;
-					LLVector4a dst;
-					bind_shape_matrix.affineTransform(v, t);
-					final_mat.affineTransform(t, dst);
-					pos[j] = dst;
-				}
-
-				//update bounding box
-				LLVector4a& min = dst_face.mExtents[0];
-				LLVector4a& max = dst_face.mExtents[1];
-
-				min = pos[0];
-				max = pos[1];
-
-				for (U32 j = 1; j < dst_face.mNumVertices; ++j)
-				{
-					min.setMin(min, pos[j]);
-					max.setMax(max, pos[j]);
-				}
-
-				dst_face.mCenter->setAdd(dst_face.mExtents[0], dst_face.mExtents[1]);
-				dst_face.mCenter->mul(0.5f);
-
-			}
-
 		// <FS:ND> Crashfix if mExtents is 0
 		if( dst_face.mExtents )
 		// </FS:ND>
@@ -4464,6 +4489,214 @@ void LLVolumeGeometryManager::getGeometry(LLSpatialGroup* group)
 static LLTrace::BlockTimerStatHandle FTM_REBUILD_VOLUME_VB("Volume VB");
 static LLTrace::BlockTimerStatHandle FTM_REBUILD_VOLUME_FACE_LIST("Build Face List");
 static LLTrace::BlockTimerStatHandle FTM_REBUILD_VOLUME_GEN_DRAW_INFO("Gen Draw Info");
+static LLTrace::BlockTimerStatHandle FTM_REBUILD_VOLUME_FACE_GEOM("Face Geometry");
+static LLTrace::BlockTimerStatHandle FTM_REBUILD_VOLUME_UPLOAD("Upload Face Geometry");
+
+// Collects the faces genDrawInfo() would copy into their vertex buffers so
+// rebuildGeom() can run LLFace::getGeometryVolume() for all of them at once,
+// on the thread pool when there are enough.  The faces write to staging
+// memory there and only the copy into the mapped buffers is left for the
+// main thread.
+class LLFaceGeometryBuilder : public LLThreadPool::RangeTask
+{
+public:
+	LLFaceGeometryBuilder();
+	~LLFaceGeometryBuilder();
+
+	void begin();
+	// Returns false if the face has to be built right away
+	bool add(LLFace* face, const LLMatrix4& mat_vert, const LLMatrix3& mat_norm);
+	void build();
+
+	/*virtual*/ void run(S32 begin, S32 end);
+
+private:
+	struct Job
+	{
+		LLFace* mFace;
+		LLMatrix4 mMatVert;
+		LLMatrix3 mMatNorm;
+		LLFaceGeometryStaging mStaging;
+		BOOL mResult;
+	};
+
+	static BOOL buildFace(Job& job);
+	void buildParallel();
+
+private:
+	std::vector<Job> mJobs;
+	S32 mFirstJob;	// run() indices start here
+	U8* mStagingData;
+	U32 mStagingSize;
+	bool mActive;
+};
+
+static LLFaceGeometryBuilder sFaceGeometryBuilder;
+
+// Below this many faces handing them to the pool costs more than it saves
+static const S32 MIN_PARALLEL_FACES = 32;
+static const S32 FACES_PER_CHUNK = 8;
+
+LLFaceGeometryBuilder::LLFaceGeometryBuilder()
+:	mFirstJob(0),
+	mStagingData(NULL),
+	mStagingSize(0),
+	mActive(false)
+{
+}
+
+LLFaceGeometryBuilder::~LLFaceGeometryBuilder()
+{
+	ll_aligned_free_16(mStagingData);
+}
+
+void LLFaceGeometryBuilder::begin()
+{
+	static LLCachedControl<bool> parallel_build(gSavedSettings, "FSParallelGeometryBuild");
+	mActive = parallel_build && !LLPipeline::sDelayVBUpdate;
+	mJobs.clear();
+}
+
+bool LLFaceGeometryBuilder::add(LLFace* face, const LLMatrix4& mat_vert, const LLMatrix3& mat_norm)
+{
+	if (!mActive || face->getVertexBuffer()->getUsage() == GL_DYNAMIC_COPY_ARB)
+	{ //transform feedback writes those on the GPU
+		return false;
+	}
+
+	// getGeometryVolume() drops TEXTURE_ANIM from faces whose object stopped
+	// animating its texture.  registerFace() reads the flag before build()
+	// runs, so drop it here, where the face is still built in order.
+	LLVOVolume* vobj = face->getDrawable()->getVOVolume();
+	if (face->isState(LLFace::TEXTURE_ANIM) && vobj && !vobj->mTexAnimMode)
+	{
+		face->clearState(LLFace::TEXTURE_ANIM);
+	}
+
+	mJobs.push_back(Job());
+	Job& job = mJobs.back();
+	job.mFace = face;
+	job.mMatVert = mat_vert;
+	job.mMatNorm = mat_norm;
+	job.mResult = FALSE;
+	return true;
+}
+
+//static
+BOOL LLFaceGeometryBuilder::buildFace(Job& job)
+{
+	LLFace* face = job.mFace;
+	LLVOVolume* vobj = face->getDrawable()->getVOVolume();
+	return face->getGeometryVolume(*vobj->getVolume(), face->getTEOffset(),
+		job.mMatVert, job.mMatNorm, face->getGeomIndex(), true);
+}
+
+void LLFaceGeometryBuilder::run(S32 begin, S32 end)
+{
+	for (S32 i = begin + mFirstJob; i < end + mFirstJob; ++i)
+	{
+		mJobs[i].mResult = buildFace(mJobs[i]);
+	}
+}
+
+void LLFaceGeometryBuilder::build()
+{
+	if (!mActive)
+	{
+		return;
+	}
+	mActive = false;
+
+	LLThreadPool* pool = LLAppViewer::getThreadPool();
+	if (pool && (S32)mJobs.size() >= MIN_PARALLEL_FACES)
+	{
+		buildParallel();
+	}
+	else
+	{
+		LL_RECORD_BLOCK_TIME(FTM_REBUILD_VOLUME_FACE_GEOM);
+		for (std::vector<Job>::iterator iter = mJobs.begin(); iter != mJobs.end(); ++iter)
+		{
+			if (!buildFace(*iter))
+			{
+				LL_WARNS() << "Failed to get geometry for face!" << LL_ENDL;
+			}
+		}
+	}
+
+	mJobs.clear();
+}
+
+void LLFaceGeometryBuilder::buildParallel()
+{
+	U32 size = 0;
+	for (std::vector<Job>::iterator iter = mJobs.begin(); iter != mJobs.end(); ++iter)
+	{
+		LLFace* face = iter->mFace;
+		LLVolume* volume = face->getDrawable()->getVOVolume()->getVolume();
+		const LLTextureEntry* te = face->getTextureEntry();
+
+		// getGeometryVolume() generates tangents on demand, but objects share
+		// volumes and so could do it for the same face on two threads
+		if ((te && (te->getBumpmap() || te->getTexGen() != LLTextureEntry::TEX_GEN_DEFAULT))
+			|| face->getVertexBuffer()->hasDataType(LLVertexBuffer::TYPE_TANGENT))
+		{
+			volume->genTangents(face->getTEOffset());
+		}
+
+		size += LLFaceGeometryStaging::calcSize(face);
+	}
+
+	if (size > mStagingSize)
+	{
+		ll_aligned_free_16(mStagingData);
+		mStagingSize = size + size / 4;
+		mStagingData = (U8*) ll_aligned_malloc_16(mStagingSize);
+	}
+
+	U8* data = mStagingData;
+	for (std::vector<Job>::iterator iter = mJobs.begin(); iter != mJobs.end(); ++iter)
+	{
+		iter->mStaging.setup(iter->mFace, data);
+		data += LLFaceGeometryStaging::calcSize(iter->mFace);
+		iter->mFace->setGeometryStaging(&iter->mStaging);
+	}
+
+	{
+		LL_RECORD_BLOCK_TIME(FTM_REBUILD_VOLUME_FACE_GEOM);
+		// The first face is built here before the rest go to the pool, that
+		// way the settings getGeometryVolume() keeps in function statics are
+		// always set up on the main thread
+		mFirstJob = 0;
+		run(0, 1);
+		mFirstJob = 1;
+		LLAppViewer::getThreadPool()->parallelFor((S32)mJobs.size() - 1, FACES_PER_CHUNK, *this);
+		mFirstJob = 0;
+	}
+
+	LL_RECORD_BLOCK_TIME(FTM_REBUILD_VOLUME_UPLOAD);
+	for (std::vector<Job>::iterator iter = mJobs.begin(); iter != mJobs.end(); ++iter)
+	{
+		iter->mFace->setGeometryStaging(NULL);
+		if (iter->mResult)
+		{
+			iter->mStaging.upload(iter->mFace);
+		}
+		else
+		{
+			LL_WARNS() << "Failed to get geometry for face!" << LL_ENDL;
+		}
+	}
+
+	for (std::vector<Job>::iterator iter = mJobs.begin(); iter != mJobs.end(); ++iter)
+	{
+		LLVertexBuffer* buffer = iter->mFace->getVertexBuffer();
+		if (buffer->isLocked())
+		{
+			buffer->flush();
+		}
+	}
+}
 
 static LLDrawPoolAvatar* get_avatar_drawpool(LLViewerObject* vobj)
 {
@@ -4516,6 +4749,8 @@ void LLVolumeGeometryManager::rebuildGeom(LLSpatialGroup* group)
 
 	group->mBuilt = 1.f;
 	
+	sFaceGeometryBuilder.begin();
+
 	LLVOAvatar* pAvatarVO = NULL;
 
 	LLSpatialBridge* bridge = group->getSpatialPartition()->asBridge();
@@ -5154,6 +5389,8 @@ void LLVolumeGeometryManager::rebuildGeom(LLSpatialGroup* group)
 	genDrawInfo(group, spec_mask | LLVertexBuffer::MAP_TEXTURE_INDEX, spec_faces, spec_count, FALSE, FALSE);
 	genDrawInfo(group, normspec_mask | LLVertexBuffer::MAP_TEXTURE_INDEX, normspec_faces, normspec_count, FALSE, FALSE);
 
+	sFaceGeometryBuilder.build();
+
 	if (!LLPipeline::sDelayVBUpdate)
 	{
 		//drawables have been rebuilt, clear rebuild status
@@ -5656,7 +5893,8 @@ void LLVolumeGeometryManager::genDrawInfo(LLSpatialGroup* group, U32 mask, LLFac
 
 					llassert(!facep->isState(LLFace::RIGGED));
 
-					if (!facep->getGeometryVolume(*volume, te_idx, 
+					if (!sFaceGeometryBuilder.add(facep, vobj->getRelativeXform(), vobj->getRelativeXformInvTrans())
+						&& !facep->getGeometryVolume(*volume, te_idx, 
 						vobj->getRelativeXform(), vobj->getRelativeXformInvTrans(), index_offset,true))
 					{
 						LL_WARNS() << "Failed to get geometry for face!" << LL_ENDL;
@@ -62,6 +62,10 @@ public:
 	}
 
 	void update(const LLMeshSkinInfo* skin, LLVOAvatar* avatar, const LLVolume* src_volume);
+
+	// Skins the positions of face f of src_volume into the same face of
+	// this volume and updates its extents.  Faces can be done in parallel.
+	void skinFace(S32 f, const LLVolume* src_volume, const LLMatrix4a* palette, S32 palette_size);
 };
 
 // Base class for implementations of the volume - Primitive, Flexible Object, etc.
@@ -593,6 +593,12 @@ LLViewerRegion* LLWorld::addRegion(const U64 &region_handle, const LLHost &host,
 	mActiveRegionList.push_back(regionp);
 	mCulledRegionList.push_back(regionp);
 
+	// Start reading the object cache before the region handshake asks for it
+	if (LLVOCache::instanceExists())
+	{
+		LLVOCache::getInstance()->prefetch(region_handle);
+	}
+
 
 	// Find all the adjacent regions, and attach them.
 	// Generate handles for all of the adjacent regions, and attach them in the correct way.
@@ -674,6 +680,9 @@ void LLWorld::removeRegion(const LLHost &host)
 		LL_WARNS() << "Trying to remove region that doesn't exist!" << LL_ENDL;
 		return;
 	}
+
+	// Queued updates still get to the region cache before it is written out
+	gObjectList.flushObjectUpdates();
 	
 	if (regionp == gAgent.getRegion())
 	{
@@ -43,6 +43,7 @@
 #include "llui.h" 
 #include "llglheaders.h"
 #include "llrender.h"
+#include "llthreadpool.h"
 #include "llwindow.h"	// swapBuffers()
 
 // newview includes
@@ -2528,6 +2529,58 @@ BOOL LLPipeline::getVisibleExtents(LLCamera& camera, LLVector3& min, LLVector3&
 }
 
 static LLTrace::BlockTimerStatHandle FTM_CULL("Object Culling");
+static LLTrace::BlockTimerStatHandle FTM_CULL_RECORD("Frustum Checks");
+static LLTrace::BlockTimerStatHandle FTM_CULL_REPLAY("Cull Results");
+
+// The partition cullers of one updateCull(), recorded on the thread pool
+class LLCullRecorder : public LLThreadPool::RangeTask
+{
+public:
+	struct Job
+	{
+		LLViewerOctreePartition* mPartition;
+		LLViewerOctreeCull* mCuller;
+	};
+
+	void add(LLViewerOctreePartition* part, LLViewerOctreeCull* culler)
+	{
+		if (culler)
+		{
+			Job job = { part, culler };
+			mJobs.push_back(job);
+		}
+	}
+
+	/*virtual*/ void run(S32 begin, S32 end)
+	{
+		for (S32 i = begin; i < end; ++i)
+		{
+			mJobs[i].mCuller->record(mJobs[i].mPartition->mOctree);
+		}
+	}
+
+	std::vector<Job> mJobs;
+};
+
+// A region's own copy of the cull camera.  The user clip plane and region
+// planes the serial loop sets on the shared camera one region at a time
+// have to stay put while every region is culled at once.
+LL_ALIGN_PREFIX(16)
+class LLRegionCullCamera : public LLCamera
+{
+public:
+	void* operator new(size_t size)
+	{
+		return ll_aligned_malloc_16(size);
+	}
+
+	void operator delete(void* ptr)
+	{
+		ll_aligned_free_16(ptr);
+	}
+
+	LLRegionCullCamera(const LLCamera& camera) : LLCamera(camera) {}
+} LL_ALIGN_POSTFIX(16);
 
 void LLPipeline::updateCull(LLCamera& camera, LLCullResult& result, S32 water_clip, LLPlane* planep)
 {
@@ -2628,38 +2681,102 @@ void LLPipeline::updateCull(LLCamera& camera, LLCullResult& result, S32 water_cl
 		mCubeVB->setBuffer(LLVertexBuffer::MAP_VERTEX);
 	}
 	
-	for (LLWorld::region_list_t::const_iterator iter = LLWorld::getInstance()->getRegionList().begin(); 
-			iter != LLWorld::getInstance()->getRegionList().end(); ++iter)
+	static LLCachedControl<bool> parallel_cull(gSavedSettings, "FSParallelCull");
+	const LLWorld::region_list_t& regions = LLWorld::getInstance()->getRegionList();
+	LLThreadPool* pool = LLAppViewer::getThreadPool();
+	bool do_occlusion_cull = can_use_occlusion && use_occlusion && !gUseWireframe/* && !gViewerWindow->getProgressView()->getVisible()*/;
+
+	if (parallel_cull && pool && regions.size() > 1)
 	{
-		LLViewerRegion* region = *iter;
-		if (water_clip != 0)
+		// Every partition of every region is set up in the order of the loop
+		// below, their frustum checks run on the pool, then their results go
+		// through occlusion and into sCull on this thread, in that order again.
+		LLCullRecorder recorder;
+		std::vector<LLRegionCullCamera*> cameras;
+		for (LLWorld::region_list_t::const_iterator iter = regions.begin(); iter != regions.end(); ++iter)
+		{
+			LLViewerRegion* region = *iter;
+			LLRegionCullCamera* region_camera = new LLRegionCullCamera(camera);
+			cameras.push_back(region_camera);
+			if (water_clip != 0)
+			{
+				LLPlane plane(LLVector3(0,0, (F32) -water_clip), (F32) water_clip*region->getWaterHeight());
+				region_camera->setUserClipPlane(plane);
+			}
+			else
+			{
+				region_camera->disableUserClipPlane();
+			}
+
+			for (U32 i = 0; i < LLViewerRegion::NUM_PARTITIONS; i++)
+			{
+				LLSpatialPartition* part = region->getSpatialPartition(i);
+				if (part && hasRenderType(part->mDrawableType))
+				{
+					recorder.add(part, part->beginCull(*region_camera, false));
+				}
+			}
+
+			LLVOCachePartition* vo_part = region->getVOCachePartition();
+			if (vo_part)
+			{
+				recorder.add(vo_part, vo_part->beginCull(*region_camera, do_occlusion_cull));
+			}
+		}
+
 		{
-			LLPlane plane(LLVector3(0,0, (F32) -water_clip), (F32) water_clip*region->getWaterHeight());
-			camera.setUserClipPlane(plane);
+			LL_RECORD_BLOCK_TIME(FTM_CULL_RECORD);
+			pool->parallelFor((S32)recorder.mJobs.size(), 1, recorder);
 		}
-		else
+
 		{
-			camera.disableUserClipPlane();
+			LL_RECORD_BLOCK_TIME(FTM_CULL_REPLAY);
+			for (std::vector<LLCullRecorder::Job>::iterator iter = recorder.mJobs.begin(); iter != recorder.mJobs.end(); ++iter)
+			{
+				iter->mCuller->replay();
+				delete iter->mCuller;
+				iter->mPartition->endCull();
+			}
 		}
 
-		for (U32 i = 0; i < LLViewerRegion::NUM_PARTITIONS; i++)
+		for (std::vector<LLRegionCullCamera*>::iterator iter = cameras.begin(); iter != cameras.end(); ++iter)
 		{
-			LLSpatialPartition* part = region->getSpatialPartition(i);
-			if (part)
+			delete *iter;
+		}
+	}
+	else
+	{
+		for (LLWorld::region_list_t::const_iterator iter = regions.begin(); iter != regions.end(); ++iter)
+		{
+			LLViewerRegion* region = *iter;
+			if (water_clip != 0)
 			{
-				if (hasRenderType(part->mDrawableType))
+				LLPlane plane(LLVector3(0,0, (F32) -water_clip), (F32) water_clip*region->getWaterHeight());
+				camera.setUserClipPlane(plane);
+			}
+			else
+			{
+				camera.disableUserClipPlane();
+			}
+
+			for (U32 i = 0; i < LLViewerRegion::NUM_PARTITIONS; i++)
+			{
+				LLSpatialPartition* part = region->getSpatialPartition(i);
+				if (part)
 				{
-					part->cull(camera);
+					if (hasRenderType(part->mDrawableType))
+					{
+						part->cull(camera);
+					}
 				}
 			}
-		}
 
-		//scan the VO Cache tree
-		LLVOCachePartition* vo_part = region->getVOCachePartition();
-		if(vo_part)
-		{
-			bool do_occlusion_cull = can_use_occlusion && use_occlusion && !gUseWireframe/* && !gViewerWindow->getProgressView()->getVisible()*/;
-			vo_part->cull(camera, do_occlusion_cull);
+			//scan the VO Cache tree
+			LLVOCachePartition* vo_part = region->getVOCachePartition();
+			if(vo_part)
+			{
+				vo_part->cull(camera, do_occlusion_cull);
+			}
 		}
 	}
 
@@ -966,5 +966,57 @@ namespace tut
 		ensure_equals("Ensure unchanged buffer ", strlen(outBuffer), 0);
 		delete reader;
 	}
+
+	template<> template<>
+	void LLTemplateMessageBuilderTestObject::test<46>()
+		// index based reads agree with the name based getters
+	{
+		LLMessageTemplate messageTemplate = defaultTemplate();
+		LLMessageBlock* fixedBlock = new LLMessageBlock(_PREHASH_Test0, MBT_SINGLE);
+		fixedBlock->addVariable(const_cast<char*>(_PREHASH_Test0), MVT_U32, 4);
+		fixedBlock->addVariable(const_cast<char*>(_PREHASH_Test1), MVT_U16, 2);
+		messageTemplate.addBlock(fixedBlock);
+		LLMessageBlock* variableBlock = new LLMessageBlock(_PREHASH_Test1, MBT_VARIABLE);
+		variableBlock->addVariable(const_cast<char*>(_PREHASH_Test0), MVT_VARIABLE, 1);
+		variableBlock->addVariable(const_cast<char*>(_PREHASH_Test1), MVT_U32, 4);
+		messageTemplate.addBlock(variableBlock);
+
+		LLTemplateMessageBuilder* builder = defaultBuilder(messageTemplate);
+		builder->addU32(_PREHASH_Test0, 0x12345678);
+		builder->addU16(_PREHASH_Test1, 0xabcd);
+		builder->nextBlock(_PREHASH_Test1);
+		builder->addString(_PREHASH_Test0, "first");
+		builder->addU32(_PREHASH_Test1, 1);
+		builder->nextBlock(_PREHASH_Test1);
+		builder->addString(_PREHASH_Test0, "second one");
+		builder->addU32(_PREHASH_Test1, 2);
+		LLTemplateMessageReader* reader = setReader(messageTemplate, builder);
+
+		S32 fixedIndex = messageTemplate.getBlockIndex(_PREHASH_Test0);
+		S32 variableIndex = messageTemplate.getBlockIndex(_PREHASH_Test1);
+		ensure_equals("Ensure variable block repeats", reader->getNumberOfBlocks(variableIndex), 2);
+
+		S32 size = 0;
+		const U8* data = reader->getFieldData(fixedIndex, fixedBlock->getVariableIndex(_PREHASH_Test1), 0, size);
+		U16 outU16 = 0;
+		memcpy(&outU16, data, sizeof(outU16));
+		ensure_equals("Ensure fixed field size", size, 2);
+		ensure_equals("Ensure fixed field value", outU16, (U16)0xabcd);
+
+		data = reader->getFieldData(variableIndex, variableBlock->getVariableIndex(_PREHASH_Test0), 1, size);
+		ensure_equals("Ensure variable field size", size, 11);
+		ensure_equals("Ensure variable field value", std::string((const char*)data), std::string("second one"));
+		ensure("Ensure missing instance", reader->getFieldData(variableIndex, 0, 2, size) == NULL);
+
+		U32 outU32 = 0;
+		std::string outString;
+		reader->getU32(_PREHASH_Test0, _PREHASH_Test0, outU32);
+		ensure_equals("Ensure fixed getter", outU32, (U32)0x12345678);
+		reader->getU32(_PREHASH_Test1, _PREHASH_Test1, outU32, 1);
+		ensure_equals("Ensure repeated getter", outU32, (U32)2);
+		reader->getString(_PREHASH_Test1, _PREHASH_Test0, outString, 0);
+		ensure_equals("Ensure string getter", outString, std::string("first"));
+		delete reader;
+	}
 }
 
@@ -0,0 +1,46 @@
+/**
+ * @file   lltestrandom.h
+ * @date   2014-10
+ * @brief  LLTestRandom, a seeded random sequence for tests.
+ *
+ * $LicenseInfo:firstyear=2014&license=viewerlgpl$
+ * Copyright (c) 2014, Linden Research, Inc.
+ * $/LicenseInfo$
+ */
+
+#if ! defined(LL_LLTESTRANDOM_H)
+#define LL_LLTESTRANDOM_H
+
+/**
+ * The same seed gives the same sequence on every platform and run, so a
+ * test that fails on randomized input fails the same way when rerun.
+ */
+class LLTestRandom
+{
+public:
+	LLTestRandom(U32 seed) : mState(seed) {}
+
+	// In [0, range)
+	U32 next(U32 range)
+	{
+		return step() % range;
+	}
+
+	// In [low, high)
+	F32 next(F32 low, F32 high)
+	{
+		return low + (high - low) * (F32)step() / (F32)(1 << 24);
+	}
+
+private:
+	// 24 bits of a linear congruential generator, the low bits cycle too fast
+	U32 step()
+	{
+		mState = mState * 1664525 + 1013904223;
+		return mState >> 8;
+	}
+
+	U32 mState;
+};
+
+#endif /* ! defined(LL_LLTESTRANDOM_H) */